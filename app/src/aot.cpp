@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aot.h"
+#include "rom.h"
+
+// Translate a ROM to a C++ translation unit, see aot.h
+//
+// aot [--quirks modern|cosmac_vip|super_chip|xo_chip] [--name ns] rom out.cpp
+int main(int argc, char* argv[]) {
+    using namespace chipp8;
+
+    const char* profile = "modern";
+    const char* name = "aot_rom";
+    std::vector<const char*> paths;
+    for (auto k = 1; k < argc; ++k) {
+        const std::string_view arg(argv[k]);
+        if ((arg == "--quirks" || arg == "--name") && k + 1 < argc) {
+            (arg == "--quirks" ? profile : name) = argv[++k];
+        } else {
+            paths.push_back(argv[k]);
+        }
+    }
+    if (paths.size() != 2u || !aot::known_profile(profile)) {
+        fprintf(stderr, "usage: %s [--quirks modern|cosmac_vip|super_chip|xo_chip] [--name ns] rom out.cpp\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> bytes;
+    if (rom::read_file(paths[0], bytes) != rom::status::ok) {
+        fprintf(stderr, "%s: not a ROM that fits in 0x%X bytes\n", paths[0], static_cast<unsigned>(rom::max_size()));
+        return 1;
+    }
+
+    const auto program = aot::analyze(bytes.data(), bytes.size());
+    std::string source;
+    if (!aot::translate(program, name, profile, source)) {
+        fprintf(stderr, "%s: no instruction to compile at 0x%03X\n", paths[0], PROGRAM_START_ADDR);
+        return 1;
+    }
+
+    FILE* f = fopen(paths[1], "wb");
+    bool written = f && fwrite(source.data(), 1u, source.size(), f) == source.size();
+    if (f) {
+        written = fclose(f) == 0 && written;
+    }
+    if (!written) {
+        fprintf(stderr, "%s: could not be written\n", paths[1]);
+        return 1;
+    }
+
+    for (const auto addr: program.indirect) {
+        printf("%s: BNNN at 0x%03X is left to the interpreter\n", paths[0], addr);
+    }
+    printf("%s: %zu blocks, %zu bytes of C++\n", paths[0], program.blocks.size(), source.size());
+    return 0;
+}
@@ -1,29 +1,59 @@
+#include <stdio.h>
+#include <string_view>
+
 #include "chip8.h"
+#include "rom.h"
+#include "scheduler.h"
 #include "utils.h"
 
 int main(int argc, char* argv[]) {
     using namespace chipp8;
-    chip8 cpu;
-    init(cpu);
-    load_font_sprites(cpu);
 
-    cpu.v[1] = 2;
-    cpu.v[2] = 2;
-    cpu.i = 0x50;
-
-    DRW(cpu, 1, 2, 5);
+    // app [--turbo] [rom]
+    bool turbo = false;
+    const char* path = nullptr;
+    for (auto k = 1; k < argc; ++k) {
+        if (std::string_view(argv[k]) == "--turbo") {
+            turbo = true;
+        } else {
+            path = argv[k];
+        }
+    }
 
-    utils::pp_display(cpu.pixels, 64, 32);
+    chip8 cpu;
+    if (path) {
+        const auto s = rom::load_file(cpu, path);
+        if (s == rom::status::unreadable) {
+            fprintf(stderr, "%s: cannot be read\n", path);
+            return 1;
+        }
+        if (s != rom::status::ok) {
+            fprintf(stderr, "%s: not a ROM that fits in 0x%X bytes\n", path, static_cast<unsigned>(rom::max_size()));
+            return 1;
+        }
+    } else {
+        // Draw the font sprite for 0 at (2, 2) and spin on a self jump
+        constexpr uint8_t demo[] = {
+            0xA0u, 0x50u, // LD I, 0x50
+            0x61u, 0x02u, // LD v1, 2
+            0x62u, 0x02u, // LD v2, 2
+            0xD1u, 0x25u, // DRW v1, v2, 5
+            0x12u, 0x08u, // JP 208
+        };
+        load_program(cpu, demo, sizeof(demo));
+    }
 
-    // What is the clock rate?
-    // TODO: emulate a clock source
-    while (false /*true */) {
+    // 600 instructions per second against the 60 Hz timers, --turbo runs
+    // the same frames without waiting for the wall clock
+    timing::scheduler sched;
+    timing::init(sched, timing::DEFAULT_INSTRUCTIONS_PER_SECOND, turbo);
+    constexpr auto frames = 60u;
+    for (auto frame = 0u; frame < frames; ++frame) {
         // check for user input
-        // cpu get current instruction
-        // execute instruction
-        // increment pc
-        // draw display
+        timing::run_frame(sched, cpu);
     }
 
+    utils::pp_display(cpu.pixels, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
     return 0;
 }
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+// Print the records of a trace written by trace::run, see trace.h
+//
+// trace file.c8t [cycle [count]]
+int main(int argc, char* argv[]) {
+    using namespace chipp8;
+
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "usage: %s file.c8t [cycle [count]]\n", argv[0]);
+        return 2;
+    }
+
+    trace::reader r;
+    if (!trace::open(r, argv[1])) {
+        fprintf(stderr, "%s: not a trace\n", argv[1]);
+        return 1;
+    }
+
+    bool numbers = true;
+    auto number = [&](int k, unsigned long long fallback) {
+        if (k >= argc) {
+            return fallback;
+        }
+        char* end = nullptr;
+        const auto value = strtoull(argv[k], &end, 0);
+        numbers = numbers && end != argv[k] && *end == '\0';
+        return value;
+    };
+    const auto cycle = number(2, r.start_cycle);
+    const auto count = number(3, ~0ull);
+    if (!numbers) {
+        fprintf(stderr, "usage: %s file.c8t [cycle [count]]\n", argv[0]);
+        return 2;
+    }
+
+    if (!trace::dump(r, stdout, cycle, count)) {
+        fprintf(stderr, "%s: no cycle %llu in the trace\n", argv[1], cycle);
+        return 1;
+    }
+    return 0;
+}
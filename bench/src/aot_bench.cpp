@@ -0,0 +1,84 @@
+#include "bench.h"
+
+#include "block_cache.h"
+#include "chip8.h"
+#include "dispatch.h"
+#include "jit.h"
+
+using namespace chipp8;
+
+// alu.ch8 translated by the aot tool at build time, see bench/CMakeLists.txt
+namespace chipp8::aot_alu { void run(chip8& cpu, uint64_t cycles); }
+
+namespace bench {
+
+constexpr const uint64_t AOT_CYCLES = 20'000'000u;
+
+// Instructions per call at 600 Hz and 60 frames a second
+constexpr const uint64_t AOT_FRAME_CYCLES = 10u;
+
+// The ALU loop ahead of time against the interpreters and the recompiler,
+// in one call and then a frame at a time, where every call of the
+// translation first checks that its code is still in mem
+void run_aot_bench() {
+    chip8 cpu;
+    auto start = [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load_alu_loop(cpu);
+    };
+
+    const auto table_s = time_best(3u, [&] {
+        start();
+        dispatch::run(cpu, AOT_CYCLES);
+    });
+    const auto expected = cpu;
+    report("dispatch::run table", AOT_CYCLES, table_s, "instr");
+
+    cache::block_cache c;
+    const auto cache_s = time_best(3u, [&] {
+        start();
+        cache::init(c);
+        cache::run(c, cpu, AOT_CYCLES);
+    });
+    report("cache::run cached blocks", AOT_CYCLES, cache_s, "instr");
+
+    jit::code_cache j;
+    jit::init(j);
+    const auto jit_s = time_best(3u, [&] {
+        start();
+        jit::init(j);
+        jit::run(j, cpu, AOT_CYCLES);
+    });
+    report("jit::run recompiled", AOT_CYCLES, jit_s, "instr");
+
+    const auto aot_s = time_best(3u, [&] {
+        start();
+        aot_alu::run(cpu, AOT_CYCLES);
+    });
+    report("aot_alu::run ahead of time", AOT_CYCLES, aot_s, "instr");
+    if (!(cpu == expected)) {
+        printf("  mismatch: aot disagrees with dispatch\n");
+    }
+
+    const auto table_frames_s = time_best(3u, [&] {
+        start();
+        for (uint64_t c = 0u; c < AOT_CYCLES; c += AOT_FRAME_CYCLES) {
+            dispatch::run(cpu, AOT_FRAME_CYCLES);
+        }
+    });
+    report("dispatch::run, 10 per call", AOT_CYCLES, table_frames_s, "instr");
+
+    const auto aot_frames_s = time_best(3u, [&] {
+        start();
+        for (uint64_t c = 0u; c < AOT_CYCLES; c += AOT_FRAME_CYCLES) {
+            aot_alu::run(cpu, AOT_FRAME_CYCLES);
+        }
+    });
+    report("aot_alu::run, 10 per call", AOT_CYCLES, aot_frames_s, "instr");
+    if (!(cpu == expected)) {
+        printf("  mismatch: aot in slices disagrees with dispatch\n");
+    }
+}
+
+} // namespace bench
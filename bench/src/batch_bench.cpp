@@ -0,0 +1,72 @@
+#include "bench.h"
+
+#include <memory>
+#include <vector>
+
+#include "batch.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const size_t BATCH_LANES = 256u;
+constexpr const uint64_t BATCH_CYCLES = 100'000u;
+
+// `lanes` copies of the alu loop, optionally seeded apart so the SE in the
+// loop sends them down the draw path at different times
+static void batch_case(const char* name, bool seeded) {
+    std::vector<chip8> start(BATCH_LANES);
+    for (size_t l = 0u; l < BATCH_LANES; ++l) {
+        auto& cpu = start[l];
+        init(cpu);
+        load_font_sprites(cpu);
+        load_alu_loop(cpu);
+        if (seeded) {
+            // Past the two loads, straight into the loop body
+            cpu.pc = PROGRAM_START_ADDR + 4u;
+            cpu.v[0u] = static_cast<uint8_t>(l * 37u);
+            cpu.v[1u] = static_cast<uint8_t>(l * 11u + 1u);
+            cpu.v[2u] = static_cast<uint8_t>(l);
+        }
+    }
+    const double count = static_cast<double>(BATCH_LANES) * BATCH_CYCLES;
+    printf("  %s, %zu instances\n", name, BATCH_LANES);
+
+    std::vector<chip8> expected;
+    const auto single_s = time_best(3u, [&] {
+        expected = start;
+        for (auto& cpu: expected) {
+            dispatch::run(cpu, BATCH_CYCLES);
+        }
+    });
+    report("dispatch::run per instance", count, single_s, "instr");
+
+    auto b = std::make_unique<chip8_batch<BATCH_LANES>>();
+    batch::stats s{};
+    const auto batch_s = time_best(3u, [&] {
+        for (size_t l = 0u; l < BATCH_LANES; ++l) {
+            batch::load_lane(*b, l, start[l]);
+        }
+        s = batch::run(*b, BATCH_CYCLES);
+    });
+    report("batch::run lockstep", count, batch_s, "instr");
+    printf("  %-44s %10.2f lanes/step\n", "occupancy", static_cast<double>(s.instructions) / s.steps);
+
+    chip8 actual;
+    for (size_t l = 0u; l < BATCH_LANES; ++l) {
+        batch::store_lane(*b, l, actual);
+        if (!(actual == expected[l])) {
+            printf("  mismatch: lane %zu disagrees with dispatch\n", l);
+            break;
+        }
+    }
+}
+
+void run_batch_bench() {
+    batch_case("alu loop, identical", false);
+    batch_case("alu loop, seeded", true);
+}
+
+} // namespace bench
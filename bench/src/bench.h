@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <initializer_list>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "chip8.h"
+
+namespace bench {
+
+// Best wall time in seconds over `reps` calls of fn
+template <typename Fn>
+inline double time_best(unsigned reps, Fn&& fn) {
+    double best = 1e30;
+    for (auto r = 0u; r < reps; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+inline void report(const char* name, double count, double seconds, const char* unit) {
+    printf("  %-44s %10.2f M%s/s\n", name, count / seconds / 1e6, unit);
+}
+
+// Write big-endian instruction words to mem starting at PROGRAM_START_ADDR
+inline void load_words(chipp8::chip8& cpu, std::initializer_list<uint16_t> words) {
+    auto addr = chipp8::PROGRAM_START_ADDR;
+    for (const auto word: words) {
+        cpu.mem[addr++] = static_cast<uint8_t>(word >> 8u);
+        cpu.mem[addr++] = static_cast<uint8_t>(word & 0x00FFu);
+    }
+    cpu.pc = chipp8::PROGRAM_START_ADDR;
+}
+
+// ALU heavy loop with a skip, jumps and an occasional draw
+inline void load_alu_loop(chipp8::chip8& cpu) {
+    load_words(cpu, {
+        0x6000u, // 200: LD v0, 0
+        0x6101u, // 202: LD v1, 1
+        0x7001u, // 204: ADD v0, 1
+        0x8014u, // 206: ADD v0, v1
+        0x8102u, // 208: AND v1, v0
+        0x8203u, // 20A: XOR v2, v0
+        0x8306u, // 20C: SHR v3
+        0x3000u, // 20E: SE v0, 0
+        0x1204u, // 210: JP 204
+        0xA050u, // 212: LD I, 0x50
+        0xD125u, // 214: DRW v1, v2, 5
+        0x1204u, // 216: JP 204
+    });
+}
+
+// Mostly FX and EX group opcodes, which sit behind two levels of switch
+inline void load_fx_loop(chipp8::chip8& cpu) {
+    load_words(cpu, {
+        0xA300u, // 200: LD I, 0x300
+        0xF015u, // 202: LD DT, v0
+        0xF107u, // 204: LD v1, DT
+        0xF11Eu, // 206: ADD I, v1
+        0xF229u, // 208: LD F, v2
+        0xE39Eu, // 20A: SKP v3
+        0xF418u, // 20C: LD ST, v4
+        0x8124u, // 20E: ADD v1, v2
+        0xF265u, // 210: LD v0..v2, [I]
+        0x1200u, // 212: JP 200
+    });
+}
+
+void run_dispatch_bench();
+
+void run_drw_bench();
+
+void run_batch_bench();
+
+void run_fleet_bench();
+
+void run_idle_bench();
+
+void run_rewind_bench();
+
+void run_cow_bench();
+
+void run_replay_bench();
+
+void run_rng_bench();
+
+void run_hires_bench();
+
+void run_profile_bench();
+
+void run_trace_bench();
+
+void run_debug_bench();
+
+void run_keypad_bench();
+
+void run_terminal_bench();
+
+void run_capture_bench();
+
+void run_shm_bench();
+
+void run_blit_bench();
+
+void run_state_bench();
+
+void run_rom_bench();
+
+void run_aot_bench();
+
+} // namespace bench
@@ -0,0 +1,101 @@
+#include "bench.h"
+
+#include <bitset>
+#include <memory>
+#include <vector>
+
+#include "blit.h"
+#include "chip8.h"
+#include "hires.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t BLIT_FRAMES = 200u;
+constexpr const uint32_t ON = 0xFFFFFFFFu;
+constexpr const uint32_t OFF = 0xFF000000u;
+
+// Output megapixels a second, for the display at 1x, 10x and 20x: the
+// per pixel std::bitset loop a frontend starts with, the scalar reference
+// and blit::expand. Then frames a second redrawing two changed rows, and
+// megapixels for hires planes through a palette
+void run_blit_bench() {
+    display pixels;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (auto& row: pixels) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        row = state;
+    }
+    std::bitset<DISPLAY_WIDTH * DISPLAY_HEIGHT> bits;
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        for (auto x = 0u; x < DISPLAY_WIDTH; ++x) {
+            bits[y * DISPLAY_WIDTH + x] = (pixels[y] >> (63u - x)) & 1u;
+        }
+    }
+
+    char name[64];
+    for (const auto scale: {1u, 10u, 20u}) {
+        const size_t pitch = DISPLAY_WIDTH * scale;
+        const double frame_pixels = static_cast<double>(pitch) * DISPLAY_HEIGHT * scale;
+        std::vector<uint32_t> out(pitch * DISPLAY_HEIGHT * scale);
+
+        const auto naive_s = time_best(3u, [&] {
+            for (auto f = 0u; f < BLIT_FRAMES; ++f) {
+                for (size_t y = 0u; y < DISPLAY_HEIGHT * scale; ++y) {
+                    for (size_t x = 0u; x < pitch; ++x) {
+                        out[y * pitch + x] = bits[(y / scale) * DISPLAY_WIDTH + x / scale] ? ON : OFF;
+                    }
+                }
+            }
+        });
+        snprintf(name, sizeof(name), "std::bitset per pixel, %ux", scale);
+        report(name, BLIT_FRAMES * frame_pixels, naive_s, "pixel");
+
+        const auto scalar_s = time_best(3u, [&] {
+            for (auto f = 0u; f < BLIT_FRAMES; ++f) {
+                blit::expand_scalar(pixels, ON, OFF, scale, out.data(), pitch);
+            }
+        });
+        snprintf(name, sizeof(name), "blit::expand_scalar, %ux", scale);
+        report(name, BLIT_FRAMES * frame_pixels, scalar_s, "pixel");
+
+        const auto simd_s = time_best(3u, [&] {
+            for (auto f = 0u; f < BLIT_FRAMES; ++f) {
+                blit::expand(pixels, ON, OFF, scale, out.data(), pitch);
+            }
+        });
+        snprintf(name, sizeof(name), "blit::expand, %ux, %u lanes", scale, blit::LANES);
+        report(name, BLIT_FRAMES * frame_pixels, simd_s, "pixel");
+
+        const auto dirty_s = time_best(3u, [&] {
+            for (auto f = 0u; f < BLIT_FRAMES; ++f) {
+                blit::expand(pixels, ON, OFF, scale, out.data(), pitch, (1u << 5u) | (1u << 20u));
+            }
+        });
+        snprintf(name, sizeof(name), "blit::expand, %ux, 2 dirty rows", scale);
+        report(name, BLIT_FRAMES, dirty_s, "frame");
+    }
+
+    auto m = std::make_unique<hires::machine>();
+    hires::init(*m);
+    for (auto& p: m->planes) {
+        for (auto y = 0u; y < hires::HEIGHT; ++y) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            p.left[y] = state;
+            p.right[y] = ~state;
+        }
+    }
+    const blit::palette colours = {OFF, blit::rgba(255u, 0u, 0u), blit::rgba(0u, 255u, 0u), ON};
+    constexpr uint32_t scale = 10u;
+    constexpr size_t pitch = hires::WIDTH * scale;
+    std::vector<uint32_t> out(pitch * hires::HEIGHT * scale);
+    const auto planes_s = time_best(3u, [&] {
+        for (auto f = 0u; f < BLIT_FRAMES; ++f) {
+            blit::expand(*m, colours, scale, out.data(), pitch);
+        }
+    });
+    report("blit::expand, hires planes, 10x", BLIT_FRAMES * static_cast<double>(pitch) * hires::HEIGHT * scale, planes_s, "pixel");
+}
+
+} // namespace bench
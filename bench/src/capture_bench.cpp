@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include <filesystem>
+#include <string>
+
+#include "capture.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+// An hour at 60 frames a second, 10 instructions a frame
+constexpr const uint32_t CAPTURE_FRAMES = 60u * 60u * 60u;
+constexpr const uint64_t CAPTURE_FRAME_CYCLES = 10u;
+
+// A counter digit that moves on every half second
+static void load_clock(chip8& cpu) {
+    init(cpu);
+    load_font_sprites(cpu);
+    load_words(cpu, {
+        0x611Eu, // 200: LD v1, 30
+        0xF115u, // 202: LD DT, v1
+        0xF029u, // 204: LD F, v0
+        0xD225u, // 206: DRW v2, v2, 5
+        0xF307u, // 208: LD v3, DT
+        0x3300u, // 20A: SE v3, 0
+        0x1208u, // 20C: JP 208
+        0xD225u, // 20E: DRW v2, v2, 5
+        0x7001u, // 210: ADD v0, 1
+        0x640Fu, // 212: LD v4, 0x0F
+        0x8042u, // 214: AND v0, v4
+        0x7203u, // 216: ADD v2, 3
+        0x1200u, // 218: JP 200
+    });
+}
+
+static void run_session(chip8& cpu, capture::writer* w) {
+    for (auto f = 0u; f < CAPTURE_FRAMES; ++f) {
+        dispatch::run(cpu, CAPTURE_FRAME_CYCLES);
+        tick_timers(cpu);
+        if (w) {
+            capture::frame(*w, cpu.pixels);
+        }
+    }
+}
+
+// Real time, the worker has 16 ms a frame. Here the hour goes by in a
+// fraction of a second, so the ring is sized to hold every change and the
+// emulation thread never waits on the worker
+constexpr const uint32_t CAPTURE_RING_SLOTS = 16'384u;
+
+// An hour long session uncaptured, then captured in each format. The rate
+// is what the emulation thread spends, the worker catches up by close()
+void run_capture_bench() {
+    chip8 base;
+    load_clock(base);
+    chip8 cpu;
+    const auto plain_s = time_best(3u, [&] {
+        cpu = base;
+        run_session(cpu, nullptr);
+    });
+    report("an hour of frames, no capture", CAPTURE_FRAMES, plain_s, "frame");
+
+    const auto dir = std::filesystem::temp_directory_path() / "chipp8_capture_bench";
+    std::filesystem::create_directories(dir);
+    const struct {
+        capture::format kind;
+        const char* name;
+        const char* path;
+    } formats[] = {
+        {capture::format::anim, "capture::frame, anim", "session.c8a"},
+        {capture::format::pbm, "capture::frame, pbm", "frame_"},
+        {capture::format::y4m, "capture::frame, y4m", "session.y4m"},
+    };
+    for (const auto& f: formats) {
+        const auto path = (dir / f.path).string();
+        uint64_t distinct = 0u;
+        uint64_t stalls = 0u;
+        double emulation_s = 0.0;
+        const auto s = time_best(1u, [&] {
+            cpu = base;
+            capture::writer w;
+            capture::open(w, f.kind, path.c_str(), CAPTURE_RING_SLOTS);
+            const auto start = std::chrono::steady_clock::now();
+            run_session(cpu, &w);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            emulation_s = elapsed.count();
+            capture::close(w);
+            distinct = w.distinct;
+            stalls = w.stalls;
+        });
+        uintmax_t bytes = 0u;
+        for (const auto& file: std::filesystem::directory_iterator(dir)) {
+            bytes += file.file_size();
+        }
+        report(f.name, CAPTURE_FRAMES, emulation_s, "frame");
+        printf("  %-44s %10.0f KB, %llu distinct, %llu stalls, %.2fs to close\n", "", static_cast<double>(bytes) / 1024.0,
+            static_cast<unsigned long long>(distinct), static_cast<unsigned long long>(stalls), s - emulation_s);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace bench
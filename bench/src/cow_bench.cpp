@@ -0,0 +1,66 @@
+#include "bench.h"
+
+#include <memory>
+#include <vector>
+
+#include "chip8.h"
+#include "cow.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t COW_FORKS = 100'000u;
+// Instructions each branch runs, enough to hit the FX55 in the fx loop
+constexpr const uint64_t COW_BRANCH_CYCLES = 10u;
+
+// Fork one root COW_FORKS times and keep every branch alive, like the
+// frontier of a search
+void run_cow_bench() {
+    auto root_cpu = std::make_unique<chip8>();
+    init(*root_cpu);
+    load_font_sprites(*root_cpu);
+    load_fx_loop(*root_cpu);
+    // Turn the FX65 into an FX55, storing into the font page after LD F
+    root_cpu->mem[0x211u] = 0x55u;
+    cow::machine root;
+    cow::load(root, *root_cpu);
+    const double forks = COW_FORKS;
+
+    {
+        std::vector<chip8> frontier;
+        frontier.reserve(COW_FORKS);
+        const auto copy_s = time_best(3u, [&] {
+            frontier.clear();
+            for (auto k = 0u; k < COW_FORKS; ++k) {
+                frontier.push_back(*root_cpu);
+                dispatch::run(frontier.back(), COW_BRANCH_CYCLES);
+            }
+        });
+        report("chip8 copy + run", forks, copy_s, "fork");
+        printf("  %-44s %10zu bytes\n", "memory per fork", sizeof(chip8));
+    }
+
+    std::vector<cow::machine> frontier;
+    frontier.reserve(COW_FORKS);
+    const auto fork_s = time_best(3u, [&] {
+        frontier.clear();
+        for (auto k = 0u; k < COW_FORKS; ++k) {
+            frontier.push_back(cow::fork(root));
+            cow::run(frontier.back(), COW_BRANCH_CYCLES);
+        }
+    });
+    report("cow::fork + run", forks, fork_s, "fork");
+
+    size_t copied = 0u;
+    for (const auto& m: frontier) {
+        copied += cow::private_pages(m);
+    }
+    // Each private page is a make_shared block, the page plus its counts
+    const auto page_bytes = static_cast<double>(copied) * (sizeof(cow::page) + 16u) / COW_FORKS;
+    printf("  %-44s %10.0f bytes, %.2f pages copied\n", "memory per fork", sizeof(cow::machine) + page_bytes,
+           static_cast<double>(copied) / COW_FORKS);
+}
+
+} // namespace bench
@@ -0,0 +1,53 @@
+#include "bench.h"
+
+#include "chip8.h"
+#include "debug.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint64_t DEBUG_CYCLES = 20'000'000u;
+
+// The ALU loop under the debugger with nothing armed, with breakpoints
+// that never hit, and with watchpoints on top
+void run_debug_bench() {
+    chip8 base;
+    init(base);
+    load_font_sprites(base);
+    load_alu_loop(base);
+    debug::debugger dbg;
+    debug::init(dbg);
+
+    chip8 cpu;
+    const auto plain_s = time_best(3u, [&] {
+        cpu = base;
+        dispatch::run(cpu, DEBUG_CYCLES);
+    });
+    report("dispatch::run", DEBUG_CYCLES, plain_s, "inst");
+
+    const auto unarmed_s = time_best(3u, [&] {
+        cpu = base;
+        debug::run(dbg, cpu, DEBUG_CYCLES);
+    });
+    report("debug::run, unarmed", DEBUG_CYCLES, unarmed_s, "inst");
+
+    for (auto pc = 0x800u; pc < 0x810u; ++pc) {
+        debug::set_breakpoint(dbg, static_cast<uint16_t>(pc));
+    }
+    const auto breaks_s = time_best(3u, [&] {
+        cpu = base;
+        debug::run(dbg, cpu, DEBUG_CYCLES);
+    });
+    report("debug::run, 16 breakpoints", DEBUG_CYCLES, breaks_s, "inst");
+
+    debug::watch(dbg, 0x900u, 64u, true, true);
+    const auto watch_s = time_best(3u, [&] {
+        cpu = base;
+        debug::run(dbg, cpu, DEBUG_CYCLES);
+    });
+    report("debug::run, + 64 watched bytes", DEBUG_CYCLES, watch_s, "inst");
+}
+
+} // namespace bench
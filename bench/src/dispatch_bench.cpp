@@ -0,0 +1,83 @@
+#include "bench.h"
+
+#include "block_cache.h"
+#include "chip8.h"
+#include "dispatch.h"
+#include "jit.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint64_t DISPATCH_CYCLES = 20'000'000u;
+
+void compare(const char* name, void (*load)(chip8&)) {
+    chip8 cpu;
+
+    const auto switch_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load(cpu);
+        for (uint64_t c = 0u; c < DISPATCH_CYCLES; ++c) {
+            const auto instruct = fetch(cpu);
+            cpu.pc += 2u;
+            parse_op(cpu, instruct);
+        }
+    });
+    const auto expected = cpu;
+    printf("  %s\n", name);
+    report("parse_op switch", DISPATCH_CYCLES, switch_s, "instr");
+
+    const auto table_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load(cpu);
+        dispatch::run(cpu, DISPATCH_CYCLES);
+    });
+    report("dispatch::run table", DISPATCH_CYCLES, table_s, "instr");
+    if (!(cpu == expected)) {
+        printf("  mismatch: dispatch disagrees with parse_op\n");
+    }
+
+    // Another profile's table, the quirks cost nothing at run time
+    const auto vip_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load(cpu);
+        chip8_core<quirks::cosmac_vip>::run(cpu, DISPATCH_CYCLES);
+    });
+    report("chip8_core<cosmac_vip>::run table", DISPATCH_CYCLES, vip_s, "instr");
+
+    cache::block_cache c;
+    const auto cache_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load(cpu);
+        cache::init(c);
+        cache::run(c, cpu, DISPATCH_CYCLES);
+    });
+    report("cache::run cached blocks", DISPATCH_CYCLES, cache_s, "instr");
+    if (!(cpu == expected)) {
+        printf("  mismatch: the block cache disagrees with parse_op\n");
+    }
+
+    jit::code_cache j;
+    const auto jit_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load(cpu);
+        jit::init(j);
+        jit::run(j, cpu, DISPATCH_CYCLES);
+    });
+    report(CHIPP8_JIT_NATIVE ? "jit::run x86-64" : "jit::run (no native backend)", DISPATCH_CYCLES, jit_s, "instr");
+    if (!(cpu == expected)) {
+        printf("  mismatch: the recompiler disagrees with parse_op\n");
+    }
+}
+
+void run_dispatch_bench() {
+    compare("alu loop", load_alu_loop);
+    compare("fx loop", load_fx_loop);
+}
+
+} // namespace bench
@@ -0,0 +1,79 @@
+#include "bench.h"
+
+#include <bitset>
+
+#include "chip8.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const unsigned DRW_CALLS = 2'000'000u;
+
+// The per pixel kernel DRW used before the display moved to one word per
+// row, kept here as the baseline
+static void drw_bitset(std::bitset<64u * 32u>& pixels, chip8& cpu, uint8_t x, uint8_t y, uint8_t n) {
+    auto start_x = cpu.v[x];
+    auto start_y = cpu.v[y];
+    cpu.v[0xFu] = 0u;
+
+    constexpr auto bit_width = 8u;
+    std::bitset<bit_width> buf;
+    for (auto i = 0u; i < n; ++i) {
+        buf = cpu.mem[cpu.i + i];
+        const auto draw_y = ((start_y + i) % 32u);
+        for (auto j = 0u; j < bit_width; ++j) {
+            const auto draw_x = ((start_x + j) % 64u);
+            const bool sprite_pixel_active = buf[bit_width - j - 1u];
+            const auto draw_index = draw_x + (draw_y * 64u);
+            if (sprite_pixel_active && pixels[draw_index]) {
+                cpu.v[0xFu] = 1u;
+            }
+            pixels[draw_index] = (pixels[draw_index] != sprite_pixel_active);
+        }
+    }
+}
+
+void run_drw_bench() {
+    chip8 cpu;
+    init(cpu);
+    for (auto k = 0u; k < sprites::MAX_SPRITE_SIZE; ++k) {
+        cpu.mem[0x300u + k] = static_cast<uint8_t>(0xA5u ^ (k * 29u));
+    }
+    cpu.i = 0x300u;
+
+    struct position {
+        const char* name;
+        uint8_t x;
+        uint8_t y;
+    };
+    constexpr position positions[] = {
+        {"inside", 8u, 4u},
+        {"wrapping", 60u, 28u},
+    };
+
+    printf("  %-10s %3s %18s %18s\n", "position", "n", "bitset Mdraws/s", "rows Mdraws/s");
+    for (const auto& pos: positions) {
+        cpu.v[0u] = pos.x;
+        cpu.v[1u] = pos.y;
+        for (auto n = 1u; n <= sprites::MAX_SPRITE_SIZE; ++n) {
+            std::bitset<64u * 32u> old_pixels;
+            const auto old_s = time_best(3u, [&] {
+                for (auto c = 0u; c < DRW_CALLS; ++c) {
+                    drw_bitset(old_pixels, cpu, 0u, 1u, static_cast<uint8_t>(n));
+                }
+            });
+
+            cpu.pixels.fill(0u);
+            const auto new_s = time_best(3u, [&] {
+                for (auto c = 0u; c < DRW_CALLS; ++c) {
+                    DRW(cpu, 0u, 1u, static_cast<uint8_t>(n));
+                }
+            });
+
+            printf("  %-10s %3u %18.2f %18.2f\n", pos.name, n, DRW_CALLS / old_s / 1e6, DRW_CALLS / new_s / 1e6);
+        }
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,60 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "fleet.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t FLEET_SESSIONS = 96u;
+
+void run_fleet_bench() {
+    // The alu loop image, in sessions from 1x to 8x as long so the pool has
+    // to balance them
+    chip8 image;
+    init(image);
+    load_alu_loop(image);
+    const std::vector<uint8_t> rom(image.mem.begin() + PROGRAM_START_ADDR, image.mem.begin() + PROGRAM_START_ADDR + 24u);
+
+    std::vector<fleet::session> sessions;
+    uint64_t frames = 0u;
+    for (auto k = 0u; k < FLEET_SESSIONS; ++k) {
+        fleet::session s{rom, {{0u, 0u}, {100u, 0x0001u}}, 2000u * (1u + k % 8u)};
+        frames += s.frames;
+        sessions.push_back(s);
+    }
+
+    auto cfg = fleet::default_config();
+    cfg.cycles_per_frame = 200u;
+    const double instructions = static_cast<double>(frames) * cfg.cycles_per_frame;
+
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    printf("  %u sessions, %u hardware threads\n", FLEET_SESSIONS, hw);
+
+    // Powers of two, then every hardware thread
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1u; threads < hw; threads *= 2u) {
+        counts.push_back(threads);
+    }
+    counts.push_back(hw);
+
+    double single = 0.0;
+    for (const auto threads: counts) {
+        cfg.threads = threads;
+        const auto seconds = time_best(3u, [&] { fleet::run(sessions, cfg); });
+        if (threads == 1u) {
+            single = seconds;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "%u threads", threads);
+        report(name, instructions, seconds, "instr");
+        printf("  %-44s %10.2f sessions/s, %.2fx of 1 thread\n", "", FLEET_SESSIONS / seconds, single / seconds);
+    }
+}
+
+} // namespace bench
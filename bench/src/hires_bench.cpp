@@ -0,0 +1,92 @@
+#include "bench.h"
+
+#include <memory>
+
+#include "hires.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const unsigned HIRES_SCROLLS = 200'000u;
+constexpr const unsigned HIRES_DRAWS = 2'000'000u;
+
+// Scroll right by moving one pixel at a time, the baseline
+static void scroll_right_per_pixel(hires::plane& p, unsigned n) {
+    for (auto y = 0u; y < hires::HEIGHT; ++y) {
+        for (int x = hires::WIDTH - 1; x >= 0; --x) {
+            const int from = x - static_cast<int>(n);
+            bool on = false;
+            if (from >= 0) {
+                on = ((from < 64) ? (p.left[y] >> (63 - from)) : (p.right[y] >> (127 - from))) & 1u;
+            }
+            auto& word = (x < 64) ? p.left[y] : p.right[y];
+            const auto bit = 1ull << (63 - x % 64);
+            word = on ? (word | bit) : (word & ~bit);
+        }
+    }
+}
+
+void run_hires_bench() {
+    auto m = std::make_unique<hires::machine>();
+    hires::load_program(*m, nullptr, 0u);
+    m->hires = true;
+    m->plane_mask = 0x3u;
+    const double scrolls = HIRES_SCROLLS;
+
+    auto fill = [&] {
+        for (auto& p: m->planes) {
+            p.left.fill(0xA5A5A5A5A5A5A5A5ull);
+            p.right.fill(0x0F0F0F0F0F0F0F0Full);
+        }
+    };
+    printf("  128x64, both planes selected\n");
+
+    const auto pixel_s = time_best(3u, [&] {
+        fill();
+        for (auto k = 0u; k < HIRES_SCROLLS / 100u; ++k) {
+            hires::for_planes(*m, [](hires::plane& p) { scroll_right_per_pixel(p, 4u); });
+        }
+    });
+    report("00FB per pixel", scrolls / 100u, pixel_s, "scroll");
+
+    struct scroll_case {
+        const char* name;
+        uint16_t instruct;
+    };
+    const scroll_case cases[] = {
+        {"00FB scroll right", 0x00FBu},
+        {"00FC scroll left", 0x00FCu},
+        {"00C4 scroll down 4", 0x00C4u},
+        {"00D4 scroll up 4", 0x00D4u},
+    };
+    for (const auto& c: cases) {
+        const auto s = time_best(3u, [&] {
+            fill();
+            for (auto k = 0u; k < HIRES_SCROLLS; ++k) {
+                hires::execute_system(*m, c.instruct);
+            }
+        });
+        report(c.name, scrolls, s, "scroll");
+    }
+
+    // 16x16 sprites walking across the display, wrapping at the edges
+    for (auto k = 0u; k < 64u; ++k) {
+        m->mem[0x300u + k] = static_cast<uint8_t>(0x3Cu ^ (k * 37u));
+    }
+    m->i = 0x300u;
+    const double draws = HIRES_DRAWS;
+    for (const bool hi: {true, false}) {
+        const auto s = time_best(3u, [&] {
+            m->hires = hi;
+            for (auto k = 0u; k < HIRES_DRAWS; ++k) {
+                m->v[0u] = static_cast<uint8_t>(k * 7u);
+                m->v[1u] = static_cast<uint8_t>(k * 3u);
+                hires::DRW(*m, 0u, 1u, 0u);
+            }
+        });
+        report(hi ? "DXY0 16x16, hi-res, 2 planes" : "DXY0 16x16, lo-res doubled, 2 planes", draws, s, "draw");
+    }
+}
+
+} // namespace bench
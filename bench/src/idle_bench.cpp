@@ -0,0 +1,64 @@
+#include "bench.h"
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "idle.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t IDLE_FRAMES = 20'000u;
+constexpr const uint32_t IDLE_CYCLES_PER_FRAME = 1000u;
+
+// Draw, then wait out 4 frames on the delay timer, like most game loops
+static void load_delay_loop(chip8& cpu) {
+    load_words(cpu, {
+        0xA050u, // 200: LD I, 0x50
+        0xD015u, // 202: DRW v0, v1, 5
+        0x7001u, // 204: ADD v0, 1
+        0x6A04u, // 206: LD vA, 4
+        0xFA15u, // 208: LD DT, vA
+        0xFB07u, // 20A: LD vB, DT
+        0x3B00u, // 20C: SE vB, 0
+        0x120Au, // 20E: JP 20A
+        0x1200u, // 210: JP 200
+    });
+}
+
+void run_idle_bench() {
+    chip8 cpu;
+    const double frames = IDLE_FRAMES;
+    printf("  delay timer poll, %u instructions per frame\n", IDLE_CYCLES_PER_FRAME);
+
+    const auto plain_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load_delay_loop(cpu);
+        for (auto f = 0u; f < IDLE_FRAMES; ++f) {
+            dispatch::run(cpu, IDLE_CYCLES_PER_FRAME);
+            tick_timers(cpu);
+        }
+    });
+    const auto expected = cpu;
+    report("dispatch::run", frames, plain_s, "frame");
+
+    uint64_t skipped = 0u;
+    const auto idle_s = time_best(3u, [&] {
+        init(cpu);
+        load_font_sprites(cpu);
+        load_delay_loop(cpu);
+        skipped = 0u;
+        for (auto f = 0u; f < IDLE_FRAMES; ++f) {
+            skipped += idle::run(cpu, IDLE_CYCLES_PER_FRAME).skipped;
+            tick_timers(cpu);
+        }
+    });
+    report("idle::run", frames, idle_s, "frame");
+    printf("  %-44s %10.2f %%\n", "instructions skipped", 100.0 * skipped / (frames * IDLE_CYCLES_PER_FRAME));
+    if (!(cpu == expected)) {
+        printf("  mismatch: idle::run disagrees with dispatch\n");
+    }
+}
+
+} // namespace bench
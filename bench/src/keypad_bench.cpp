@@ -0,0 +1,69 @@
+#include "bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "chip8.h"
+#include "keypad.h"
+#include "scheduler.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t KEYPAD_EVENTS = 10'000'000u;
+constexpr const uint32_t KEYPAD_FRAMES = 60u;
+
+// Queue round trips on one thread, then a second of real time frames with
+// a frontend thread tapping keys at odd moments, for the latency
+void run_keypad_bench() {
+    keypad::event_queue q;
+    keypad::init(q);
+    keypad::event e{};
+    uint32_t sink = 0u;
+    const auto queue_s = time_best(3u, [&] {
+        for (auto k = 0u; k < KEYPAD_EVENTS; ++k) {
+            keypad::push(q, {keypad::steady::time_point{}, static_cast<uint8_t>(k), true});
+            keypad::peek(q, e);
+            keypad::pop(q);
+            sink += e.key;
+        }
+    });
+    report("keypad::push + pop", KEYPAD_EVENTS, queue_s, "event");
+
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+    load_words(cpu, {
+        0xE09Eu, // 200: SKP v0
+        0x1200u, // 202: JP 200
+        0x7001u, // 204: ADD v0, 1
+        0x1200u, // 206: JP 200
+    });
+    keypad::init(q);
+    timing::scheduler s;
+    timing::init(s, timing::DEFAULT_INSTRUCTIONS_PER_SECOND, false);
+    std::atomic<bool> stop{false};
+    std::thread frontend([&] {
+        for (auto k = 0u; !stop.load(std::memory_order_relaxed); ++k) {
+            keypad::push(q, static_cast<uint8_t>(k % 3u), (k & 1u) == 0u);
+            std::this_thread::sleep_for(std::chrono::microseconds(7'000u + (k * 2'473u) % 9'000u));
+        }
+    });
+    for (auto f = 0u; f < KEYPAD_FRAMES; ++f) {
+        timing::run_frame(s, cpu, q);
+    }
+    stop.store(true, std::memory_order_relaxed);
+    frontend.join();
+
+    const auto mean = std::chrono::duration<double, std::milli>(q.latency_total).count() / static_cast<double>(q.applied ? q.applied : 1u);
+    const auto worst = std::chrono::duration<double, std::milli>(q.latency_max).count();
+    printf("  %-44s %10.2f ms mean, %.2f ms max over %llu events\n", "input to end of frame", mean, worst,
+        static_cast<unsigned long long>(q.applied));
+    if (sink == 0u) {
+        printf("\n");
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,47 @@
+#include "bench.h"
+
+#include <string_view>
+
+struct entry {
+    const char* name;
+    void (*fn)();
+};
+
+constexpr entry BENCHMARKS[] = {
+    {"dispatch", bench::run_dispatch_bench},
+    {"drw", bench::run_drw_bench},
+    {"batch", bench::run_batch_bench},
+    {"fleet", bench::run_fleet_bench},
+    {"idle", bench::run_idle_bench},
+    {"rewind", bench::run_rewind_bench},
+    {"cow", bench::run_cow_bench},
+    {"replay", bench::run_replay_bench},
+    {"rng", bench::run_rng_bench},
+    {"hires", bench::run_hires_bench},
+    {"profile", bench::run_profile_bench},
+    {"trace", bench::run_trace_bench},
+    {"debug", bench::run_debug_bench},
+    {"keypad", bench::run_keypad_bench},
+    {"terminal", bench::run_terminal_bench},
+    {"capture", bench::run_capture_bench},
+    {"shm", bench::run_shm_bench},
+    {"blit", bench::run_blit_bench},
+    {"state", bench::run_state_bench},
+    {"rom", bench::run_rom_bench},
+    {"aot", bench::run_aot_bench},
+};
+
+// bench [name...]  - runs every benchmark, or only the named ones
+int main(int argc, char* argv[]) {
+    for (const auto& b: BENCHMARKS) {
+        bool selected = (argc < 2);
+        for (auto a = 1; a < argc; ++a) {
+            selected = selected || (std::string_view(argv[a]) == b.name);
+        }
+        if (selected) {
+            printf("%s\n", b.name);
+            b.fn();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "bench.h"
+
+#include <memory>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "profile.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint64_t PROFILE_CYCLES = 20'000'000u;
+
+// The ALU loop plain, through profile::run compiled out, and counting
+void run_profile_bench() {
+    chip8 base;
+    init(base);
+    load_font_sprites(base);
+    load_alu_loop(base);
+    auto c = std::make_unique<profile::counters>();
+    profile::reset(*c);
+
+    chip8 cpu;
+    const auto plain_s = time_best(3u, [&] {
+        cpu = base;
+        dispatch::run(cpu, PROFILE_CYCLES);
+    });
+    report("dispatch::run", PROFILE_CYCLES, plain_s, "inst");
+
+    const auto off_s = time_best(3u, [&] {
+        cpu = base;
+        profile::run<quirks::modern, false>(cpu, PROFILE_CYCLES, *c);
+    });
+    report("profile::run, disabled", PROFILE_CYCLES, off_s, "inst");
+
+    const auto on_s = time_best(3u, [&] {
+        cpu = base;
+        profile::run<quirks::modern, true>(cpu, PROFILE_CYCLES, *c);
+    });
+    report("profile::run, enabled", PROFILE_CYCLES, on_s, "inst");
+    if (profile::total(*c) == 0u) {
+        printf("\n");
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,69 @@
+#include "bench.h"
+
+#include "chip8.h"
+#include "replay.h"
+#include "scheduler.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+// 10 minutes at the default 600 Hz
+constexpr const uint32_t REPLAY_FRAMES = 10u * 60u * timing::TIMER_HZ;
+
+// Random digits at random spots, moved while their key is down, one every
+// 2 frames on the delay timer
+static void load_random_game(chip8& cpu) {
+    load_words(cpu, {
+        0xC03Fu, // 200: RND v0, 0x3F
+        0xC11Fu, // 202: RND v1, 0x1F
+        0xC20Fu, // 204: RND v2, 0x0F
+        0xE2A1u, // 206: SKNP v2
+        0x7004u, // 208: ADD v0, 4
+        0xF229u, // 20A: LD F, v2
+        0xD015u, // 20C: DRW v0, v1, 5
+        0x6A02u, // 20E: LD vA, 2
+        0xFA15u, // 210: LD DT, vA
+        0xFB07u, // 212: LD vB, DT
+        0x3B00u, // 214: SE vB, 0
+        0x1212u, // 216: JP 212
+        0x1200u, // 218: JP 200
+    });
+}
+
+void run_replay_bench() {
+    chip8 start;
+    init(start);
+    load_font_sprites(start);
+    load_random_game(start);
+
+    // A key goes down or up about every quarter second
+    chip8 cpu = start;
+    replay::recorder r;
+    timing::scheduler s;
+    replay::start(r, s, cpu, 2024u, timing::DEFAULT_INSTRUCTIONS_PER_SECOND, true);
+    for (auto f = 0u; f < REPLAY_FRAMES; ++f) {
+        if (f % 15u == 0u) {
+            replay::set_keys(r, s, cpu, static_cast<uint16_t>((f / 30u) % 2u ? 1u << ((f / 30u) % 16u) : 0u));
+        }
+        timing::run_frame(s, cpu);
+    }
+    const auto l = replay::finish(r, s, cpu);
+    const auto bytes = replay::encode(l);
+    printf("  10 minute session, %llu instructions, %llu key events\n",
+           static_cast<unsigned long long>(l.cycles), static_cast<unsigned long long>(l.event_count));
+    printf("  %-44s %10zu bytes\n", "log size", bytes.size());
+
+    bool ok = true;
+    const auto play_s = time_best(3u, [&] {
+        cpu = start;
+        ok &= replay::verify(l, cpu);
+    });
+    report("replay::verify", static_cast<double>(l.cycles), play_s, "instr");
+    printf("  %-44s %10.2f ms\n", "whole session", play_s * 1e3);
+    if (!ok) {
+        printf("  mismatch: the replay ended on another display\n");
+    }
+}
+
+} // namespace bench
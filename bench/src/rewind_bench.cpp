@@ -0,0 +1,67 @@
+#include "bench.h"
+
+#include <memory>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "rewind.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t REWIND_FRAMES = 200'000u;
+// 1000 Hz at 60 frames per second
+constexpr const uint64_t REWIND_CYCLES_PER_FRAME = 17u;
+// 10 seconds of history
+constexpr const size_t REWIND_HISTORY = 600u;
+
+void run_rewind_bench() {
+    auto cpu = std::make_unique<chip8>();
+    const double frames = REWIND_FRAMES;
+    printf("  alu loop, %llu instructions per frame, %zu frames of history\n",
+           static_cast<unsigned long long>(REWIND_CYCLES_PER_FRAME), REWIND_HISTORY);
+
+    const auto plain_s = time_best(3u, [&] {
+        init(*cpu);
+        load_font_sprites(*cpu);
+        load_alu_loop(*cpu);
+        for (auto f = 0u; f < REWIND_FRAMES; ++f) {
+            dispatch::run(*cpu, REWIND_CYCLES_PER_FRAME);
+            tick_timers(*cpu);
+        }
+    });
+    report("run", frames, plain_s, "frame");
+
+    auto h = std::make_unique<rewind::history>();
+    const auto record_s = time_best(3u, [&] {
+        init(*cpu);
+        load_font_sprites(*cpu);
+        load_alu_loop(*cpu);
+        rewind::init(*h, *cpu, REWIND_HISTORY, 4u << 20u);
+        for (auto f = 0u; f < REWIND_FRAMES; ++f) {
+            dispatch::run(*cpu, REWIND_CYCLES_PER_FRAME);
+            tick_timers(*cpu);
+            rewind::record(*h, *cpu);
+        }
+    });
+    report("run + record", frames, record_s, "frame");
+
+    const auto per_frame_s = (record_s - plain_s) / frames;
+    printf("  %-44s %10.2f ns, %.4f %% of a 60 Hz frame\n", "record cost per frame", per_frame_s * 1e9, per_frame_s * 60.0 * 100.0);
+
+    uint64_t bytes = 0u;
+    for (size_t k = 0u; k < h->count; ++k) {
+        bytes += h->records[(h->first + k) % h->records.size()].size;
+    }
+    printf("  %-44s %10.2f bytes, %zu frames kept\n", "history per frame", static_cast<double>(bytes) / h->count, h->count);
+
+    const auto kept = static_cast<double>(h->count);
+    const auto back_s = time_best(1u, [&] {
+        while (rewind::step_back(*h, *cpu)) {
+        }
+    });
+    report("step_back", kept, back_s, "frame");
+}
+
+} // namespace bench
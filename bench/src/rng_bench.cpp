@@ -0,0 +1,54 @@
+#include "bench.h"
+
+#include <vector>
+
+#include "chip8.h"
+#include "rng.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t RNG_LANES = 256u;
+constexpr const uint32_t RNG_ROUNDS = 4'000u;
+
+// One draw for each of RNG_LANES instances per round, one at a time
+// through the stream and in bulk like the batch engine
+void run_rng_bench() {
+    std::vector<rng::stream> streams(RNG_LANES);
+    std::vector<uint32_t> seed(RNG_LANES, DEFAULT_RNG_SEED);
+    std::vector<uint32_t> instance(RNG_LANES);
+    std::vector<uint32_t> count(RNG_LANES, 0u);
+    std::vector<uint8_t> out(RNG_LANES);
+    for (auto l = 0u; l < RNG_LANES; ++l) {
+        streams[l] = {DEFAULT_RNG_SEED, l, 0u};
+        instance[l] = l;
+    }
+    const double draws = static_cast<double>(RNG_LANES) * RNG_ROUNDS;
+
+    uint32_t sink = 0u;
+    const auto scalar_s = time_best(3u, [&] {
+        for (auto r = 0u; r < RNG_ROUNDS; ++r) {
+            for (auto& s: streams) {
+                sink += rng::next(s);
+            }
+        }
+    });
+    report("rng::next", draws, scalar_s, "byte");
+
+    const auto bulk_s = time_best(3u, [&] {
+        for (auto r = 0u; r < RNG_ROUNDS; ++r) {
+            rng::bytes(seed.data(), instance.data(), count.data(), out.data(), RNG_LANES);
+            for (auto l = 0u; l < RNG_LANES; ++l) {
+                ++count[l];
+            }
+            sink += out[r % RNG_LANES];
+        }
+    });
+    report("rng::bytes", draws, bulk_s, "byte");
+    if (sink == 0u) {
+        printf("\n");
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,77 @@
+#include "bench.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "rom.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t ROM_COUNT = 4'000u;
+
+// Starting a session for every ROM of a corpus: one file per ROM read with
+// rom::load_file, against one pack opened once with every ROM loaded from
+// the mapping. Files are warm in the page cache either way
+void run_rom_bench() {
+    const auto dir = std::filesystem::temp_directory_path() / "chipp8_rom_bench";
+    std::filesystem::create_directories(dir);
+    std::vector<rom::item> items;
+    std::vector<std::string> paths;
+    for (auto k = 0u; k < ROM_COUNT; ++k) {
+        rom::item i{"rom_" + std::to_string(k) + ".ch8", std::vector<uint8_t>(200u + (k * 37u) % 3'000u)};
+        for (size_t b = 0u; b < i.bytes.size(); ++b) {
+            i.bytes[b] = static_cast<uint8_t>(k * 31u + b);
+        }
+        paths.push_back((dir / i.name).string());
+        FILE* f = fopen(paths.back().c_str(), "wb");
+        if (!f) {
+            printf("  could not write %s\n", paths.back().c_str());
+            return;
+        }
+        fwrite(i.bytes.data(), 1u, i.bytes.size(), f);
+        fclose(f);
+        items.push_back(std::move(i));
+    }
+    const auto pack_path = (dir / "corpus.c8p").string();
+    rom::write(pack_path.c_str(), items);
+
+    chip8 cpu;
+    uint64_t sum = 0u;
+    const auto files_s = time_best(3u, [&] {
+        for (const auto& path: paths) {
+            rom::load_file(cpu, path.c_str());
+            sum += cpu.mem[PROGRAM_START_ADDR];
+        }
+    });
+    report("rom::load_file per ROM", ROM_COUNT, files_s, "rom");
+
+    const auto pack_s = time_best(3u, [&] {
+        rom::pack p;
+        rom::open(p, pack_path.c_str());
+        for (uint32_t k = 0u; k < p.count; ++k) {
+            rom::load(cpu, p, k);
+            sum += cpu.mem[PROGRAM_START_ADDR];
+        }
+        rom::close(p);
+    });
+    report("rom::open once, rom::load per ROM", ROM_COUNT, pack_s, "rom");
+
+    const auto find_s = time_best(3u, [&] {
+        rom::pack p;
+        rom::open(p, pack_path.c_str());
+        for (const auto& i: items) {
+            rom::load(cpu, p, i.name);
+            sum += cpu.mem[PROGRAM_START_ADDR];
+        }
+        rom::close(p);
+    });
+    report("rom::open once, rom::load by name", ROM_COUNT, find_s, "rom");
+    printf("  %-44s %10.2f ms vs %.2f ms for %u ROMs\n", "", pack_s * 1e3, files_s * 1e3, ROM_COUNT);
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace bench
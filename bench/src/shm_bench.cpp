@@ -0,0 +1,71 @@
+#include "bench.h"
+
+#include <atomic>
+#include <thread>
+
+#include "chip8.h"
+#include "shm.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t SHM_PUBLISHES = 10'000'000u;
+
+// publish() alone, read() alone, then publish() with a reader copying
+// frames as fast as it can from another thread, which is the worst a
+// renderer process can do to the emulation thread
+void run_shm_bench() {
+    shm::region r;
+    if (!shm::create(r, nullptr)) {
+        printf("  shm segment unavailable\n");
+        return;
+    }
+    chip8 cpu;
+    init(cpu);
+
+    const auto publish_s = time_best(3u, [&] {
+        for (auto k = 0u; k < SHM_PUBLISHES; ++k) {
+            cpu.pixels[k & 31u] = k;
+            shm::publish(*r.seg, cpu);
+        }
+    });
+    report("shm::publish", SHM_PUBLISHES, publish_s, "frame");
+
+    uint64_t sum = 0u;
+    const auto read_s = time_best(3u, [&] {
+        for (auto k = 0u; k < SHM_PUBLISHES; ++k) {
+            sum += shm::read(*r.seg).pixels[k & 31u];
+        }
+    });
+    report("shm::read", SHM_PUBLISHES, read_s, "frame");
+
+    std::atomic<bool> done{false};
+    uint64_t copies = 0u;
+    uint64_t retries = 0u;
+    std::thread reader([&] {
+        shm::snapshot snap;
+        while (!done.load(std::memory_order_relaxed)) {
+            if (shm::try_read(*r.seg, snap)) {
+                ++copies;
+                sum += snap.frame;
+            } else {
+                ++retries;
+            }
+        }
+    });
+    const auto contended_s = time_best(1u, [&] {
+        for (auto k = 0u; k < SHM_PUBLISHES; ++k) {
+            cpu.pixels[k & 31u] = k;
+            shm::publish(*r.seg, cpu);
+        }
+    });
+    done.store(true);
+    reader.join();
+    report("shm::publish, reader copying alongside", SHM_PUBLISHES, contended_s, "frame");
+    printf("  %-44s %10llu copies, %llu retries\n", "", static_cast<unsigned long long>(copies),
+        static_cast<unsigned long long>(retries));
+    shm::close(r);
+}
+
+} // namespace bench
@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include <filesystem>
+#include <vector>
+
+#include "chip8.h"
+#include "state.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t STATE_INSTANCES = 10'000u;
+
+// Warm starting a fleet from one snapshot file: map and check it once,
+// then restore every instance from the mapping. Loading from a buffer,
+// checksum included, for comparison
+void run_state_bench() {
+    const auto path = (std::filesystem::temp_directory_path() / "chipp8_state_bench.c8s").string();
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+    load_alu_loop(cpu);
+    if (!state::save(cpu, path.c_str())) {
+        printf("  could not write %s\n", path.c_str());
+        return;
+    }
+
+    std::vector<chip8> fleet(STATE_INSTANCES);
+    bool ok = true;
+    const auto warm_s = time_best(5u, [&] {
+        state::mapping m;
+        ok = state::map(m, path.c_str()) == state::status::ok;
+        for (auto& instance: fleet) {
+            state::restore(m.data, instance);
+        }
+        state::unmap(m);
+    });
+    report("map once, restore per instance", STATE_INSTANCES, warm_s, "instance");
+    printf("  %-44s %10.2f ms for %u instances%s\n", "", warm_s * 1e3, STATE_INSTANCES, ok ? "" : ", FAILED");
+
+    const auto data = state::encode(cpu);
+    const auto load_s = time_best(3u, [&] {
+        for (auto& instance: fleet) {
+            ok = ok && state::load(data.data(), data.size(), instance) == state::status::ok;
+        }
+    });
+    report("state::load per instance, checksummed", STATE_INSTANCES, load_s, "instance");
+    std::filesystem::remove(path);
+}
+
+} // namespace bench
@@ -0,0 +1,69 @@
+#include "bench.h"
+
+#include <bit>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "terminal.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint32_t TERMINAL_FRAMES = 20'000u;
+
+// A few sprites moving a row a frame, over frames built the way
+// utils::pp_display builds them and composed by the renderer
+void run_terminal_bench() {
+    std::vector<display> frames(64u);
+    for (auto f = 0u; f < frames.size(); ++f) {
+        frames[f].fill(0u);
+        for (auto s = 0u; s < 3u; ++s) {
+            const auto y = (f + s * 11u) % DISPLAY_HEIGHT;
+            for (auto row = 0u; row < 5u; ++row) {
+                frames[f][(y + row) % DISPLAY_HEIGHT] |= std::rotr(0xF0ull << 56u, s * 20u);
+            }
+        }
+    }
+
+    size_t bytes = 0u;
+    const auto full_s = time_best(3u, [&] {
+        bytes = 0u;
+        for (auto f = 0u; f < TERMINAL_FRAMES; ++f) {
+            const auto& disp = frames[f % frames.size()];
+            std::string buf;
+            buf += " ";
+            for (auto j = 0u; j < DISPLAY_WIDTH; ++j) {
+                buf += std::to_string((j % 10));
+            }
+            buf += "\n";
+            for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+                buf += std::to_string((y % 10));
+                for (auto x = 0u; x < DISPLAY_WIDTH; ++x) {
+                    buf += (((disp[y] >> (DISPLAY_WIDTH - 1u - x)) & 1u) ? "#" : " ");
+                }
+                buf += "\n";
+            }
+            bytes += buf.size();
+        }
+    });
+    report("pp_display string per frame", TERMINAL_FRAMES, full_s, "frame");
+    printf("  %-44s %10.0f bytes/frame\n", "", static_cast<double>(bytes) / TERMINAL_FRAMES);
+
+    for (const auto style: {terminal::mode::ascii, terminal::mode::half_blocks}) {
+        terminal::renderer r;
+        terminal::init(r, style, -1);
+        terminal::compose(r, frames[0u]);
+        const auto s = time_best(3u, [&] {
+            bytes = 0u;
+            for (auto f = 1u; f <= TERMINAL_FRAMES; ++f) {
+                bytes += terminal::compose(r, frames[f % frames.size()]);
+            }
+        });
+        report(style == terminal::mode::ascii ? "terminal::compose, ascii" : "terminal::compose, half blocks", TERMINAL_FRAMES, s, "frame");
+        printf("  %-44s %10.0f bytes/frame\n", "", static_cast<double>(bytes) / TERMINAL_FRAMES);
+    }
+}
+
+} // namespace bench
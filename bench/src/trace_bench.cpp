@@ -0,0 +1,97 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <time.h>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "trace.h"
+
+using namespace chipp8;
+
+namespace bench {
+
+constexpr const uint64_t TRACE_CYCLES = 20'000'000u;
+
+// CPU seconds of the calling thread, leaves out the flusher even when it
+// shares a core with the emulation thread
+static double thread_seconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+// The ALU loop untraced and traced to a temp file, close included, the
+// emulation thread's own share of that, then seeking and reading back
+void run_trace_bench() {
+    const auto path = (std::filesystem::temp_directory_path() / "chipp8_trace_bench.c8t").string();
+    chip8 base;
+    init(base);
+    load_font_sprites(base);
+    load_alu_loop(base);
+
+    chip8 cpu;
+    const auto plain_s = time_best(3u, [&] {
+        cpu = base;
+        dispatch::run(cpu, TRACE_CYCLES);
+    });
+    report("dispatch::run", TRACE_CYCLES, plain_s, "inst");
+
+    uint64_t stalls = 0u;
+    const auto traced_s = time_best(3u, [&] {
+        cpu = base;
+        trace::writer w;
+        trace::open(w, path.c_str());
+        trace::run(w, cpu, TRACE_CYCLES);
+        trace::close(w);
+        stalls = w.stalls;
+    });
+    report("trace::run", TRACE_CYCLES, traced_s, "inst");
+
+    // Wall time counts the flusher too when it shares a core with the
+    // emulation thread. CPU time of the calling thread alone, untraced and
+    // traced runs interleaved so that frequency drift hits both alike
+    double plain_cpu_s = 1e30;
+    double emulation_s = 1e30;
+    for (auto r = 0u; r < 9u; ++r) {
+        cpu = base;
+        auto start = thread_seconds();
+        dispatch::run(cpu, TRACE_CYCLES);
+        plain_cpu_s = std::min(plain_cpu_s, thread_seconds() - start);
+
+        cpu = base;
+        trace::writer w;
+        trace::open(w, path.c_str());
+        start = thread_seconds();
+        trace::run(w, cpu, TRACE_CYCLES);
+        emulation_s = std::min(emulation_s, thread_seconds() - start);
+    }
+    report("trace::run, emulation thread CPU time", TRACE_CYCLES, emulation_s, "inst");
+    printf("  %-44s %10.2f bytes/inst, %llu stalls, %.0f%% slower, emulation thread %.0f%% slower\n", "trace size",
+        static_cast<double>(std::filesystem::file_size(path)) / TRACE_CYCLES,
+        static_cast<unsigned long long>(stalls), (traced_s / plain_s - 1.0) * 100.0,
+        (emulation_s / plain_cpu_s - 1.0) * 100.0);
+
+    constexpr auto SEEKS = 1'000u;
+    trace::reader r;
+    trace::open(r, path.c_str());
+    trace::record rec;
+    const auto seek_s = time_best(3u, [&] {
+        for (auto k = 0u; k < SEEKS; ++k) {
+            trace::seek(r, (k * 7'919'993ull) % TRACE_CYCLES);
+            trace::next(r, rec);
+        }
+    });
+    report("trace::seek", SEEKS, seek_s, "seek");
+
+    const auto read_s = time_best(1u, [&] {
+        trace::seek(r, 0u);
+        while (trace::next(r, rec)) {
+        }
+    });
+    report("trace::next", TRACE_CYCLES, read_s, "record");
+    std::filesystem::remove(path);
+}
+
+} // namespace bench
@@ -0,0 +1,454 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <span>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "block_cache.h"
+#include "chip8.h"
+#include "dispatch.h"
+#include "quirks.h"
+
+/* Ahead-of-time recompiler
+
+   analyze() recovers the control flow graph of a ROM offline, starting at
+   its load address and following the targets of JP, SYS, CALL (and the
+   return address after it), the skips and WAIT_KP. Basic blocks end where
+   the cached interpreter ends them (see cache::ends_block) and also before
+   any address another instruction branches to.
+
+   translate() emits a C++ translation unit with a single
+   run(chip8&, uint64_t) holding every block as a label. Each instruction is
+   a call to its opcode function in chip8.h with the operands as constants,
+   and branches between known blocks are gotos, so the compiler sees the
+   whole program at once. The tool in app/src/aot.cpp does both from a ROM
+   file.
+
+   The generated run() executes exactly `cycles` instructions with the same
+   result as dispatch::run<Q>, falling back to the interpreter
+     - one instruction at a time wherever pc is not a compiled block, e.g.
+       after BNNN, whose target is only known at run time, or past the ROM
+     - for the rest of the call when fewer cycles are left than a block
+       holds
+     - for the rest of the call once FX33/FX55 changes the bytes of any
+       compiled instruction, and for the whole call when they are changed on
+       entry. Compiled code only ever runs on the exact bytes it came from
+*/
+
+namespace chipp8 {
+
+namespace aot {
+
+// Compiled instruction bytes, as they were in the ROM
+struct range {
+    uint16_t start;
+    uint16_t len;
+    const uint8_t* bytes;
+};
+
+// True if mem still holds every compiled instruction
+inline bool intact(const chip8& cpu, std::span<const range> code) {
+    for (const auto& r: code) {
+        if (std::memcmp(cpu.mem.data() + r.start, r.bytes, r.len) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if a write to [addr, addr + len) changed a compiled instruction,
+// writing back the same bytes does not count
+inline bool wrote_code(const chip8& cpu, uint16_t addr, uint16_t len, std::span<const range> code) {
+    for (const auto& r: code) {
+        const bool overlaps = static_cast<uint32_t>(addr) < r.start + r.len && r.start < static_cast<uint32_t>(addr) + len;
+        if (overlaps && std::memcmp(cpu.mem.data() + r.start, r.bytes, r.len) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// dispatch::step<Q>, returning false if the instruction changed compiled code
+template <typename Q = quirks::modern>
+inline bool step(chip8& cpu, std::span<const range> code) {
+    const auto& d = dispatch::DECODE_TABLE_FOR<Q>[fetch(cpu)];
+    const auto addr = cpu.i;
+    cpu.pc += 2u;
+    dispatch::execute(cpu, d);
+    switch (d.code) {
+        case dispatch::op::LD_BCD:
+            return !wrote_code(cpu, addr, 3u, code);
+        case dispatch::op::LD_I_V0X:
+            return !wrote_code(cpu, addr, static_cast<uint16_t>(d.x + 1u), code);
+        default:
+            return true;
+    }
+}
+
+struct block {
+    uint16_t start;
+    // Instructions
+    uint16_t len;
+};
+
+struct program {
+    // mem as load_program leaves it, minus the font
+    std::array<uint8_t, 4096u> image;
+    uint16_t start;
+    uint16_t end;
+
+    // Sorted by start
+    std::vector<block> blocks;
+    // Addresses of the BNNN instructions reached
+    std::vector<uint16_t> indirect;
+    std::bitset<4096u> leader;
+};
+
+// True if the whole instruction at addr lies in the ROM
+constexpr inline bool in_rom(const program& p, uint32_t addr) {
+    return addr >= p.start && addr + 2u <= p.end;
+}
+
+constexpr inline uint16_t word_at(const program& p, uint16_t addr) {
+    return static_cast<uint16_t>((p.image[addr] << 8u) | p.image[addr + 1u]);
+}
+
+// Only the part of a ROM that fits in mem from start is looked at, targets
+// outside the ROM are left to the interpreter
+inline program analyze(const uint8_t* rom, size_t size, uint16_t start = PROGRAM_START_ADDR) {
+    using dispatch::op;
+
+    program p;
+    p.image.fill(0u);
+    p.start = start;
+    p.end = start;
+    for (size_t k = 0u; k < size && start + k < p.image.size(); ++k) {
+        p.image[start + k] = rom[k];
+        ++p.end;
+    }
+
+    std::bitset<4096u> seen;
+    std::vector<uint16_t> work;
+    auto target = [&](uint32_t addr) {
+        if (in_rom(p, addr) && !p.leader[addr]) {
+            p.leader[addr] = true;
+            work.push_back(static_cast<uint16_t>(addr));
+        }
+    };
+    target(start);
+
+    while (!work.empty()) {
+        auto addr = work.back();
+        work.pop_back();
+        while (in_rom(p, addr) && !seen[addr]) {
+            seen[addr] = true;
+            const auto& d = dispatch::DECODE_TABLE[word_at(p, addr)];
+            const uint32_t next = addr + 2u;
+            if (!cache::ends_block(d.code)) {
+                addr = static_cast<uint16_t>(next);
+                continue;
+            }
+            switch (d.code) {
+                case op::SYS:
+                case op::JP: {
+                    target(d.nnn);
+                } break;
+
+                case op::CALL: {
+                    target(d.nnn);
+                    target(next);
+                } break;
+
+                case op::SE:
+                case op::SNE:
+                case op::SE_REG:
+                case op::SNE_REG:
+                case op::SKP:
+                case op::SKNP: {
+                    target(next);
+                    target(next + 2u);
+                } break;
+
+                case op::WAIT_KP: {
+                    target(addr);
+                    target(next);
+                } break;
+
+                case op::JP_V0: {
+                    p.indirect.push_back(addr);
+                } break;
+
+                case op::LD_BCD:
+                case op::LD_I_V0X: {
+                    target(next);
+                } break;
+
+                default: {
+                } break;
+            }
+            break;
+        }
+    }
+
+    for (uint32_t addr = start; addr < p.end; ++addr) {
+        if (!p.leader[addr]) {
+            continue;
+        }
+        block b{static_cast<uint16_t>(addr), 0u};
+        uint32_t a = addr;
+        do {
+            ++b.len;
+            const auto code = dispatch::DECODE_TABLE[word_at(p, static_cast<uint16_t>(a))].code;
+            a += 2u;
+            if (cache::ends_block(code)) {
+                break;
+            }
+        } while (in_rom(p, a) && !p.leader[a]);
+        p.blocks.push_back(b);
+    }
+    return p;
+}
+
+// Merged ranges of the bytes of all the blocks, len in bytes
+inline std::vector<block> code_ranges(const program& p) {
+    std::vector<block> ranges;
+    for (const auto& b: p.blocks) {
+        const auto end = static_cast<uint16_t>(b.start + b.len * 2u);
+        if (!ranges.empty() && b.start <= ranges.back().start + ranges.back().len) {
+            auto& last = ranges.back();
+            if (end > last.start + last.len) {
+                last.len = static_cast<uint16_t>(end - last.start);
+            }
+        } else {
+            ranges.push_back({b.start, static_cast<uint16_t>(b.len * 2u)});
+        }
+    }
+    return ranges;
+}
+
+inline constexpr const char* PROFILES[] = {"modern", "cosmac_vip", "super_chip", "xo_chip"};
+
+inline bool known_profile(std::string_view name) {
+    for (const auto* profile: PROFILES) {
+        if (name == profile) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The call of the opcode function for d, empty for NOP
+inline std::string call(const dispatch::decoded_op& d) {
+    using dispatch::op;
+
+    char line[64];
+    line[0] = '\0';
+    switch (d.code) {
+        case op::NOP: break;
+        case op::CLS: snprintf(line, sizeof(line), "CLS(cpu);"); break;
+        case op::RET: snprintf(line, sizeof(line), "RET(cpu);"); break;
+        case op::SYS: snprintf(line, sizeof(line), "SYS(cpu, 0x%03Xu);", d.nnn); break;
+        case op::JP: snprintf(line, sizeof(line), "JP(cpu, 0x%03Xu);", d.nnn); break;
+        case op::CALL: snprintf(line, sizeof(line), "CALL(cpu, 0x%03Xu);", d.nnn); break;
+        case op::SE: snprintf(line, sizeof(line), "SE(cpu, 0x%Xu, 0x%02Xu);", d.x, d.nn); break;
+        case op::SNE: snprintf(line, sizeof(line), "SNE(cpu, 0x%Xu, 0x%02Xu);", d.x, d.nn); break;
+        case op::SE_REG: snprintf(line, sizeof(line), "SE_REG(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::LD: snprintf(line, sizeof(line), "LD(cpu, 0x%Xu, 0x%02Xu);", d.x, d.nn); break;
+        case op::ADD: snprintf(line, sizeof(line), "ADD(cpu, 0x%Xu, 0x%02Xu);", d.x, d.nn); break;
+        case op::LD_REG: snprintf(line, sizeof(line), "LD_REG(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::OR_REG: snprintf(line, sizeof(line), "OR_REG<Q>(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::AND_REG: snprintf(line, sizeof(line), "AND_REG<Q>(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::XOR_REG: snprintf(line, sizeof(line), "XOR_REG<Q>(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::ADD_REG: snprintf(line, sizeof(line), "ADD_REG(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::SUB_REG: snprintf(line, sizeof(line), "SUB_REG(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::SHR: snprintf(line, sizeof(line), "SHR<Q>(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::SUBN_REG: snprintf(line, sizeof(line), "SUBN_REG(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::SHL: snprintf(line, sizeof(line), "SHL<Q>(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::SNE_REG: snprintf(line, sizeof(line), "SNE_REG(cpu, 0x%Xu, 0x%Xu);", d.x, d.y); break;
+        case op::LD_I: snprintf(line, sizeof(line), "LD_I(cpu, 0x%03Xu);", d.nnn); break;
+        case op::JP_V0: snprintf(line, sizeof(line), "JP_V0<Q>(cpu, 0x%03Xu);", d.nnn); break;
+        case op::RND: snprintf(line, sizeof(line), "RND(cpu, 0x%Xu, 0x%02Xu);", d.x, d.nn); break;
+        case op::DRW: snprintf(line, sizeof(line), "DRW<Q>(cpu, 0x%Xu, 0x%Xu, %uu);", d.x, d.y, d.n); break;
+        case op::SKP: snprintf(line, sizeof(line), "SKP(cpu, 0x%Xu);", d.x); break;
+        case op::SKNP: snprintf(line, sizeof(line), "SKNP(cpu, 0x%Xu);", d.x); break;
+        case op::LD_REG_DT: snprintf(line, sizeof(line), "LD_REG_DT(cpu, 0x%Xu);", d.x); break;
+        case op::WAIT_KP: snprintf(line, sizeof(line), "WAIT_KP(cpu, 0x%Xu);", d.x); break;
+        case op::LD_DT_REG: snprintf(line, sizeof(line), "LD_DT_REG(cpu, 0x%Xu);", d.x); break;
+        case op::LD_ST_REG: snprintf(line, sizeof(line), "LD_ST_REG(cpu, 0x%Xu);", d.x); break;
+        case op::ADD_I_REG: snprintf(line, sizeof(line), "ADD_I_REG(cpu, 0x%Xu);", d.x); break;
+        case op::LD_FONT: snprintf(line, sizeof(line), "LD_FONT(cpu, 0x%Xu);", d.x); break;
+        case op::LD_BCD: snprintf(line, sizeof(line), "LD_BCD(cpu, 0x%Xu);", d.x); break;
+        case op::LD_I_V0X: snprintf(line, sizeof(line), "LD_I_V0X<Q>(cpu, 0x%Xu);", d.x); break;
+        case op::LD_V0X_I: snprintf(line, sizeof(line), "LD_V0X_I<Q>(cpu, 0x%Xu);", d.x); break;
+        case op::COUNT: break;
+    }
+    return line;
+}
+
+// Emit the translation unit for p into out, defining
+// chipp8::<name>::run(chip8& cpu, uint64_t cycles) for quirks::<profile>.
+// Fails for an unknown profile or a ROM without a single instruction
+inline bool translate(const program& p, const char* name, const char* profile, std::string& out) {
+    using dispatch::op;
+
+    if (p.blocks.empty() || !known_profile(profile)) {
+        return false;
+    }
+
+    char line[160];
+    auto emit = [&](const char* text) { out += text; };
+    // Continue at addr, pc must already hold it
+    auto jump = [&](uint32_t addr) {
+        if (addr < p.leader.size() && p.leader[addr]) {
+            char label[16];
+            snprintf(label, sizeof(label), "goto b_%03X;", addr);
+            return std::string(label);
+        }
+        return std::string("continue;");
+    };
+
+    size_t instructions = 0u;
+    for (const auto& b: p.blocks) {
+        instructions += b.len;
+    }
+
+    out.clear();
+    snprintf(line, sizeof(line), "// Generated by the chipp8 aot tool for quirks::%s, do not edit\n//\n", profile);
+    emit(line);
+    snprintf(line, sizeof(line), "// %zu blocks, %zu instructions, %zu indirect jumps\n\n",
+        p.blocks.size(), instructions, p.indirect.size());
+    emit(line);
+    emit("#include <stdint.h>\n\n#include \"aot.h\"\n#include \"chip8.h\"\n#include \"dispatch.h\"\n\n");
+    snprintf(line, sizeof(line), "namespace chipp8::%s {\n\nnamespace {\n\nusing Q = quirks::%s;\n\n", name, profile);
+    emit(line);
+
+    const auto ranges = code_ranges(p);
+    emit("constexpr const uint8_t BYTES[] = {");
+    size_t count = 0u;
+    for (const auto& r: ranges) {
+        for (auto k = 0u; k < r.len; ++k) {
+            snprintf(line, sizeof(line), "%s0x%02Xu,", (count % 16u) ? " " : "\n    ", p.image[r.start + k]);
+            emit(line);
+            ++count;
+        }
+    }
+    emit("\n};\n\nconstexpr const aot::range CODE[] = {\n");
+    size_t offset = 0u;
+    for (const auto& r: ranges) {
+        snprintf(line, sizeof(line), "    {0x%03Xu, %uu, BYTES + %zuu},\n", r.start, r.len, offset);
+        emit(line);
+        offset += r.len;
+    }
+    emit("};\n\n} // namespace\n\n");
+
+    emit("void run(chip8& cpu, uint64_t cycles) {\n");
+    emit("    if (!aot::intact(cpu, CODE)) {\n        goto interpret;\n    }\n");
+    emit("    for (;;) {\n        switch (cpu.pc) {\n");
+    for (const auto& b: p.blocks) {
+        snprintf(line, sizeof(line), "            case 0x%03Xu: goto b_%03X;\n", b.start, b.start);
+        emit(line);
+    }
+    emit("            default: break;\n        }\n");
+    emit("        // Not compiled, one instruction at a time\n");
+    emit("        if (cycles == 0u) {\n            return;\n        }\n        --cycles;\n");
+    emit("        if (!aot::step<Q>(cpu, CODE)) {\n            goto interpret;\n        }\n        continue;\n");
+
+    for (const auto& b: p.blocks) {
+        snprintf(line, sizeof(line), "\n    b_%03X:\n        if (cycles < %uu) {\n            cpu.pc = 0x%03Xu;\n            goto interpret;\n        }\n",
+            b.start, b.len, b.start);
+        emit(line);
+        snprintf(line, sizeof(line), "        cycles -= %uu;\n", b.len);
+        emit(line);
+
+        for (auto k = 0u; k < b.len; ++k) {
+            const auto addr = static_cast<uint16_t>(b.start + k * 2u);
+            const uint32_t next = addr + 2u;
+            const auto word = word_at(p, addr);
+            const auto& d = dispatch::DECODE_TABLE[word];
+            const auto text = call(d);
+            const bool last = k + 1u == b.len;
+
+            std::string before;
+            std::string after;
+            if (last) {
+                switch (d.code) {
+                    case op::SYS:
+                    case op::JP: {
+                        after = jump(d.nnn);
+                    } break;
+
+                    case op::CALL: {
+                        snprintf(line, sizeof(line), "cpu.pc = 0x%03Xu;", next);
+                        before = line;
+                        after = jump(d.nnn);
+                    } break;
+
+                    case op::SE:
+                    case op::SNE:
+                    case op::SE_REG:
+                    case op::SNE_REG:
+                    case op::SKP:
+                    case op::SKNP:
+                    case op::WAIT_KP: {
+                        // The op moves pc on to the next but one, or back to itself
+                        const auto other = d.code == op::WAIT_KP ? static_cast<uint32_t>(addr) : next + 2u;
+                        snprintf(line, sizeof(line), "cpu.pc = 0x%03Xu;", next);
+                        before = line;
+                        snprintf(line, sizeof(line), "if (cpu.pc == 0x%03Xu) {\n            ", next);
+                        after = line + jump(next) + "\n        }\n        " + jump(other);
+                    } break;
+
+                    case op::RET:
+                    case op::JP_V0: {
+                        after = "continue;";
+                    } break;
+
+                    case op::LD_BCD:
+                    case op::LD_I_V0X: {
+                        snprintf(line, sizeof(line), "cpu.pc = 0x%03Xu;\n        {\n            const uint16_t written = cpu.i;", next);
+                        before = line;
+                        snprintf(line, sizeof(line),
+                            "\n            if (aot::wrote_code(cpu, written, %uu, CODE)) {\n                goto interpret;\n            }\n        }\n        ",
+                            d.code == op::LD_BCD ? 3u : d.x + 1u);
+                        after = line + jump(next);
+                    } break;
+
+                    default: {
+                        // Ran into another block or off the end of the ROM
+                        if (!(next < p.leader.size() && p.leader[next])) {
+                            snprintf(line, sizeof(line), "cpu.pc = 0x%03Xu;", next);
+                            after = line;
+                            after += "\n        ";
+                        }
+                        after += jump(next);
+                    } break;
+                }
+            }
+
+            if (!before.empty()) {
+                out += "        " + before + "\n";
+            }
+            snprintf(line, sizeof(line), "%s// %03X: %04X\n", text.empty() ? "" : " ", addr, word);
+            out += (d.code == op::LD_BCD || d.code == op::LD_I_V0X) && last ? "            " : "        ";
+            out += text + line;
+            if (!after.empty()) {
+                out += "        " + after + "\n";
+            }
+        }
+    }
+
+    emit("    }\n\ninterpret:\n    dispatch::run<Q>(cpu, cycles);\n}\n\n");
+    snprintf(line, sizeof(line), "} // namespace chipp8::%s\n", name);
+    emit(line);
+    return true;
+}
+
+} // namespace aot
+
+} // namespace chipp8
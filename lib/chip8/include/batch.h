@@ -0,0 +1,484 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "simd.h"
+
+/* Lockstep multi-instance engine
+
+   N instances of the machine stored structure-of-arrays, v[register][lane],
+   so the same register of every instance is contiguous. Each step picks the
+   lowest pc among the lanes with cycles left, masks in every lane sitting on
+   that pc with the same instruction word, and runs the instruction once for
+   all of them. The register-only ops (8XYn, 6XNN, 7XNN, CXNN, the skips,
+   timers) run through the byte lane kernels in simd.h, 16 or 32 lanes at a
+   time; the rest loop over the masked lanes.
+
+   Lanes that branched apart are masked off until the lowest pc catches up
+   with them, which brings loops back together on their next iteration.
+   While every lane shares one pc and the code in mem is identical across
+   lanes, pc and the cycle count are kept once for the whole batch and the
+   scan only runs again once a branch splits the lanes.
+
+   Every lane ends up exactly where dispatch::run(cpu, cycles) would take
+   the same machine on its own.
+
+   mem and the display are per lane, so a batch is large: allocate it on
+   the heap.
+*/
+
+namespace chipp8 {
+
+template <size_t N>
+struct chip8_batch {
+    std::array<std::array<uint8_t, N>, 16u> v;
+    std::array<uint16_t, N> i;
+    std::array<uint16_t, N> pc;
+    std::array<uint8_t, N> d_timer;
+    std::array<uint8_t, N> s_timer;
+    std::array<uint16_t, N> keys;
+    std::array<uint8_t, N> sp;
+    std::array<std::array<uint16_t, 16u>, N> stack;
+    std::array<uint32_t, N> rng_seed;
+    std::array<uint32_t, N> rng_instance;
+    std::array<uint32_t, N> rng_count;
+    std::array<std::array<uint8_t, 4096u>, N> mem;
+    std::array<display, N> pixels;
+
+    // Lanes taking part in the current step, and per lane scratch
+    std::array<uint8_t, N> mask;
+    std::array<uint8_t, N> cond;
+    std::array<uint64_t, N> remaining;
+};
+
+namespace batch {
+
+// Steps taken and lane-instructions executed by the last run, their ratio
+// is the average number of lanes sharing an instruction
+struct stats {
+    uint64_t steps;
+    uint64_t instructions;
+};
+
+template <size_t N>
+inline void load_lane(chip8_batch<N>& b, size_t lane, const chip8& cpu) {
+    for (auto r = 0u; r < 16u; ++r) {
+        b.v[r][lane] = cpu.v[r];
+    }
+    b.i[lane] = cpu.i;
+    b.pc[lane] = cpu.pc;
+    b.d_timer[lane] = cpu.d_timer;
+    b.s_timer[lane] = cpu.s_timer;
+    b.keys[lane] = cpu.keys;
+    b.sp[lane] = cpu.sp;
+    b.stack[lane] = cpu.stack;
+    b.rng_seed[lane] = cpu.rng.seed;
+    b.rng_instance[lane] = cpu.rng.instance;
+    b.rng_count[lane] = cpu.rng.count;
+    b.mem[lane] = cpu.mem;
+    b.pixels[lane] = cpu.pixels;
+}
+
+template <size_t N>
+inline void store_lane(const chip8_batch<N>& b, size_t lane, chip8& cpu) {
+    for (auto r = 0u; r < 16u; ++r) {
+        cpu.v[r] = b.v[r][lane];
+    }
+    cpu.i = b.i[lane];
+    cpu.pc = b.pc[lane];
+    cpu.d_timer = b.d_timer[lane];
+    cpu.s_timer = b.s_timer[lane];
+    cpu.keys = b.keys[lane];
+    cpu.sp = b.sp[lane];
+    cpu.stack = b.stack[lane];
+    cpu.rng = {b.rng_seed[lane], b.rng_instance[lane], b.rng_count[lane]};
+    cpu.mem = b.mem[lane];
+    cpu.pixels = b.pixels[lane];
+}
+
+template <size_t N>
+inline uint16_t fetch_lane(const chip8_batch<N>& b, size_t lane) {
+    const auto pc = b.pc[lane];
+    return static_cast<uint16_t>((b.mem[lane][pc & 0x0FFFu] << 8u) | b.mem[lane][(pc + 1u) & 0x0FFFu]);
+}
+
+// The register-only ops, vectorized across lanes. Returns false for the
+// ops it does not cover. The skips only mark the lanes taking them in cond,
+// see apply_skips
+template <size_t N>
+inline bool execute_lanes(chip8_batch<N>& b, const dispatch::decoded_op& d) {
+    using dispatch::op;
+    using namespace simd;
+
+    const uint8_t* m = b.mask.data();
+    uint8_t* vx = b.v[d.x].data();
+    uint8_t* vy = b.v[d.y].data();
+    uint8_t* vf = b.v[0xFu].data();
+    uint8_t* c = b.cond.data();
+
+    switch (d.code) {
+        case op::LD: {
+            for_lanes<N>([&](size_t l, auto t) {
+                store(vx + l, select(load(t, m + l), splat(t, d.nn), load(t, vx + l)));
+            });
+        } break;
+
+        case op::ADD: {
+            for_lanes<N>([&](size_t l, auto t) {
+                const auto a = load(t, vx + l);
+                store(vx + l, select(load(t, m + l), add(a, splat(t, d.nn)), a));
+            });
+        } break;
+
+        case op::LD_REG: {
+            for_lanes<N>([&](size_t l, auto t) {
+                store(vx + l, select(load(t, m + l), load(t, vy + l), load(t, vx + l)));
+            });
+        } break;
+
+        case op::OR_REG:
+        case op::AND_REG:
+        case op::XOR_REG: {
+            for_lanes<N>([&](size_t l, auto t) {
+                const auto a = load(t, vx + l);
+                const auto y = load(t, vy + l);
+                const auto r = (d.code == op::OR_REG) ? bor(a, y) : ((d.code == op::AND_REG) ? band(a, y) : bxor(a, y));
+                store(vx + l, select(load(t, m + l), r, a));
+            });
+        } break;
+
+        // The flag ops store vF before vX, exactly like chip8.h, and load
+        // vX/vY again after the flag store when chip8.h reads them after it
+        case op::ADD_REG: {
+            for_lanes<N>([&](size_t l, auto t) {
+                const auto mask = load(t, m + l);
+                const auto a = load(t, vx + l);
+                const auto sum = add(a, load(t, vy + l));
+                // Carry out iff the wrapped sum is below an operand
+                const auto carry = band(gt(a, sum), splat(t, 1u));
+                store(vf + l, select(mask, carry, load(t, vf + l)));
+                store(vx + l, select(mask, sum, load(t, vx + l)));
+            });
+        } break;
+
+        case op::SUB_REG:
+        case op::SUBN_REG: {
+            for_lanes<N>([&](size_t l, auto t) {
+                const auto mask = load(t, m + l);
+                const auto a = load(t, vx + l);
+                const auto y = load(t, vy + l);
+                const auto flag = band((d.code == op::SUB_REG) ? gt(a, y) : gt(y, a), splat(t, 1u));
+                store(vf + l, select(mask, flag, load(t, vf + l)));
+                const auto a2 = load(t, vx + l);
+                const auto y2 = load(t, vy + l);
+                store(vx + l, select(mask, (d.code == op::SUB_REG) ? sub(a2, y2) : sub(y2, a2), a2));
+            });
+        } break;
+
+        case op::SHR:
+        case op::SHL: {
+            for_lanes<N>([&](size_t l, auto t) {
+                const auto mask = load(t, m + l);
+                const auto a = load(t, vx + l);
+                // The bit shifted out, bit 7 is set exactly when a > 0x7F
+                const auto flag = band((d.code == op::SHR) ? a : gt(a, splat(t, 0x7Fu)), splat(t, 1u));
+                store(vx + l, select(mask, (d.code == op::SHR) ? shr1(a) : shl1(a), a));
+                store(vf + l, select(mask, flag, load(t, vf + l)));
+            });
+        } break;
+
+        case op::LD_REG_DT: {
+            for_lanes<N>([&](size_t l, auto t) {
+                store(vx + l, select(load(t, m + l), load(t, b.d_timer.data() + l), load(t, vx + l)));
+            });
+        } break;
+
+        case op::LD_DT_REG:
+        case op::LD_ST_REG: {
+            uint8_t* timer = (d.code == op::LD_DT_REG) ? b.d_timer.data() : b.s_timer.data();
+            for_lanes<N>([&](size_t l, auto t) {
+                store(timer + l, select(load(t, m + l), load(t, vx + l), load(t, timer + l)));
+            });
+        } break;
+
+        case op::SE:
+        case op::SNE:
+        case op::SE_REG:
+        case op::SNE_REG: {
+            for_lanes<N>([&](size_t l, auto t) {
+                const auto other = (d.code == op::SE || d.code == op::SNE) ? splat(t, d.nn) : load(t, vy + l);
+                const auto same = eq(load(t, vx + l), other);
+                const auto taken = (d.code == op::SE || d.code == op::SE_REG) ? same : bxor(same, splat(t, 0xFFu));
+                store(c + l, band(load(t, m + l), taken));
+            });
+        } break;
+
+        // Draw for every lane in bulk, then keep it and advance the stream
+        // only in the masked ones
+        case op::RND: {
+            rng::bytes(b.rng_seed.data(), b.rng_instance.data(), b.rng_count.data(), c, N);
+            for_lanes<N>([&](size_t l, auto t) {
+                store(vx + l, select(load(t, m + l), band(load(t, c + l), splat(t, d.nn)), load(t, vx + l)));
+            });
+            for (size_t l = 0u; l < N; ++l) {
+                b.rng_count[l] += m[l] & 1u;
+            }
+        } break;
+
+        case op::NOP: {
+        } break;
+
+        default: {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Everything else, one masked lane at a time with the semantics of the
+// matching opcode function in chip8.h
+template <size_t N>
+inline void execute_scalar(chip8_batch<N>& b, const dispatch::decoded_op& d) {
+    using dispatch::op;
+
+    for (size_t l = 0u; l < N; ++l) {
+        if (!b.mask[l]) {
+            continue;
+        }
+        auto& vx = b.v[d.x][l];
+        switch (d.code) {
+            case op::CLS: b.pixels[l].fill(0u); break;
+            case op::RET: b.pc[l] = b.stack[l][b.sp[l]--]; break;
+            case op::SYS:
+            case op::JP: b.pc[l] = d.nnn; break;
+            case op::CALL: {
+                b.stack[l][++b.sp[l]] = b.pc[l];
+                b.pc[l] = d.nnn;
+            } break;
+            case op::LD_I: b.i[l] = d.nnn; break;
+            case op::JP_V0: b.pc[l] = static_cast<uint16_t>(b.v[0u][l] + d.nnn); break;
+            case op::DRW: {
+                const bool collision = draw_sprite(b.pixels[l], b.mem[l], b.i[l], vx, b.v[d.y][l], d.n);
+                b.v[0xFu][l] = collision ? 1u : 0u;
+            } break;
+            case op::SKP: {
+                if (b.keys[l] & (1u << vx)) {
+                    b.pc[l] += 2u;
+                }
+            } break;
+            case op::SKNP: {
+                if (!(b.keys[l] & (1u << vx))) {
+                    b.pc[l] += 2u;
+                }
+            } break;
+            case op::WAIT_KP: {
+                if (b.keys[l] & 0xFFFF) {
+                    vx = static_cast<uint8_t>(b.keys[l]);
+                } else {
+                    b.pc[l] -= 2u;
+                }
+            } break;
+            case op::ADD_I_REG: b.i[l] += vx; break;
+            case op::LD_FONT: b.i[l] = static_cast<uint16_t>(FONT_START_ADDR + (sprites::FONT_SIZE * vx)); break;
+            case op::LD_BCD: {
+                b.mem[l][b.i[l] + 2u] = vx % 10u;
+                b.mem[l][b.i[l] + 1u] = (vx / 10u) % 10u;
+                b.mem[l][b.i[l]] = (vx / 100u) % 10u;
+            } break;
+            case op::LD_I_V0X: {
+                for (auto r = 0u; r <= d.x; ++r) {
+                    b.mem[l][b.i[l] + r] = b.v[r][l];
+                }
+            } break;
+            case op::LD_V0X_I: {
+                for (auto r = 0u; r <= d.x; ++r) {
+                    b.v[r][l] = b.mem[l][b.i[l] + r];
+                }
+            } break;
+            default: break;
+        }
+    }
+}
+
+// True for the ops that read or write the pc of each lane themselves
+constexpr inline bool uses_lane_pc(dispatch::op code) {
+    using dispatch::op;
+    switch (code) {
+        case op::RET:
+        case op::CALL:
+        case op::JP_V0:
+        case op::SKP:
+        case op::SKNP:
+        case op::WAIT_KP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+constexpr inline bool is_skip(dispatch::op code) {
+    using dispatch::op;
+    return code == op::SE || code == op::SNE || code == op::SE_REG || code == op::SNE_REG;
+}
+
+constexpr inline bool writes_mem(dispatch::op code) {
+    return code == dispatch::op::LD_BCD || code == dispatch::op::LD_I_V0X;
+}
+
+// Step the lanes marked in cond over the next instruction
+template <size_t N>
+inline void apply_skips(chip8_batch<N>& b) {
+    for (size_t l = 0u; l < N; ++l) {
+        b.pc[l] = static_cast<uint16_t>(b.pc[l] + (b.cond[l] & 2u));
+    }
+}
+
+// One instruction for the masked lanes
+template <size_t N>
+inline void step_masked(chip8_batch<N>& b, uint16_t instruct) {
+    for (size_t l = 0u; l < N; ++l) {
+        if (b.mask[l]) {
+            b.pc[l] += 2u;
+            --b.remaining[l];
+        }
+    }
+
+    const auto& d = dispatch::DECODE_TABLE[instruct];
+    if (!execute_lanes(b, d)) {
+        execute_scalar(b, d);
+    }
+    if (is_skip(d.code)) {
+        apply_skips(b);
+    }
+}
+
+// Every masked lane sits on pc and holds the same code as `leader`, so pc
+// and the cycle count are kept once for all of them until a branch splits
+// the lanes, an op needs the pc of each lane, mem is written or budget runs
+// out. Returns the number of instructions run
+template <size_t N>
+inline uint64_t run_lockstep(chip8_batch<N>& b, size_t leader, size_t lanes, uint64_t budget, bool& same_code) {
+    const auto& code = b.mem[leader];
+    const dispatch::decoded_op* lane_pc_op = nullptr;
+    bool split = false;
+
+    auto pc = b.pc[leader];
+    uint64_t n = 0u;
+    while (n < budget) {
+        const auto instruct = static_cast<uint16_t>((code[pc & 0x0FFFu] << 8u) | code[(pc + 1u) & 0x0FFFu]);
+        const auto& d = dispatch::DECODE_TABLE[instruct];
+        pc = static_cast<uint16_t>(pc + 2u);
+        ++n;
+
+        if (d.code == dispatch::op::JP || d.code == dispatch::op::SYS) {
+            pc = d.nnn;
+            continue;
+        }
+        if (uses_lane_pc(d.code)) {
+            lane_pc_op = &d;
+            break;
+        }
+        if (!execute_lanes(b, d)) {
+            execute_scalar(b, d);
+        }
+        if (is_skip(d.code)) {
+            size_t taken = 0u;
+            for (size_t l = 0u; l < N; ++l) {
+                taken += (b.cond[l] & 1u);
+            }
+            if (taken == lanes) {
+                pc = static_cast<uint16_t>(pc + 2u);
+            } else if (taken != 0u) {
+                split = true;
+                break;
+            }
+        }
+        if (writes_mem(d.code)) {
+            same_code = false;
+            break;
+        }
+    }
+
+    for (size_t l = 0u; l < N; ++l) {
+        if (b.mask[l]) {
+            b.pc[l] = pc;
+            b.remaining[l] -= n;
+        }
+    }
+    if (split) {
+        apply_skips(b);
+    }
+    if (lane_pc_op) {
+        execute_scalar(b, *lane_pc_op);
+    }
+    return n;
+}
+
+// Run every lane for exactly `cycles` instructions
+template <size_t N>
+inline stats run(chip8_batch<N>& b, uint64_t cycles) {
+    stats s{0u, 0u};
+    b.remaining.fill(cycles);
+
+    // While mem is identical across lanes, lanes on the same pc are on the
+    // same instruction too. Any guest write to mem gives that up for the
+    // rest of the run
+    bool same_code = true;
+    for (size_t l = 1u; l < N && same_code; ++l) {
+        same_code = (memcmp(b.mem[l].data(), b.mem[0u].data(), 4096u) == 0);
+    }
+
+    while (true) {
+        // Lowest pc among the lanes with cycles left
+        size_t leader = N;
+        size_t active = 0u;
+        for (size_t l = 0u; l < N; ++l) {
+            if (b.remaining[l] > 0u) {
+                ++active;
+                if (leader == N || b.pc[l] < b.pc[leader]) {
+                    leader = l;
+                }
+            }
+        }
+        if (leader == N) {
+            break;
+        }
+
+        const auto pc = b.pc[leader];
+        const auto instruct = fetch_lane(b, leader);
+        size_t selected = 0u;
+        uint64_t budget = ~0ull;
+        for (size_t l = 0u; l < N; ++l) {
+            const bool in = (b.remaining[l] > 0u) && (b.pc[l] == pc) && (same_code || fetch_lane(b, l) == instruct);
+            b.mask[l] = in ? 0xFFu : 0x00u;
+            selected += in;
+            if (in && b.remaining[l] < budget) {
+                budget = b.remaining[l];
+            }
+        }
+
+        if (selected == active && same_code) {
+            const auto n = run_lockstep(b, leader, selected, budget, same_code);
+            s.steps += n;
+            s.instructions += n * selected;
+        } else {
+            const auto& d = dispatch::DECODE_TABLE[instruct];
+            step_masked(b, instruct);
+            if (writes_mem(d.code)) {
+                same_code = false;
+            }
+            ++s.steps;
+            s.instructions += selected;
+        }
+    }
+    return s;
+}
+
+} // namespace batch
+
+} // namespace chipp8
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <initializer_list>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "chip8.h"
+#include "hires.h"
+
+/* Framebuffer expansion
+
+   Turns the 1 bit rows of a display, or the two planes of a hires
+   machine, into 32 bit RGBA pixels scaled up by an integer factor, in a
+   buffer the caller owns. Rows of the buffer are `pitch` pixels apart.
+
+   Each source row is expanded once into the first of its `scale` output
+   lines and the line is then copied to the rest, so the per pixel work is
+   1/scale of the output and the remainder is memcpy. Expanding a line
+   picks the colour of 8 pixels (AVX2) or 4 (SSE2) at a time from a byte of
+   the row: the byte is broadcast to every lane, ANDed with one bit per
+   lane and compared, which gives a lane mask that selects between colours.
+   Scaled up by 4 or more each pixel is one colour broadcast over a run of
+   lanes, stored a register at a time with the last store overlapping the
+   one before so it ends exactly on the run. Like simd.h this follows what
+   the compiler targets, AVX2, else SSE2, else the scalar loop, which is
+   always compiled as the reference.
+
+   A row mask selects the source rows to expand, bit y for row y, so a
+   frontend that keeps what it last showed redraws only the rows
+   changed_rows() reports.
+
+   For XO-CHIP the two planes make a 2 bit colour index per pixel, which
+   goes out through a 4 colour palette, or as the index itself, a byte per
+   pixel, for a frontend with its own palette stage.
+*/
+
+namespace chipp8 {
+
+namespace blit {
+
+constexpr const uint32_t ALL_ROWS = ~0u;
+constexpr const uint64_t ALL_HIRES_ROWS = ~0ull;
+
+// Plane 0 is bit 0 of the index
+using palette = std::array<uint32_t, 4u>;
+
+// A colour whose bytes are r, g, b, a in memory
+constexpr inline uint32_t rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 0xFFu) {
+    if constexpr (std::endian::native == std::endian::little) {
+        return static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8u) | (static_cast<uint32_t>(b) << 16u) |
+               (static_cast<uint32_t>(a) << 24u);
+    } else {
+        return (static_cast<uint32_t>(r) << 24u) | (static_cast<uint32_t>(g) << 16u) | (static_cast<uint32_t>(b) << 8u) |
+               static_cast<uint32_t>(a);
+    }
+}
+
+// Bit y set for every row that differs
+inline uint32_t changed_rows(const display& now, const display& before) {
+    uint32_t rows = 0u;
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        rows |= static_cast<uint32_t>(now[y] != before[y]) << y;
+    }
+    return rows;
+}
+
+inline uint64_t changed_rows(const std::array<hires::plane, hires::PLANE_COUNT>& now,
+                             const std::array<hires::plane, hires::PLANE_COUNT>& before) {
+    uint64_t rows = 0u;
+    for (auto y = 0u; y < hires::HEIGHT; ++y) {
+        bool changed = false;
+        for (auto p = 0u; p < hires::PLANE_COUNT; ++p) {
+            changed |= (now[p].left[y] != before[p].left[y]) | (now[p].right[y] != before[p].right[y]);
+        }
+        rows |= static_cast<uint64_t>(changed) << y;
+    }
+    return rows;
+}
+
+// Pixel x of a row pair as a palette index
+constexpr inline uint32_t index_at(uint64_t p0, uint64_t p1, uint32_t x) {
+    return static_cast<uint32_t>(((p0 >> (63u - x)) & 1u) | (((p1 >> (63u - x)) & 1u) << 1u));
+}
+
+// One line of 64 * scale pixels from a row pair, pixel by pixel
+inline void expand_line_scalar(uint64_t p0, uint64_t p1, const palette& colours, uint32_t scale, uint32_t* out) {
+    for (auto x = 0u; x < 64u; ++x) {
+        const auto c = colours[index_at(p0, p1, x)];
+        for (auto k = 0u; k < scale; ++k) {
+            *out++ = c;
+        }
+    }
+}
+
+#if defined(__AVX2__)
+
+constexpr const uint32_t LANES = 8u;
+
+using vec = __m256i;
+
+inline vec splat(uint32_t c) { return _mm256_set1_epi32(static_cast<int>(c)); }
+inline void store(uint32_t* p, vec a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+inline vec select(vec mask, vec a, vec b) { return _mm256_blendv_epi8(b, a, mask); }
+
+// All ones in lane k when bit 7 - (first + k) of byte b is set
+inline vec lane_mask(uint32_t b, uint32_t first) {
+    const auto bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+    const auto v = _mm256_set1_epi32(static_cast<int>(b << first));
+    return _mm256_cmpeq_epi32(_mm256_and_si256(v, bits), bits);
+}
+
+#elif defined(__SSE2__)
+
+constexpr const uint32_t LANES = 4u;
+
+using vec = __m128i;
+
+inline vec splat(uint32_t c) { return _mm_set1_epi32(static_cast<int>(c)); }
+inline void store(uint32_t* p, vec a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+inline vec select(vec mask, vec a, vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+inline vec lane_mask(uint32_t b, uint32_t first) {
+    const auto bits = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const auto v = _mm_set1_epi32(static_cast<int>(b << first));
+    return _mm_cmpeq_epi32(_mm_and_si128(v, bits), bits);
+}
+
+#else
+
+constexpr const uint32_t LANES = 0u;
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+// `LANES` pixels, the ones of bits 7 - first... of the two plane bytes
+template <bool TwoPlanes>
+inline vec colours_of(uint32_t b0, uint32_t b1, uint32_t first, const vec* c) {
+    const auto m0 = lane_mask(b0, first);
+    if constexpr (!TwoPlanes) {
+        return select(m0, c[1], c[0]);
+    } else {
+        const auto m1 = lane_mask(b1, first);
+        return select(m1, select(m0, c[3], c[2]), select(m0, c[1], c[0]));
+    }
+}
+
+template <bool TwoPlanes>
+inline void expand_line(uint64_t p0, uint64_t p1, const palette& colours, uint32_t scale, uint32_t* out) {
+    if (scale == 1u) {
+        const vec c[4] = {splat(colours[0]), splat(colours[1]), splat(colours[2]), splat(colours[3])};
+        for (auto b = 0u; b < 8u; ++b) {
+            const auto b0 = static_cast<uint32_t>(p0 >> (56u - 8u * b)) & 0xFFu;
+            const auto b1 = static_cast<uint32_t>(p1 >> (56u - 8u * b)) & 0xFFu;
+            for (auto first = 0u; first < 8u; first += LANES) {
+                store(out + 8u * b + first, colours_of<TwoPlanes>(b0, b1, first, c));
+            }
+        }
+        return;
+    }
+    if (scale < LANES) {
+        expand_line_scalar(p0, p1, colours, scale, out);
+        return;
+    }
+    for (auto x = 0u; x < 64u; ++x) {
+        const auto c = splat(colours[index_at(p0, p1, x)]);
+        uint32_t k = 0u;
+        for (; k + LANES <= scale; k += LANES) {
+            store(out + k, c);
+        }
+        if (k < scale) {
+            // Overlaps the store before, ends on the last pixel of the run
+            store(out + scale - LANES, c);
+        }
+        out += scale;
+    }
+}
+
+#else
+
+template <bool TwoPlanes>
+inline void expand_line(uint64_t p0, uint64_t p1, const palette& colours, uint32_t scale, uint32_t* out) {
+    expand_line_scalar(p0, p1, colours, scale, out);
+}
+
+#endif
+
+// Copy the first line of a scaled row to the scale - 1 lines under it
+inline void repeat_line(uint32_t* line, size_t pitch, uint32_t width, uint32_t scale) {
+    for (auto k = 1u; k < scale; ++k) {
+        memcpy(line + k * pitch, line, width * sizeof(uint32_t));
+    }
+}
+
+// The display, `off` and `on` pixels, into a (64 * scale) x (32 * scale)
+// area of out. Only the rows set in `rows` are written
+inline void expand(const display& pixels, uint32_t on, uint32_t off, uint32_t scale, uint32_t* out, size_t pitch,
+                   uint32_t rows = ALL_ROWS) {
+    const palette colours = {off, on, off, on};
+    const auto width = DISPLAY_WIDTH * scale;
+    while (rows != 0u) {
+        const auto y = static_cast<uint32_t>(std::countr_zero(rows));
+        rows &= rows - 1u;
+        auto* line = out + static_cast<size_t>(y) * scale * pitch;
+        expand_line<false>(pixels[y], 0u, colours, scale, line);
+        repeat_line(line, pitch, width, scale);
+    }
+}
+
+// The scalar reference for expand()
+inline void expand_scalar(const display& pixels, uint32_t on, uint32_t off, uint32_t scale, uint32_t* out, size_t pitch,
+                          uint32_t rows = ALL_ROWS) {
+    const palette colours = {off, on, off, on};
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        if (!((rows >> y) & 1u)) {
+            continue;
+        }
+        auto* line = out + static_cast<size_t>(y) * scale * pitch;
+        expand_line_scalar(pixels[y], 0u, colours, scale, line);
+        repeat_line(line, pitch, DISPLAY_WIDTH * scale, scale);
+    }
+}
+
+// The planes of m, coloured through the palette, into a
+// (128 * scale) x (64 * scale) area of out
+inline void expand(const hires::machine& m, const palette& colours, uint32_t scale, uint32_t* out, size_t pitch,
+                   uint64_t rows = ALL_HIRES_ROWS) {
+    const auto& p0 = m.planes[0u];
+    const auto& p1 = m.planes[1u];
+    const auto half = 64u * scale;
+    while (rows != 0u) {
+        const auto y = static_cast<uint32_t>(std::countr_zero(rows));
+        rows &= rows - 1u;
+        auto* line = out + static_cast<size_t>(y) * scale * pitch;
+        expand_line<true>(p0.left[y], p1.left[y], colours, scale, line);
+        expand_line<true>(p0.right[y], p1.right[y], colours, scale, line + half);
+        repeat_line(line, pitch, 2u * half, scale);
+    }
+}
+
+// The scalar reference for the planes
+inline void expand_scalar(const hires::machine& m, const palette& colours, uint32_t scale, uint32_t* out, size_t pitch,
+                          uint64_t rows = ALL_HIRES_ROWS) {
+    const auto& p0 = m.planes[0u];
+    const auto& p1 = m.planes[1u];
+    for (auto y = 0u; y < hires::HEIGHT; ++y) {
+        if (!((rows >> y) & 1u)) {
+            continue;
+        }
+        auto* line = out + static_cast<size_t>(y) * scale * pitch;
+        expand_line_scalar(p0.left[y], p1.left[y], colours, scale, line);
+        expand_line_scalar(p0.right[y], p1.right[y], colours, scale, line + 64u * scale);
+        repeat_line(line, pitch, 128u * scale, scale);
+    }
+}
+
+// Byte b spread over 8 bytes, bit 7 in the first, each byte 0 or 1
+constexpr inline std::array<uint64_t, 256u> build_spread_table() {
+    std::array<uint64_t, 256u> table{};
+    for (auto b = 0u; b < 256u; ++b) {
+        for (auto k = 0u; k < 8u; ++k) {
+            const uint64_t bit = (b >> (7u - k)) & 1u;
+            if constexpr (std::endian::native == std::endian::little) {
+                table[b] |= bit << (8u * k);
+            } else {
+                table[b] |= bit << (56u - 8u * k);
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr std::array<uint64_t, 256u> SPREAD_TABLE = build_spread_table();
+
+// The planes of m as palette indices, a byte per pixel, into a
+// (128 * scale) x (64 * scale) area of out, rows `pitch` bytes apart
+inline void index(const hires::machine& m, uint32_t scale, uint8_t* out, size_t pitch, uint64_t rows = ALL_HIRES_ROWS) {
+    const auto& p0 = m.planes[0u];
+    const auto& p1 = m.planes[1u];
+    const auto width = 128u * scale;
+    while (rows != 0u) {
+        const auto y = static_cast<uint32_t>(std::countr_zero(rows));
+        rows &= rows - 1u;
+        auto* line = out + static_cast<size_t>(y) * scale * pitch;
+        auto* dst = line;
+        for (const auto& [w0, w1]: {std::pair{p0.left[y], p1.left[y]}, std::pair{p0.right[y], p1.right[y]}}) {
+            for (auto b = 0u; b < 8u; ++b) {
+                const auto shift = 56u - 8u * b;
+                const uint64_t indices = SPREAD_TABLE[(w0 >> shift) & 0xFFu] | (SPREAD_TABLE[(w1 >> shift) & 0xFFu] << 1u);
+                if (scale == 1u) {
+                    memcpy(dst, &indices, 8u);
+                    dst += 8u;
+                    continue;
+                }
+                uint8_t bytes[8];
+                memcpy(bytes, &indices, 8u);
+                for (const auto i: bytes) {
+                    memset(dst, i, scale);
+                    dst += scale;
+                }
+            }
+        }
+        for (auto k = 1u; k < scale; ++k) {
+            memcpy(line + k * pitch, line, width);
+        }
+    }
+}
+
+} // namespace blit
+
+} // namespace chipp8
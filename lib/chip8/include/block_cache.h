@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+
+/* Cached interpreter
+
+   Straight-line runs of instructions are decoded once into blocks of
+   decoded_op, keyed by the address of their first instruction. A block ends
+   on the first instruction that can change the pc (jumps, skips, calls,
+   WAIT_KP) or write memory (LD_BCD, LD_I_V0X), so inside a block every
+   instruction simply falls through to the next one.
+
+   The only guest writes to mem are LD_BCD and LD_I_V0X. Because they always
+   end a block, the written range is checked against a bitmap of the 64 byte
+   pages holding cached code once the block returns, and only the blocks on
+   those pages are dropped.
+*/
+
+namespace chipp8 {
+
+namespace cache {
+
+constexpr const uint16_t PAGE_SIZE = 64u;
+constexpr const uint16_t PAGE_COUNT = 4096u / PAGE_SIZE;
+constexpr const uint16_t MAX_BLOCK_LEN = 32u;
+
+// Dead blocks pile up in the arena as code is invalidated, once there are
+// this many blocks everything is flushed and decoded again
+constexpr const uint16_t MAX_BLOCKS = 4096u;
+
+static_assert(PAGE_COUNT == 64u, "One bit per page in a uint64_t");
+
+struct block {
+    uint16_t start;
+    uint16_t len;
+    // Offset of the first op in block_cache::ops
+    uint32_t first;
+    // Pages spanned by the instructions of this block
+    uint64_t pages;
+    bool live;
+};
+
+struct block_cache {
+    // Block index + 1 for the block starting at each address, 0 if none
+    std::array<uint16_t, 4096u> lookup;
+
+    // Pages holding at least one live block
+    uint64_t code_pages;
+
+    std::vector<block> blocks;
+    std::vector<dispatch::decoded_op> ops;
+};
+
+constexpr inline uint64_t page_mask(uint16_t addr, uint16_t len) {
+    if (len == 0u) {
+        return 0u;
+    }
+    const auto first = (addr & 0x0FFFu) / PAGE_SIZE;
+    const auto last = ((addr + len - 1u) & 0x0FFFu) / PAGE_SIZE;
+    if (last < first) {
+        // Wrapped past the end of mem
+        return ~0ull;
+    }
+    const auto count = last - first + 1u;
+    return (count == 64u ? ~0ull : ((1ull << count) - 1u)) << first;
+}
+
+// True for the ops that can leave pc anywhere but the next instruction
+constexpr inline bool ends_block(dispatch::op code) {
+    using dispatch::op;
+    switch (code) {
+        case op::RET:
+        case op::SYS:
+        case op::JP:
+        case op::CALL:
+        case op::SE:
+        case op::SNE:
+        case op::SE_REG:
+        case op::SNE_REG:
+        case op::JP_V0:
+        case op::SKP:
+        case op::SKNP:
+        case op::WAIT_KP:
+        case op::LD_BCD:
+        case op::LD_I_V0X:
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline void flush(block_cache& cache) {
+    cache.lookup.fill(0u);
+    cache.code_pages = 0u;
+    cache.blocks.clear();
+    cache.ops.clear();
+}
+
+inline void init(block_cache& cache) {
+    flush(cache);
+    cache.blocks.reserve(MAX_BLOCKS);
+    cache.ops.reserve(MAX_BLOCKS * 8u);
+}
+
+// Drop every block overlapping [addr, addr + len). Must be called for any
+// write to mem that does not go through run(), e.g. loading a program
+inline void invalidate(block_cache& cache, uint16_t addr, uint16_t len) {
+    const auto mask = page_mask(addr, len);
+    if (!(mask & cache.code_pages)) {
+        return;
+    }
+    cache.code_pages = 0u;
+    for (auto& b: cache.blocks) {
+        if (!b.live) {
+            continue;
+        }
+        if (b.pages & mask) {
+            b.live = false;
+            cache.lookup[b.start] = 0u;
+        } else {
+            cache.code_pages |= b.pages;
+        }
+    }
+}
+
+inline const block& compile(block_cache& cache, const chip8& cpu, uint16_t start) {
+    if (cache.blocks.size() >= MAX_BLOCKS) {
+        flush(cache);
+    }
+
+    block b{start, 0u, static_cast<uint32_t>(cache.ops.size()), 0u, true};
+    auto addr = start;
+    while (b.len < MAX_BLOCK_LEN && addr < 0x0FFFu) {
+        const auto instruct = static_cast<uint16_t>((cpu.mem[addr] << 8u) | cpu.mem[addr + 1u]);
+        const auto& d = dispatch::DECODE_TABLE[instruct];
+        cache.ops.push_back(d);
+        ++b.len;
+        addr += 2u;
+        if (ends_block(d.code)) {
+            break;
+        }
+    }
+    b.pages = page_mask(start, static_cast<uint16_t>(b.len * 2u));
+
+    cache.code_pages |= b.pages;
+    cache.blocks.push_back(b);
+    cache.lookup[start] = static_cast<uint16_t>(cache.blocks.size());
+    return cache.blocks.back();
+}
+
+// Execute exactly `cycles` instructions, with the same result as
+// dispatch::run(cpu, cycles)
+inline void run(block_cache& cache, chip8& cpu, uint64_t cycles) {
+    while (cycles > 0u) {
+        const auto pc = cpu.pc;
+        if (pc >= 0x0FFFu) {
+            // The instruction wraps the end of mem, leave it to the plain path
+            dispatch::step(cpu);
+            --cycles;
+            continue;
+        }
+
+        const auto idx = cache.lookup[pc];
+        const auto& b = (idx != 0u) ? cache.blocks[idx - 1u] : compile(cache, cpu, pc);
+        const auto n = static_cast<uint16_t>(std::min<uint64_t>(b.len, cycles));
+        const auto* ops = cache.ops.data() + b.first;
+
+        // Only the last op of a block can read pc, so it is set once up front
+        cpu.pc = static_cast<uint16_t>(pc + n * 2u);
+        for (auto k = 0u; k < n; ++k) {
+            dispatch::execute(cpu, ops[k]);
+        }
+        cycles -= n;
+
+        switch (ops[n - 1u].code) {
+            case dispatch::op::LD_BCD: {
+                invalidate(cache, cpu.i, 3u);
+            } break;
+
+            case dispatch::op::LD_I_V0X: {
+                invalidate(cache, cpu.i, static_cast<uint16_t>(ops[n - 1u].x + 1u));
+            } break;
+
+            default: {
+            } break;
+        }
+    }
+}
+
+} // namespace cache
+
+} // namespace chipp8
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+
+/* Headless frame capture
+
+   frame() is called once per emulated frame with the display. A frame
+   equal to the one before it only bumps a counter, so the emulation thread
+   does one 256 byte compare per frame and hands over a copy only when the
+   picture changes. Each distinct frame goes into a single producer, single
+   consumer ring along with the number of frames it stayed on screen, and a
+   worker thread encodes and writes it out, so nothing is held beyond the
+   ring.
+
+   Formats:
+   - y4m: YUV4MPEG2, 64x32 mono at 60 fps, every frame written out in full
+     (1 bit pixels as 0 and 255), repeats included, for ffmpeg and friends
+   - pbm: one binary PBM per distinct frame, named prefix + the frame it
+     first appeared at, zero padded to 8 digits. A picture lasts until the
+     next file's frame
+   - anim: one stream of (duration, frame XOR the previous one) entries,
+     the XOR run-length coded as alternating zero runs and literal bytes.
+     A mostly static session compresses to almost nothing
+*/
+
+namespace chipp8 {
+
+namespace capture {
+
+enum class format : uint8_t {
+    y4m,
+    pbm,
+    anim,
+};
+
+constexpr const uint32_t ANIM_MAGIC = 0x4E413843u; // "C8AN"
+constexpr const uint8_t ANIM_VERSION = 1u;
+constexpr const uint32_t FRAMES_PER_SECOND = 60u;
+constexpr const size_t FRAME_BYTES = DISPLAY_HEIGHT * sizeof(uint64_t);
+
+constexpr const uint32_t DEFAULT_RING_SLOTS = 64u;
+
+struct slot {
+    display pixels;
+    // Frames it stayed on screen
+    uint32_t frames;
+};
+
+// One entry of an anim stream
+struct entry {
+    display pixels;
+    uint32_t frames;
+};
+
+// The display as 256 bytes, rows top to bottom, leftmost pixel in the MSB,
+// which is also PBM's P4 layout
+inline std::array<uint8_t, FRAME_BYTES> to_bytes(const display& pixels) {
+    std::array<uint8_t, FRAME_BYTES> out;
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        for (auto b = 0u; b < 8u; ++b) {
+            out[y * 8u + b] = static_cast<uint8_t>(pixels[y] >> (56u - 8u * b));
+        }
+    }
+    return out;
+}
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80u) {
+        out.push_back(static_cast<uint8_t>(value | 0x80u));
+        value >>= 7u;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool get_varint(const uint8_t* data, size_t size, size_t& pos, uint64_t& value) {
+    value = 0u;
+    for (auto shift = 0u; shift < 64u; shift += 7u) {
+        if (pos >= size) {
+            return false;
+        }
+        const auto byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+        if (!(byte & 0x80u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Append the anim entry for pixels lasting `frames`, against previous
+inline void encode_entry(std::vector<uint8_t>& out, const display& previous, const display& pixels, uint32_t frames) {
+    put_varint(out, frames);
+    display delta;
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        delta[y] = previous[y] ^ pixels[y];
+    }
+    const auto bytes = to_bytes(delta);
+    size_t k = 0u;
+    while (k < FRAME_BYTES) {
+        auto zeros = k;
+        while (zeros < FRAME_BYTES && bytes[zeros] == 0u) {
+            ++zeros;
+        }
+        // A literal run ends at the first two zero bytes in a row
+        auto literal = zeros;
+        while (literal < FRAME_BYTES && !(bytes[literal] == 0u && (literal + 1u == FRAME_BYTES || bytes[literal + 1u] == 0u))) {
+            ++literal;
+        }
+        put_varint(out, zeros - k);
+        put_varint(out, literal - zeros);
+        out.insert(out.end(), bytes.begin() + zeros, bytes.begin() + literal);
+        k = literal;
+    }
+}
+
+inline std::vector<uint8_t> anim_header() {
+    std::vector<uint8_t> out;
+    for (auto b = 0u; b < 4u; ++b) {
+        out.push_back(static_cast<uint8_t>(ANIM_MAGIC >> (8u * b)));
+    }
+    out.push_back(ANIM_VERSION);
+    out.push_back(static_cast<uint8_t>(DISPLAY_WIDTH));
+    out.push_back(static_cast<uint8_t>(DISPLAY_HEIGHT));
+    out.push_back(static_cast<uint8_t>(FRAMES_PER_SECOND));
+    return out;
+}
+
+// Read a whole anim stream, false if it is not one or is cut short
+inline bool decode_anim(const uint8_t* data, size_t size, std::vector<entry>& entries) {
+    const auto header = anim_header();
+    if (size < header.size() || !std::equal(header.begin(), header.end(), data)) {
+        return false;
+    }
+    entries.clear();
+    size_t pos = header.size();
+    display current{};
+    while (pos < size) {
+        uint64_t frames = 0u;
+        if (!get_varint(data, size, pos, frames)) {
+            return false;
+        }
+        std::array<uint8_t, FRAME_BYTES> bytes{};
+        size_t k = 0u;
+        while (k < FRAME_BYTES) {
+            uint64_t zeros = 0u;
+            uint64_t literal = 0u;
+            if (!get_varint(data, size, pos, zeros) || !get_varint(data, size, pos, literal) ||
+                zeros + literal > FRAME_BYTES - k || literal > size - pos) {
+                return false;
+            }
+            k += zeros;
+            std::copy(data + pos, data + pos + literal, bytes.begin() + k);
+            pos += literal;
+            k += literal;
+        }
+        for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+            uint64_t row = 0u;
+            for (auto b = 0u; b < 8u; ++b) {
+                row = (row << 8u) | bytes[y * 8u + b];
+            }
+            current[y] ^= row;
+        }
+        entries.push_back({current, static_cast<uint32_t>(frames)});
+    }
+    return true;
+}
+
+struct writer {
+    format kind;
+    std::string path;
+    FILE* file;
+
+    std::unique_ptr<slot[]> ring;
+    uint32_t ring_slots;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<bool> closing;
+    std::atomic<bool> failed;
+    std::thread worker;
+
+    // Emulation thread only: the picture on screen and for how long
+    display current;
+    uint32_t current_frames;
+    uint64_t frames;
+    uint64_t distinct;
+    // Times a new picture found the ring full and had to wait
+    uint64_t stalls;
+
+    // Worker only
+    display previous;
+    uint64_t written_frames;
+
+    writer() : kind(format::anim), file(nullptr), ring_slots(0u), head(0u), tail(0u), closing(false), failed(false),
+               current{}, current_frames(0u), frames(0u), distinct(0u), stalls(0u), previous{}, written_frames(0u) {}
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    ~writer();
+};
+
+inline bool write_all(FILE* f, const void* data, size_t size) {
+    return fwrite(data, 1u, size, f) == size;
+}
+
+// Encode one slot, on the worker
+inline bool encode(writer& w, const slot& s) {
+    bool ok = true;
+    switch (w.kind) {
+        case format::y4m: {
+            std::array<uint8_t, DISPLAY_WIDTH * DISPLAY_HEIGHT> luma;
+            for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+                for (auto x = 0u; x < DISPLAY_WIDTH; ++x) {
+                    luma[y * DISPLAY_WIDTH + x] = ((s.pixels[y] >> (63u - x)) & 1u) ? 255u : 0u;
+                }
+            }
+            for (uint32_t f = 0u; f < s.frames && ok; ++f) {
+                ok = write_all(w.file, "FRAME\n", 6u) && write_all(w.file, luma.data(), luma.size());
+            }
+        } break;
+        case format::pbm: {
+            char name[16];
+            snprintf(name, sizeof(name), "%08llu.pbm", static_cast<unsigned long long>(w.written_frames));
+            FILE* f = fopen((w.path + name).c_str(), "wb");
+            const auto bytes = to_bytes(s.pixels);
+            ok = f && write_all(f, "P4\n64 32\n", 9u) && write_all(f, bytes.data(), bytes.size());
+            ok = f && (fclose(f) == 0) && ok;
+        } break;
+        case format::anim: {
+            std::vector<uint8_t> out;
+            encode_entry(out, w.previous, s.pixels, s.frames);
+            ok = write_all(w.file, out.data(), out.size());
+        } break;
+    }
+    w.previous = s.pixels;
+    w.written_frames += s.frames;
+    return ok;
+}
+
+// Worker thread body
+inline void drain(writer& w) {
+    for (;;) {
+        const auto t = w.tail.load(std::memory_order_relaxed);
+        if (w.head.load(std::memory_order_acquire) == t) {
+            if (w.closing.load(std::memory_order_acquire) && w.head.load(std::memory_order_acquire) == t) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (!encode(w, w.ring[t % w.ring_slots])) {
+            w.failed.store(true, std::memory_order_relaxed);
+        }
+        w.tail.store(t + 1u, std::memory_order_release);
+    }
+}
+
+// Hand the picture on screen to the worker
+inline void push(writer& w) {
+    const auto h = w.head.load(std::memory_order_relaxed);
+    while (h - w.tail.load(std::memory_order_acquire) == w.ring_slots) {
+        ++w.stalls;
+        std::this_thread::yield();
+    }
+    w.ring[h % w.ring_slots] = {w.current, w.current_frames};
+    w.head.store(h + 1u, std::memory_order_release);
+}
+
+// Start capturing. path is the file for y4m and anim, and the prefix of
+// every file name for pbm, e.g. "out/frame_". False if it cannot be written
+inline bool open(writer& w, format kind, const char* path, uint32_t ring_slots = DEFAULT_RING_SLOTS) {
+    if (w.ring || ring_slots == 0u) {
+        return false;
+    }
+    w.kind = kind;
+    w.path = path;
+    w.file = nullptr;
+    if (kind != format::pbm) {
+        w.file = fopen(path, "wb");
+        if (!w.file) {
+            return false;
+        }
+        bool ok = true;
+        if (kind == format::y4m) {
+            ok = fprintf(w.file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 Cmono\n", static_cast<unsigned>(DISPLAY_WIDTH),
+                static_cast<unsigned>(DISPLAY_HEIGHT), static_cast<unsigned>(FRAMES_PER_SECOND)) > 0;
+        } else {
+            const auto header = anim_header();
+            ok = write_all(w.file, header.data(), header.size());
+        }
+        if (!ok) {
+            fclose(w.file);
+            w.file = nullptr;
+            return false;
+        }
+    }
+    w.ring = std::make_unique<slot[]>(ring_slots);
+    w.ring_slots = ring_slots;
+    w.head.store(0u, std::memory_order_relaxed);
+    w.tail.store(0u, std::memory_order_relaxed);
+    w.closing.store(false, std::memory_order_relaxed);
+    w.failed.store(false, std::memory_order_relaxed);
+    w.current.fill(0u);
+    w.current_frames = 0u;
+    w.frames = 0u;
+    w.distinct = 0u;
+    w.stalls = 0u;
+    w.previous.fill(0u);
+    w.written_frames = 0u;
+    w.worker = std::thread(drain, std::ref(w));
+    return true;
+}
+
+// Capture one frame of the session
+inline void frame(writer& w, const display& pixels) {
+    ++w.frames;
+    if (w.current_frames > 0u && pixels == w.current) {
+        ++w.current_frames;
+        return;
+    }
+    if (w.current_frames > 0u) {
+        push(w);
+    }
+    w.current = pixels;
+    w.current_frames = 1u;
+    ++w.distinct;
+}
+
+// Write out the last picture, wait for the worker and close. False if any
+// write failed
+inline bool close(writer& w) {
+    if (!w.ring) {
+        return false;
+    }
+    if (w.current_frames > 0u) {
+        push(w);
+        w.current_frames = 0u;
+    }
+    w.closing.store(true, std::memory_order_release);
+    w.worker.join();
+    bool ok = !w.failed.load(std::memory_order_relaxed);
+    if (w.file) {
+        ok = (fclose(w.file) == 0) && ok;
+        w.file = nullptr;
+    }
+    w.ring.reset();
+    return ok;
+}
+
+inline writer::~writer() {
+    close(*this);
+}
+
+} // namespace capture
+
+} // namespace chipp8
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <array>
-#include <bitset>
+#include <bit>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "quirks.h"
+#include "rng.h"
 #include "sprites.h"
 
 /* https://en.wikipedia.org/wiki/CHIP-8#Virtual_machine_description
@@ -17,6 +20,19 @@ constexpr const uint16_t FONT_START_ADDR = 0x050u;
 constexpr const uint16_t PROGRAM_START_ADDR = 0x0200u;
 constexpr const uint16_t ETI_660_PROGRAM_START_ADDR = 0x0600u;
 
+constexpr const uint16_t DISPLAY_WIDTH = 64u;
+constexpr const uint16_t DISPLAY_HEIGHT = 32u;
+
+// One word per row, pixel x of a row is bit (63 - x) so that a sprite
+// byte lines up MSB first, the same way it is stored in mem
+using display = std::array<uint64_t, DISPLAY_HEIGHT>;
+
+static_assert(DISPLAY_WIDTH == 64u, "A display row must be exactly one uint64_t");
+
+// Seed of the CXNN stream after init, so that unseeded runs are still
+// reproducible
+constexpr const uint32_t DEFAULT_RNG_SEED = 0x2545F491u;
+
 // Memory MAP
 // 0x000-0x1FF - Chip 8 interpreter (contains font set in emu)
 // 0x050-0x0A0 - Used for the built in 4x5 pixel font set (0-F)
@@ -24,7 +40,7 @@ constexpr const uint16_t ETI_660_PROGRAM_START_ADDR = 0x0600u;
 struct chip8 {
     uint16_t keys;
 
-    std::bitset<64u /*width*/ * 32u /*height*/ > pixels;
+    display pixels;
 
     // Interpreter occupies the first 512 bytes so most
     // programs begin at memory location 512 (0x200).
@@ -68,11 +84,16 @@ struct chip8 {
     uint8_t sp;
 
     std::array<uint16_t, 16u> stack;
+
+    // Position in the random stream behind CXNN, see seed_rng
+    rng::stream rng;
+
+    bool operator==(const chip8&) const = default;
 };
 
 constexpr inline void init(chip8& cpu) {
     cpu.keys = 0u;
-    cpu.pixels.reset();
+    cpu.pixels.fill(0u);
     cpu.mem.fill(0u);
     cpu.v.fill(0u);
     cpu.i = 0u;
@@ -81,6 +102,14 @@ constexpr inline void init(chip8& cpu) {
     cpu.pc = 0u;
     cpu.sp = 0u;
     cpu.stack.fill(0u);
+    cpu.rng = {DEFAULT_RNG_SEED, 0u, 0u};
+}
+
+// Restart CXNN on the stream of (seed, instance). Instances sharing a seed
+// get independent streams, and the same pair gives the same results
+// wherever and whenever it runs
+constexpr inline void seed_rng(chip8& cpu, uint32_t seed, uint32_t instance = 0u) {
+    cpu.rng = {seed, instance, 0u};
 }
 
 constexpr inline void load_font_sprites(chip8& cpu) {
@@ -94,101 +123,143 @@ constexpr inline void load_font_sprites(chip8& cpu) {
     }
 }
 
-constexpr inline uint16_t pop_stack(chip8& cpu) {
+// Reset the machine, load the font and copy a program image to start,
+// anything past the end of mem is dropped. rom::load checks the size first
+constexpr inline void load_program(chip8& cpu, const uint8_t* program, size_t size, uint16_t start = PROGRAM_START_ADDR) {
+    init(cpu);
+    load_font_sprites(cpu);
+    for (size_t k = 0u; k < size && start + k < cpu.mem.size(); ++k) {
+        cpu.mem[start + k] = program[k];
+    }
+    cpu.pc = start;
+}
+
+// Count both timers down towards 0, call at 60 Hz
+constexpr inline void tick_timers(auto& cpu) {
+    if (cpu.d_timer > 0u) {
+        --cpu.d_timer;
+    }
+    if (cpu.s_timer > 0u) {
+        --cpu.s_timer;
+    }
+}
+
+// From here on the machine is any type with the members of chip8, so the
+// same opcode functions also run cow::machine. The opcodes the variants
+// disagree on take a quirks profile Q, see quirks.h
+
+constexpr inline uint16_t pop_stack(auto& cpu) {
     // Take and then decrement
     return cpu.stack[cpu.sp--];
 }
 
-constexpr inline void push_stack(chip8& cpu, uint16_t val) {
+constexpr inline void push_stack(auto& cpu, uint16_t val) {
     // Increment then add
     cpu.stack[++cpu.sp] = val;
 }
 
-constexpr inline uint8_t rand_byte() {
-    // static_assert(false, "rand_byte Not implemented yet");
-    return 0x00;
+// Read the big-endian instruction word at pc, the pc is not changed
+constexpr inline uint16_t fetch(const auto& cpu) {
+    return static_cast<uint16_t>((cpu.mem[cpu.pc & 0x0FFFu] << 8u) | cpu.mem[(cpu.pc + 1u) & 0x0FFFu]);
+}
+
+// Each machine draws from its own generator
+constexpr inline uint8_t rand_byte(auto& cpu) {
+    return rng::next(cpu.rng);
 }
 
 // 00E0  - clear the screen
-constexpr inline void CLS(chip8& cpu) {
-    cpu.pixels.reset();
+constexpr inline void CLS(auto& cpu) {
+    cpu.pixels.fill(0u);
 }
 
 // 00EE - return from subroutine to address pulled from stack
-constexpr inline void RET(chip8& cpu) {
+constexpr inline void RET(auto& cpu) {
     cpu.pc = pop_stack(cpu);
 }
 
 // 0NNN - jump to native assembler subroutine at 0xNNN
-constexpr inline void SYS(chip8& cpu, uint16_t addr) {
+constexpr inline void SYS(auto& cpu, uint16_t addr) {
     cpu.pc = addr;
 }
 
 // 1NNN - jump to address NNN
-constexpr inline void JP(chip8& cpu, uint16_t addr) {
+constexpr inline void JP(auto& cpu, uint16_t addr) {
     cpu.pc = addr;
 }
 
 // 2NNN - push return address onto stack and call subroutine at address NNN
-constexpr inline void CALL(chip8& cpu, uint16_t addr) {
+constexpr inline void CALL(auto& cpu, uint16_t addr) {
     push_stack(cpu, cpu.pc);
     cpu.pc = addr;
 }
 
 // 3XNN - skip next opcode if vX == NN
-constexpr inline void SE(chip8& cpu, uint8_t /*V*/x, uint8_t nn) {
+constexpr inline void SE(auto& cpu, uint8_t /*V*/x, uint8_t nn) {
     if (cpu.v[x] == nn) {
         cpu.pc += 2;
     }
 }
 
 // 4XNN - skip next opcode if vX != NN
-constexpr inline void SNE(chip8& cpu, uint8_t /*V*/x, uint8_t nn) {
+constexpr inline void SNE(auto& cpu, uint8_t /*V*/x, uint8_t nn) {
     if (cpu.v[x] != nn) {
         cpu.pc += 2u;
     }
 }
 
 // 5XY0 - skip next opcode if vX == vY
-constexpr inline void SE_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+constexpr inline void SE_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     if (cpu.v[x] == cpu.v[y]) {
         cpu.pc += 2u;
     }
 }
 
 // 6XNN - set vX to NN
-constexpr inline void LD(chip8& cpu, uint8_t /*V*/x, uint8_t nn) {
+constexpr inline void LD(auto& cpu, uint8_t /*V*/x, uint8_t nn) {
     cpu.v[x] = nn;
 }
 
 // 7XNN - add NN to vX
 // NOTE: The carry flag is not changed
-constexpr inline void ADD(chip8& cpu, uint8_t /*V*/x, uint8_t nn) {
+constexpr inline void ADD(auto& cpu, uint8_t /*V*/x, uint8_t nn) {
     cpu.v[x] += nn;
 }
 
 // 8XY0 - set vX to the value of vY
-constexpr inline void LD_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+constexpr inline void LD_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     cpu.v[x] = cpu.v[y];
 }
 
 // 8XY1 - set vX to the result of bitwise vX OR vY
-constexpr inline void OR_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+template <typename Q = quirks::modern>
+constexpr inline void OR_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     cpu.v[x] = (cpu.v[x] | cpu.v[y]);
+    if constexpr (Q::logic_resets_vf) {
+        cpu.v[0xFu] = 0u;
+    }
 }
 
 // 8XY2 - set vX to the result of bitwise vX AND vY
-constexpr inline void AND_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+template <typename Q = quirks::modern>
+constexpr inline void AND_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     cpu.v[x] = (cpu.v[x] & cpu.v[y]);
+    if constexpr (Q::logic_resets_vf) {
+        cpu.v[0xFu] = 0u;
+    }
 }
 
 // 8XY3 - set vX to the result of bitwise vX XOR vY
-constexpr inline void XOR_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+template <typename Q = quirks::modern>
+constexpr inline void XOR_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     cpu.v[x] = (cpu.v[x] ^ cpu.v[y]);
+    if constexpr (Q::logic_resets_vf) {
+        cpu.v[0xFu] = 0u;
+    }
 }
 
 // 8XY4 - add vY to vX, vF is set to 1 if an overflow happened, to 0 if not, even if X=F!
-constexpr inline void ADD_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+constexpr inline void ADD_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     uint16_t sum = cpu.v[x] + cpu.v[y];
     if (sum > 255u) {
         cpu.v[0xFu] = 1u;
@@ -199,7 +270,7 @@ constexpr inline void ADD_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
 }
 
 // 8XY5 - subtract vY from vX, vF is set to 0 if an underflow happened, to 1 if not, even if X=F!
-constexpr inline void SUB_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+constexpr inline void SUB_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     if (cpu.v[x] > cpu.v[y]) {
         cpu.v[0xFu] = 1u;
     } else {
@@ -209,13 +280,16 @@ constexpr inline void SUB_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
 }
 
 // 8XY6 - If the least-significant bit of Vx is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
-constexpr inline void SHR(chip8& cpu, uint8_t /*V*/x) {
-    cpu.v[0xFu] = cpu.v[x] & 0x01u;
-    cpu.v[x] >>= 1u;
+// With Q::shift_vy, Vx = Vy >> 1 and VF is the bit shifted out of Vy. VF is written last, even if X=F!
+template <typename Q = quirks::modern>
+constexpr inline void SHR(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y = 0u) {
+    const uint8_t value = Q::shift_vy ? cpu.v[y] : cpu.v[x];
+    cpu.v[x] = static_cast<uint8_t>(value >> 1u);
+    cpu.v[0xFu] = value & 0x01u;
 }
 
 // 8XY7 - set vX to the result of subtracting vX from vY, vF is set to 0 if an underflow happened, to 1 if not, even if X=F!
-constexpr inline void SUBN_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+constexpr inline void SUBN_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     if (cpu.v[y] > cpu.v[x]) {
         cpu.v[0xFu] = 1u;
     } else {
@@ -225,31 +299,70 @@ constexpr inline void SUBN_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
 }
 
 // 8XYE - set vX to vY and shift vX one bit to the left, set vF to the bit shifted out, even if X=F!
-constexpr inline void SHL(chip8& cpu, uint8_t /*V*/x) {
-    cpu.v[0xFu] = cpu.v[x] & 0x80u;
-    cpu.v[x] <<= 1u;
+template <typename Q = quirks::modern>
+constexpr inline void SHL(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y = 0u) {
+    const uint8_t value = Q::shift_vy ? cpu.v[y] : cpu.v[x];
+    cpu.v[x] = static_cast<uint8_t>(value << 1u);
+    cpu.v[0xFu] = (value >> 7u) & 0x01u;
 }
 
 // 9XY0 - skip next opcode if vX != vY
-constexpr inline void SNE_REG(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
+constexpr inline void SNE_REG(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y) {
     if (cpu.v[x] != cpu.v[y]) {
         cpu.pc += 2u;
     }
 }
 
 // ANNN - set I to NNN
-constexpr inline void LD_I(chip8& cpu, uint16_t addr) {
+constexpr inline void LD_I(auto& cpu, uint16_t addr) {
     cpu.i = addr;
 }
 
-// BNNN - jump to address NNN + v0
-constexpr inline void JP_V0(chip8& cpu, uint16_t nnn) {
-    cpu.pc = cpu.v[0x0u] + nnn;
+// BNNN - jump to address NNN + v0, or BXNN - to XNN + vX with Q::jump_vx
+template <typename Q = quirks::modern>
+constexpr inline void JP_V0(auto& cpu, uint16_t nnn) {
+    if constexpr (Q::jump_vx) {
+        cpu.pc = cpu.v[(nnn >> 8u) & 0x0Fu] + nnn;
+    } else {
+        cpu.pc = cpu.v[0x0u] + nnn;
+    }
 }
 
 // CXNN - set vx to a random value masked (bitwise AND) (Typically: 0 to 255) with NN
-constexpr inline void RND(chip8& cpu, uint8_t /*V*/x, uint8_t nn) {
-    cpu.v[x] = rand_byte() & nn;
+constexpr inline void RND(auto& cpu, uint8_t /*V*/x, uint8_t nn) {
+    cpu.v[x] = rand_byte(cpu) & nn;
+}
+
+// XOR the n byte sprite at addr onto the display at (x, y), wrapping at the
+// edges, or cut off at them with Q::clip_sprites. Returns true if any pixel
+// was turned off
+template <typename Q = quirks::modern>
+constexpr inline bool draw_sprite(display& pixels, const auto& mem, uint16_t addr, uint8_t x, uint8_t y, uint8_t n) {
+    const auto start_x = x % DISPLAY_WIDTH;
+
+    uint64_t collision = 0u;
+    if constexpr (Q::clip_sprites) {
+        const auto start_y = y % DISPLAY_HEIGHT;
+        const uint32_t rows = (n < DISPLAY_HEIGHT - start_y) ? n : DISPLAY_HEIGHT - start_y;
+        for (auto i = 0u; i < rows; ++i) {
+            // The bits shifted off the right edge are dropped
+            const auto sprite = (static_cast<uint64_t>(mem[addr + i]) << 56u) >> start_x;
+            auto& row = pixels[start_y + i];
+            collision |= (row & sprite);
+            row ^= sprite;
+        }
+    } else {
+        for (auto i = 0u; i < n; ++i) {
+            // Put the sprite byte in the leftmost 8 pixels then rotate it into
+            // place, the bits rotated off the right edge wrap around to the left
+            const auto sprite = std::rotr(static_cast<uint64_t>(mem[addr + i]) << 56u, start_x);
+            auto& row = pixels[(y + i) % DISPLAY_HEIGHT]; // Wrap y
+            // Collision!
+            collision |= (row & sprite);
+            row ^= sprite;
+        }
+    }
+    return collision != 0u;
 }
 
 // DXYN - draw 8xN pixel sprite at position vX, vY with data
@@ -259,54 +372,38 @@ constexpr inline void RND(chip8& cpu, uint8_t /*V*/x, uint8_t nn) {
 // memory location I; I value does not change after the execution of this instruction.
 // As described above, VF is set to 1 if any screen pixels are flipped from
 // set to unset when the sprite is drawn, and to 0 if that does not happen.
-constexpr inline void DRW(chip8& cpu, uint8_t /*V*/x, uint8_t /*V*/y, uint8_t n) {
-    auto start_x = cpu.v[x];
-    auto start_y = cpu.v[y];
-    cpu.v[0xFu] = 0u;
-
-    constexpr auto bit_width = sizeof(decltype(cpu.mem[0])) * 8u;
-    std::bitset<bit_width> buf;
-    for (auto i = 0u; i < n; ++i) {
-        // const auto buf = cpu.mem[cpu.i + i];
-        buf = cpu.mem[cpu.i + i];
-        const auto idx_y = (start_y + i);
-        const auto draw_y = (idx_y % 32u); // Wrap y
-        for (auto j = 0; j < bit_width; ++j) {
-            const auto idx_x = (start_x + j);
-            const auto draw_x = (idx_x % 64u); // Wrap x
-            // const bool sprite_pixel_active = static_cast<bool>((buf & (1u << (bit_width - j - 1u))));
-            const bool sprite_pixel_active = buf[bit_width - j - 1u];
-            const auto draw_index = draw_x + (draw_y * 64u);
-            // Collision!
-            if (sprite_pixel_active && cpu.pixels[draw_index]) {
-                cpu.v[0xFu] = 1u;
-            }
-            cpu.pixels[draw_index] = (cpu.pixels[draw_index] != sprite_pixel_active);
-        }
-    }
+template <typename Q = quirks::modern>
+constexpr inline void DRW(auto& cpu, uint8_t /*V*/x, uint8_t /*V*/y, uint8_t n) {
+    const bool collision = draw_sprite<Q>(cpu.pixels, cpu.mem, cpu.i, cpu.v[x], cpu.v[y], n);
+    cpu.v[0xFu] = collision ? 1u : 0u;
+}
+
+// Pixel state at (x, y) of the display
+constexpr inline bool get_pixel(const auto& cpu, uint16_t x, uint16_t y) {
+    return (cpu.pixels[y] >> (DISPLAY_WIDTH - 1u - x)) & 1u;
 }
 
 // EX9E - Skip next instruction if key with the value of Vx is pressed.
-constexpr inline void SKP(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void SKP(auto& cpu, uint8_t /*V*/x) {
     if (cpu.keys & (1u << cpu.v[x])) {
         cpu.pc += 2u;
     }
 }
 
 // EXA1 - Skip next instruction if key with the value of Vx is not pressed.
-constexpr inline void SKNP(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void SKNP(auto& cpu, uint8_t /*V*/x) {
     if (!(cpu.keys & (1u << cpu.v[x]))) {
         cpu.pc += 2u;
     }
 }
 
 // FX07 - set vX to the value of the delay timer
-constexpr inline void LD_REG_DT(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void LD_REG_DT(auto& cpu, uint8_t /*V*/x) {
     cpu.v[x] = cpu.d_timer;
 }
 
 // FX0A - Wait for a key press, store the value of the key in Vx
-constexpr inline void WAIT_KP(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void WAIT_KP(auto& cpu, uint8_t /*V*/x) {
     if (cpu.keys & 0xFFFF) {
         cpu.v[x] = cpu.keys;
     } else {
@@ -317,27 +414,27 @@ constexpr inline void WAIT_KP(chip8& cpu, uint8_t /*V*/x) {
 }
 
 // FX15 - set delay timer to vX
-constexpr inline void LD_DT_REG(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void LD_DT_REG(auto& cpu, uint8_t /*V*/x) {
     cpu.d_timer = cpu.v[x];
 }
 
 // FX18 - set sound timer to vX, sound is played as long as the sound timer reaches zero
-constexpr inline void LD_ST_REG(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void LD_ST_REG(auto& cpu, uint8_t /*V*/x) {
     cpu.s_timer = cpu.v[x];
 }
 
 // FX1E - add vX to I
-constexpr inline void ADD_I_REG(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void ADD_I_REG(auto& cpu, uint8_t /*V*/x) {
     cpu.i += cpu.v[x];
 }
 
 // FX29 - Set I = location of sprite for digit Vx
-constexpr inline void LD_FONT(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void LD_FONT(auto& cpu, uint8_t /*V*/x) {
     cpu.i = FONT_START_ADDR + (sprites::FONT_SIZE * cpu.v[x]);
 }
 
 // FX33 - Store BCD representation of Vx in memory locations I, I+1, and I+2. (hundreds, tens, ones)
-constexpr inline void LD_BCD(chip8& cpu, uint8_t /*V*/x) {
+constexpr inline void LD_BCD(auto& cpu, uint8_t /*V*/x) {
     auto val = cpu.v[x];
 
     // Ones
@@ -353,21 +450,30 @@ constexpr inline void LD_BCD(chip8& cpu, uint8_t /*V*/x) {
 }
 
 // FX55 - Store registers V0 through Vx in memory starting at location I.
-constexpr inline void LD_I_V0X(chip8& cpu, uint8_t /*V*/x) {
+// With Q::load_store_increments_i, I ends up at I + X + 1
+template <typename Q = quirks::modern>
+constexpr inline void LD_I_V0X(auto& cpu, uint8_t /*V*/x) {
     for (auto i = 0u; i <= x; ++i) {
         cpu.mem[cpu.i + i] = cpu.v[i];
     }
+    if constexpr (Q::load_store_increments_i) {
+        cpu.i += x + 1u;
+    }
 }
 
 // FX65- Read registers V0 through Vx from memory starting at location I.
-constexpr inline void LD_V0X_I(chip8& cpu, uint8_t /*V*/x) {
+template <typename Q = quirks::modern>
+constexpr inline void LD_V0X_I(auto& cpu, uint8_t /*V*/x) {
     for (auto i = 0u; i <= x; ++i) {
         cpu.v[i] = cpu.mem[cpu.i + i];
     }
+    if constexpr (Q::load_store_increments_i) {
+        cpu.i += x + 1u;
+    }
 }
 
-
-constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
+template <typename Q = quirks::modern>
+constexpr bool parse_op(auto& cpu, uint16_t instruct) {
     switch (instruct & 0xF000u) {
         case 0x0000u: {
             switch (instruct & 0x0FFFu) {
@@ -432,19 +538,19 @@ constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
                 } break;
 
                 case 0x0001u: {
-                    OR_REG(cpu,
+                    OR_REG<Q>(cpu,
                         static_cast<uint8_t>((instruct & 0x0F00u) >> 8u),
                         static_cast<uint8_t>((instruct & 0x00F0u) >> 4u));
                 } break;
 
                 case 0x0002u: {
-                    AND_REG(cpu,
+                    AND_REG<Q>(cpu,
                         static_cast<uint8_t>((instruct & 0x0F00u) >> 8u),
                         static_cast<uint8_t>((instruct & 0x00F0u) >> 4u));
                 } break;
 
                 case 0x0003u: {
-                    XOR_REG(cpu,
+                    XOR_REG<Q>(cpu,
                         static_cast<uint8_t>((instruct & 0x0F00) >> 8u),
                         static_cast<uint8_t>((instruct & 0x00F0) >> 4u));
                 } break;
@@ -462,7 +568,9 @@ constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
                 } break;
 
                 case 0x0006u: {
-                    SHR(cpu, static_cast<uint8_t>((instruct & 0x0F00u) >> 8u));
+                    SHR<Q>(cpu,
+                        static_cast<uint8_t>((instruct & 0x0F00u) >> 8u),
+                        static_cast<uint8_t>((instruct & 0x00F0u) >> 4u));
                 } break;
 
                 case 0x0007u: {
@@ -472,7 +580,9 @@ constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
                 } break;
 
                 case 0x000Eu: {
-                    SHL(cpu, static_cast<uint8_t>((instruct & 0x0F00u) >> 8u));
+                    SHL<Q>(cpu,
+                        static_cast<uint8_t>((instruct & 0x0F00u) >> 8u),
+                        static_cast<uint8_t>((instruct & 0x00F0u) >> 4u));
                 } break;
             }
         } break;
@@ -488,7 +598,7 @@ constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
         } break;
 
         case 0xB000u: {
-            JP_V0(cpu, instruct & 0x0FFFu);
+            JP_V0<Q>(cpu, instruct & 0x0FFFu);
         } break;
 
         case 0xC000u: {
@@ -498,7 +608,7 @@ constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
         } break;
 
         case 0xD000u: {
-            DRW(cpu,
+            DRW<Q>(cpu,
                 static_cast<uint8_t>((instruct & 0x0F00u) >> 8u),
                 static_cast<uint8_t>((instruct & 0x00F0u) >> 4u),
                 static_cast<uint8_t>((instruct & 0x000Fu)));
@@ -547,11 +657,11 @@ constexpr bool parse_op(chip8& cpu, uint16_t instruct) {
                 } break;
 
                 case 0x0055u: {
-                    LD_I_V0X(cpu, static_cast<uint8_t>((instruct & 0x0F00u) >> 8u));
+                    LD_I_V0X<Q>(cpu, static_cast<uint8_t>((instruct & 0x0F00u) >> 8u));
                 } break;
 
                 case 0x0065u: {
-                    LD_V0X_I(cpu, static_cast<uint8_t>((instruct & 0x0F00u) >> 8u));
+                    LD_V0X_I<Q>(cpu, static_cast<uint8_t>((instruct & 0x0F00u) >> 8u));
                 } break;
             }
         } break;
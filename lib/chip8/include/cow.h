@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+#include "chip8.h"
+
+/* Copy-on-write machines
+
+   cow::machine has the same members as chip8, except that mem is split in
+   PAGE_COUNT reference counted pages. fork() copies the registers and the
+   display and only bumps the page counts, so every child shares mem with
+   its parent until it writes to it. The only guest writes are FX33 and
+   FX55, which copy the page they hit first if anyone else still holds it.
+
+   The counts are atomic, so any number of threads can fork from one root
+   at the same time, as long as nothing is running the root itself. A
+   machine writes a page in place only once it sees itself as the last
+   holder with an acquire load, which pairs with the release of every
+   other holder letting go, so their reads of the page happen before the
+   write. shared_ptr::use_count() is a relaxed load and gives no such
+   order, hence the count kept in the page itself.
+
+   The opcode functions in chip8.h take any machine, so a cow::machine runs
+   through exactly the same code as a chip8, via parse_op.
+*/
+
+namespace chipp8 {
+
+namespace cow {
+
+constexpr const uint16_t PAGE_SIZE = 512u;
+constexpr const uint16_t PAGE_COUNT = 4096u / PAGE_SIZE;
+
+using page = std::array<uint8_t, PAGE_SIZE>;
+
+// A page and the number of machines holding it
+struct shared_page {
+    page bytes;
+    std::atomic<uint32_t> refs;
+};
+
+// Counted handle to a shared_page, copied by fork()
+struct page_ref {
+    shared_page* p;
+
+    page_ref() : p(nullptr) {}
+    explicit page_ref(const page& bytes) : p(new shared_page{bytes, 1u}) {}
+
+    page_ref(const page_ref& other) : p(other.p) {
+        if (p) {
+            p->refs.fetch_add(1u, std::memory_order_relaxed);
+        }
+    }
+
+    page_ref(page_ref&& other) noexcept : p(std::exchange(other.p, nullptr)) {}
+
+    page_ref& operator=(page_ref other) noexcept {
+        std::swap(p, other.p);
+        return *this;
+    }
+
+    ~page_ref() {
+        // Release so that this holder's reads happen before a write in place
+        // by the last one, acquire so that the last one deleting sees them
+        if (p && p->refs.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+            delete p;
+        }
+    }
+
+    const page& operator*() const { return p->bytes; }
+    page& operator*() { return p->bytes; }
+
+    // No other machine holds the page, and none will read it again
+    bool unique() const {
+        return p->refs.load(std::memory_order_acquire) == 1u;
+    }
+};
+
+struct paged_mem;
+
+// What a write through mem[addr] lands on
+struct byte_ref {
+    paged_mem& mem;
+    size_t addr;
+
+    operator uint8_t() const;
+    byte_ref& operator=(uint8_t value);
+};
+
+struct paged_mem {
+    std::array<page_ref, PAGE_COUNT> pages;
+
+    uint8_t operator[](size_t addr) const {
+        return (*pages[addr / PAGE_SIZE])[addr % PAGE_SIZE];
+    }
+
+    byte_ref operator[](size_t addr) {
+        return {*this, addr};
+    }
+
+    constexpr size_t size() const {
+        return 4096u;
+    }
+};
+
+// Take a private copy of the page holding addr unless it already is one
+inline uint8_t& writable(paged_mem& mem, size_t addr) {
+    auto& p = mem.pages[addr / PAGE_SIZE];
+    if (!p.unique()) {
+        p = page_ref(*std::as_const(p));
+    }
+    return (*p)[addr % PAGE_SIZE];
+}
+
+inline byte_ref::operator uint8_t() const {
+    return std::as_const(mem)[addr];
+}
+
+inline byte_ref& byte_ref::operator=(uint8_t value) {
+    writable(mem, addr) = value;
+    return *this;
+}
+
+struct machine {
+    uint16_t keys;
+    display pixels;
+    paged_mem mem;
+    std::array<uint8_t, 16u> v;
+    uint16_t i;
+    uint8_t d_timer;
+    uint8_t s_timer;
+    uint16_t pc;
+    uint8_t sp;
+    std::array<uint16_t, 16u> stack;
+    rng::stream rng;
+};
+
+// Fresh pages holding the state of cpu
+inline void load(machine& m, const chip8& cpu) {
+    m.keys = cpu.keys;
+    m.pixels = cpu.pixels;
+    for (auto p = 0u; p < PAGE_COUNT; ++p) {
+        page fresh;
+        std::copy_n(cpu.mem.begin() + p * PAGE_SIZE, PAGE_SIZE, fresh.begin());
+        m.mem.pages[p] = page_ref(fresh);
+    }
+    m.v = cpu.v;
+    m.i = cpu.i;
+    m.d_timer = cpu.d_timer;
+    m.s_timer = cpu.s_timer;
+    m.pc = cpu.pc;
+    m.sp = cpu.sp;
+    m.stack = cpu.stack;
+    m.rng = cpu.rng;
+}
+
+inline void store(const machine& m, chip8& cpu) {
+    cpu.keys = m.keys;
+    cpu.pixels = m.pixels;
+    for (auto p = 0u; p < PAGE_COUNT; ++p) {
+        std::copy_n((*m.mem.pages[p]).begin(), PAGE_SIZE, cpu.mem.begin() + p * PAGE_SIZE);
+    }
+    cpu.v = m.v;
+    cpu.i = m.i;
+    cpu.d_timer = m.d_timer;
+    cpu.s_timer = m.s_timer;
+    cpu.pc = m.pc;
+    cpu.sp = m.sp;
+    cpu.stack = m.stack;
+    cpu.rng = m.rng;
+}
+
+// A child sharing every page of mem with parent
+inline machine fork(const machine& parent) {
+    return parent;
+}
+
+// Pages held by this machine alone
+inline size_t private_pages(const machine& m) {
+    size_t n = 0u;
+    for (const auto& p: m.mem.pages) {
+        n += p.unique() ? 1u : 0u;
+    }
+    return n;
+}
+
+inline void step(machine& m) {
+    const auto instruct = fetch(m);
+    m.pc += 2u;
+    parse_op(m, instruct);
+}
+
+inline void run(machine& m, uint64_t cycles) {
+    for (uint64_t c = 0u; c < cycles; ++c) {
+        step(m);
+    }
+}
+
+} // namespace cow
+
+} // namespace chipp8
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+
+/* Breakpoints and watchpoints
+
+   A debugger holds one 4096 bit map per kind of stop, indexed by address:
+   pcs to break at, and addresses to watch for reads and for writes through
+   I. debug::run checks the pc bit before every instruction, and the watch
+   bits only for the four opcodes that go through I (DXYN and FX65 read,
+   FX33 and FX55 write), so a handful of breakpoints costs one bit test per
+   instruction rather than a scan of a list.
+
+   A breakpoint can carry a condition on a v register, e.g. break at 0x2A4
+   once v3 == 7. The conditions of a pc are only looked at when its bit is
+   set.
+
+   With nothing armed debug::run is dispatch::run.
+
+   run() stops before the instruction that hit, with cpu still on it. The
+   next run() executes that instruction without checking it, so calling it
+   again continues.
+*/
+
+namespace chipp8 {
+
+namespace debug {
+
+using bitmap = std::array<uint64_t, 4096u / 64u>;
+
+enum class stop : uint8_t {
+    // Ran all the cycles
+    none,
+    breakpoint,
+    condition,
+    read,
+    write,
+};
+
+enum class compare : uint8_t {
+    eq,
+    ne,
+    lt,
+    ge,
+};
+
+// Break at pc when v[reg] compares to value
+struct condition {
+    uint16_t pc;
+    uint8_t reg;
+    compare cmp;
+    uint8_t value;
+};
+
+struct hit {
+    stop reason;
+    // The instruction stopped at, not executed yet
+    uint16_t pc;
+    // First watched address the instruction would touch
+    uint16_t addr;
+    // Instructions executed by this run
+    uint64_t executed;
+};
+
+struct debugger {
+    // pcs with a breakpoint, conditional or not
+    bitmap exec;
+    // pcs with an unconditional breakpoint
+    bitmap always;
+    bitmap reads;
+    bitmap writes;
+    std::vector<condition> conditions;
+    // Bits set in exec, reads and writes
+    uint32_t exec_count;
+    uint32_t watch_count;
+    // Step over the instruction at cpu.pc without checking it
+    bool resuming;
+};
+
+constexpr inline bool test(const bitmap& b, uint16_t addr) {
+    return (b[(addr >> 6u) & 0x3Fu] >> (addr & 0x3Fu)) & 1u;
+}
+
+// Sets or clears the bit, returns +1 or -1 if that changed it, else 0
+constexpr inline int change(bitmap& b, uint16_t addr, bool on) {
+    const bool was = test(b, addr);
+    auto& word = b[(addr >> 6u) & 0x3Fu];
+    const auto bit = 1ull << (addr & 0x3Fu);
+    word = on ? (word | bit) : (word & ~bit);
+    return static_cast<int>(on) - static_cast<int>(was);
+}
+
+// Offset of the first bit set among [addr, addr + len) with len <= 64,
+// wrapping at 4096, or len if there is none
+constexpr inline uint32_t first_in(const bitmap& b, uint16_t addr, uint32_t len) {
+    const auto word = (addr >> 6u) & 0x3Fu;
+    const auto offset = addr & 0x3Fu;
+    uint64_t window = b[word] >> offset;
+    if (offset != 0u) {
+        window |= b[(word + 1u) & 0x3Fu] << (64u - offset);
+    }
+    if (len < 64u) {
+        window &= (1ull << len) - 1u;
+    }
+    return window ? static_cast<uint32_t>(std::countr_zero(window)) : len;
+}
+
+constexpr inline void init(debugger& dbg) {
+    dbg.exec.fill(0u);
+    dbg.always.fill(0u);
+    dbg.reads.fill(0u);
+    dbg.writes.fill(0u);
+    dbg.conditions.clear();
+    dbg.exec_count = 0u;
+    dbg.watch_count = 0u;
+    dbg.resuming = false;
+}
+
+constexpr inline bool armed(const debugger& dbg) {
+    return dbg.exec_count != 0u || dbg.watch_count != 0u;
+}
+
+inline void set_breakpoint(debugger& dbg, uint16_t pc) {
+    change(dbg.always, pc, true);
+    dbg.exec_count += change(dbg.exec, pc, true);
+}
+
+inline void set_condition(debugger& dbg, uint16_t pc, uint8_t reg, compare cmp, uint8_t value) {
+    dbg.conditions.push_back({static_cast<uint16_t>(pc & 0x0FFFu), static_cast<uint8_t>(reg & 0x0Fu), cmp, value});
+    dbg.exec_count += change(dbg.exec, pc, true);
+}
+
+// Drops the breakpoint at pc and every condition on it
+inline void clear_breakpoint(debugger& dbg, uint16_t pc) {
+    pc &= 0x0FFFu;
+    change(dbg.always, pc, false);
+    dbg.exec_count += change(dbg.exec, pc, false);
+    std::erase_if(dbg.conditions, [pc](const condition& c) { return c.pc == pc; });
+}
+
+// Watch [addr, addr + len) for reads, writes or both
+inline void watch(debugger& dbg, uint16_t addr, uint16_t len, bool on_read, bool on_write) {
+    for (uint32_t k = 0u; k < len; ++k) {
+        const auto a = static_cast<uint16_t>(addr + k);
+        if (on_read) {
+            dbg.watch_count += change(dbg.reads, a, true);
+        }
+        if (on_write) {
+            dbg.watch_count += change(dbg.writes, a, true);
+        }
+    }
+}
+
+// Stop watching [addr, addr + len) for anything
+inline void unwatch(debugger& dbg, uint16_t addr, uint16_t len) {
+    for (uint32_t k = 0u; k < len; ++k) {
+        const auto a = static_cast<uint16_t>(addr + k);
+        dbg.watch_count += change(dbg.reads, a, false);
+        dbg.watch_count += change(dbg.writes, a, false);
+    }
+}
+
+constexpr inline bool holds(const condition& c, const chip8& cpu) {
+    const auto v = cpu.v[c.reg];
+    switch (c.cmp) {
+        case compare::eq: return v == c.value;
+        case compare::ne: return v != c.value;
+        case compare::lt: return v < c.value;
+        case compare::ge: return v >= c.value;
+    }
+    return false;
+}
+
+// Why the instruction d at cpu.pc should stop, and the address for a watch
+inline stop check(const debugger& dbg, const chip8& cpu, const dispatch::decoded_op& d, uint16_t& addr) {
+    if (test(dbg.exec, cpu.pc)) {
+        if (test(dbg.always, cpu.pc)) {
+            return stop::breakpoint;
+        }
+        const auto pc = static_cast<uint16_t>(cpu.pc & 0x0FFFu);
+        for (const auto& c: dbg.conditions) {
+            if (c.pc == pc && holds(c, cpu)) {
+                return stop::condition;
+            }
+        }
+    }
+    if (dbg.watch_count == 0u) {
+        return stop::none;
+    }
+    const bitmap* watched = nullptr;
+    uint32_t len = 0u;
+    stop reason = stop::none;
+    switch (d.code) {
+        case dispatch::op::DRW:      watched = &dbg.reads;  len = d.n;      reason = stop::read;  break;
+        case dispatch::op::LD_V0X_I: watched = &dbg.reads;  len = d.x + 1u; reason = stop::read;  break;
+        case dispatch::op::LD_BCD:   watched = &dbg.writes; len = 3u;       reason = stop::write; break;
+        case dispatch::op::LD_I_V0X: watched = &dbg.writes; len = d.x + 1u; reason = stop::write; break;
+        default: return stop::none;
+    }
+    const auto offset = first_in(*watched, cpu.i, len);
+    if (offset == len) {
+        return stop::none;
+    }
+    addr = static_cast<uint16_t>((cpu.i + offset) & 0x0FFFu);
+    return reason;
+}
+
+// Run up to cycles instructions, stopping before the first one that hits a
+// breakpoint or touches a watched address
+template <typename Q = quirks::modern>
+inline hit run(debugger& dbg, chip8& cpu, uint64_t cycles) {
+    if (!armed(dbg)) {
+        dispatch::run<Q>(cpu, cycles);
+        dbg.resuming = false;
+        return {stop::none, cpu.pc, 0u, cycles};
+    }
+    bool skip = dbg.resuming;
+    dbg.resuming = false;
+    for (uint64_t c = 0u; c < cycles; ++c) {
+        const auto& d = dispatch::DECODE_TABLE_FOR<Q>[fetch(cpu)];
+        if (!skip) {
+            uint16_t addr = 0u;
+            const auto reason = check(dbg, cpu, d, addr);
+            if (reason != stop::none) {
+                dbg.resuming = true;
+                return {reason, cpu.pc, addr, c};
+            }
+        }
+        skip = false;
+        cpu.pc += 2u;
+        dispatch::execute(cpu, d);
+    }
+    return {stop::none, cpu.pc, 0u, cycles};
+}
+
+} // namespace debug
+
+} // namespace chipp8
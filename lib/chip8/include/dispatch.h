@@ -0,0 +1,264 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+/* Table driven dispatch
+
+   Every one of the 65536 possible instruction words is decoded once, at
+   compile time, into a decoded_op holding the opcode kind and its
+   X/Y/N/NN/NNN operands and the handler that runs it. Executing an
+   instruction is then a single table load plus an indirect call, instead of
+   re-masking the word through the nested switch in parse_op.
+
+   Every table, step and run takes a quirks profile Q, so each profile gets
+   its own decode table whose handlers have the quirks compiled in, e.g.
+   chip8_core<quirks::cosmac_vip>::run. Without one they use quirks::modern.
+*/
+
+namespace chipp8 {
+
+namespace dispatch {
+
+// One entry per opcode function in chip8.h, in opcode order.
+// NOP covers the words parse_op ignores (8XY8, EX00, FX99, ...)
+enum class op : uint8_t {
+    NOP,
+    CLS,
+    RET,
+    SYS,
+    JP,
+    CALL,
+    SE,
+    SNE,
+    SE_REG,
+    LD,
+    ADD,
+    LD_REG,
+    OR_REG,
+    AND_REG,
+    XOR_REG,
+    ADD_REG,
+    SUB_REG,
+    SHR,
+    SUBN_REG,
+    SHL,
+    SNE_REG,
+    LD_I,
+    JP_V0,
+    RND,
+    DRW,
+    SKP,
+    SKNP,
+    LD_REG_DT,
+    WAIT_KP,
+    LD_DT_REG,
+    LD_ST_REG,
+    ADD_I_REG,
+    LD_FONT,
+    LD_BCD,
+    LD_I_V0X,
+    LD_V0X_I,
+    COUNT
+};
+
+constexpr const auto OP_COUNT = static_cast<size_t>(op::COUNT);
+
+struct decoded_op;
+
+using handler = void (*)(chip8&, const decoded_op&);
+
+// 16 bytes, the handler plus every operand pre-decoded
+struct decoded_op {
+    handler fn;
+    op code;
+    uint8_t x;
+    uint8_t y;
+    uint8_t n;
+    uint8_t nn;
+    uint16_t nnn;
+};
+
+template <typename Q = quirks::modern>
+constexpr inline std::array<handler, OP_COUNT> build_handler_table() {
+    std::array<handler, OP_COUNT> h{};
+    h[static_cast<size_t>(op::NOP)]       = [](chip8&, const decoded_op&) {};
+    h[static_cast<size_t>(op::CLS)]       = [](chip8& cpu, const decoded_op&) { CLS(cpu); };
+    h[static_cast<size_t>(op::RET)]       = [](chip8& cpu, const decoded_op&) { RET(cpu); };
+    h[static_cast<size_t>(op::SYS)]       = [](chip8& cpu, const decoded_op& d) { SYS(cpu, d.nnn); };
+    h[static_cast<size_t>(op::JP)]        = [](chip8& cpu, const decoded_op& d) { JP(cpu, d.nnn); };
+    h[static_cast<size_t>(op::CALL)]      = [](chip8& cpu, const decoded_op& d) { CALL(cpu, d.nnn); };
+    h[static_cast<size_t>(op::SE)]        = [](chip8& cpu, const decoded_op& d) { SE(cpu, d.x, d.nn); };
+    h[static_cast<size_t>(op::SNE)]       = [](chip8& cpu, const decoded_op& d) { SNE(cpu, d.x, d.nn); };
+    h[static_cast<size_t>(op::SE_REG)]    = [](chip8& cpu, const decoded_op& d) { SE_REG(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::LD)]        = [](chip8& cpu, const decoded_op& d) { LD(cpu, d.x, d.nn); };
+    h[static_cast<size_t>(op::ADD)]       = [](chip8& cpu, const decoded_op& d) { ADD(cpu, d.x, d.nn); };
+    h[static_cast<size_t>(op::LD_REG)]    = [](chip8& cpu, const decoded_op& d) { LD_REG(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::OR_REG)]    = [](chip8& cpu, const decoded_op& d) { OR_REG<Q>(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::AND_REG)]   = [](chip8& cpu, const decoded_op& d) { AND_REG<Q>(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::XOR_REG)]   = [](chip8& cpu, const decoded_op& d) { XOR_REG<Q>(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::ADD_REG)]   = [](chip8& cpu, const decoded_op& d) { ADD_REG(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::SUB_REG)]   = [](chip8& cpu, const decoded_op& d) { SUB_REG(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::SHR)]       = [](chip8& cpu, const decoded_op& d) { SHR<Q>(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::SUBN_REG)]  = [](chip8& cpu, const decoded_op& d) { SUBN_REG(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::SHL)]       = [](chip8& cpu, const decoded_op& d) { SHL<Q>(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::SNE_REG)]   = [](chip8& cpu, const decoded_op& d) { SNE_REG(cpu, d.x, d.y); };
+    h[static_cast<size_t>(op::LD_I)]      = [](chip8& cpu, const decoded_op& d) { LD_I(cpu, d.nnn); };
+    h[static_cast<size_t>(op::JP_V0)]     = [](chip8& cpu, const decoded_op& d) { JP_V0<Q>(cpu, d.nnn); };
+    h[static_cast<size_t>(op::RND)]       = [](chip8& cpu, const decoded_op& d) { RND(cpu, d.x, d.nn); };
+    h[static_cast<size_t>(op::DRW)]       = [](chip8& cpu, const decoded_op& d) { DRW<Q>(cpu, d.x, d.y, d.n); };
+    h[static_cast<size_t>(op::SKP)]       = [](chip8& cpu, const decoded_op& d) { SKP(cpu, d.x); };
+    h[static_cast<size_t>(op::SKNP)]      = [](chip8& cpu, const decoded_op& d) { SKNP(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_REG_DT)] = [](chip8& cpu, const decoded_op& d) { LD_REG_DT(cpu, d.x); };
+    h[static_cast<size_t>(op::WAIT_KP)]   = [](chip8& cpu, const decoded_op& d) { WAIT_KP(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_DT_REG)] = [](chip8& cpu, const decoded_op& d) { LD_DT_REG(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_ST_REG)] = [](chip8& cpu, const decoded_op& d) { LD_ST_REG(cpu, d.x); };
+    h[static_cast<size_t>(op::ADD_I_REG)] = [](chip8& cpu, const decoded_op& d) { ADD_I_REG(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_FONT)]   = [](chip8& cpu, const decoded_op& d) { LD_FONT(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_BCD)]    = [](chip8& cpu, const decoded_op& d) { LD_BCD(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_I_V0X)]  = [](chip8& cpu, const decoded_op& d) { LD_I_V0X<Q>(cpu, d.x); };
+    h[static_cast<size_t>(op::LD_V0X_I)]  = [](chip8& cpu, const decoded_op& d) { LD_V0X_I<Q>(cpu, d.x); };
+    return h;
+}
+
+template <typename Q = quirks::modern>
+inline constexpr std::array<handler, OP_COUNT> HANDLER_TABLE = build_handler_table<Q>();
+
+// Mirrors the case structure of parse_op exactly, so that both paths agree
+// on every word, including the ones with unchecked low nibbles (5XY1, 9XYF)
+template <typename Q = quirks::modern>
+constexpr inline decoded_op decode(uint16_t instruct) {
+    decoded_op d{
+        nullptr,
+        op::NOP,
+        static_cast<uint8_t>((instruct & 0x0F00u) >> 8u),
+        static_cast<uint8_t>((instruct & 0x00F0u) >> 4u),
+        static_cast<uint8_t>(instruct & 0x000Fu),
+        static_cast<uint8_t>(instruct & 0x00FFu),
+        static_cast<uint16_t>(instruct & 0x0FFFu)
+    };
+
+    switch (instruct & 0xF000u) {
+        case 0x0000u: {
+            switch (instruct & 0x0FFFu) {
+                case 0x00E0u: d.code = op::CLS; break;
+                case 0x00EEu: d.code = op::RET; break;
+                default:      d.code = op::SYS; break;
+            }
+        } break;
+        case 0x1000u: d.code = op::JP; break;
+        case 0x2000u: d.code = op::CALL; break;
+        case 0x3000u: d.code = op::SE; break;
+        case 0x4000u: d.code = op::SNE; break;
+        case 0x5000u: d.code = op::SE_REG; break;
+        case 0x6000u: d.code = op::LD; break;
+        case 0x7000u: d.code = op::ADD; break;
+        case 0x8000u: {
+            switch (instruct & 0x000Fu) {
+                case 0x0000u: d.code = op::LD_REG; break;
+                case 0x0001u: d.code = op::OR_REG; break;
+                case 0x0002u: d.code = op::AND_REG; break;
+                case 0x0003u: d.code = op::XOR_REG; break;
+                case 0x0004u: d.code = op::ADD_REG; break;
+                case 0x0005u: d.code = op::SUB_REG; break;
+                case 0x0006u: d.code = op::SHR; break;
+                case 0x0007u: d.code = op::SUBN_REG; break;
+                case 0x000Eu: d.code = op::SHL; break;
+            }
+        } break;
+        case 0x9000u: d.code = op::SNE_REG; break;
+        case 0xA000u: d.code = op::LD_I; break;
+        case 0xB000u: d.code = op::JP_V0; break;
+        case 0xC000u: d.code = op::RND; break;
+        case 0xD000u: d.code = op::DRW; break;
+        case 0xE000u: {
+            switch (instruct & 0x00FFu) {
+                case 0x009Eu: d.code = op::SKP; break;
+                case 0x00A1u: d.code = op::SKNP; break;
+            }
+        } break;
+        case 0xF000u: {
+            switch (instruct & 0x00FFu) {
+                case 0x0007u: d.code = op::LD_REG_DT; break;
+                case 0x000Au: d.code = op::WAIT_KP; break;
+                case 0x0015u: d.code = op::LD_DT_REG; break;
+                case 0x0018u: d.code = op::LD_ST_REG; break;
+                case 0x001Eu: d.code = op::ADD_I_REG; break;
+                case 0x0029u: d.code = op::LD_FONT; break;
+                case 0x0033u: d.code = op::LD_BCD; break;
+                case 0x0055u: d.code = op::LD_I_V0X; break;
+                case 0x0065u: d.code = op::LD_V0X_I; break;
+            }
+        } break;
+    }
+
+    d.fn = HANDLER_TABLE<Q>[static_cast<size_t>(d.code)];
+    return d;
+}
+
+using decode_table = std::array<decoded_op, 0x10000u>;
+
+template <typename Q = quirks::modern>
+constexpr inline decode_table build_decode_table() {
+    decode_table table{};
+    for (auto instruct = 0u; instruct < table.size(); ++instruct) {
+        table[instruct] = decode<Q>(static_cast<uint16_t>(instruct));
+    }
+    return table;
+}
+
+// 64K entries * 16 bytes per profile, built by the compiler
+template <typename Q>
+inline constexpr decode_table DECODE_TABLE_FOR = build_decode_table<Q>();
+
+// The table of quirks::modern, the one the other engines decode with
+inline constexpr const decode_table& DECODE_TABLE = DECODE_TABLE_FOR<quirks::modern>;
+
+static_assert(sizeof(decoded_op) == 16u, "decoded_op should pack into 16 bytes");
+static_assert(DECODE_TABLE[0x00E0u].code == op::CLS);
+static_assert(DECODE_TABLE[0x8AB4u].code == op::ADD_REG);
+static_assert(DECODE_TABLE[0x8AB4u].x == 0xAu && DECODE_TABLE[0x8AB4u].y == 0xBu);
+static_assert(DECODE_TABLE[0xD125u].code == op::DRW && DECODE_TABLE[0xD125u].n == 5u);
+static_assert(DECODE_TABLE[0x8AB8u].code == op::NOP);
+
+constexpr inline void execute(chip8& cpu, const decoded_op& d) {
+    d.fn(cpu, d);
+}
+
+// fetch, increment pc, execute
+template <typename Q = quirks::modern>
+constexpr inline void step(chip8& cpu) {
+    const auto& d = DECODE_TABLE_FOR<Q>[fetch(cpu)];
+    cpu.pc += 2u;
+    execute(cpu, d);
+}
+
+template <typename Q = quirks::modern>
+constexpr inline void run(chip8& cpu, uint64_t cycles) {
+    for (uint64_t c = 0u; c < cycles; ++c) {
+        step<Q>(cpu);
+    }
+}
+
+} // namespace dispatch
+
+// The interpreter of one quirks profile
+template <typename Q>
+struct chip8_core {
+    using quirks = Q;
+
+    static constexpr const dispatch::decode_table& table = dispatch::DECODE_TABLE_FOR<Q>;
+
+    static constexpr void step(chip8& cpu) {
+        dispatch::step<Q>(cpu);
+    }
+
+    static constexpr void run(chip8& cpu, uint64_t cycles) {
+        dispatch::run<Q>(cpu, cycles);
+    }
+};
+
+} // namespace chipp8
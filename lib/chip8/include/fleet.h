@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "idle.h"
+
+/* Fleet runner
+
+   Runs many independent sessions, each a ROM plus a script of key states
+   for a fixed number of frames, as separate chip8 instances across a pool
+   of worker threads.
+
+   Every worker owns a queue of session indices. A worker pops from the
+   front of its own queue, runs that session for slice_frames frames and
+   pushes it onto the back, so it round-robins its sessions and a long one
+   never holds up the others queued behind it. A worker with an empty queue
+   steals from the back of the others. Each queue has
+   its own mutex, held only for the push or pop itself.
+
+   A session is only ever in one queue, so its state and its result slot are
+   touched by one thread at a time and need no lock at all.
+*/
+
+namespace chipp8 {
+
+namespace fleet {
+
+constexpr const uint32_t DEFAULT_CYCLES_PER_FRAME = 10u;
+constexpr const uint32_t DEFAULT_SLICE_FRAMES = 60u;
+
+// The keypad holds `keys` from `frame` on, until the next event
+struct key_event {
+    uint32_t frame;
+    uint16_t keys;
+};
+
+struct session {
+    std::vector<uint8_t> rom;
+    // Sorted by frame
+    std::vector<key_event> input;
+    uint32_t frames;
+};
+
+struct config {
+    // 0 uses every hardware thread
+    unsigned threads;
+    uint32_t cycles_per_frame;
+    // Frames a worker runs a session for before putting it back on its queue
+    uint32_t slice_frames;
+};
+
+constexpr inline config default_config() {
+    return {0u, DEFAULT_CYCLES_PER_FRAME, DEFAULT_SLICE_FRAMES};
+}
+
+struct result {
+    uint64_t display_hash;
+    uint64_t cycles;
+    // Of those, the ones idle::run skipped instead of executing
+    uint64_t skipped;
+    // Wall time spent running this session, summed over its slices
+    double seconds;
+};
+
+// 64 bit FNV-1a over the display, row by row, MSB first
+constexpr inline uint64_t display_hash(const display& pixels) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (const auto row: pixels) {
+        for (auto shift = 56; shift >= 0; shift -= 8) {
+            h ^= (row >> shift) & 0xFFu;
+            h *= 0x00000100000001B3ull;
+        }
+    }
+    return h;
+}
+
+// Where a session is between slices
+struct state {
+    chip8 cpu;
+    uint32_t frame;
+    size_t next_event;
+    uint64_t skipped;
+    double seconds;
+};
+
+inline void start(state& st, const session& s) {
+    load_program(st.cpu, s.rom.data(), s.rom.size());
+    st.frame = 0u;
+    st.next_event = 0u;
+    st.skipped = 0u;
+    st.seconds = 0.0;
+}
+
+// Apply the input for the current frame, run its instructions, then tick
+// the timers. Idle loops are fast-forwarded to the end of the frame
+inline void run_frame(state& st, const session& s, uint32_t cycles_per_frame) {
+    while (st.next_event < s.input.size() && s.input[st.next_event].frame <= st.frame) {
+        st.cpu.keys = s.input[st.next_event].keys;
+        ++st.next_event;
+    }
+    st.skipped += idle::run(st.cpu, cycles_per_frame).skipped;
+    tick_timers(st.cpu);
+    ++st.frame;
+}
+
+inline result finish(const state& st, uint32_t cycles_per_frame) {
+    return {display_hash(st.cpu.pixels), static_cast<uint64_t>(st.frame) * cycles_per_frame, st.skipped, st.seconds};
+}
+
+// One session start to finish on the calling thread, the reference for run()
+inline result run_session(const session& s, uint32_t cycles_per_frame) {
+    state st;
+    start(st, s);
+    const auto begin = std::chrono::steady_clock::now();
+    while (st.frame < s.frames) {
+        run_frame(st, s, cycles_per_frame);
+    }
+    st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return finish(st, cycles_per_frame);
+}
+
+// Own cache line each, workers hammer their own lock
+struct alignas(64) task_queue {
+    std::mutex lock;
+    std::deque<uint32_t> tasks;
+};
+
+inline void push(task_queue& q, uint32_t task) {
+    std::lock_guard<std::mutex> guard(q.lock);
+    q.tasks.push_back(task);
+}
+
+// Owner end, the session that has waited longest
+inline bool pop(task_queue& q, uint32_t& task) {
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = q.tasks.front();
+    q.tasks.pop_front();
+    return true;
+}
+
+// Thief end, away from the owner
+inline bool steal(task_queue& q, uint32_t& task) {
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+}
+
+// Run every session to completion, results are in session order
+inline std::vector<result> run(const std::vector<session>& sessions, const config& cfg) {
+    const unsigned threads = std::max(1u, (cfg.threads != 0u) ? cfg.threads : std::thread::hardware_concurrency());
+    const uint32_t slice = std::max(1u, cfg.slice_frames);
+
+    std::vector<state> states(sessions.size());
+    std::vector<result> results(sessions.size());
+    std::vector<task_queue> queues(threads);
+    std::atomic<size_t> left{sessions.size()};
+
+    for (uint32_t k = 0u; k < sessions.size(); ++k) {
+        start(states[k], sessions[k]);
+        queues[k % threads].tasks.push_back(k);
+    }
+
+    auto work = [&](unsigned self) {
+        while (left.load(std::memory_order_acquire) > 0u) {
+            uint32_t task = 0u;
+            bool found = pop(queues[self], task);
+            for (unsigned k = 1u; k < threads && !found; ++k) {
+                found = steal(queues[(self + k) % threads], task);
+            }
+            if (!found) {
+                // Everything left is being run by other workers right now
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto& st = states[task];
+            const auto& s = sessions[task];
+            const auto end = std::min(s.frames, st.frame + slice);
+            const auto begin = std::chrono::steady_clock::now();
+            while (st.frame < end) {
+                run_frame(st, s, cfg.cycles_per_frame);
+            }
+            st.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+            if (st.frame < s.frames) {
+                push(queues[self], task);
+            } else {
+                results[task] = finish(st, cfg.cycles_per_frame);
+                left.fetch_sub(1u, std::memory_order_release);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0u; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    for (auto& t: pool) {
+        t.join();
+    }
+    return results;
+}
+
+} // namespace fleet
+
+} // namespace chipp8
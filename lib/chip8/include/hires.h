@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "quirks.h"
+#include "rng.h"
+
+/* SUPER-CHIP / XO-CHIP machine
+
+   hires::machine has the registers of chip8, 64 KB of mem and two 128x64
+   bitplanes. It runs the base opcodes through the same functions as
+   chip8, plus
+
+       00CN  scroll down N rows         00FE  lo-res, 64x32
+       00DN  scroll up N rows           00FF  hi-res, 128x64
+       00FB  scroll right 4 pixels      DXY0  16x16 sprite
+       00FC  scroll left 4 pixels       F000  NNNN, I = NNNN
+       00FD  exit                       FN01  select the planes in N
+
+   Each plane keeps the left and right 64 pixels of every row in two
+   separate arrays of words, pixel x is bit 63 - x % 64. Scrolling is then
+   a word copy for whole rows, or two shifts and an OR per word across
+   every row, loops over contiguous uint64_t that the compiler vectorizes.
+
+   In lo-res every pixel covers 2x2 of the planes, sprites are drawn with
+   their bits doubled and scroll distances are in lo-res pixels. Switching
+   mode clears the planes, like Octo.
+
+   The machine is 64 KB, allocate it on the heap.
+*/
+
+namespace chipp8 {
+
+namespace hires {
+
+constexpr const uint16_t WIDTH = 128u;
+constexpr const uint16_t HEIGHT = 64u;
+constexpr const uint8_t PLANE_COUNT = 2u;
+constexpr const size_t MEM_SIZE = 0x10000u;
+
+struct plane {
+    // Pixels 0-63 and 64-127 of each row
+    std::array<uint64_t, HEIGHT> left;
+    std::array<uint64_t, HEIGHT> right;
+
+    bool operator==(const plane&) const = default;
+};
+
+struct machine {
+    uint16_t keys;
+    std::array<plane, PLANE_COUNT> planes;
+    std::array<uint8_t, MEM_SIZE> mem;
+    std::array<uint8_t, 16u> v;
+    uint16_t i;
+    uint8_t d_timer;
+    uint8_t s_timer;
+    uint16_t pc;
+    uint8_t sp;
+    std::array<uint16_t, 16u> stack;
+    rng::stream rng;
+
+    // 00FF/00FE
+    bool hires;
+    // Bit p selects plane p for drawing, clearing and scrolling
+    uint8_t plane_mask;
+
+    bool operator==(const machine&) const = default;
+};
+
+inline void clear(plane& p) {
+    p.left.fill(0u);
+    p.right.fill(0u);
+}
+
+inline void init(machine& m) {
+    m.keys = 0u;
+    for (auto& p: m.planes) {
+        clear(p);
+    }
+    m.mem.fill(0u);
+    m.v.fill(0u);
+    m.i = 0u;
+    m.d_timer = 0u;
+    m.s_timer = 0u;
+    m.pc = 0u;
+    m.sp = 0u;
+    m.stack.fill(0u);
+    m.rng = {DEFAULT_RNG_SEED, 0u, 0u};
+    m.hires = false;
+    m.plane_mask = 0x1u;
+}
+
+// Reset, load the font and copy a program image to PROGRAM_START_ADDR
+inline void load_program(machine& m, const uint8_t* program, size_t size) {
+    init(m);
+    constexpr auto sprite_list = sprites::all_font_sprites();
+    auto addr = FONT_START_ADDR;
+    for (const auto& sprite: sprite_list) {
+        for (const auto byte: sprite) {
+            m.mem[addr++] = byte;
+        }
+    }
+    for (size_t k = 0u; k < size && PROGRAM_START_ADDR + k < MEM_SIZE; ++k) {
+        m.mem[PROGRAM_START_ADDR + k] = program[k];
+    }
+    m.pc = PROGRAM_START_ADDR;
+}
+
+// Pixel (x, y) of a plane, in hi-res coordinates
+inline bool get_pixel(const machine& m, uint8_t p, uint16_t x, uint16_t y) {
+    const auto word = (x < 64u) ? m.planes[p].left[y] : m.planes[p].right[y];
+    return (word >> (63u - x % 64u)) & 1u;
+}
+
+// Rows move down by n, the top n rows are cleared
+inline void scroll_down(plane& p, unsigned n) {
+    n = std::min<unsigned>(n, HEIGHT);
+    memmove(p.left.data() + n, p.left.data(), (HEIGHT - n) * sizeof(uint64_t));
+    memmove(p.right.data() + n, p.right.data(), (HEIGHT - n) * sizeof(uint64_t));
+    std::fill_n(p.left.begin(), n, 0u);
+    std::fill_n(p.right.begin(), n, 0u);
+}
+
+// Rows move up by n, the bottom n rows are cleared
+inline void scroll_up(plane& p, unsigned n) {
+    n = std::min<unsigned>(n, HEIGHT);
+    memmove(p.left.data(), p.left.data() + n, (HEIGHT - n) * sizeof(uint64_t));
+    memmove(p.right.data(), p.right.data() + n, (HEIGHT - n) * sizeof(uint64_t));
+    std::fill_n(p.left.end() - n, n, 0u);
+    std::fill_n(p.right.end() - n, n, 0u);
+}
+
+// Every row moves right by 0 < n < 64 pixels, the left n columns are cleared
+inline void scroll_right(plane& p, unsigned n) {
+    for (auto y = 0u; y < HEIGHT; ++y) {
+        p.right[y] = (p.right[y] >> n) | (p.left[y] << (64u - n));
+        p.left[y] >>= n;
+    }
+}
+
+// Every row moves left by 0 < n < 64 pixels, the right n columns are cleared
+inline void scroll_left(plane& p, unsigned n) {
+    for (auto y = 0u; y < HEIGHT; ++y) {
+        p.left[y] = (p.left[y] << n) | (p.right[y] >> (64u - n));
+        p.right[y] <<= n;
+    }
+}
+
+// Apply fn to every selected plane
+template <typename Fn>
+inline void for_planes(machine& m, Fn&& fn) {
+    for (auto p = 0u; p < PLANE_COUNT; ++p) {
+        if (m.plane_mask & (1u << p)) {
+            fn(m.planes[p]);
+        }
+    }
+}
+
+// Every bit of a byte twice, for lo-res sprites
+constexpr inline std::array<uint16_t, 256u> build_double_table() {
+    std::array<uint16_t, 256u> t{};
+    for (auto b = 0u; b < 256u; ++b) {
+        for (auto k = 0u; k < 8u; ++k) {
+            t[b] |= static_cast<uint16_t>(((b >> k) & 1u) * (3u << (2u * k)));
+        }
+    }
+    return t;
+}
+
+inline constexpr std::array<uint16_t, 256u> DOUBLE_TABLE = build_double_table();
+
+// The low `width` (8 or 16) bits of b, each twice
+constexpr inline uint32_t double_bits(uint32_t b, unsigned width) {
+    const uint32_t low = DOUBLE_TABLE[b & 0xFFu];
+    return (width == 16u) ? (static_cast<uint32_t>(DOUBLE_TABLE[(b >> 8u) & 0xFFu]) << 16u) | low : low;
+}
+
+static_assert(double_bits(0xA5u, 8u) == 0xCC33u);
+static_assert(double_bits(0x8001u, 16u) == 0xC0000003u);
+
+// XOR `bits`, left aligned, onto row y starting at pixel x. Bits past the
+// right edge wrap around to the left or are dropped. Returns the pixels
+// turned off
+template <bool Wrap>
+inline uint64_t xor_row(plane& p, unsigned y, unsigned x, uint64_t bits) {
+    uint64_t l = 0u;
+    uint64_t r = 0u;
+    if (x < 64u) {
+        // At most 32 bits wide, so nothing runs past pixel 127
+        l = bits >> x;
+        r = (x != 0u) ? bits << (64u - x) : 0u;
+    } else {
+        const auto s = x - 64u;
+        r = bits >> s;
+        l = (Wrap && s != 0u) ? bits << (64u - s) : 0u;
+    }
+    const auto collision = (p.left[y] & l) | (p.right[y] & r);
+    p.left[y] ^= l;
+    p.right[y] ^= r;
+    return collision;
+}
+
+// DXYN - N rows of 8 pixels, or DXY0 - 16 rows of 16 pixels, into every
+// selected plane, the planes taking their rows from mem one after another
+// starting at I. vF is set if any pixel was turned off
+template <typename Q = quirks::xo_chip>
+inline void DRW(machine& m, uint8_t /*V*/x, uint8_t /*V*/y, uint8_t n) {
+    const unsigned scale = m.hires ? 1u : 2u;
+    const unsigned x0 = (m.v[x] % (WIDTH / scale)) * scale;
+    const unsigned y0 = (m.v[y] % (HEIGHT / scale)) * scale;
+    const bool big = (n == 0u);
+    const unsigned rows = big ? 16u : n;
+    const unsigned width = big ? 16u : 8u;
+
+    uint64_t collision = 0u;
+    uint16_t addr = m.i;
+    for_planes(m, [&](plane& p) {
+        for (auto row = 0u; row < rows; ++row) {
+            uint32_t data = m.mem[addr++];
+            if (big) {
+                data = (data << 8u) | m.mem[addr++];
+            }
+            const auto bits = (scale == 1u) ? static_cast<uint64_t>(data) << (64u - width)
+                                            : static_cast<uint64_t>(double_bits(data, width)) << (64u - 2u * width);
+            for (auto dy = 0u; dy < scale; ++dy) {
+                auto line = y0 + row * scale + dy;
+                if constexpr (Q::clip_sprites) {
+                    if (line >= HEIGHT) {
+                        break;
+                    }
+                    collision |= xor_row<false>(p, line, x0, bits);
+                } else {
+                    collision |= xor_row<true>(p, line % HEIGHT, x0, bits);
+                }
+            }
+        }
+    });
+    m.v[0xFu] = (collision != 0u) ? 1u : 0u;
+}
+
+// The 00xx opcodes beyond CLS/RET. Returns false for anything else
+inline bool execute_system(machine& m, uint16_t instruct) {
+    const unsigned scale = m.hires ? 1u : 2u;
+    if ((instruct & 0xFFF0u) == 0x00C0u) {
+        for_planes(m, [&](plane& p) { scroll_down(p, (instruct & 0x000Fu) * scale); });
+        return true;
+    }
+    if ((instruct & 0xFFF0u) == 0x00D0u) {
+        for_planes(m, [&](plane& p) { scroll_up(p, (instruct & 0x000Fu) * scale); });
+        return true;
+    }
+    switch (instruct) {
+        case 0x00FBu: for_planes(m, [&](plane& p) { scroll_right(p, 4u * scale); }); return true;
+        case 0x00FCu: for_planes(m, [&](plane& p) { scroll_left(p, 4u * scale); }); return true;
+        // Stay on the exit for good
+        case 0x00FDu: m.pc -= 2u; return true;
+        case 0x00FEu:
+        case 0x00FFu: {
+            m.hires = (instruct == 0x00FFu);
+            for (auto& p: m.planes) {
+                clear(p);
+            }
+        } return true;
+        default: return false;
+    }
+}
+
+constexpr inline uint16_t fetch(const machine& m, uint16_t addr) {
+    return static_cast<uint16_t>((m.mem[addr] << 8u) | m.mem[static_cast<uint16_t>(addr + 1u)]);
+}
+
+constexpr inline bool is_skip(dispatch::op code) {
+    using dispatch::op;
+    return code == op::SE || code == op::SNE || code == op::SE_REG || code == op::SNE_REG || code == op::SKP || code == op::SKNP;
+}
+
+// The base opcodes go through the functions in chip8.h with the quirks of Q
+template <typename Q = quirks::xo_chip>
+inline void execute(machine& m, uint16_t instruct) {
+    using dispatch::op;
+    const auto& d = dispatch::DECODE_TABLE[instruct];
+    switch (d.code) {
+        case op::NOP: {
+            if (instruct == 0xF000u) {
+                // F000 NNNN, the only 4 byte instruction
+                m.i = fetch(m, m.pc);
+                m.pc += 2u;
+            } else if ((instruct & 0xF0FFu) == 0xF001u) {
+                m.plane_mask = d.x & 0x3u;
+            }
+        } break;
+        case op::CLS: for_planes(m, [](plane& p) { clear(p); }); break;
+        case op::RET: RET(m); break;
+        case op::SYS: {
+            if (!execute_system(m, instruct)) {
+                SYS(m, d.nnn);
+            }
+        } break;
+        case op::JP: JP(m, d.nnn); break;
+        case op::CALL: CALL(m, d.nnn); break;
+        case op::SE: SE(m, d.x, d.nn); break;
+        case op::SNE: SNE(m, d.x, d.nn); break;
+        case op::SE_REG: SE_REG(m, d.x, d.y); break;
+        case op::LD: LD(m, d.x, d.nn); break;
+        case op::ADD: ADD(m, d.x, d.nn); break;
+        case op::LD_REG: LD_REG(m, d.x, d.y); break;
+        case op::OR_REG: OR_REG<Q>(m, d.x, d.y); break;
+        case op::AND_REG: AND_REG<Q>(m, d.x, d.y); break;
+        case op::XOR_REG: XOR_REG<Q>(m, d.x, d.y); break;
+        case op::ADD_REG: ADD_REG(m, d.x, d.y); break;
+        case op::SUB_REG: SUB_REG(m, d.x, d.y); break;
+        case op::SHR: SHR<Q>(m, d.x, d.y); break;
+        case op::SUBN_REG: SUBN_REG(m, d.x, d.y); break;
+        case op::SHL: SHL<Q>(m, d.x, d.y); break;
+        case op::SNE_REG: SNE_REG(m, d.x, d.y); break;
+        case op::LD_I: LD_I(m, d.nnn); break;
+        case op::JP_V0: JP_V0<Q>(m, d.nnn); break;
+        case op::RND: RND(m, d.x, d.nn); break;
+        case op::DRW: DRW<Q>(m, d.x, d.y, d.n); break;
+        case op::SKP: SKP(m, d.x); break;
+        case op::SKNP: SKNP(m, d.x); break;
+        case op::LD_REG_DT: LD_REG_DT(m, d.x); break;
+        case op::WAIT_KP: WAIT_KP(m, d.x); break;
+        case op::LD_DT_REG: LD_DT_REG(m, d.x); break;
+        case op::LD_ST_REG: LD_ST_REG(m, d.x); break;
+        case op::ADD_I_REG: ADD_I_REG(m, d.x); break;
+        case op::LD_FONT: LD_FONT(m, d.x); break;
+        case op::LD_BCD: LD_BCD(m, d.x); break;
+        case op::LD_I_V0X: LD_I_V0X<Q>(m, d.x); break;
+        case op::LD_V0X_I: LD_V0X_I<Q>(m, d.x); break;
+        case op::COUNT: break;
+    }
+}
+
+// fetch, increment pc, execute. A skip over F000 NNNN skips all 4 bytes
+template <typename Q = quirks::xo_chip>
+inline void step(machine& m) {
+    const auto instruct = fetch(m, m.pc);
+    m.pc += 2u;
+    const auto next = m.pc;
+    execute<Q>(m, instruct);
+    if (is_skip(dispatch::DECODE_TABLE[instruct].code) && m.pc == static_cast<uint16_t>(next + 2u) && fetch(m, next) == 0xF000u) {
+        m.pc += 2u;
+    }
+}
+
+template <typename Q = quirks::xo_chip>
+inline void run(machine& m, uint64_t cycles) {
+    for (uint64_t c = 0u; c < cycles; ++c) {
+        step<Q>(m);
+    }
+}
+
+} // namespace hires
+
+} // namespace chipp8
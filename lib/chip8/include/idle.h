@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+
+#include "chip8.h"
+#include "dispatch.h"
+
+/* Idle fast-forward
+
+   Within one run() call the keypad and the timers never change, they are
+   only updated between frames. A loop that only reads them, like FX0A with
+   no key down, a 1NNN jumping to itself or a delay timer poll
+
+       202: F007  LD v0, DT
+       204: 3000  SE v0, 0
+       206: 1202  JP 202
+
+   therefore comes back to its first instruction with exactly the registers
+   it started with, and keeps doing so until the frame ends. Once one
+   iteration has been seen to do that, every remaining whole iteration is
+   skipped. The state afterwards is exactly the one dispatch::run gives.
+
+   Loops whose body writes mem, the display or the stack, or draws random
+   numbers, are always executed.
+*/
+
+namespace chipp8 {
+
+namespace idle {
+
+// Longest backward jump, in instructions, that is checked for a poll loop
+constexpr const uint16_t MAX_LOOP_LEN = 16u;
+
+struct counters {
+    uint64_t executed;
+    uint64_t skipped;
+};
+
+// Everything a pure loop could change
+struct registers {
+    std::array<uint8_t, 16u> v;
+    uint16_t i;
+    uint16_t pc;
+    uint8_t sp;
+    uint8_t d_timer;
+    uint8_t s_timer;
+
+    bool operator==(const registers&) const = default;
+};
+
+constexpr inline registers snapshot(const chip8& cpu) {
+    return {cpu.v, cpu.i, cpu.pc, cpu.sp, cpu.d_timer, cpu.s_timer};
+}
+
+// True for the ops that leave mem, the display and the stack alone and give
+// the same result every time for the same registers, keys and timers
+constexpr inline bool is_pure(dispatch::op code) {
+    using dispatch::op;
+    switch (code) {
+        case op::CLS:
+        case op::RET:
+        case op::CALL:
+        case op::RND:
+        case op::DRW:
+        case op::WAIT_KP:
+        case op::LD_BCD:
+        case op::LD_I_V0X:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Execute exactly `cycles` instructions, with the same result as
+// dispatch::run(cpu, cycles), skipping the ones spent idling
+inline counters run(chip8& cpu, uint64_t cycles) {
+    counters n{0u, 0u};
+    uint64_t c = 0u;
+    while (c < cycles) {
+        const auto jump_pc = cpu.pc;
+        const auto& d = dispatch::DECODE_TABLE[fetch(cpu)];
+
+        // Both leave every register as it was, pc included
+        const bool waiting = (d.code == dispatch::op::WAIT_KP) && !(cpu.keys & 0xFFFFu);
+        const bool self_jump = (d.code == dispatch::op::JP) && (d.nnn == jump_pc);
+        if (waiting || self_jump) {
+            n.skipped += cycles - c;
+            break;
+        }
+
+        dispatch::step(cpu);
+        ++c;
+        ++n.executed;
+
+        const bool backward = (d.code == dispatch::op::JP) && (d.nnn < jump_pc) &&
+                              (static_cast<uint32_t>(jump_pc - d.nnn) < MAX_LOOP_LEN * 2u);
+        if (!backward) {
+            continue;
+        }
+
+        // Run one iteration for real, it counts towards the budget either way
+        const auto head = snapshot(cpu);
+        uint64_t period = 0u;
+        bool pure = true;
+        while (c < cycles && pure) {
+            const auto& body = dispatch::DECODE_TABLE[fetch(cpu)];
+            const auto pc = cpu.pc;
+            pure = is_pure(body.code) && (pc >= head.pc) && (pc <= jump_pc);
+            dispatch::step(cpu);
+            ++c;
+            ++n.executed;
+            ++period;
+            if (pc == jump_pc) {
+                break;
+            }
+        }
+        if (pure && period > 0u && snapshot(cpu) == head) {
+            const auto whole = ((cycles - c) / period) * period;
+            c += whole;
+            n.skipped += whole;
+        }
+    }
+    return n;
+}
+
+} // namespace idle
+
+} // namespace chipp8
@@ -0,0 +1,611 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include "block_cache.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+/* x86-64 dynamic recompiler
+
+   Blocks are found exactly as in the cached interpreter (see block_cache.h)
+   and translated to native code with the signature void(chip8*).
+
+   Inside a block
+     - rbx holds the chip8 pointer
+     - ebp holds I
+     - up to 8 of the v registers, the most used ones, live in r8-r15,
+       the rest are accessed in place
+     - pc is a compile time constant, only stored on the way out
+
+   The ALU, timer, I and conditional skip ops are emitted inline with the
+   exact semantics of the opcode functions in chip8.h, flag quirks included.
+   Everything else (DRW, RND, CALL, WAIT_KP, ...) writes the registers back
+   and calls the decoded handler, so those stay defined in one place.
+
+   Only built when CHIPP8_ENABLE_JIT is defined on an x86-64 Linux host,
+   otherwise jit::run is the cached interpreter.
+*/
+
+#if defined(CHIPP8_ENABLE_JIT) && defined(__x86_64__) && defined(__linux__)
+#define CHIPP8_JIT_NATIVE 1
+#include <sys/mman.h>
+#else
+#define CHIPP8_JIT_NATIVE 0
+#endif
+
+namespace chipp8 {
+
+namespace jit {
+
+#if CHIPP8_JIT_NATIVE
+
+constexpr const size_t CODE_BUFFER_SIZE = 4u * 1024u * 1024u;
+
+using block_fn = void (*)(chip8*);
+
+struct block {
+    uint16_t start;
+    uint16_t len;
+    uint64_t pages;
+    block_fn fn;
+    dispatch::op last;
+    bool live;
+};
+
+struct code_cache {
+    std::array<uint16_t, 4096u> lookup;
+    uint64_t code_pages;
+    std::vector<block> blocks;
+
+    uint8_t* code;
+    size_t code_used;
+
+    code_cache() : code(nullptr), code_used(0u) {}
+    code_cache(const code_cache&) = delete;
+    code_cache& operator=(const code_cache&) = delete;
+    ~code_cache() {
+        if (code) {
+            munmap(code, CODE_BUFFER_SIZE);
+        }
+    }
+};
+
+namespace x64 {
+
+// Host register numbers
+constexpr const uint8_t RAX = 0u;
+constexpr const uint8_t RCX = 1u;
+constexpr const uint8_t RDX = 2u;
+
+constexpr const int32_t OFF_V = static_cast<int32_t>(offsetof(chip8, v));
+constexpr const int32_t OFF_I = static_cast<int32_t>(offsetof(chip8, i));
+constexpr const int32_t OFF_PC = static_cast<int32_t>(offsetof(chip8, pc));
+constexpr const int32_t OFF_DT = static_cast<int32_t>(offsetof(chip8, d_timer));
+constexpr const int32_t OFF_ST = static_cast<int32_t>(offsetof(chip8, s_timer));
+
+// Guest v registers can be cached in these, none of them are used as scratch
+constexpr const std::array<uint8_t, 8u> POOL{12u, 13u, 14u, 15u, 8u, 9u, 10u, 11u};
+
+struct emitter {
+    uint8_t* p;
+
+    // Host register caching each guest v register, 0 when it lives in memory
+    std::array<uint8_t, 16u> host;
+
+    void byte(uint8_t b) { *p++ = b; }
+
+    void u16(uint16_t w) {
+        byte(static_cast<uint8_t>(w));
+        byte(static_cast<uint8_t>(w >> 8u));
+    }
+
+    void u32(uint32_t d) {
+        u16(static_cast<uint16_t>(d));
+        u16(static_cast<uint16_t>(d >> 16u));
+    }
+
+    void u64(uint64_t q) {
+        u32(static_cast<uint32_t>(q));
+        u32(static_cast<uint32_t>(q >> 32u));
+    }
+
+    // ModRM for [rbx + disp32] with the given reg field
+    void mem_rbx(uint8_t reg, int32_t disp) {
+        byte(static_cast<uint8_t>(0x80u | ((reg & 7u) << 3u) | 3u));
+        u32(static_cast<uint32_t>(disp));
+    }
+
+    // movzx scratch, byte v[x]
+    void load_v(uint8_t scratch, uint8_t x) {
+        if (host[x]) {
+            byte(0x41u);
+            byte(0x0Fu); byte(0xB6u);
+            byte(static_cast<uint8_t>(0xC0u | (scratch << 3u) | (host[x] & 7u)));
+        } else {
+            byte(0x0Fu); byte(0xB6u);
+            mem_rbx(scratch, OFF_V + x);
+        }
+    }
+
+    // mov byte v[x], low byte of scratch
+    void store_v(uint8_t x, uint8_t scratch) {
+        if (host[x]) {
+            byte(0x41u);
+            byte(0x88u);
+            byte(static_cast<uint8_t>(0xC0u | (scratch << 3u) | (host[x] & 7u)));
+        } else {
+            byte(0x88u);
+            mem_rbx(scratch, OFF_V + x);
+        }
+    }
+
+    void load_cached() {
+        for (auto x = 0u; x < 16u; ++x) {
+            if (host[x]) {
+                // movzx rN, byte [rbx + v + x]
+                byte(0x44u);
+                byte(0x0Fu); byte(0xB6u);
+                mem_rbx(host[x], OFF_V + x);
+            }
+        }
+        // movzx ebp, word [rbx + i]
+        byte(0x0Fu); byte(0xB7u);
+        mem_rbx(5u, OFF_I);
+    }
+
+    void store_cached() {
+        for (auto x = 0u; x < 16u; ++x) {
+            if (host[x]) {
+                // mov byte [rbx + v + x], rNb
+                byte(0x44u);
+                byte(0x88u);
+                mem_rbx(host[x], OFF_V + x);
+            }
+        }
+        // mov word [rbx + i], bp
+        byte(0x66u);
+        byte(0x89u);
+        mem_rbx(5u, OFF_I);
+    }
+
+    void store_pc_imm(uint16_t pc) {
+        byte(0x66u);
+        byte(0xC7u);
+        mem_rbx(0u, OFF_PC);
+        u16(pc);
+    }
+
+    void mov_imm(uint8_t reg, uint32_t imm) {
+        byte(static_cast<uint8_t>(0xB8u + reg));
+        u32(imm);
+    }
+
+    void prologue() {
+        byte(0x53u);                          // push rbx
+        byte(0x55u);                          // push rbp
+        byte(0x41u); byte(0x54u);             // push r12
+        byte(0x41u); byte(0x55u);             // push r13
+        byte(0x41u); byte(0x56u);             // push r14
+        byte(0x41u); byte(0x57u);             // push r15
+        byte(0x48u); byte(0x83u); byte(0xECu); byte(0x08u); // sub rsp, 8
+        byte(0x48u); byte(0x89u); byte(0xFBu);              // mov rbx, rdi
+        load_cached();
+    }
+
+    void epilogue() {
+        byte(0x48u); byte(0x83u); byte(0xC4u); byte(0x08u); // add rsp, 8
+        byte(0x41u); byte(0x5Fu);             // pop r15
+        byte(0x41u); byte(0x5Eu);             // pop r14
+        byte(0x41u); byte(0x5Du);             // pop r13
+        byte(0x41u); byte(0x5Cu);             // pop r12
+        byte(0x5Du);                          // pop rbp
+        byte(0x5Bu);                          // pop rbx
+        byte(0xC3u);                          // ret
+    }
+
+    // Write everything back and run the decoded handler with pc already
+    // pointing past the instruction, as dispatch::step would
+    void call_handler(uint16_t instruct, uint16_t next_pc) {
+        store_cached();
+        store_pc_imm(next_pc);
+        byte(0x48u); byte(0x89u); byte(0xDFu); // mov rdi, rbx
+        byte(0x48u); byte(0xBEu);              // mov rsi, imm64
+        u64(reinterpret_cast<uint64_t>(&dispatch::DECODE_TABLE[instruct]));
+        byte(0x48u); byte(0xB8u);              // mov rax, imm64
+        u64(reinterpret_cast<uint64_t>(dispatch::DECODE_TABLE[instruct].fn));
+        byte(0xFFu); byte(0xD0u);              // call rax
+    }
+
+    // Leave with pc = (condition code cc holds) ? taken : not_taken
+    void exit_cmov(uint8_t cc, uint16_t not_taken, uint16_t taken) {
+        mov_imm(RCX, not_taken);
+        mov_imm(RDX, taken);
+        byte(0x0Fu); byte(static_cast<uint8_t>(0x40u | cc)); byte(0xCAu); // cmovcc ecx, edx
+        store_cached();
+        byte(0x66u); byte(0x89u);              // mov word [rbx + pc], cx
+        mem_rbx(RCX, OFF_PC);
+        epilogue();
+    }
+};
+
+constexpr const uint8_t CC_E = 0x4u;
+constexpr const uint8_t CC_NE = 0x5u;
+
+// Give the v registers used more than once in the block a host register,
+// most used first. Handler calls write everything back, so only the inline
+// ops are counted
+inline std::array<uint8_t, 16u> allocate(const std::vector<dispatch::decoded_op>& ops) {
+    using dispatch::op;
+
+    std::array<uint32_t, 16u> uses{};
+    for (const auto& d: ops) {
+        switch (d.code) {
+            case op::ADD_REG:
+            case op::SUB_REG:
+            case op::SUBN_REG: {
+                ++uses[d.y];
+                uses[0xFu] += 2u;
+            } [[fallthrough]];
+            case op::SE:
+            case op::SNE:
+            case op::LD:
+            case op::ADD:
+            case op::ADD_I_REG:
+            case op::LD_FONT:
+            case op::LD_REG_DT:
+            case op::LD_DT_REG:
+            case op::LD_ST_REG: {
+                uses[d.x] += 2u;
+            } break;
+
+            case op::SHR:
+            case op::SHL: {
+                uses[d.x] += 2u;
+                uses[0xFu] += 2u;
+            } break;
+
+            case op::SE_REG:
+            case op::SNE_REG:
+            case op::LD_REG:
+            case op::OR_REG:
+            case op::AND_REG:
+            case op::XOR_REG: {
+                uses[d.x] += 2u;
+                ++uses[d.y];
+            } break;
+
+            default: {
+            } break;
+        }
+    }
+
+    std::array<uint8_t, 16u> order{};
+    for (auto x = 0u; x < 16u; ++x) {
+        order[x] = static_cast<uint8_t>(x);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint8_t a, uint8_t b) { return uses[a] > uses[b]; });
+
+    // A register touched once is cheaper to access in place than to load
+    // in the prologue and store in the epilogue
+    std::array<uint8_t, 16u> host{};
+    for (auto k = 0u; k < POOL.size() && uses[order[k]] > 2u; ++k) {
+        host[order[k]] = POOL[k];
+    }
+    return host;
+}
+
+// Worst case code sizes, with every POOL register live
+constexpr const size_t STORE_CACHED_SIZE = POOL.size() * 7u + 7u;
+constexpr const size_t LOAD_CACHED_SIZE = POOL.size() * 8u + 7u;
+constexpr const size_t PROLOGUE_SIZE = 17u + LOAD_CACHED_SIZE;
+constexpr const size_t EPILOGUE_SIZE = 15u;
+
+// store_cached, store_pc_imm, mov rdi, the two imm64 moves and the call,
+// then load_cached. No other op emits more
+constexpr const size_t HANDLER_CALL_SIZE = STORE_CACHED_SIZE + 9u + 3u + 20u + 2u + LOAD_CACHED_SIZE;
+
+// The longest exit, SE_REG/SNE_REG with both operands in memory
+constexpr const size_t CMOV_EXIT_SIZE = 7u + 7u + 2u + 10u + 3u + STORE_CACHED_SIZE + 7u + EPILOGUE_SIZE;
+static_assert(CMOV_EXIT_SIZE <= HANDLER_CALL_SIZE, "An exit must fit the worst case of an op");
+
+// Falling through at the end of a block that ran into MAX_BLOCK_LEN
+constexpr const size_t FALL_THROUGH_SIZE = STORE_CACHED_SIZE + 9u + EPILOGUE_SIZE;
+
+} // namespace x64
+
+// Worst case for one block, prologue and epilogue included
+constexpr const size_t MAX_BLOCK_CODE =
+    x64::PROLOGUE_SIZE + cache::MAX_BLOCK_LEN * x64::HANDLER_CALL_SIZE + x64::FALL_THROUGH_SIZE;
+
+static_assert(MAX_BLOCK_CODE * 64u < CODE_BUFFER_SIZE, "The code buffer should hold many blocks");
+
+inline void flush(code_cache& cache) {
+    cache.lookup.fill(0u);
+    cache.code_pages = 0u;
+    cache.blocks.clear();
+    cache.code_used = 0u;
+}
+
+inline bool init(code_cache& cache) {
+    if (!cache.code) {
+        void* mem = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return false;
+        }
+        cache.code = static_cast<uint8_t*>(mem);
+    }
+    flush(cache);
+    cache.blocks.reserve(cache::MAX_BLOCKS);
+    return true;
+}
+
+inline void invalidate(code_cache& cache, uint16_t addr, uint16_t len) {
+    const auto mask = cache::page_mask(addr, len);
+    if (!(mask & cache.code_pages)) {
+        return;
+    }
+    cache.code_pages = 0u;
+    for (auto& b: cache.blocks) {
+        if (!b.live) {
+            continue;
+        }
+        if (b.pages & mask) {
+            b.live = false;
+            cache.lookup[b.start] = 0u;
+        } else {
+            cache.code_pages |= b.pages;
+        }
+    }
+}
+
+inline const block& compile(code_cache& cache, const chip8& cpu, uint16_t start) {
+    using dispatch::op;
+
+    if (cache.blocks.size() >= cache::MAX_BLOCKS || cache.code_used + MAX_BLOCK_CODE > CODE_BUFFER_SIZE) {
+        flush(cache);
+    }
+
+    std::vector<dispatch::decoded_op> ops;
+    std::vector<uint16_t> words;
+    auto addr = start;
+    while (ops.size() < cache::MAX_BLOCK_LEN && addr < 0x0FFFu) {
+        const auto instruct = static_cast<uint16_t>((cpu.mem[addr] << 8u) | cpu.mem[addr + 1u]);
+        ops.push_back(dispatch::DECODE_TABLE[instruct]);
+        words.push_back(instruct);
+        addr += 2u;
+        if (cache::ends_block(ops.back().code)) {
+            break;
+        }
+    }
+
+    x64::emitter e{cache.code + cache.code_used, x64::allocate(ops)};
+    const auto* entry = e.p;
+    e.prologue();
+
+    bool exited = false;
+    for (auto k = 0u; k < ops.size(); ++k) {
+        const auto& d = ops[k];
+        const auto next = static_cast<uint16_t>(start + (k + 1u) * 2u);
+        switch (d.code) {
+            case op::NOP: {
+            } break;
+
+            case op::LD: {
+                e.mov_imm(x64::RAX, d.nn);
+                e.store_v(d.x, x64::RAX);
+            } break;
+
+            case op::ADD: {
+                e.load_v(x64::RAX, d.x);
+                e.byte(0x05u); e.u32(d.nn);                 // add eax, nn
+                e.store_v(d.x, x64::RAX);
+            } break;
+
+            case op::LD_REG: {
+                e.load_v(x64::RAX, d.y);
+                e.store_v(d.x, x64::RAX);
+            } break;
+
+            case op::OR_REG:
+            case op::AND_REG:
+            case op::XOR_REG: {
+                e.load_v(x64::RAX, d.x);
+                e.load_v(x64::RCX, d.y);
+                e.byte(d.code == op::OR_REG ? 0x09u : (d.code == op::AND_REG ? 0x21u : 0x31u));
+                e.byte(0xC8u);                              // op eax, ecx
+                e.store_v(d.x, x64::RAX);
+            } break;
+
+            case op::ADD_REG: {
+                e.load_v(x64::RAX, d.x);
+                e.load_v(x64::RCX, d.y);
+                e.byte(0x01u); e.byte(0xC8u);               // add eax, ecx
+                e.byte(0x89u); e.byte(0xC2u);               // mov edx, eax
+                e.byte(0xC1u); e.byte(0xEAu); e.byte(8u);   // shr edx, 8
+                e.store_v(0xFu, x64::RDX);
+                e.store_v(d.x, x64::RAX);
+            } break;
+
+            case op::SUB_REG:
+            case op::SUBN_REG: {
+                // vF is written before vX is computed, so vX/vY are read
+                // again afterwards exactly like SUB_REG/SUBN_REG do
+                e.load_v(x64::RAX, d.x);
+                e.load_v(x64::RCX, d.y);
+                e.byte(0x39u); e.byte(d.code == op::SUB_REG ? 0xC8u : 0xC1u); // cmp eax, ecx / cmp ecx, eax
+                e.byte(0x0Fu); e.byte(0x97u); e.byte(0xC2u); // seta dl
+                e.store_v(0xFu, x64::RDX);
+                e.load_v(x64::RAX, d.x);
+                e.load_v(x64::RCX, d.y);
+                if (d.code == op::SUB_REG) {
+                    e.byte(0x29u); e.byte(0xC8u);           // sub eax, ecx
+                    e.store_v(d.x, x64::RAX);
+                } else {
+                    e.byte(0x29u); e.byte(0xC1u);           // sub ecx, eax
+                    e.store_v(d.x, x64::RCX);
+                }
+            } break;
+
+            case op::SHR:
+            case op::SHL: {
+                e.load_v(x64::RAX, d.x);
+                e.byte(0x89u); e.byte(0xC2u);               // mov edx, eax
+                e.byte(0xD1u); e.byte(d.code == op::SHR ? 0xE8u : 0xE0u); // shr/shl eax, 1
+                e.store_v(d.x, x64::RAX);
+                if (d.code == op::SHR) {
+                    e.byte(0x83u); e.byte(0xE2u); e.byte(0x01u); // and edx, 1
+                } else {
+                    e.byte(0xC1u); e.byte(0xEAu); e.byte(0x07u); // shr edx, 7
+                }
+                e.store_v(0xFu, x64::RDX);
+            } break;
+
+            case op::LD_I: {
+                e.byte(0xBDu); e.u32(d.nnn);                // mov ebp, nnn
+            } break;
+
+            case op::ADD_I_REG: {
+                e.load_v(x64::RAX, d.x);
+                e.byte(0x01u); e.byte(0xC5u);               // add ebp, eax
+                e.byte(0x0Fu); e.byte(0xB7u); e.byte(0xEDu); // movzx ebp, bp
+            } break;
+
+            case op::LD_FONT: {
+                static_assert(FONT_START_ADDR < 0x80u && sprites::FONT_SIZE == 5u);
+                e.load_v(x64::RAX, d.x);
+                e.byte(0x8Du); e.byte(0x6Cu); e.byte(0x80u); // lea ebp, [rax + rax * 4 + FONT_START_ADDR]
+                e.byte(static_cast<uint8_t>(FONT_START_ADDR));
+            } break;
+
+            case op::LD_REG_DT: {
+                e.byte(0x0Fu); e.byte(0xB6u);               // movzx eax, byte [rbx + d_timer]
+                e.mem_rbx(x64::RAX, x64::OFF_DT);
+                e.store_v(d.x, x64::RAX);
+            } break;
+
+            case op::LD_DT_REG:
+            case op::LD_ST_REG: {
+                e.load_v(x64::RAX, d.x);
+                e.byte(0x88u);                              // mov byte [rbx + timer], al
+                e.mem_rbx(x64::RAX, d.code == op::LD_DT_REG ? x64::OFF_DT : x64::OFF_ST);
+            } break;
+
+            case op::SYS:
+            case op::JP: {
+                e.store_cached();
+                e.store_pc_imm(d.nnn);
+                e.epilogue();
+                exited = true;
+            } break;
+
+            case op::SE:
+            case op::SNE: {
+                e.load_v(x64::RAX, d.x);
+                e.byte(0x3Du); e.u32(d.nn);                 // cmp eax, nn
+                e.exit_cmov(d.code == op::SE ? x64::CC_E : x64::CC_NE, next, static_cast<uint16_t>(next + 2u));
+                exited = true;
+            } break;
+
+            case op::SE_REG:
+            case op::SNE_REG: {
+                e.load_v(x64::RAX, d.x);
+                e.load_v(x64::RDX, d.y);
+                e.byte(0x39u); e.byte(0xD0u);               // cmp eax, edx
+                e.exit_cmov(d.code == op::SE_REG ? x64::CC_E : x64::CC_NE, next, static_cast<uint16_t>(next + 2u));
+                exited = true;
+            } break;
+
+            default: {
+                e.call_handler(words[k], next);
+                if (cache::ends_block(d.code)) {
+                    // The handler left pc and the registers in memory
+                    e.epilogue();
+                    exited = true;
+                } else {
+                    e.load_cached();
+                }
+            } break;
+        }
+    }
+
+    if (!exited) {
+        // Ran into MAX_BLOCK_LEN or the end of mem, fall through
+        e.store_cached();
+        e.store_pc_imm(static_cast<uint16_t>(start + ops.size() * 2u));
+        e.epilogue();
+    }
+
+    cache.code_used += static_cast<size_t>(e.p - entry);
+
+    block b{
+        start,
+        static_cast<uint16_t>(ops.size()),
+        cache::page_mask(start, static_cast<uint16_t>(ops.size() * 2u)),
+        reinterpret_cast<block_fn>(const_cast<uint8_t*>(entry)),
+        ops.back().code,
+        true
+    };
+    cache.code_pages |= b.pages;
+    cache.blocks.push_back(b);
+    cache.lookup[start] = static_cast<uint16_t>(cache.blocks.size());
+    return cache.blocks.back();
+}
+
+// Execute exactly `cycles` instructions, with the same result as
+// dispatch::run(cpu, cycles)
+inline void run(code_cache& cache, chip8& cpu, uint64_t cycles) {
+    while (cycles > 0u) {
+        const auto pc = cpu.pc;
+        if (pc >= 0x0FFFu) {
+            dispatch::step(cpu);
+            --cycles;
+            continue;
+        }
+
+        const auto idx = cache.lookup[pc];
+        const auto& b = (idx != 0u) ? cache.blocks[idx - 1u] : compile(cache, cpu, pc);
+        if (b.len > cycles) {
+            // Not enough budget left for the whole block
+            dispatch::run(cpu, cycles);
+            return;
+        }
+
+        b.fn(&cpu);
+        cycles -= b.len;
+
+        if (b.last == dispatch::op::LD_BCD) {
+            invalidate(cache, cpu.i, 3u);
+        } else if (b.last == dispatch::op::LD_I_V0X) {
+            invalidate(cache, cpu.i, 16u);
+        }
+    }
+}
+
+#else
+
+// No native backend, the cached interpreter stands in
+using code_cache = cache::block_cache;
+
+inline bool init(code_cache& c) {
+    cache::init(c);
+    return true;
+}
+
+inline void invalidate(code_cache& c, uint16_t addr, uint16_t len) {
+    cache::invalidate(c, addr, len);
+}
+
+inline void run(code_cache& c, chip8& cpu, uint64_t cycles) {
+    cache::run(c, cpu, cycles);
+}
+
+#endif
+
+} // namespace jit
+
+} // namespace chipp8
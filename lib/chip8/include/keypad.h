@@ -1,8 +1,27 @@
 #pragma once
 
 #include "chip8.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <stdint.h>
 
+/* Keypad
+
+   The KEY_x functions set cpu.keys directly and are only safe on the
+   thread running the machine.
+
+   A frontend on another thread pushes timestamped key events into an
+   event_queue instead, a single producer, single consumer ring with no
+   locks: the producer only writes head and the consumer only writes tail.
+   timing::run_frame takes the events that fell into the frame's slot of
+   wall time and applies each one before the instruction it lines up with,
+   so a press and release within one frame is still seen by SKP, SKNP and
+   FX0A running in between. The consumer side also keeps how long events
+   took from being pushed to the end of the frame that applied them.
+*/
+
 namespace chipp8 {
 
 namespace keypad {
@@ -154,6 +173,90 @@ constexpr inline void KEY_F_RELEASED(chip8& cpu) {
     cpu.keys &= ~(static_cast<uint16_t>(Key::Key_F));
 }
 
+using steady = std::chrono::steady_clock;
+
+constexpr const uint32_t EVENT_QUEUE_SIZE = 256u;
+
+static_assert((EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1u)) == 0u, "The queue indices wrap with a mask");
+
+struct event {
+    steady::time_point time;
+    // 0x0-0xF
+    uint8_t key;
+    bool pressed;
+};
+
+struct event_queue {
+    std::array<event, EVENT_QUEUE_SIZE> events;
+    // Own cache line each, written by the frontend and the emulator
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+
+    // Consumer only, events applied and their push to end of frame times
+    uint64_t applied;
+    steady::duration latency_total;
+    steady::duration latency_max;
+    // Consumer only. After a press, the instructions the next event still
+    // waits for SKP, SKNP or FX0A to run, across frames. 0 when none waits
+    uint64_t unread;
+};
+
+inline void init(event_queue& q) {
+    q.head.store(0u, std::memory_order_relaxed);
+    q.tail.store(0u, std::memory_order_relaxed);
+    q.applied = 0u;
+    q.latency_total = steady::duration::zero();
+    q.latency_max = steady::duration::zero();
+    q.unread = 0u;
+}
+
+// Frontend thread. False if the queue is full, the event is dropped
+inline bool push(event_queue& q, const event& e) {
+    const auto head = q.head.load(std::memory_order_relaxed);
+    if (head - q.tail.load(std::memory_order_acquire) == EVENT_QUEUE_SIZE) {
+        return false;
+    }
+    q.events[head & (EVENT_QUEUE_SIZE - 1u)] = e;
+    q.head.store(head + 1u, std::memory_order_release);
+    return true;
+}
+
+inline bool push(event_queue& q, uint8_t key, bool pressed) {
+    return push(q, {steady::now(), static_cast<uint8_t>(key & 0x0Fu), pressed});
+}
+
+// Emulator thread. The oldest event without taking it, false if empty
+inline bool peek(const event_queue& q, event& e) {
+    const auto tail = q.tail.load(std::memory_order_relaxed);
+    if (q.head.load(std::memory_order_acquire) == tail) {
+        return false;
+    }
+    e = q.events[tail & (EVENT_QUEUE_SIZE - 1u)];
+    return true;
+}
+
+// Emulator thread, drops the event peek returned
+inline void pop(event_queue& q) {
+    q.tail.store(q.tail.load(std::memory_order_relaxed) + 1u, std::memory_order_release);
+}
+
+constexpr inline void apply(chip8& cpu, const event& e) {
+    const auto bit = static_cast<uint16_t>(1u << (e.key & 0x0Fu));
+    cpu.keys = e.pressed ? static_cast<uint16_t>(cpu.keys | bit) : static_cast<uint16_t>(cpu.keys & ~bit);
+}
+
+// Count `count` applied events as visible at `shown`. time_sum is their
+// push times added up since the clock's epoch, oldest the earliest of them
+inline void record_latency(event_queue& q, uint64_t count, steady::duration time_sum, steady::time_point oldest,
+                           steady::time_point shown) {
+    if (count == 0u) {
+        return;
+    }
+    q.applied += count;
+    q.latency_total += shown.time_since_epoch() * static_cast<int64_t>(count) - time_sum;
+    q.latency_max = std::max(q.latency_max, shown - oldest);
+}
+
 } // namespace keypad
 
 } // namespace chipp8
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+
+/* Opcode profiler
+
+   profile::run is dispatch::run plus a set of counters: executions per
+   dispatch::op (the cases of parse_op), executions per pc over the 4K
+   address space, DXYN calls and the rows they drew, and the instructions
+   spent waiting on the delay timer or the keypad.
+
+   Whether anything is counted is decided at compile time, by the Enabled
+   template parameter, which defaults to CHIPP8_ENABLE_PROFILER being
+   defined. With it off step() and run() are dispatch::step and
+   dispatch::run, the counters are never touched, and the build is the
+   plain interpreter instruction for instruction.
+
+   The counters export as a flat little-endian binary dump, as CSV, or as a
+   text report of the busiest opcodes and addresses.
+*/
+
+namespace chipp8 {
+
+namespace profile {
+
+#if defined(CHIPP8_ENABLE_PROFILER)
+constexpr const bool ENABLED = true;
+#else
+constexpr const bool ENABLED = false;
+#endif
+
+constexpr const uint32_t DUMP_MAGIC = 0x46503843u; // "C8PF"
+constexpr const uint8_t DUMP_VERSION = 1u;
+
+constexpr const size_t PC_COUNT = 4096u;
+
+// Same order as dispatch::op
+constexpr const std::array<const char*, dispatch::OP_COUNT> OP_NAMES = {
+    "NOP", "CLS", "RET", "SYS", "JP", "CALL", "SE", "SNE", "SE_REG", "LD", "ADD", "LD_REG",
+    "OR_REG", "AND_REG", "XOR_REG", "ADD_REG", "SUB_REG", "SHR", "SUBN_REG", "SHL", "SNE_REG",
+    "LD_I", "JP_V0", "RND", "DRW", "SKP", "SKNP", "LD_REG_DT", "WAIT_KP", "LD_DT_REG",
+    "LD_ST_REG", "ADD_I_REG", "LD_FONT", "LD_BCD", "LD_I_V0X", "LD_V0X_I"
+};
+
+struct counters {
+    std::array<uint64_t, dispatch::OP_COUNT> ops;
+    // Indexed by the pc the instruction was fetched from, masked to 12 bits
+    std::array<uint64_t, PC_COUNT> pc;
+    // DXYN executed, and the sprite rows they put on the display
+    uint64_t draws;
+    uint64_t rows_drawn;
+    // FX07 reading a delay timer that has not run out yet, each one an
+    // iteration of a loop waiting on it
+    uint64_t timer_wait;
+    // FX0A run with no key down, it will run again
+    uint64_t key_wait;
+
+    bool operator==(const counters&) const = default;
+};
+
+constexpr inline void reset(counters& c) {
+    c.ops.fill(0u);
+    c.pc.fill(0u);
+    c.draws = 0u;
+    c.rows_drawn = 0u;
+    c.timer_wait = 0u;
+    c.key_wait = 0u;
+}
+
+// Instructions counted, the sum over every opcode
+constexpr inline uint64_t total(const counters& c) {
+    return std::accumulate(c.ops.begin(), c.ops.end(), uint64_t{0u});
+}
+
+// Rows DXYN puts on the display, the ones cut off by Q::clip_sprites aside
+template <typename Q = quirks::modern>
+constexpr inline uint64_t sprite_rows(const chip8& cpu, const dispatch::decoded_op& d) {
+    if constexpr (Q::clip_sprites) {
+        const auto start_y = cpu.v[d.y] % DISPLAY_HEIGHT;
+        return std::min<uint64_t>(d.n, DISPLAY_HEIGHT - start_y);
+    } else {
+        return d.n;
+    }
+}
+
+// fetch, count, increment pc, execute
+template <typename Q = quirks::modern, bool Enabled = ENABLED>
+constexpr inline void step(chip8& cpu, [[maybe_unused]] counters& c) {
+    if constexpr (!Enabled) {
+        dispatch::step<Q>(cpu);
+    } else {
+        const auto& d = dispatch::DECODE_TABLE_FOR<Q>[fetch(cpu)];
+        ++c.ops[static_cast<size_t>(d.code)];
+        ++c.pc[cpu.pc & 0x0FFFu];
+        switch (d.code) {
+            case dispatch::op::DRW:
+                ++c.draws;
+                c.rows_drawn += sprite_rows<Q>(cpu, d);
+                break;
+            case dispatch::op::LD_REG_DT:
+                c.timer_wait += (cpu.d_timer != 0u) ? 1u : 0u;
+                break;
+            case dispatch::op::WAIT_KP:
+                c.key_wait += (cpu.keys & 0xFFFFu) ? 0u : 1u;
+                break;
+            default:
+                break;
+        }
+        cpu.pc += 2u;
+        dispatch::execute(cpu, d);
+    }
+}
+
+template <typename Q = quirks::modern, bool Enabled = ENABLED>
+constexpr inline void run(chip8& cpu, uint64_t cycles, [[maybe_unused]] counters& c) {
+    if constexpr (!Enabled) {
+        dispatch::run<Q>(cpu, cycles);
+    } else {
+        for (uint64_t k = 0u; k < cycles; ++k) {
+            step<Q, true>(cpu, c);
+        }
+    }
+}
+
+// Magic and version then every counter as a u64, in declaration order
+inline std::vector<uint8_t> encode(const counters& c) {
+    std::vector<uint8_t> out;
+    out.reserve(5u + 8u * (dispatch::OP_COUNT + PC_COUNT + 4u));
+    auto put = [&](uint64_t value, unsigned bytes) {
+        for (auto b = 0u; b < bytes; ++b) {
+            out.push_back(static_cast<uint8_t>(value >> (8u * b)));
+        }
+    };
+    put(DUMP_MAGIC, 4u);
+    put(DUMP_VERSION, 1u);
+    for (const auto n: c.ops) {
+        put(n, 8u);
+    }
+    for (const auto n: c.pc) {
+        put(n, 8u);
+    }
+    put(c.draws, 8u);
+    put(c.rows_drawn, 8u);
+    put(c.timer_wait, 8u);
+    put(c.key_wait, 8u);
+    return out;
+}
+
+// False if data is not a whole dump of this version
+inline bool decode(const uint8_t* data, size_t size, counters& c) {
+    if (size != 5u + 8u * (dispatch::OP_COUNT + PC_COUNT + 4u)) {
+        return false;
+    }
+    size_t pos = 0u;
+    auto get = [&](unsigned bytes) {
+        uint64_t value = 0u;
+        for (auto b = 0u; b < bytes; ++b) {
+            value |= static_cast<uint64_t>(data[pos++]) << (8u * b);
+        }
+        return value;
+    };
+    if (get(4u) != DUMP_MAGIC || get(1u) != DUMP_VERSION) {
+        return false;
+    }
+    for (auto& n: c.ops) {
+        n = get(8u);
+    }
+    for (auto& n: c.pc) {
+        n = get(8u);
+    }
+    c.draws = get(8u);
+    c.rows_drawn = get(8u);
+    c.timer_wait = get(8u);
+    c.key_wait = get(8u);
+    return true;
+}
+
+// kind,key,count lines, one per opcode and per address that ran at all
+inline std::string to_csv(const counters& c) {
+    std::string out = "kind,key,count\n";
+    char line[64];
+    for (size_t k = 0u; k < c.ops.size(); ++k) {
+        if (c.ops[k] != 0u) {
+            snprintf(line, sizeof(line), "op,%s,%llu\n", OP_NAMES[k], static_cast<unsigned long long>(c.ops[k]));
+            out += line;
+        }
+    }
+    for (size_t k = 0u; k < c.pc.size(); ++k) {
+        if (c.pc[k] != 0u) {
+            snprintf(line, sizeof(line), "pc,0x%03zX,%llu\n", k, static_cast<unsigned long long>(c.pc[k]));
+            out += line;
+        }
+    }
+    const std::array<std::pair<const char*, uint64_t>, 4u> totals = {{
+        {"draws", c.draws}, {"rows_drawn", c.rows_drawn}, {"timer_wait", c.timer_wait}, {"key_wait", c.key_wait}
+    }};
+    for (const auto& [name, n]: totals) {
+        snprintf(line, sizeof(line), "total,%s,%llu\n", name, static_cast<unsigned long long>(n));
+        out += line;
+    }
+    return out;
+}
+
+// Indices of the top_n largest entries of counts that are not 0, largest
+// first and lowest index first on ties
+template <size_t N>
+inline std::vector<size_t> top(const std::array<uint64_t, N>& counts, size_t top_n) {
+    std::vector<size_t> order;
+    for (size_t k = 0u; k < N; ++k) {
+        if (counts[k] != 0u) {
+            order.push_back(k);
+        }
+    }
+    const auto n = std::min(top_n, order.size());
+    std::partial_sort(order.begin(), order.begin() + n, order.end(), [&](size_t a, size_t b) {
+        return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+    });
+    order.resize(n);
+    return order;
+}
+
+// The top_n opcodes and addresses by executions, with their share of the
+// instructions counted
+inline std::string report(const counters& c, size_t top_n = 10u) {
+    const auto all = total(c);
+    const auto share = [&](uint64_t n) {
+        return all ? 100.0 * static_cast<double>(n) / static_cast<double>(all) : 0.0;
+    };
+    std::string out;
+    char line[192];
+    snprintf(line, sizeof(line), "instructions %llu, draws %llu (%llu rows), timer waits %llu, key waits %llu\n",
+        static_cast<unsigned long long>(all), static_cast<unsigned long long>(c.draws),
+        static_cast<unsigned long long>(c.rows_drawn), static_cast<unsigned long long>(c.timer_wait),
+        static_cast<unsigned long long>(c.key_wait));
+    out += line;
+    out += "opcodes\n";
+    for (const auto k: top(c.ops, top_n)) {
+        snprintf(line, sizeof(line), "  %-10s %14llu %6.2f%%\n", OP_NAMES[k], static_cast<unsigned long long>(c.ops[k]), share(c.ops[k]));
+        out += line;
+    }
+    out += "hotspots\n";
+    for (const auto k: top(c.pc, top_n)) {
+        snprintf(line, sizeof(line), "  0x%03zX      %14llu %6.2f%%\n", k, static_cast<unsigned long long>(c.pc[k]), share(c.pc[k]));
+        out += line;
+    }
+    return out;
+}
+
+} // namespace profile
+
+} // namespace chipp8
@@ -0,0 +1,64 @@
+#pragma once
+
+/* Interpreter quirks
+
+   The CHIP-8 variants disagree on a handful of opcodes. A quirks profile
+   is a type holding one constexpr flag per disagreement, passed as the
+   template parameter Q of the opcode functions in chip8.h, of parse_op and
+   of dispatch. The opcode functions test the flags with if constexpr, so
+   every profile compiles to its own interpreter with no quirk left to
+   check at run time.
+
+   https://chip8.gulrak.net/#quirks
+*/
+
+namespace chipp8 {
+
+namespace quirks {
+
+// The behaviour chip8.h has always had, and the only one the cached
+// interpreter, the recompiler and the batch engine implement
+struct modern {
+    // 8XY6/8XYE shift vY into vX instead of shifting vX in place
+    static constexpr bool shift_vy = false;
+    // FX55/FX65 leave I pointing past the last register they moved
+    static constexpr bool load_store_increments_i = false;
+    // BNNN jumps to XNN + vX instead of NNN + v0
+    static constexpr bool jump_vx = false;
+    // 8XY1/8XY2/8XY3 set vF to 0
+    static constexpr bool logic_resets_vf = false;
+    // DXYN clips sprites at the edges of the display instead of wrapping
+    // them around, the starting position wraps either way
+    static constexpr bool clip_sprites = false;
+};
+
+// The original COSMAC VIP interpreter
+struct cosmac_vip {
+    static constexpr bool shift_vy = true;
+    static constexpr bool load_store_increments_i = true;
+    static constexpr bool jump_vx = false;
+    static constexpr bool logic_resets_vf = true;
+    static constexpr bool clip_sprites = true;
+};
+
+// SUPER-CHIP 1.1 on the HP 48
+struct super_chip {
+    static constexpr bool shift_vy = false;
+    static constexpr bool load_store_increments_i = false;
+    static constexpr bool jump_vx = true;
+    static constexpr bool logic_resets_vf = false;
+    static constexpr bool clip_sprites = true;
+};
+
+// XO-CHIP, as in Octo
+struct xo_chip {
+    static constexpr bool shift_vy = true;
+    static constexpr bool load_store_increments_i = true;
+    static constexpr bool jump_vx = false;
+    static constexpr bool logic_resets_vf = false;
+    static constexpr bool clip_sprites = false;
+};
+
+} // namespace quirks
+
+} // namespace chipp8
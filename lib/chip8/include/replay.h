@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "chip8.h"
+#include "fleet.h"
+#include "idle.h"
+#include "scheduler.h"
+
+/* Input recording and replay
+
+   With the generator seeded, the only thing from outside that changes a
+   run is cpu.keys. A recorder sits next to the timing::scheduler driving
+   the machine and logs every change of the keys as (cycle, keys) with
+   cycle the scheduler's instruction count at that point. Along with the
+   seed and the instruction rate that is everything needed to run the
+   session again, frame split and timer ticks included.
+
+   Events are stored as deltas, the cycles since the previous event and
+   the keys XOR the previous keys, each as a LEB128 varint, so a key going
+   up or down a few frames after the last one takes three to five bytes.
+
+   play() runs the log back without any throttling, through idle::run, and
+   verify() checks that it ends on the display hash of the recording.
+*/
+
+namespace chipp8 {
+
+namespace replay {
+
+constexpr const uint32_t LOG_MAGIC = 0x4C493843u; // "C8IL"
+constexpr const uint8_t LOG_VERSION = 1u;
+
+struct log {
+    uint32_t seed;
+    uint32_t instructions_per_second;
+    // Instructions from the start to the end of the recording
+    uint64_t cycles;
+    // fleet::display_hash at the end of the recording
+    uint64_t display_hash;
+    uint64_t event_count;
+    // event_count pairs of varints, (cycle delta, keys ^ previous keys)
+    std::vector<uint8_t> events;
+};
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80u) {
+        out.push_back(static_cast<uint8_t>(value | 0x80u));
+        value >>= 7u;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads a varint at pos and moves pos past it, false if it runs off the end
+inline bool get_varint(const uint8_t* data, size_t size, size_t& pos, uint64_t& value) {
+    value = 0u;
+    for (auto shift = 0u; shift < 64u; shift += 7u) {
+        if (pos >= size) {
+            return false;
+        }
+        const auto byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+        if (!(byte & 0x80u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct recorder {
+    log out;
+    // Keys and cycle of the last event
+    uint16_t keys;
+    uint64_t cycle;
+};
+
+// Seed cpu and start s and r on a new recording. cpu holds the machine the
+// replay will start from, e.g. straight after load_program
+inline void start(recorder& r, timing::scheduler& s, chip8& cpu, uint32_t seed, uint32_t instructions_per_second, bool turbo) {
+    seed_rng(cpu, seed);
+    timing::init(s, instructions_per_second, turbo);
+    r.out = {seed, instructions_per_second, 0u, 0u, 0u, {}};
+    r.keys = 0u;
+    r.cycle = 0u;
+    if (cpu.keys != 0u) {
+        put_varint(r.out.events, 0u);
+        put_varint(r.out.events, cpu.keys);
+        ++r.out.event_count;
+        r.keys = cpu.keys;
+    }
+}
+
+// Set the keypad to keys from the current instruction on, logging it if it
+// changed anything
+inline void set_keys(recorder& r, const timing::scheduler& s, chip8& cpu, uint16_t keys) {
+    cpu.keys = keys;
+    if (keys == r.keys) {
+        return;
+    }
+    put_varint(r.out.events, s.instructions - r.cycle);
+    put_varint(r.out.events, static_cast<uint16_t>(keys ^ r.keys));
+    ++r.out.event_count;
+    r.keys = keys;
+    r.cycle = s.instructions;
+}
+
+// Close the recording where the machine is now
+inline const log& finish(recorder& r, const timing::scheduler& s, const chip8& cpu) {
+    r.out.cycles = s.instructions;
+    r.out.display_hash = fleet::display_hash(cpu.pixels);
+    return r.out;
+}
+
+// Run l from cpu, which must be the machine start() was given before
+// seeding. Frames are split and timers ticked exactly as the recording's
+// scheduler did. False if the events are malformed
+inline bool play(const log& l, chip8& cpu) {
+    if (l.instructions_per_second == 0u) {
+        return false;
+    }
+    seed_rng(cpu, l.seed);
+    cpu.keys = 0u;
+
+    const auto* data = l.events.data();
+    const auto size = l.events.size();
+    size_t pos = 0u;
+    uint64_t left = l.event_count;
+
+    // Next event, ~0 once there are none
+    uint64_t last = 0u;
+    uint64_t event_cycle = ~0ull;
+    uint64_t event_keys = 0u;
+    auto next_event = [&] {
+        if (left == 0u) {
+            event_cycle = ~0ull;
+            return true;
+        }
+        --left;
+        uint64_t delta = 0u;
+        if (!get_varint(data, size, pos, delta) || !get_varint(data, size, pos, event_keys)) {
+            return false;
+        }
+        last += delta;
+        event_cycle = last;
+        return true;
+    };
+    if (!next_event()) {
+        return false;
+    }
+
+    uint64_t done = 0u;
+    for (uint64_t frame = 1u; done < l.cycles; ++frame) {
+        const auto frame_end = std::min(timing::instructions_by(frame, l.instructions_per_second), l.cycles);
+        while (done < frame_end) {
+            while (event_cycle == done) {
+                cpu.keys = static_cast<uint16_t>(cpu.keys ^ event_keys);
+                if (!next_event()) {
+                    return false;
+                }
+            }
+            const auto until = std::min(frame_end, event_cycle);
+            idle::run(cpu, until - done);
+            done = until;
+        }
+        if (done == timing::instructions_by(frame, l.instructions_per_second)) {
+            tick_timers(cpu);
+        }
+    }
+    // Keys set after the last instruction still count
+    while (event_cycle == done) {
+        cpu.keys = static_cast<uint16_t>(cpu.keys ^ event_keys);
+        if (!next_event()) {
+            return false;
+        }
+    }
+    return pos == size;
+}
+
+// Replay l on cpu and check it lands on the recorded display
+inline bool verify(const log& l, chip8& cpu) {
+    return play(l, cpu) && fleet::display_hash(cpu.pixels) == l.display_hash;
+}
+
+// Header then the events, integers little-endian
+inline std::vector<uint8_t> encode(const log& l) {
+    std::vector<uint8_t> out;
+    auto put = [&](uint64_t value, unsigned bytes) {
+        for (auto b = 0u; b < bytes; ++b) {
+            out.push_back(static_cast<uint8_t>(value >> (8u * b)));
+        }
+    };
+    put(LOG_MAGIC, 4u);
+    put(LOG_VERSION, 1u);
+    put(l.seed, 4u);
+    put(l.instructions_per_second, 4u);
+    put(l.display_hash, 8u);
+    put_varint(out, l.cycles);
+    put_varint(out, l.event_count);
+    put_varint(out, l.events.size());
+    out.insert(out.end(), l.events.begin(), l.events.end());
+    return out;
+}
+
+// False if data is not a whole log of this version
+inline bool decode(const uint8_t* data, size_t size, log& l) {
+    size_t pos = 0u;
+    auto get = [&](unsigned bytes, uint64_t& value) {
+        if (size - pos < bytes) {
+            return false;
+        }
+        value = 0u;
+        for (auto b = 0u; b < bytes; ++b) {
+            value |= static_cast<uint64_t>(data[pos++]) << (8u * b);
+        }
+        return true;
+    };
+    uint64_t magic = 0u;
+    uint64_t version = 0u;
+    uint64_t seed = 0u;
+    uint64_t rate = 0u;
+    uint64_t event_bytes = 0u;
+    if (!get(4u, magic) || magic != LOG_MAGIC || !get(1u, version) || version != LOG_VERSION) {
+        return false;
+    }
+    if (!get(4u, seed) || !get(4u, rate) || !get(8u, l.display_hash)) {
+        return false;
+    }
+    if (!get_varint(data, size, pos, l.cycles) || !get_varint(data, size, pos, l.event_count) ||
+        !get_varint(data, size, pos, event_bytes) || event_bytes != size - pos || rate == 0u) {
+        return false;
+    }
+    l.seed = static_cast<uint32_t>(seed);
+    l.instructions_per_second = static_cast<uint32_t>(rate);
+    l.events.assign(data + pos, data + size);
+    return true;
+}
+
+} // namespace replay
+
+} // namespace chipp8
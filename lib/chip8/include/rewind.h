@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "chip8.h"
+
+/* Rewind history
+
+   record() is called once per frame. Each record is an undo delta: the
+   registers of the previous frame plus the old contents of every 64 byte
+   chunk of mem and every display row the frame changed, so stepping back
+   one frame costs only what that frame touched. Every keyframe_interval
+   records also carry a full copy of the previous frame, which lets
+   rewind() jump far back without undoing every frame in between.
+
+   Records live back to back in one byte arena allocated up front and used
+   as a ring, the oldest records are dropped to make room, so recording
+   never allocates. The changes are found against a shadow copy of the last
+   recorded frame.
+
+   Stepping back expects the machine to still be in the last recorded
+   frame, i.e. record() after every frame you want to be able to return to.
+*/
+
+namespace chipp8 {
+
+namespace rewind {
+
+constexpr const uint16_t CHUNK_SIZE = 64u;
+constexpr const uint16_t CHUNK_COUNT = 4096u / CHUNK_SIZE;
+constexpr const uint32_t DEFAULT_KEYFRAME_INTERVAL = 60u;
+
+// Everything but mem and the display
+struct registers {
+    std::array<uint16_t, 16u> stack;
+    std::array<uint8_t, 16u> v;
+    rng::stream rng;
+    uint16_t i;
+    uint16_t pc;
+    uint16_t keys;
+    uint8_t sp;
+    uint8_t d_timer;
+    uint8_t s_timer;
+};
+
+struct record_header {
+    registers regs;
+    uint8_t chunks;
+    uint8_t rows;
+    bool keyframe;
+};
+
+// Largest possible record: every chunk and row changed, plus a keyframe
+constexpr const size_t MAX_RECORD_SIZE = sizeof(record_header) + CHUNK_COUNT * (1u + CHUNK_SIZE) +
+                                         DISPLAY_HEIGHT * (1u + sizeof(uint64_t)) + sizeof(chip8);
+
+// Where a record sits in the arena, offsets count up forever and wrap by
+// the arena size
+struct record_ref {
+    uint64_t offset;
+    uint32_t size;
+    bool keyframe;
+};
+
+struct history {
+    std::vector<uint8_t> arena;
+    // Ring of records, oldest at `first`
+    std::vector<record_ref> records;
+    size_t first;
+    size_t count;
+    // Arena offset the next record is written at
+    uint64_t head;
+
+    uint32_t keyframe_interval;
+    uint64_t recorded;
+
+    // The last recorded frame
+    chip8 shadow;
+};
+
+constexpr inline registers save_registers(const chip8& cpu) {
+    return {cpu.stack, cpu.v, cpu.rng, cpu.i, cpu.pc, cpu.keys, cpu.sp, cpu.d_timer, cpu.s_timer};
+}
+
+constexpr inline void load_registers(chip8& cpu, const registers& r) {
+    cpu.stack = r.stack;
+    cpu.v = r.v;
+    cpu.rng = r.rng;
+    cpu.i = r.i;
+    cpu.pc = r.pc;
+    cpu.keys = r.keys;
+    cpu.sp = r.sp;
+    cpu.d_timer = r.d_timer;
+    cpu.s_timer = r.s_timer;
+}
+
+// Keep up to max_frames frames in arena_bytes of records, starting from cpu
+inline void init(history& h, const chip8& cpu, size_t max_frames, size_t arena_bytes, uint32_t keyframe_interval = DEFAULT_KEYFRAME_INTERVAL) {
+    h.arena.assign(std::max(arena_bytes, 2u * MAX_RECORD_SIZE), 0u);
+    h.records.assign(std::max<size_t>(max_frames, 1u), record_ref{0u, 0u, false});
+    h.first = 0u;
+    h.count = 0u;
+    h.head = 0u;
+    h.keyframe_interval = std::max(keyframe_interval, 1u);
+    h.recorded = 0u;
+    h.shadow = cpu;
+}
+
+// Frames that can be stepped back
+inline size_t available(const history& h) {
+    return h.count;
+}
+
+inline const record_ref& newest(const history& h) {
+    return h.records[(h.first + h.count - 1u) % h.records.size()];
+}
+
+inline void drop_oldest(history& h) {
+    h.first = (h.first + 1u) % h.records.size();
+    --h.count;
+}
+
+inline uint8_t* at(history& h, uint64_t offset) {
+    return h.arena.data() + (offset % h.arena.size());
+}
+
+inline const uint8_t* at(const history& h, uint64_t offset) {
+    return h.arena.data() + (offset % h.arena.size());
+}
+
+// Add the step from the last recorded frame to cpu
+inline void record(history& h, const chip8& cpu) {
+    // What changed since the last record
+    std::array<uint8_t, CHUNK_COUNT> chunks;
+    std::array<uint8_t, DISPLAY_HEIGHT> rows;
+    size_t chunk_count = 0u;
+    size_t row_count = 0u;
+    for (auto c = 0u; c < CHUNK_COUNT; ++c) {
+        if (memcmp(cpu.mem.data() + c * CHUNK_SIZE, h.shadow.mem.data() + c * CHUNK_SIZE, CHUNK_SIZE) != 0) {
+            chunks[chunk_count++] = static_cast<uint8_t>(c);
+        }
+    }
+    for (auto r = 0u; r < DISPLAY_HEIGHT; ++r) {
+        if (cpu.pixels[r] != h.shadow.pixels[r]) {
+            rows[row_count++] = static_cast<uint8_t>(r);
+        }
+    }
+
+    const bool keyframe = (h.recorded % h.keyframe_interval) == 0u;
+    const auto size = static_cast<uint32_t>(sizeof(record_header) + chunk_count * (1u + CHUNK_SIZE) +
+                                            row_count * (1u + sizeof(uint64_t)) + (keyframe ? sizeof(chip8) : 0u));
+
+    // Records never wrap the end of the arena, skip the leftover bytes
+    uint64_t offset = h.head;
+    if ((offset % h.arena.size()) + size > h.arena.size()) {
+        offset += h.arena.size() - (offset % h.arena.size());
+    }
+    if (h.count == h.records.size()) {
+        drop_oldest(h);
+    }
+    while (h.count > 0u && offset + size - h.records[h.first].offset > h.arena.size()) {
+        drop_oldest(h);
+    }
+
+    auto* p = at(h, offset);
+    const record_header header{save_registers(h.shadow), static_cast<uint8_t>(chunk_count), static_cast<uint8_t>(row_count), keyframe};
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    if (keyframe) {
+        memcpy(p, &h.shadow, sizeof(chip8));
+        p += sizeof(chip8);
+    }
+    for (size_t k = 0u; k < chunk_count; ++k) {
+        const auto c = chunks[k];
+        *p++ = c;
+        memcpy(p, h.shadow.mem.data() + c * CHUNK_SIZE, CHUNK_SIZE);
+        memcpy(h.shadow.mem.data() + c * CHUNK_SIZE, cpu.mem.data() + c * CHUNK_SIZE, CHUNK_SIZE);
+        p += CHUNK_SIZE;
+    }
+    for (size_t k = 0u; k < row_count; ++k) {
+        const auto r = rows[k];
+        *p++ = r;
+        memcpy(p, &h.shadow.pixels[r], sizeof(uint64_t));
+        h.shadow.pixels[r] = cpu.pixels[r];
+        p += sizeof(uint64_t);
+    }
+    load_registers(h.shadow, save_registers(cpu));
+
+    h.records[(h.first + h.count) % h.records.size()] = {offset, size, keyframe};
+    ++h.count;
+    h.head = offset + size;
+    ++h.recorded;
+}
+
+// Undo the newest record on both cpu and the shadow
+inline void undo_newest(history& h, chip8& cpu) {
+    const auto ref = newest(h);
+    const auto* p = at(h, ref.offset);
+    record_header header;
+    memcpy(&header, p, sizeof(header));
+    p += sizeof(header) + (header.keyframe ? sizeof(chip8) : 0u);
+
+    for (auto k = 0u; k < header.chunks; ++k) {
+        const auto c = *p++;
+        memcpy(cpu.mem.data() + c * CHUNK_SIZE, p, CHUNK_SIZE);
+        memcpy(h.shadow.mem.data() + c * CHUNK_SIZE, p, CHUNK_SIZE);
+        p += CHUNK_SIZE;
+    }
+    for (auto k = 0u; k < header.rows; ++k) {
+        const auto r = *p++;
+        memcpy(&cpu.pixels[r], p, sizeof(uint64_t));
+        h.shadow.pixels[r] = cpu.pixels[r];
+        p += sizeof(uint64_t);
+    }
+    load_registers(cpu, header.regs);
+    load_registers(h.shadow, header.regs);
+
+    h.head = ref.offset;
+    --h.count;
+    --h.recorded;
+}
+
+// Go back `frames` recorded frames, or as many as there are. Restores the
+// oldest keyframe in range first when that saves undoing any frames.
+// Returns the number of frames gone back
+inline size_t rewind(history& h, chip8& cpu, size_t frames) {
+    frames = std::min(frames, h.count);
+    const auto target = h.count - frames;
+
+    // Undoing record k gives back the frame its keyframe holds, so loading
+    // the keyframe of any k from target up skips the deltas above k
+    for (size_t k = target; k + 1u < h.count; ++k) {
+        const auto& ref = h.records[(h.first + k) % h.records.size()];
+        if (ref.keyframe) {
+            memcpy(&h.shadow, at(h, ref.offset) + sizeof(record_header), sizeof(chip8));
+            cpu = h.shadow;
+            h.head = ref.offset;
+            h.recorded -= h.count - k;
+            h.count = k;
+            break;
+        }
+    }
+    while (h.count > target) {
+        undo_newest(h, cpu);
+    }
+    return frames;
+}
+
+inline bool step_back(history& h, chip8& cpu) {
+    return rewind(h, cpu, 1u) == 1u;
+}
+
+} // namespace rewind
+
+} // namespace chipp8
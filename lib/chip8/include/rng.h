@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Counter based random numbers
+
+   CXNN draws byte `count` of the stream keyed by (seed, instance), computed
+   directly as Philox2x32-10 of the counter (count, instance) under the key
+   seed (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"). A
+   draw only depends on those three numbers, not on what ran before or on
+   which thread, so instances give the same results however they are
+   scheduled, and there is no shared state to fight over.
+
+   Everything but bytes() is constexpr. bytes() fills many lanes at once,
+   running each round over a block of lanes in a plain loop that the
+   compiler vectorizes.
+*/
+
+namespace chipp8 {
+
+namespace rng {
+
+constexpr const uint32_t PHILOX_M = 0xD256D193u;
+constexpr const uint32_t PHILOX_W = 0x9E3779B9u;
+constexpr const unsigned PHILOX_ROUNDS = 10u;
+
+// Where a machine is in its stream
+struct stream {
+    uint32_t seed;
+    uint32_t instance;
+    // CXNN draws so far
+    uint32_t count;
+
+    bool operator==(const stream&) const = default;
+};
+
+constexpr inline std::array<uint32_t, 2u> philox2x32(uint32_t c0, uint32_t c1, uint32_t key) {
+    for (auto r = 0u; r < PHILOX_ROUNDS; ++r) {
+        const uint64_t product = static_cast<uint64_t>(PHILOX_M) * c0;
+        const auto hi = static_cast<uint32_t>(product >> 32u);
+        const auto lo = static_cast<uint32_t>(product);
+        c0 = hi ^ key ^ c1;
+        c1 = lo;
+        key += PHILOX_W;
+    }
+    return {c0, c1};
+}
+
+// Known answers from the Random123 test vectors
+static_assert(philox2x32(0x00000000u, 0x00000000u, 0x00000000u) == std::array<uint32_t, 2u>{0xFF1DAE59u, 0x6CD10DF2u});
+static_assert(philox2x32(0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu) == std::array<uint32_t, 2u>{0x2C3F628Bu, 0xAB4FD7ADu});
+static_assert(philox2x32(0x243F6A88u, 0x85A308D3u, 0x13198A2Eu) == std::array<uint32_t, 2u>{0xDD7CE038u, 0xF62A4C12u});
+
+// Byte `index` of the (seed, instance) stream
+constexpr inline uint8_t byte_at(uint32_t seed, uint32_t instance, uint32_t index) {
+    return static_cast<uint8_t>(philox2x32(index, instance, seed)[0u] >> 24u);
+}
+
+constexpr inline uint8_t next(stream& s) {
+    return byte_at(s.seed, s.instance, s.count++);
+}
+
+constexpr const size_t BULK_BLOCK = 16u;
+
+// out[k] = byte_at(seed[k], instance[k], count[k]) for k < n, the counts
+// are not advanced. Lanes go through the rounds BULK_BLOCK at a time, so
+// each round is one vector multiply over the block
+inline void bytes(const uint32_t* seed, const uint32_t* instance, const uint32_t* count, uint8_t* out, size_t n) {
+    size_t k = 0u;
+    for (; k + BULK_BLOCK <= n; k += BULK_BLOCK) {
+        uint32_t c0[BULK_BLOCK];
+        uint32_t c1[BULK_BLOCK];
+        uint32_t key[BULK_BLOCK];
+        for (size_t l = 0u; l < BULK_BLOCK; ++l) {
+            c0[l] = count[k + l];
+            c1[l] = instance[k + l];
+            key[l] = seed[k + l];
+        }
+        for (auto r = 0u; r < PHILOX_ROUNDS; ++r) {
+            for (size_t l = 0u; l < BULK_BLOCK; ++l) {
+                const uint64_t product = static_cast<uint64_t>(PHILOX_M) * c0[l];
+                c0[l] = static_cast<uint32_t>(product >> 32u) ^ key[l] ^ c1[l];
+                c1[l] = static_cast<uint32_t>(product);
+                key[l] += PHILOX_W;
+            }
+        }
+        for (size_t l = 0u; l < BULK_BLOCK; ++l) {
+            out[k + l] = static_cast<uint8_t>(c0[l] >> 24u);
+        }
+    }
+    for (; k < n; ++k) {
+        out[k] = byte_at(seed[k], instance[k], count[k]);
+    }
+}
+
+} // namespace rng
+
+} // namespace chipp8
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "chip8.h"
+
+/* ROMs and ROM packs
+
+   rom::load copies a program into a machine after checking that it fits
+   between its start address and the end of mem, 0xE00 bytes from
+   PROGRAM_START_ADDR and 0xA00 from ETI_660_PROGRAM_START_ADDR. load_file
+   does the same from a file.
+
+   A pack is many ROMs in one file, opened with a single mmap, so starting
+   thousands of sessions costs one open and page faults instead of an open
+   and a read per ROM. Each ROM is copied straight from the mapping into
+   mem. Little endian:
+
+       header   16 bytes   "C8RP", version u16, reserved u16, count u32,
+                           names size u32
+       index    count x 24 name offset u32, name length u32, FNV-1a 64
+                           hash u64, offset u32, length u32
+       names    the names, back to back, no terminators
+       roms     the ROM bytes, back to back
+
+   The index is sorted by name so find() is a binary search, name offsets
+   are into the names block and ROM offsets from the start of the file.
+   Identical ROMs under different names share their bytes. open() checks
+   every range against the file once, after which get() and load() trust
+   the index.
+*/
+
+namespace chipp8 {
+
+namespace rom {
+
+constexpr const uint32_t PACK_MAGIC = 0x50523843u; // "C8RP"
+constexpr const uint16_t PACK_VERSION = 1u;
+constexpr const size_t PACK_HEADER_SIZE = 16u;
+constexpr const size_t PACK_ENTRY_SIZE = 24u;
+constexpr const size_t MEM_SIZE = 0x1000u;
+
+enum class status : uint8_t {
+    ok,
+    unreadable,
+    empty,
+    // Runs past the end of mem from its start address
+    too_large,
+    not_a_pack,
+    // Written by a newer version of this code
+    future_version,
+    // An index entry points outside the file, or names are out of order
+    corrupt,
+    not_found,
+};
+
+constexpr inline size_t max_size(uint16_t start = PROGRAM_START_ADDR) {
+    return start < MEM_SIZE ? MEM_SIZE - start : 0u;
+}
+
+constexpr inline status check_size(size_t size, uint16_t start = PROGRAM_START_ADDR) {
+    if (size == 0u) {
+        return status::empty;
+    }
+    return size > max_size(start) ? status::too_large : status::ok;
+}
+
+// 64 bit FNV-1a
+constexpr inline uint64_t hash(const uint8_t* data, size_t size) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t k = 0u; k < size; ++k) {
+        h ^= data[k];
+        h *= 0x00000100000001B3ull;
+    }
+    return h;
+}
+
+// Reset cpu and load the program at start, cpu is untouched unless ok
+inline status load(chip8& cpu, const uint8_t* program, size_t size, uint16_t start = PROGRAM_START_ADDR) {
+    const auto s = check_size(size, start);
+    if (s == status::ok) {
+        load_program(cpu, program, size, start);
+    }
+    return s;
+}
+
+// Read a ROM file, refusing one that cannot fit from start
+inline status read_file(const char* path, std::vector<uint8_t>& out, uint16_t start = PROGRAM_START_ADDR) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return status::unreadable;
+    }
+    // One byte more than fits, to tell a full ROM from a too large one
+    out.resize(max_size(start) + 1u);
+    const auto n = fread(out.data(), 1u, out.size(), f);
+    const bool failed = ferror(f) != 0;
+    fclose(f);
+    if (failed) {
+        return status::unreadable;
+    }
+    out.resize(n);
+    return check_size(n, start);
+}
+
+inline status load_file(chip8& cpu, const char* path, uint16_t start = PROGRAM_START_ADDR) {
+    std::vector<uint8_t> program;
+    const auto s = read_file(path, program, start);
+    if (s == status::ok) {
+        load_program(cpu, program.data(), program.size(), start);
+    }
+    return s;
+}
+
+inline uint32_t get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8u) | (static_cast<uint32_t>(p[2]) << 16u) |
+           (static_cast<uint32_t>(p[3]) << 24u);
+}
+
+inline uint64_t get_u64(const uint8_t* p) {
+    return static_cast<uint64_t>(get_u32(p)) | (static_cast<uint64_t>(get_u32(p + 4u)) << 32u);
+}
+
+inline void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (auto b = 0u; b < 4u; ++b) {
+        out.push_back(static_cast<uint8_t>(value >> (8u * b)));
+    }
+}
+
+inline void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value));
+    put_u32(out, static_cast<uint32_t>(value >> 32u));
+}
+
+// A ROM to pack
+struct item {
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+// The pack of items, false if a name repeats or a ROM is empty or does not
+// fit from PROGRAM_START_ADDR
+inline bool build(std::vector<item> items, std::vector<uint8_t>& out) {
+    std::sort(items.begin(), items.end(), [](const item& a, const item& b) { return a.name < b.name; });
+    size_t names_size = 0u;
+    for (size_t k = 0u; k < items.size(); ++k) {
+        if ((k > 0u && items[k].name == items[k - 1u].name) || check_size(items[k].bytes.size()) != status::ok) {
+            return false;
+        }
+        names_size += items[k].name.size();
+    }
+    const auto roms_start = PACK_HEADER_SIZE + PACK_ENTRY_SIZE * items.size() + names_size;
+
+    // Where each ROM goes, identical ones share the first copy
+    std::vector<uint64_t> hashes(items.size());
+    std::vector<uint32_t> offsets(items.size());
+    std::vector<size_t> stored;
+    std::unordered_multimap<uint64_t, size_t> by_hash;
+    size_t roms_size = 0u;
+    for (size_t k = 0u; k < items.size(); ++k) {
+        const auto& bytes = items[k].bytes;
+        hashes[k] = hash(bytes.data(), bytes.size());
+        const auto [first, last] = by_hash.equal_range(hashes[k]);
+        const auto same = std::find_if(first, last, [&](const auto& h) { return items[h.second].bytes == bytes; });
+        if (same != last) {
+            offsets[k] = offsets[same->second];
+            continue;
+        }
+        offsets[k] = static_cast<uint32_t>(roms_start + roms_size);
+        roms_size += bytes.size();
+        stored.push_back(k);
+        by_hash.emplace(hashes[k], k);
+    }
+    if (roms_start + roms_size > UINT32_MAX) {
+        return false;
+    }
+
+    out.clear();
+    out.reserve(roms_start + roms_size);
+    put_u32(out, PACK_MAGIC);
+    put_u32(out, PACK_VERSION);
+    put_u32(out, static_cast<uint32_t>(items.size()));
+    put_u32(out, static_cast<uint32_t>(names_size));
+    uint32_t name_offset = 0u;
+    for (size_t k = 0u; k < items.size(); ++k) {
+        put_u32(out, name_offset);
+        put_u32(out, static_cast<uint32_t>(items[k].name.size()));
+        put_u64(out, hashes[k]);
+        put_u32(out, offsets[k]);
+        put_u32(out, static_cast<uint32_t>(items[k].bytes.size()));
+        name_offset += static_cast<uint32_t>(items[k].name.size());
+    }
+    for (const auto& i: items) {
+        out.insert(out.end(), i.name.begin(), i.name.end());
+    }
+    for (const auto k: stored) {
+        out.insert(out.end(), items[k].bytes.begin(), items[k].bytes.end());
+    }
+    return true;
+}
+
+inline bool write(const char* path, std::vector<item> items) {
+    std::vector<uint8_t> data;
+    if (!build(std::move(items), data)) {
+        return false;
+    }
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    const bool ok = fwrite(data.data(), 1u, data.size(), f) == data.size();
+    return (fclose(f) == 0) && ok;
+}
+
+struct pack {
+    const uint8_t* data;
+    size_t size;
+    uint32_t count;
+    // Set when open() mapped it, close() unmaps
+    bool mapped;
+};
+
+struct entry {
+    std::string_view name;
+    uint64_t hash;
+    const uint8_t* bytes;
+    uint32_t size;
+};
+
+inline const uint8_t* index_of(const pack& p, uint32_t k) {
+    return p.data + PACK_HEADER_SIZE + PACK_ENTRY_SIZE * k;
+}
+
+inline std::string_view name_of(const pack& p, uint32_t k) {
+    const auto* e = index_of(p, k);
+    const auto* names = p.data + PACK_HEADER_SIZE + PACK_ENTRY_SIZE * p.count;
+    return {reinterpret_cast<const char*>(names + get_u32(e)), get_u32(e + 4u)};
+}
+
+// Check a whole pack in memory and point p at it, data has to outlive p
+inline status attach(pack& p, const uint8_t* data, size_t size) {
+    p = {nullptr, 0u, 0u, false};
+    if (size < PACK_HEADER_SIZE) {
+        return status::not_a_pack;
+    }
+    if (get_u32(data) != PACK_MAGIC) {
+        return status::not_a_pack;
+    }
+    if ((get_u32(data + 4u) & 0xFFFFu) > PACK_VERSION) {
+        return status::future_version;
+    }
+    const uint64_t count = get_u32(data + 8u);
+    const uint64_t names_size = get_u32(data + 12u);
+    const uint64_t names_start = PACK_HEADER_SIZE + PACK_ENTRY_SIZE * count;
+    if (names_start + names_size > size) {
+        return status::corrupt;
+    }
+    p = {data, size, static_cast<uint32_t>(count), false};
+    for (uint32_t k = 0u; k < count; ++k) {
+        const auto* e = index_of(p, k);
+        const uint64_t name_end = static_cast<uint64_t>(get_u32(e)) + get_u32(e + 4u);
+        const uint64_t offset = get_u32(e + 16u);
+        const uint64_t length = get_u32(e + 20u);
+        const bool bad = name_end > names_size || offset < names_start + names_size || offset + length > size ||
+                         check_size(length) != status::ok || (k > 0u && !(name_of(p, k - 1u) < name_of(p, k)));
+        if (bad) {
+            p = {nullptr, 0u, 0u, false};
+            return status::corrupt;
+        }
+    }
+    return status::ok;
+}
+
+inline void close(pack& p) {
+    if (p.mapped) {
+        munmap(const_cast<uint8_t*>(p.data), p.size);
+    }
+    p = {nullptr, 0u, 0u, false};
+}
+
+// Map a pack file and check it, one open and one mmap for every ROM in it
+inline status open(pack& p, const char* path) {
+    p = {nullptr, 0u, 0u, false};
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return status::unreadable;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return status::unreadable;
+    }
+    if (st.st_size < static_cast<off_t>(PACK_HEADER_SIZE)) {
+        ::close(fd);
+        return status::not_a_pack;
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        return status::unreadable;
+    }
+    const auto s = attach(p, static_cast<const uint8_t*>(m), size);
+    if (s != status::ok) {
+        munmap(m, size);
+        return s;
+    }
+    p.mapped = true;
+    return status::ok;
+}
+
+inline entry get(const pack& p, uint32_t k) {
+    const auto* e = index_of(p, k);
+    return {name_of(p, k), get_u64(e + 8u), p.data + get_u32(e + 16u), get_u32(e + 20u)};
+}
+
+// Index of the ROM called name, count if there is none
+inline uint32_t find(const pack& p, std::string_view name) {
+    uint32_t lo = 0u;
+    uint32_t hi = p.count;
+    while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2u;
+        if (name_of(p, mid) < name) {
+            lo = mid + 1u;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < p.count && name_of(p, lo) == name) ? lo : p.count;
+}
+
+// The ROM's bytes still hash to what the index says
+inline bool verify(const pack& p, uint32_t k) {
+    const auto e = get(p, k);
+    return hash(e.bytes, e.size) == e.hash;
+}
+
+// Reset cpu and load ROM k of the pack from the mapping
+inline status load(chip8& cpu, const pack& p, uint32_t k, uint16_t start = PROGRAM_START_ADDR) {
+    if (k >= p.count) {
+        return status::not_found;
+    }
+    const auto e = get(p, k);
+    return load(cpu, e.bytes, e.size, start);
+}
+
+inline status load(chip8& cpu, const pack& p, std::string_view name, uint16_t start = PROGRAM_START_ADDR) {
+    return load(cpu, p, find(p, name), start);
+}
+
+} // namespace rom
+
+} // namespace chipp8
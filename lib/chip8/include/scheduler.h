@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <thread>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "idle.h"
+#include "keypad.h"
+
+/* Clock scheduler
+
+   Instructions run at instructions_per_second and the timers tick at
+   exactly TIMER_HZ. Frame f ends once floor(f * instructions_per_second /
+   TIMER_HZ) instructions have run in total, so a rate that does not divide
+   evenly (e.g. 700 Hz, 11.67 per frame) spreads the remainder over the
+   frames and never drifts, and the split is the same whatever the host
+   speed.
+
+   In real time mode each frame ends by sleeping until start + f / TIMER_HZ
+   on the steady clock. The deadlines are absolute, so a late wakeup is
+   made up by the next frame instead of adding up. Turbo mode runs the
+   exact same frames without sleeping.
+
+   The frame run with s.frame == f starts f / TIMER_HZ after start, so the
+   key events it can see are the ones pushed during the slot before that.
+   run_frame with a keypad::event_queue applies each of them before the
+   instruction that lines up with where in the slot it was pushed.
+*/
+
+namespace chipp8 {
+
+namespace timing {
+
+constexpr const uint32_t TIMER_HZ = 60u;
+constexpr const uint32_t DEFAULT_INSTRUCTIONS_PER_SECOND = 600u;
+
+// Running this many frames behind real time, e.g. after the host was
+// suspended, the deadlines restart from now instead of racing to catch up
+constexpr const uint64_t MAX_LAG_FRAMES = 6u;
+
+using steady = std::chrono::steady_clock;
+
+// One frame's slot of wall time
+constexpr const steady::duration FRAME_DURATION = std::chrono::duration_cast<steady::duration>(std::chrono::seconds(1)) / TIMER_HZ;
+
+struct scheduler {
+    uint32_t instructions_per_second;
+    bool turbo;
+
+    // Timer ticks and instructions since init
+    uint64_t frame;
+    uint64_t instructions;
+    // Of those, the ones idle::run skipped
+    uint64_t skipped;
+
+    // Real time deadline of frame 0
+    steady::time_point start;
+};
+
+inline void init(scheduler& s, uint32_t instructions_per_second, bool turbo) {
+    s.instructions_per_second = instructions_per_second;
+    s.turbo = turbo;
+    s.frame = 0u;
+    s.instructions = 0u;
+    s.skipped = 0u;
+    s.start = steady::now();
+}
+
+// Total instructions by the end of `frame`
+constexpr inline uint64_t instructions_by(uint64_t frame, uint32_t instructions_per_second) {
+    return (frame * instructions_per_second) / TIMER_HZ;
+}
+
+// Instructions in the next frame
+constexpr inline uint64_t frame_cycles(const scheduler& s) {
+    return instructions_by(s.frame + 1u, s.instructions_per_second) - s.instructions;
+}
+
+inline steady::time_point deadline(const scheduler& s, uint64_t frame) {
+    return s.start + std::chrono::duration_cast<steady::duration>(std::chrono::duration<double>(static_cast<double>(frame) / TIMER_HZ));
+}
+
+// Where in a frame of `cycles` instructions an event `since` into the
+// slot of wall time before it lands
+constexpr inline uint64_t event_cycle(steady::duration since, uint64_t cycles) {
+    if (since <= steady::duration::zero()) {
+        return 0u;
+    }
+    if (since >= FRAME_DURATION) {
+        return cycles;
+    }
+    return static_cast<uint64_t>(since.count()) * cycles / static_cast<uint64_t>(FRAME_DURATION.count());
+}
+
+// Tick the timers and in real time mode sleep until the next frame is due
+inline void end_frame(scheduler& s, chip8& cpu) {
+    tick_timers(cpu);
+    ++s.frame;
+
+    if (s.turbo) {
+        return;
+    }
+    const auto now = steady::now();
+    if (now > deadline(s, s.frame + MAX_LAG_FRAMES)) {
+        s.start = now - (deadline(s, s.frame) - s.start);
+        return;
+    }
+    std::this_thread::sleep_until(deadline(s, s.frame));
+}
+
+// Run one frame of instructions, tick the timers, and in real time mode
+// sleep until the frame is due. Keys are read as they are in cpu.keys
+inline void run_frame(scheduler& s, chip8& cpu) {
+    const auto cycles = frame_cycles(s);
+    s.skipped += idle::run(cpu, cycles).skipped;
+    s.instructions += cycles;
+    end_frame(s, cpu);
+}
+
+constexpr inline bool reads_keys(dispatch::op code) {
+    return code == dispatch::op::SKP || code == dispatch::op::SKNP || code == dispatch::op::WAIT_KP;
+}
+
+// Step cpu until it looks at the keypad, q.unread runs out or done reaches
+// cycles
+inline void run_until_read(chip8& cpu, keypad::event_queue& q, uint64_t& done, uint64_t cycles) {
+    while (q.unread && done < cycles) {
+        const auto code = dispatch::DECODE_TABLE[fetch(cpu)].code;
+        dispatch::step(cpu);
+        ++done;
+        q.unread = reads_keys(code) ? 0u : q.unread - 1u;
+    }
+}
+
+// run_frame with the keys driven by q. Each event is applied on its own
+// instruction boundary, and after a press the next event waits until the
+// program has looked at the keypad, so a tap shorter than a poll loop is
+// still seen, even when the press comes after the last poll of a frame.
+// A program that never looks holds the next event up for at most one
+// frame's worth of instructions. Events that do not fit in the frame wait
+// for the next one. In turbo mode the wall time means nothing and the
+// pending events are applied as early as those rules allow
+inline void run_frame(scheduler& s, chip8& cpu, keypad::event_queue& q) {
+    const auto cycles = frame_cycles(s);
+    const auto slot_end = deadline(s, s.frame);
+    const auto slot_start = slot_end - FRAME_DURATION;
+
+    uint64_t done = 0u;
+    uint64_t count = 0u;
+    steady::duration time_sum = steady::duration::zero();
+    steady::time_point oldest = steady::time_point::max();
+    keypad::event e{};
+    while (keypad::peek(q, e)) {
+        if (!s.turbo && e.time >= slot_end) {
+            break;
+        }
+        auto at = s.turbo ? done : event_cycle(e.time - slot_start, cycles);
+        if (count > 0u) {
+            at = std::max(at, done + 1u);
+        }
+        if (at >= cycles) {
+            break;
+        }
+        run_until_read(cpu, q, done, cycles);
+        if (q.unread) {
+            break;
+        }
+        at = std::max(at, done);
+        if (at >= cycles) {
+            break;
+        }
+        s.skipped += idle::run(cpu, at - done).skipped;
+        done = at;
+        keypad::apply(cpu, e);
+        q.unread = e.pressed ? cycles : 0u;
+        keypad::pop(q);
+        ++count;
+        time_sum += e.time.time_since_epoch();
+        oldest = std::min(oldest, e.time);
+    }
+    // A poll later in the frame still counts for an event not pushed yet
+    run_until_read(cpu, q, done, cycles);
+    s.skipped += idle::run(cpu, cycles - done).skipped;
+    s.instructions += cycles;
+    keypad::record_latency(q, count, time_sum, oldest, steady::now());
+    end_frame(s, cpu);
+}
+
+inline void run(scheduler& s, chip8& cpu, uint64_t frames) {
+    for (uint64_t f = 0u; f < frames; ++f) {
+        run_frame(s, cpu);
+    }
+}
+
+} // namespace timing
+
+} // namespace chipp8
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <fcntl.h>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "keypad.h"
+
+/* Shared memory framebuffer export
+
+   The emulator publishes the display, timers and keys into a segment
+   shared with a renderer or recorder process, which maps it and reads
+   them in place. Nothing is serialized and neither side makes a syscall
+   per frame.
+
+   The frame is guarded by a seqlock: publish() makes the sequence odd,
+   stores the fields and makes it even again, so the emulation thread never
+   waits on a reader. A reader copies the fields out between two loads of
+   the sequence and tries again if it changed or was odd. Every field is a
+   relaxed atomic so the racing copy is well defined, and on x86 and ARM
+   those are plain loads and stores.
+
+   Input goes the other way through a keypad::event_queue in the segment,
+   the same single producer, single consumer ring a frontend thread uses:
+   the reader process pushes and timing::run_frame applies the events at
+   instruction boundaries. Its atomics are address free and its timestamps
+   are steady_clock, CLOCK_MONOTONIC, which both processes share.
+
+   A segment is either a named POSIX shared memory object, for a process
+   that attaches by name, or an anonymous memfd whose descriptor a child
+   inherits or gets over a unix socket.
+*/
+
+namespace chipp8 {
+
+namespace shm {
+
+constexpr const uint32_t MAGIC = 0x4D533843u; // "C8SM"
+constexpr const uint32_t VERSION = 1u;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Atomics in shared memory must not hide a lock");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Atomics in shared memory must not hide a lock");
+
+struct segment {
+    uint32_t magic;
+    uint32_t version;
+    // sizeof(segment) of the creator, a reader built differently refuses it
+    uint32_t size;
+
+    // Odd while publish() is storing the fields below
+    alignas(64) std::atomic<uint32_t> sequence;
+    std::array<std::atomic<uint64_t>, DISPLAY_HEIGHT> pixels;
+    // Frames published so far
+    std::atomic<uint64_t> frame;
+    std::atomic<uint16_t> keys;
+    std::atomic<uint8_t> d_timer;
+    std::atomic<uint8_t> s_timer;
+
+    // Reader process to emulator
+    alignas(64) keypad::event_queue input;
+};
+
+// One consistent copy of what was published
+struct snapshot {
+    display pixels;
+    uint64_t frame;
+    uint16_t keys;
+    uint8_t d_timer;
+    uint8_t s_timer;
+};
+
+struct region {
+    segment* seg;
+    int fd;
+    // Set on the side that created a named segment, it unlinks it on close
+    const char* name;
+};
+
+inline void close(region& r);
+
+inline bool map(region& r, int fd, bool create) {
+    if (create && ftruncate(fd, sizeof(segment)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(segment)) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, sizeof(segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    r.fd = fd;
+    if (create) {
+        r.seg = new (p) segment{};
+        r.seg->version = VERSION;
+        r.seg->size = sizeof(segment);
+        keypad::init(r.seg->input);
+        // Last, a reader that sees the magic sees a usable segment
+        std::atomic_thread_fence(std::memory_order_release);
+        r.seg->magic = MAGIC;
+        return true;
+    }
+    r.seg = static_cast<segment*>(p);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (r.seg->magic != MAGIC || r.seg->version != VERSION || r.seg->size != sizeof(segment)) {
+        close(r);
+        return false;
+    }
+    return true;
+}
+
+// Create the segment, named "/something" for shm_open, or an anonymous
+// memfd when name is nullptr. name is unlinked on close and has to live as
+// long as the region. False if it exists already or cannot be made
+inline bool create(region& r, const char* name) {
+    r = {nullptr, -1, nullptr};
+    int fd = -1;
+    if (name) {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    } else {
+        fd = memfd_create("chipp8", MFD_CLOEXEC);
+    }
+    if (fd < 0) {
+        return false;
+    }
+    if (!map(r, fd, true)) {
+        if (name) {
+            shm_unlink(name);
+        }
+        return false;
+    }
+    r.name = name;
+    return true;
+}
+
+// Attach to a segment created by name in another process
+inline bool attach(region& r, const char* name) {
+    r = {nullptr, -1, nullptr};
+    const int fd = shm_open(name, O_RDWR, 0);
+    return fd >= 0 && map(r, fd, false);
+}
+
+// Attach through a descriptor of the segment, e.g. an inherited memfd.
+// The region takes its own copy of fd
+inline bool attach(region& r, int fd) {
+    r = {nullptr, -1, nullptr};
+    const int own = dup(fd);
+    return own >= 0 && map(r, own, false);
+}
+
+inline void close(region& r) {
+    if (r.seg) {
+        munmap(r.seg, sizeof(segment));
+        r.seg = nullptr;
+    }
+    if (r.fd >= 0) {
+        ::close(r.fd);
+        r.fd = -1;
+    }
+    if (r.name) {
+        shm_unlink(r.name);
+        r.name = nullptr;
+    }
+}
+
+// Emulation thread, once a frame
+inline void publish(segment& s, const chip8& cpu) {
+    const auto seq = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(seq + 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        s.pixels[y].store(cpu.pixels[y], std::memory_order_relaxed);
+    }
+    s.frame.store(s.frame.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+    s.keys.store(cpu.keys, std::memory_order_relaxed);
+    s.d_timer.store(cpu.d_timer, std::memory_order_relaxed);
+    s.s_timer.store(cpu.s_timer, std::memory_order_relaxed);
+    s.sequence.store(seq + 2u, std::memory_order_release);
+}
+
+// Reader side. One try at a consistent copy, false if publish() was
+// running and it has to be tried again
+inline bool try_read(const segment& s, snapshot& out) {
+    const auto before = s.sequence.load(std::memory_order_acquire);
+    if (before & 1u) {
+        return false;
+    }
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        out.pixels[y] = s.pixels[y].load(std::memory_order_relaxed);
+    }
+    out.frame = s.frame.load(std::memory_order_relaxed);
+    out.keys = s.keys.load(std::memory_order_relaxed);
+    out.d_timer = s.d_timer.load(std::memory_order_relaxed);
+    out.s_timer = s.s_timer.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.sequence.load(std::memory_order_relaxed) == before;
+}
+
+// Reader side. A publish takes well under a microsecond, so a reader that
+// keeps colliding with one gets a copy within a few tries
+inline snapshot read(const segment& s) {
+    snapshot out;
+    while (!try_read(s, out)) {
+    }
+    return out;
+}
+
+// Reader side, the frame count without copying the frame, to poll for a
+// new one
+inline uint64_t frame(const segment& s) {
+    return s.frame.load(std::memory_order_acquire);
+}
+
+// Reader side, false if the emulator is too far behind and the ring is full
+inline bool send_key(segment& s, uint8_t key, bool pressed) {
+    return keypad::push(s.input, key, pressed);
+}
+
+} // namespace shm
+
+} // namespace chipp8
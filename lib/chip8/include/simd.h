@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Byte lane helpers
+
+   The same set of operations on a single uint8_t and on a register of
+   WIDTH uint8_t lanes (AVX2 when the compiler targets it, else SSE2), so a
+   lane kernel is written once as a generic lambda and run by for_lanes over
+   full registers first and single bytes for the tail.
+
+   Masks are 0xFF for set lanes and 0x00 for clear ones.
+*/
+
+namespace chipp8 {
+
+namespace simd {
+
+struct scalar_tag {};
+
+inline uint8_t load(scalar_tag, const uint8_t* p) { return *p; }
+inline void store(uint8_t* p, uint8_t a) { *p = a; }
+inline uint8_t splat(scalar_tag, uint8_t b) { return b; }
+
+inline uint8_t add(uint8_t a, uint8_t b) { return static_cast<uint8_t>(a + b); }
+inline uint8_t sub(uint8_t a, uint8_t b) { return static_cast<uint8_t>(a - b); }
+inline uint8_t band(uint8_t a, uint8_t b) { return a & b; }
+inline uint8_t bor(uint8_t a, uint8_t b) { return a | b; }
+inline uint8_t bxor(uint8_t a, uint8_t b) { return a ^ b; }
+inline uint8_t shr1(uint8_t a) { return static_cast<uint8_t>(a >> 1u); }
+inline uint8_t shl1(uint8_t a) { return static_cast<uint8_t>(a << 1u); }
+inline uint8_t eq(uint8_t a, uint8_t b) { return (a == b) ? 0xFFu : 0x00u; }
+// Unsigned a > b
+inline uint8_t gt(uint8_t a, uint8_t b) { return (a > b) ? 0xFFu : 0x00u; }
+inline uint8_t select(uint8_t mask, uint8_t a, uint8_t b) { return static_cast<uint8_t>((a & mask) | (b & ~mask)); }
+
+#if defined(__AVX2__)
+
+constexpr const size_t WIDTH = 32u;
+
+struct vector_tag {};
+using vec = __m256i;
+
+inline vec load(vector_tag, const uint8_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void store(uint8_t* p, vec a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+inline vec splat(vector_tag, uint8_t b) { return _mm256_set1_epi8(static_cast<char>(b)); }
+
+inline vec add(vec a, vec b) { return _mm256_add_epi8(a, b); }
+inline vec sub(vec a, vec b) { return _mm256_sub_epi8(a, b); }
+inline vec band(vec a, vec b) { return _mm256_and_si256(a, b); }
+inline vec bor(vec a, vec b) { return _mm256_or_si256(a, b); }
+inline vec bxor(vec a, vec b) { return _mm256_xor_si256(a, b); }
+inline vec shr1(vec a) { return _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)); }
+inline vec shl1(vec a) { return _mm256_add_epi8(a, a); }
+inline vec eq(vec a, vec b) { return _mm256_cmpeq_epi8(a, b); }
+inline vec gt(vec a, vec b) {
+    // a > b  <=>  min(a, b) != a
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a), _mm256_set1_epi8(-1));
+}
+inline vec select(vec mask, vec a, vec b) { return _mm256_blendv_epi8(b, a, mask); }
+
+#elif defined(__SSE2__)
+
+constexpr const size_t WIDTH = 16u;
+
+struct vector_tag {};
+using vec = __m128i;
+
+inline vec load(vector_tag, const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void store(uint8_t* p, vec a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+inline vec splat(vector_tag, uint8_t b) { return _mm_set1_epi8(static_cast<char>(b)); }
+
+inline vec add(vec a, vec b) { return _mm_add_epi8(a, b); }
+inline vec sub(vec a, vec b) { return _mm_sub_epi8(a, b); }
+inline vec band(vec a, vec b) { return _mm_and_si128(a, b); }
+inline vec bor(vec a, vec b) { return _mm_or_si128(a, b); }
+inline vec bxor(vec a, vec b) { return _mm_xor_si128(a, b); }
+inline vec shr1(vec a) { return _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi8(0x7F)); }
+inline vec shl1(vec a) { return _mm_add_epi8(a, a); }
+inline vec eq(vec a, vec b) { return _mm_cmpeq_epi8(a, b); }
+inline vec gt(vec a, vec b) {
+    // a > b  <=>  min(a, b) != a
+    return _mm_xor_si128(_mm_cmpeq_epi8(_mm_min_epu8(a, b), a), _mm_set1_epi8(-1));
+}
+inline vec select(vec mask, vec a, vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+#else
+
+constexpr const size_t WIDTH = 0u;
+
+#endif
+
+// Call fn(lane, tag) for every lane group of an N lane array, tag selects
+// the overloads above
+template <size_t N, typename Fn>
+inline void for_lanes(Fn&& fn) {
+    size_t l = 0u;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; l + WIDTH <= N; l += WIDTH) {
+        fn(l, vector_tag{});
+    }
+#endif
+    for (; l < N; ++l) {
+        fn(l, scalar_tag{});
+    }
+}
+
+} // namespace simd
+
+} // namespace chipp8
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "chip8.h"
+#include "quirks.h"
+
+/* Save states
+
+   A save state is a 64 byte header followed by the chip8 struct exactly
+   as it sits in memory, so loading is one bounds checked memcpy, and a
+   mapped file can be used in place. Since the payload is the in memory
+   layout, the header carries a fingerprint of it (the size and offset of
+   every field, and the byte order); a build that lays chip8 out
+   differently rejects the file instead of misreading it.
+
+   Header, little endian:
+
+       0  "C8SS"
+       4  version             u16
+       6  header size         u16, 64
+       8  quirks              u8, quirk_bits of the profile it ran under
+       9  reserved            3 bytes, 0
+      12  payload size        u32, sizeof(chip8)
+      16  layout fingerprint  u32
+      20  payload checksum    u32, FNV-1a
+      24  reserved            40 bytes, 0
+
+   A reader rejects a version newer than its own. An older version, of
+   which there are none yet, would be converted field by field here.
+
+   check() looks at the whole file once, checksum included. After that a
+   snapshot can seed any number of machines with restore(), a 4 KB copy
+   each.
+*/
+
+namespace chipp8 {
+
+namespace state {
+
+constexpr const uint32_t MAGIC = 0x53533843u; // "C8SS"
+constexpr const uint16_t VERSION = 1u;
+constexpr const size_t HEADER_SIZE = 64u;
+constexpr const size_t FILE_SIZE = HEADER_SIZE + sizeof(chip8);
+
+static_assert(std::is_trivially_copyable_v<chip8>, "A state is the chip8 bytes as they are");
+static_assert(std::is_standard_layout_v<chip8>, "The layout fingerprint needs offsetof");
+static_assert(HEADER_SIZE % alignof(chip8) == 0u, "The payload of a mapped file is aligned for use in place");
+
+enum class status : uint8_t {
+    ok,
+    // The file could not be opened or mapped
+    unreadable,
+    // Shorter than its header or payload says
+    truncated,
+    not_a_state,
+    // Written by a newer version of this code
+    future_version,
+    // Written by a build that lays chip8 out differently
+    other_layout,
+    // Saved under a different quirk profile than the one asked for
+    other_quirks,
+    corrupt,
+    // pc, sp or the stack are outside what the machine can hold
+    out_of_bounds,
+};
+
+// One bit per quirk flag of the profile
+template <typename Q>
+constexpr inline uint8_t quirk_bits() {
+    return static_cast<uint8_t>((Q::shift_vy ? 1u : 0u) | (Q::load_store_increments_i ? 2u : 0u) | (Q::jump_vx ? 4u : 0u) |
+                                (Q::logic_resets_vf ? 8u : 0u) | (Q::clip_sprites ? 16u : 0u));
+}
+
+constexpr inline uint32_t mix(uint32_t h, uint32_t value) {
+    for (auto b = 0u; b < 4u; ++b) {
+        h = (h ^ ((value >> (8u * b)) & 0xFFu)) * 16777619u;
+    }
+    return h;
+}
+
+// Changes whenever the in memory layout of chip8 does
+constexpr inline uint32_t layout_fingerprint() {
+    uint32_t h = 2166136261u;
+    h = mix(h, static_cast<uint32_t>(sizeof(chip8)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, keys)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, pixels)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, mem)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, v)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, i)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, d_timer)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, s_timer)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, pc)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, sp)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, stack)));
+    h = mix(h, static_cast<uint32_t>(offsetof(chip8, rng)));
+    h = mix(h, static_cast<uint32_t>(sizeof(rng::stream)));
+    return mix(h, std::endian::native == std::endian::little ? 1u : 2u);
+}
+
+inline uint32_t checksum(const uint8_t* data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t k = 0u; k < size; ++k) {
+        h = (h ^ data[k]) * 16777619u;
+    }
+    return h;
+}
+
+inline uint32_t get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8u) | (static_cast<uint32_t>(p[2]) << 16u) |
+           (static_cast<uint32_t>(p[3]) << 24u);
+}
+
+inline uint16_t get_u16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8u));
+}
+
+inline void put_u32(uint8_t* p, uint32_t value) {
+    for (auto b = 0u; b < 4u; ++b) {
+        p[b] = static_cast<uint8_t>(value >> (8u * b));
+    }
+}
+
+// The whole file for cpu, saved under quirk profile Q
+template <typename Q = quirks::modern>
+inline std::vector<uint8_t> encode(const chip8& cpu) {
+    std::vector<uint8_t> out(FILE_SIZE, 0u);
+    auto* payload = out.data() + HEADER_SIZE;
+    // Field by field, so the padding between them is 0 and equal machines
+    // give equal files
+    auto put = [&](size_t offset, const auto& field) { memcpy(payload + offset, &field, sizeof(field)); };
+    put(offsetof(chip8, keys), cpu.keys);
+    put(offsetof(chip8, pixels), cpu.pixels);
+    put(offsetof(chip8, mem), cpu.mem);
+    put(offsetof(chip8, v), cpu.v);
+    put(offsetof(chip8, i), cpu.i);
+    put(offsetof(chip8, d_timer), cpu.d_timer);
+    put(offsetof(chip8, s_timer), cpu.s_timer);
+    put(offsetof(chip8, pc), cpu.pc);
+    put(offsetof(chip8, sp), cpu.sp);
+    put(offsetof(chip8, stack), cpu.stack);
+    put(offsetof(chip8, rng), cpu.rng);
+    put_u32(out.data(), MAGIC);
+    out[4] = static_cast<uint8_t>(VERSION);
+    out[5] = static_cast<uint8_t>(VERSION >> 8u);
+    out[6] = static_cast<uint8_t>(HEADER_SIZE);
+    out[8] = quirk_bits<Q>();
+    put_u32(out.data() + 12u, static_cast<uint32_t>(sizeof(chip8)));
+    put_u32(out.data() + 16u, layout_fingerprint());
+    put_u32(out.data() + 20u, checksum(payload, sizeof(chip8)));
+    return out;
+}
+
+template <typename Q = quirks::modern>
+inline bool save(const chip8& cpu, const char* path) {
+    const auto data = encode<Q>(cpu);
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    const bool ok = fwrite(data.data(), 1u, data.size(), f) == data.size();
+    return (fclose(f) == 0) && ok;
+}
+
+// Validate a whole file for a machine running under Q
+template <typename Q = quirks::modern>
+inline status check(const uint8_t* data, size_t size) {
+    if (size < HEADER_SIZE) {
+        return size >= 4u && get_u32(data) != MAGIC ? status::not_a_state : status::truncated;
+    }
+    if (get_u32(data) != MAGIC) {
+        return status::not_a_state;
+    }
+    if (get_u16(data + 4u) > VERSION) {
+        return status::future_version;
+    }
+    if (get_u16(data + 6u) != HEADER_SIZE || get_u32(data + 12u) != sizeof(chip8) ||
+        get_u32(data + 16u) != layout_fingerprint()) {
+        return status::other_layout;
+    }
+    if (size < FILE_SIZE) {
+        return status::truncated;
+    }
+    if (data[8] != quirk_bits<Q>()) {
+        return status::other_quirks;
+    }
+    const auto* payload = data + HEADER_SIZE;
+    if (get_u32(data + 20u) != checksum(payload, sizeof(chip8))) {
+        return status::corrupt;
+    }
+    // Fields read one by one, the payload is not necessarily aligned
+    uint16_t pc;
+    uint8_t sp;
+    std::array<uint16_t, 16u> stack;
+    memcpy(&pc, payload + offsetof(chip8, pc), sizeof(pc));
+    memcpy(&sp, payload + offsetof(chip8, sp), sizeof(sp));
+    memcpy(stack.data(), payload + offsetof(chip8, stack), sizeof(stack));
+    if (pc > 0x0FFFu || sp >= stack.size()) {
+        return status::out_of_bounds;
+    }
+    for (const auto addr: stack) {
+        if (addr > 0x0FFFu) {
+            return status::out_of_bounds;
+        }
+    }
+    return status::ok;
+}
+
+// Copy the payload of a file check() passed into cpu
+inline void restore(const uint8_t* data, chip8& cpu) {
+    memcpy(&cpu, data + HEADER_SIZE, sizeof(chip8));
+}
+
+// check() and restore()
+template <typename Q = quirks::modern>
+inline status load(const uint8_t* data, size_t size, chip8& cpu) {
+    const auto s = check<Q>(data, size);
+    if (s == status::ok) {
+        restore(data, cpu);
+    }
+    return s;
+}
+
+// A state file mapped read only
+struct mapping {
+    const uint8_t* data;
+    size_t size;
+};
+
+inline void unmap(mapping& m) {
+    if (m.data) {
+        munmap(const_cast<uint8_t*>(m.data), m.size);
+    }
+    m = {nullptr, 0u};
+}
+
+// Map path and check() it. On ok, m.data stays mapped until unmap and
+// in_place(m) is the machine it holds
+template <typename Q = quirks::modern>
+inline status map(mapping& m, const char* path) {
+    m = {nullptr, 0u};
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return status::unreadable;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return status::unreadable;
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return status::unreadable;
+    }
+    m = {static_cast<const uint8_t*>(p), size};
+    const auto s = check<Q>(m.data, m.size);
+    if (s != status::ok) {
+        unmap(m);
+    }
+    return s;
+}
+
+// The machine of a checked mapping, read in place. Mappings are page
+// aligned and the header keeps the payload aligned
+inline const chip8& in_place(const mapping& m) {
+    return *reinterpret_cast<const chip8*>(m.data + HEADER_SIZE);
+}
+
+} // namespace state
+
+} // namespace chipp8
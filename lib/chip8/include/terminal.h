@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "chip8.h"
+
+/* Incremental terminal renderer
+
+   Keeps the frame the terminal is showing and, for the next one, emits
+   only ANSI cursor moves and the cells that changed. The changed rows are
+   found by comparing each row word with the one shown, 32 compares, so
+   nothing in the core has to track them and every engine's display works
+   as is. Within a changed row the changed pixels are grouped into runs,
+   bridging gaps of up to MAX_GAP unchanged cells, which are cheaper to
+   rewrite than to jump over with another cursor move.
+
+   ascii draws a pixel as '#' or ' ', one line per row, like
+   utils::pp_display. half_blocks packs two rows into each character with
+   the Unicode upper/lower half blocks, 64x16 characters for the display.
+
+   A frame is composed into a buffer allocated with the renderer, sized for
+   the worst case, and goes out in one write().
+*/
+
+namespace chipp8 {
+
+namespace terminal {
+
+enum class mode : uint8_t {
+    ascii,
+    half_blocks,
+};
+
+// Unchanged cells between two changed ones that are rewritten rather than
+// skipped, a cursor move costs 6 to 8 bytes
+constexpr const uint32_t MAX_GAP = 4u;
+
+// "\x1b[rrr;cccH"
+constexpr const size_t CURSOR_MOVE_MAX = 10u;
+// Hide the cursor and clear the screen ahead of the first frame
+constexpr const char FIRST_FRAME_PREFIX[] = "\x1b[?25l\x1b[2J";
+// Every cell behind its own cursor move, and a cell is at most 3 bytes
+constexpr const size_t MAX_FRAME_BYTES = sizeof(FIRST_FRAME_PREFIX) + DISPLAY_WIDTH * DISPLAY_HEIGHT * (CURSOR_MOVE_MAX + 3u);
+
+struct renderer {
+    mode style;
+    int fd;
+    // Terminal position of the display's top left cell, 1 based
+    uint16_t top;
+    uint16_t left;
+
+    // What the terminal shows, meaningless until the first frame
+    display shown;
+    bool drawn;
+
+    std::array<char, MAX_FRAME_BYTES> buffer;
+    size_t used;
+};
+
+inline void init(renderer& r, mode style, int fd = STDOUT_FILENO, uint16_t top = 1u, uint16_t left = 1u) {
+    r.style = style;
+    r.fd = fd;
+    r.top = top;
+    r.left = left;
+    r.shown.fill(0u);
+    r.drawn = false;
+    r.used = 0u;
+}
+
+// Draw everything again with the next frame, e.g. after the terminal was
+// cleared or resized
+inline void invalidate(renderer& r) {
+    r.drawn = false;
+}
+
+inline void put(renderer& r, const char* s, size_t n) {
+    for (size_t k = 0u; k < n; ++k) {
+        r.buffer[r.used++] = s[k];
+    }
+}
+
+inline void put_uint(renderer& r, uint32_t value) {
+    char digits[10];
+    auto n = 0u;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10u);
+        value /= 10u;
+    } while (value != 0u);
+    while (n > 0u) {
+        r.buffer[r.used++] = digits[--n];
+    }
+}
+
+inline void move_to(renderer& r, uint32_t line, uint32_t column) {
+    r.buffer[r.used++] = '\x1b';
+    r.buffer[r.used++] = '[';
+    put_uint(r, r.top + line);
+    r.buffer[r.used++] = ';';
+    put_uint(r, r.left + column);
+    r.buffer[r.used++] = 'H';
+}
+
+// Cells [first, last] of the line whose upper row is `upper` and lower row
+// `lower`, lower is ignored for ascii
+inline void put_cells(renderer& r, uint64_t upper, uint64_t lower, uint32_t first, uint32_t last) {
+    for (auto x = first; x <= last; ++x) {
+        const auto shift = DISPLAY_WIDTH - 1u - x;
+        const auto hi = (upper >> shift) & 1u;
+        if (r.style == mode::ascii) {
+            r.buffer[r.used++] = hi ? '#' : ' ';
+            continue;
+        }
+        const auto lo = (lower >> shift) & 1u;
+        if (!hi && !lo) {
+            r.buffer[r.used++] = ' ';
+            continue;
+        }
+        // U+2580 upper half, U+2584 lower half, U+2588 full block
+        r.buffer[r.used++] = '\xE2';
+        r.buffer[r.used++] = '\x96';
+        r.buffer[r.used++] = static_cast<char>(hi ? (lo ? 0x88 : 0x80) : 0x84);
+    }
+}
+
+// Emit the changed cells of one line, changed has bit (63 - x) set for
+// every column x that differs from what is shown
+inline void put_line(renderer& r, uint32_t line, uint64_t changed, uint64_t upper, uint64_t lower) {
+    while (changed != 0u) {
+        const auto first = static_cast<uint32_t>(std::countl_zero(changed));
+        auto last = first;
+        for (;;) {
+            const auto rest = (last == 63u) ? 0u : (changed << (last + 1u));
+            if (rest == 0u) {
+                break;
+            }
+            const auto next = last + 1u + static_cast<uint32_t>(std::countl_zero(rest));
+            if (next - last - 1u > MAX_GAP) {
+                break;
+            }
+            last = next;
+        }
+        move_to(r, line, first);
+        put_cells(r, upper, lower, first, last);
+        // Drop columns first..last
+        const auto run = (last - first == 63u) ? ~0ull : (((1ull << (last - first + 1u)) - 1u) << (63u - last));
+        changed &= ~run;
+    }
+}
+
+// Compose the bytes that take the terminal from what it shows to pixels
+// into r.buffer, and take pixels as shown. Returns the byte count, 0 if
+// nothing changed
+inline size_t compose(renderer& r, const display& pixels) {
+    r.used = 0u;
+    if (!r.drawn) {
+        put(r, FIRST_FRAME_PREFIX, sizeof(FIRST_FRAME_PREFIX) - 1u);
+    }
+    if (r.style == mode::ascii) {
+        for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+            const auto changed = r.drawn ? (pixels[y] ^ r.shown[y]) : ~0ull;
+            put_line(r, y, changed, pixels[y], 0u);
+        }
+    } else {
+        for (auto y = 0u; y < DISPLAY_HEIGHT; y += 2u) {
+            const auto changed = r.drawn ? ((pixels[y] ^ r.shown[y]) | (pixels[y + 1u] ^ r.shown[y + 1u])) : ~0ull;
+            put_line(r, y / 2u, changed, pixels[y], pixels[y + 1u]);
+        }
+    }
+    r.shown = pixels;
+    r.drawn = true;
+    return r.used;
+}
+
+// Compose the frame and send it with one write(), false if it could not be
+// written
+inline bool present(renderer& r, const display& pixels) {
+    const auto n = compose(r, pixels);
+    size_t sent = 0u;
+    while (sent < n) {
+        const auto w = ::write(r.fd, r.buffer.data() + sent, n - sent);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            // The terminal is in an unknown state now
+            r.drawn = false;
+            return false;
+        }
+        sent += static_cast<size_t>(w);
+    }
+    return true;
+}
+
+} // namespace terminal
+
+} // namespace chipp8
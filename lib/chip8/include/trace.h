@@ -0,0 +1,821 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "quirks.h"
+
+/* Execution trace
+
+   trace::run is dispatch::run that also writes one record per instruction
+   to a file. A reader gets back, per instruction, the pc, the instruction
+   word and whatever it wrote among the v registers, I, the timers, sp with
+   the stack slot it points at, and the bytes FX33/FX55 stored to mem. The
+   cycle of a record is its position in the trace, counted from the start
+   cycle in the header.
+
+   The file does not hold those fields. It holds what it takes to work them
+   out again: a record is 4 bytes, the pc and the word, plus vF after DXYN
+   and v0..vF after FX65, the only two ops whose result depends on mem or
+   the display. Records come in blocks, each starting with the registers
+   (v, I, the timers, sp, the stack, keys, the rng position) and the quirks
+   profile. The reader replays a block from those registers with parse_op
+   and reads off what each op wrote, through WRITES_FOR, so a field an op
+   writes is in its record even when the value stays the same.
+
+   That keeps the emulation thread down to one 4 byte store per instruction
+   into a single producer, single consumer ring. A block ends every
+   index_interval records, at most MAX_BLOCK_RECORDS, and whenever a run
+   starts from registers other than the ones the last run left, e.g. after
+   the scheduler ticks the timers. The producer publishes whole blocks, and
+   a background thread writes them to the file, so the emulation thread
+   never waits on I/O, only on the ring being full if the flusher cannot
+   keep up.
+
+   A block's (cycle, file offset) goes into a sparse index, appended to the
+   file on close, when index_interval records have passed since the last
+   entry, which is how a reader seeks to a cycle without replaying
+   everything before it.
+
+   File: header (magic, version, start cycle, interval), the blocks as
+   32 bit words, then the index entries, their count and a closing magic,
+   little-endian.
+*/
+
+namespace chipp8 {
+
+namespace trace {
+
+constexpr const uint32_t TRACE_MAGIC = 0x52543843u; // "C8TR"
+constexpr const uint32_t INDEX_MAGIC = 0x58543843u; // "C8TX"
+constexpr const uint8_t TRACE_VERSION = 2u;
+constexpr const size_t HEADER_SIZE = 4u + 1u + 8u + 4u;
+constexpr const size_t FOOTER_SIZE = 8u + 4u;
+
+constexpr const uint32_t DEFAULT_INDEX_INTERVAL = 4096u;
+constexpr const size_t DEFAULT_RING_SIZE = 4u << 20u;
+
+// Record flags, which fields of a record hold something
+constexpr const uint8_t HAS_PC = 0x01u;
+constexpr const uint8_t CHANGED_V = 0x02u;
+constexpr const uint8_t CHANGED_I = 0x04u;
+constexpr const uint8_t CHANGED_MEM = 0x08u;
+constexpr const uint8_t CHANGED_TIMERS = 0x10u;
+constexpr const uint8_t CHANGED_SP = 0x20u;
+
+// FX55 stores at most 16 bytes
+constexpr const size_t MAX_MEM_DELTA = 16u;
+
+struct index_entry {
+    uint64_t cycle;
+    uint64_t offset;
+};
+
+// One decoded record, fields the flags leave out are 0. HAS_PC is set when
+// the pc is not the previous record's pc + 2
+struct record {
+    uint64_t cycle;
+    uint16_t pc;
+    uint16_t instruct;
+    uint8_t flags;
+    // Bit k set when vk changed, v holds the new values
+    uint16_t v_mask;
+    std::array<uint8_t, 16u> v;
+    uint16_t i;
+    uint16_t mem_addr;
+    uint8_t mem_len;
+    std::array<uint8_t, MAX_MEM_DELTA> mem;
+    uint8_t d_timer;
+    uint8_t s_timer;
+    uint8_t sp;
+    // stack[sp] after the instruction
+    uint16_t stack_top;
+};
+
+// What an op writes, outside pc and the display
+constexpr const uint8_t WRITES_VX = 0x01u;
+constexpr const uint8_t WRITES_VF = 0x02u;
+// v0..vX for FX65
+constexpr const uint8_t WRITES_V0X = 0x04u;
+constexpr const uint8_t WRITES_I = 0x08u;
+constexpr const uint8_t WRITES_TIMERS = 0x10u;
+constexpr const uint8_t WRITES_SP = 0x20u;
+// 3 bytes at I for FX33, X + 1 for FX55
+constexpr const uint8_t WRITES_BCD = 0x40u;
+constexpr const uint8_t WRITES_V0X_MEM = 0x80u;
+
+using writes_table = std::array<uint8_t, dispatch::OP_COUNT>;
+
+template <typename Q = quirks::modern>
+constexpr inline writes_table build_writes_table() {
+    using dispatch::op;
+    writes_table t{};
+    auto set = [&](op code, uint8_t writes) { t[static_cast<size_t>(code)] = writes; };
+    set(op::RET, WRITES_SP);
+    set(op::CALL, WRITES_SP);
+    for (const auto code: {op::LD, op::ADD, op::LD_REG, op::RND, op::LD_REG_DT, op::WAIT_KP}) {
+        set(code, WRITES_VX);
+    }
+    for (const auto code: {op::OR_REG, op::AND_REG, op::XOR_REG}) {
+        set(code, Q::logic_resets_vf ? WRITES_VX | WRITES_VF : WRITES_VX);
+    }
+    for (const auto code: {op::ADD_REG, op::SUB_REG, op::SHR, op::SUBN_REG, op::SHL}) {
+        set(code, WRITES_VX | WRITES_VF);
+    }
+    set(op::DRW, WRITES_VF);
+    set(op::LD_I, WRITES_I);
+    set(op::ADD_I_REG, WRITES_I);
+    set(op::LD_FONT, WRITES_I);
+    set(op::LD_DT_REG, WRITES_TIMERS);
+    set(op::LD_ST_REG, WRITES_TIMERS);
+    set(op::LD_BCD, WRITES_BCD);
+    set(op::LD_I_V0X, Q::load_store_increments_i ? WRITES_V0X_MEM | WRITES_I : WRITES_V0X_MEM);
+    set(op::LD_V0X_I, Q::load_store_increments_i ? WRITES_V0X | WRITES_I : WRITES_V0X);
+    return t;
+}
+
+template <typename Q>
+inline constexpr writes_table WRITES_FOR = build_writes_table<Q>();
+
+// The profiles a trace can replay, by the id stored in each block
+constexpr const uint8_t PROFILE_COUNT = 4u;
+
+template <typename Q>
+inline constexpr uint8_t PROFILE_OF = PROFILE_COUNT;
+template <>
+inline constexpr uint8_t PROFILE_OF<quirks::modern> = 0u;
+template <>
+inline constexpr uint8_t PROFILE_OF<quirks::cosmac_vip> = 1u;
+template <>
+inline constexpr uint8_t PROFILE_OF<quirks::super_chip> = 2u;
+template <>
+inline constexpr uint8_t PROFILE_OF<quirks::xo_chip> = 3u;
+
+inline constexpr std::array<writes_table, PROFILE_COUNT> WRITES_BY_PROFILE = {
+    WRITES_FOR<quirks::modern>,
+    WRITES_FOR<quirks::cosmac_vip>,
+    WRITES_FOR<quirks::super_chip>,
+    WRITES_FOR<quirks::xo_chip>,
+};
+
+// A block is its record count and length in words, the cycle of its first
+// record in 2 words, the registers, then the records
+constexpr const size_t BLOCK_HEADER_WORDS = 4u;
+// v in 4 words, the stack in 8, the rng in 3, keys and I, then the timers,
+// sp and the profile id
+constexpr const size_t REGISTER_WORDS = 17u;
+constexpr const uint32_t MAX_BLOCK_RECORDS = 4096u;
+// pc and word, then v0..vF after FX65
+constexpr const size_t MAX_RECORD_WORDS = 5u;
+
+using registers = std::array<uint32_t, REGISTER_WORDS>;
+
+inline void pack_registers(registers& out, const chip8& cpu, uint8_t profile) {
+    for (auto k = 0u; k < 4u; ++k) {
+        out[k] = cpu.v[4u * k] | (cpu.v[4u * k + 1u] << 8u) | (cpu.v[4u * k + 2u] << 16u) |
+                 (static_cast<uint32_t>(cpu.v[4u * k + 3u]) << 24u);
+    }
+    for (auto k = 0u; k < 8u; ++k) {
+        out[4u + k] = cpu.stack[2u * k] | (static_cast<uint32_t>(cpu.stack[2u * k + 1u]) << 16u);
+    }
+    out[12u] = cpu.rng.seed;
+    out[13u] = cpu.rng.instance;
+    out[14u] = cpu.rng.count;
+    out[15u] = cpu.keys | (static_cast<uint32_t>(cpu.i) << 16u);
+    out[16u] = cpu.d_timer | (cpu.s_timer << 8u) | (cpu.sp << 16u) | (static_cast<uint32_t>(profile) << 24u);
+}
+
+struct writer {
+    FILE* file;
+
+    // Producer owns head, the flusher owns tail, both count words
+    std::unique_ptr<uint32_t[]> ring;
+    uint64_t ring_mask;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<bool> closing;
+    std::atomic<bool> failed;
+    std::thread flusher;
+
+    // Emulation thread only, the next word to write, where the open block
+    // starts and how many more records it takes
+    alignas(64) uint64_t cursor;
+    uint64_t block_start;
+    uint32_t block_left;
+    uint32_t block_records;
+    // Words a full block takes
+    uint64_t block_words;
+    // Of the open block's first record
+    uint64_t cycle;
+    // The registers the last run left, a block starts on any difference
+    registers last;
+    // Times a block found the ring full and had to wait
+    uint64_t stalls;
+
+    // Flusher thread only from here, until close() joins it
+    alignas(64) uint64_t offset;
+    uint32_t index_interval;
+    std::vector<index_entry> index;
+
+    writer() : file(nullptr), ring_mask(0u), head(0u), tail(0u), closing(false), failed(false), cursor(0u),
+               block_start(0u), block_left(0u), block_records(0u), block_words(0u), cycle(0u), last{}, stalls(0u),
+               offset(0u), index_interval(0u) {}
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    ~writer();
+};
+
+// Write count words from the ring at word t, little-endian
+inline void write_words(writer& w, uint64_t t, uint64_t count) {
+    while (count) {
+        const auto from = t & w.ring_mask;
+        const auto n = std::min(count, w.ring_mask + 1u - from);
+        const auto* const words = w.ring.get() + from;
+        bool ok = true;
+        if constexpr (std::endian::native == std::endian::little) {
+            ok = fwrite(words, 4u, n, w.file) == n;
+        } else {
+            uint8_t bytes[4096u];
+            for (uint64_t k = 0u; ok && k < n; k += sizeof(bytes) / 4u) {
+                const auto m = std::min<uint64_t>(n - k, sizeof(bytes) / 4u);
+                for (uint64_t j = 0u; j < m; ++j) {
+                    for (auto b = 0u; b < 4u; ++b) {
+                        bytes[4u * j + b] = static_cast<uint8_t>(words[k + j] >> (8u * b));
+                    }
+                }
+                ok = fwrite(bytes, 4u, m, w.file) == m;
+            }
+        }
+        if (!ok) {
+            w.failed.store(true, std::memory_order_relaxed);
+        }
+        t += n;
+        count -= n;
+    }
+}
+
+// Flusher thread body, writes out whatever blocks the producer has published
+inline void drain(writer& w) {
+    const auto* const ring = w.ring.get();
+    for (;;) {
+        auto t = w.tail.load(std::memory_order_relaxed);
+        const auto h = w.head.load(std::memory_order_acquire);
+        if (h == t) {
+            if (w.closing.load(std::memory_order_acquire)) {
+                if (w.head.load(std::memory_order_acquire) == t) {
+                    return;
+                }
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        while (t != h) {
+            const uint64_t words = ring[(t + 1u) & w.ring_mask];
+            const auto cycle = ring[(t + 2u) & w.ring_mask] | (static_cast<uint64_t>(ring[(t + 3u) & w.ring_mask]) << 32u);
+            if (w.index.empty() || cycle - w.index.back().cycle >= w.index_interval) {
+                w.index.push_back({cycle, w.offset});
+            }
+            write_words(w, t, words);
+            w.offset += 4u * words;
+            t += words;
+        }
+        w.tail.store(t, std::memory_order_release);
+    }
+}
+
+// Close the open block and hand it to the flusher, an empty block is
+// dropped. Returns the cursor after it
+inline uint64_t end_block(writer& w, uint64_t cursor, uint32_t left) {
+    const auto records = w.block_records - left;
+    if (records == 0u) {
+        return w.block_start;
+    }
+    w.ring[w.block_start & w.ring_mask] = records;
+    w.ring[(w.block_start + 1u) & w.ring_mask] = static_cast<uint32_t>(cursor - w.block_start);
+    w.cycle += records;
+    w.head.store(cursor, std::memory_order_release);
+    return cursor;
+}
+
+// Wait until the ring has room for a full block, then start one from regs.
+// Returns the cursor after its registers
+inline uint64_t begin_block(writer& w, uint64_t cursor, const registers& regs) {
+    const auto ring_words = w.ring_mask + 1u;
+    while (cursor + w.block_words - w.tail.load(std::memory_order_acquire) > ring_words) {
+        ++w.stalls;
+        std::this_thread::yield();
+    }
+    w.block_start = cursor;
+    auto* const ring = w.ring.get();
+    const uint32_t header[BLOCK_HEADER_WORDS] = {0u, 0u, static_cast<uint32_t>(w.cycle),
+                                                 static_cast<uint32_t>(w.cycle >> 32u)};
+    for (const auto word: header) {
+        ring[cursor++ & w.ring_mask] = word;
+    }
+    for (const auto word: regs) {
+        ring[cursor++ & w.ring_mask] = word;
+    }
+    return cursor;
+}
+
+// Start a trace at path, cycle numbering from start_cycle. ring_size is
+// rounded up to a power of two of at least two full blocks. False if the
+// file cannot be written
+inline bool open(writer& w, const char* path, uint64_t start_cycle = 0u,
+                 uint32_t index_interval = DEFAULT_INDEX_INTERVAL, size_t ring_size = DEFAULT_RING_SIZE) {
+    if (w.file || index_interval == 0u) {
+        return false;
+    }
+    w.file = fopen(path, "wb");
+    if (!w.file) {
+        return false;
+    }
+    uint8_t header[HEADER_SIZE];
+    auto put = [&, k = 0u](uint64_t value, unsigned bytes) mutable {
+        for (auto b = 0u; b < bytes; ++b) {
+            header[k++] = static_cast<uint8_t>(value >> (8u * b));
+        }
+    };
+    put(TRACE_MAGIC, 4u);
+    put(TRACE_VERSION, 1u);
+    put(start_cycle, 8u);
+    put(index_interval, 4u);
+    if (fwrite(header, 1u, HEADER_SIZE, w.file) != HEADER_SIZE) {
+        fclose(w.file);
+        w.file = nullptr;
+        return false;
+    }
+
+    // The flusher writes whole blocks, no need to copy them through stdio
+    setvbuf(w.file, nullptr, _IONBF, 0u);
+
+    w.block_records = std::min(index_interval, MAX_BLOCK_RECORDS);
+    w.block_words = BLOCK_HEADER_WORDS + REGISTER_WORDS + w.block_records * MAX_RECORD_WORDS;
+    const auto ring_words = std::bit_ceil(std::max<uint64_t>(2u * w.block_words, ring_size / 4u));
+    w.ring = std::make_unique<uint32_t[]>(ring_words);
+    w.ring_mask = ring_words - 1u;
+    w.head.store(0u, std::memory_order_relaxed);
+    w.tail.store(0u, std::memory_order_relaxed);
+    w.closing.store(false, std::memory_order_relaxed);
+    w.failed.store(false, std::memory_order_relaxed);
+    // No block open, and no registers match, so the first run starts one
+    w.cursor = 0u;
+    w.block_start = 0u;
+    w.block_left = w.block_records;
+    w.cycle = start_cycle;
+    w.last.fill(~0u);
+    w.stalls = 0u;
+    w.offset = HEADER_SIZE;
+    w.index_interval = index_interval;
+    w.index.clear();
+    w.flusher = std::thread(drain, std::ref(w));
+    return true;
+}
+
+// Flush everything, append the index and close the file. False if any
+// write failed
+inline bool close(writer& w) {
+    if (!w.file) {
+        return false;
+    }
+    w.cursor = end_block(w, w.cursor, w.block_left);
+    w.block_left = w.block_records;
+    w.closing.store(true, std::memory_order_release);
+    w.flusher.join();
+
+    bool ok = !w.failed.load(std::memory_order_relaxed);
+    std::vector<uint8_t> footer;
+    footer.reserve(w.index.size() * 16u + FOOTER_SIZE);
+    auto put = [&](uint64_t value, unsigned bytes) {
+        for (auto b = 0u; b < bytes; ++b) {
+            footer.push_back(static_cast<uint8_t>(value >> (8u * b)));
+        }
+    };
+    for (const auto& e: w.index) {
+        put(e.cycle, 8u);
+        put(e.offset, 8u);
+    }
+    put(w.index.size(), 8u);
+    put(INDEX_MAGIC, 4u);
+    ok = (fwrite(footer.data(), 1u, footer.size(), w.file) == footer.size()) && ok;
+    ok = (fclose(w.file) == 0) && ok;
+    w.file = nullptr;
+    return ok;
+}
+
+inline writer::~writer() {
+    close(*this);
+}
+
+// fetch, increment pc, execute, record, for cycles instructions. The
+// ring position lives in locals and the inner loop runs to the end of the
+// block, so the common record is one store and one branch
+template <typename Q = quirks::modern>
+inline void run(writer& w, chip8& cpu, uint64_t cycles) {
+    static_assert(PROFILE_OF<Q> < PROFILE_COUNT, "trace::run records the profiles in quirks.h");
+    // DRW and FX65 sit among the few ops past DRW, one compare skips both
+    static_assert(dispatch::op::DRW < dispatch::op::LD_V0X_I);
+    registers regs;
+    pack_registers(regs, cpu, PROFILE_OF<Q>);
+    auto* const ring = w.ring.get();
+    const auto mask = w.ring_mask;
+    auto cursor = w.cursor;
+    auto left = w.block_left;
+    if (regs != w.last) {
+        cursor = begin_block(w, end_block(w, cursor, left), regs);
+        left = w.block_records;
+    }
+    while (cycles) {
+        const auto n = static_cast<uint32_t>(std::min<uint64_t>(left, cycles));
+        for (auto c = 0u; c < n; ++c) {
+            const auto pc = cpu.pc;
+            const auto instruct = fetch(cpu);
+            const auto& d = dispatch::DECODE_TABLE_FOR<Q>[instruct];
+            cpu.pc += 2u;
+            dispatch::execute(cpu, d);
+
+            ring[cursor++ & mask] = pc | (static_cast<uint32_t>(instruct) << 16u);
+            if (d.code >= dispatch::op::DRW) {
+                if (d.code == dispatch::op::DRW) {
+                    ring[cursor++ & mask] = cpu.v[0xFu];
+                } else if (d.code == dispatch::op::LD_V0X_I) {
+                    for (auto k = 0u; k < 16u; k += 4u) {
+                        ring[cursor++ & mask] = cpu.v[k] | (cpu.v[k + 1u] << 8u) | (cpu.v[k + 2u] << 16u) |
+                                                (static_cast<uint32_t>(cpu.v[k + 3u]) << 24u);
+                    }
+                }
+            }
+        }
+        cycles -= n;
+        left -= n;
+        if (left == 0u) {
+            pack_registers(regs, cpu, PROFILE_OF<Q>);
+            cursor = begin_block(w, end_block(w, cursor, left), regs);
+            left = w.block_records;
+        }
+    }
+    w.cursor = cursor;
+    w.block_left = left;
+    pack_registers(w.last, cpu, PROFILE_OF<Q>);
+}
+
+template <typename Q = quirks::modern>
+inline void step(writer& w, chip8& cpu) {
+    run<Q>(w, cpu, 1u);
+}
+
+// mem of the machine a reader replays on. The trace carries every byte an
+// op reads back from mem, so stores go nowhere and loads read 0
+struct no_mem {
+    struct byte {
+        constexpr byte& operator=(uint8_t) { return *this; }
+        constexpr operator uint8_t() const { return 0u; }
+    };
+    constexpr byte operator[](size_t) const { return {}; }
+};
+
+// chip8 without mem, enough for parse_op
+struct machine {
+    uint16_t keys;
+    display pixels;
+    no_mem mem;
+    std::array<uint8_t, 16u> v;
+    uint16_t i;
+    uint8_t d_timer;
+    uint8_t s_timer;
+    uint16_t pc;
+    uint8_t sp;
+    std::array<uint16_t, 16u> stack;
+    rng::stream rng;
+};
+
+inline void replay_op(machine& m, uint8_t profile, uint16_t instruct) {
+    switch (profile) {
+        case PROFILE_OF<quirks::modern>: {
+            parse_op<quirks::modern>(m, instruct);
+        } break;
+
+        case PROFILE_OF<quirks::cosmac_vip>: {
+            parse_op<quirks::cosmac_vip>(m, instruct);
+        } break;
+
+        case PROFILE_OF<quirks::super_chip>: {
+            parse_op<quirks::super_chip>(m, instruct);
+        } break;
+
+        default: {
+            parse_op<quirks::xo_chip>(m, instruct);
+        } break;
+    }
+}
+
+struct reader {
+    FILE* file;
+    uint64_t start_cycle;
+    uint32_t index_interval;
+    std::vector<index_entry> index;
+    // Where the blocks stop and the index starts
+    uint64_t records_end;
+
+    // The current block, words decoded to host order
+    std::vector<uint32_t> block;
+    size_t pos;
+    uint32_t block_left;
+    uint64_t next_block;
+    machine m;
+    uint8_t profile;
+
+    // Of the next record
+    uint64_t cycle;
+    uint16_t next_pc;
+    bool pc_known;
+
+    reader() : file(nullptr), start_cycle(0u), index_interval(0u), records_end(0u), pos(0u), block_left(0u),
+               next_block(0u), m{}, profile(0u), cycle(0u), next_pc(0u), pc_known(false) {}
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+    ~reader() {
+        if (file) {
+            fclose(file);
+        }
+    }
+};
+
+// Read the block at offset and set the machine to its registers. False if
+// there is no whole block there
+inline bool load_block(reader& r, uint64_t offset) {
+    uint8_t head[8u];
+    if (offset >= r.records_end || r.records_end - offset < sizeof(head) ||
+        fseek(r.file, static_cast<long>(offset), SEEK_SET) != 0 || fread(head, 1u, sizeof(head), r.file) != sizeof(head)) {
+        return false;
+    }
+    auto get = [](const uint8_t* in) {
+        return in[0u] | (in[1u] << 8u) | (in[2u] << 16u) | (static_cast<uint32_t>(in[3u]) << 24u);
+    };
+    const auto records = get(head);
+    const uint64_t words = get(head + 4u);
+    if (words < BLOCK_HEADER_WORDS + REGISTER_WORDS || words > (r.records_end - offset) / 4u || records == 0u ||
+        records > words) {
+        return false;
+    }
+    std::vector<uint8_t> bytes(4u * words);
+    if (fseek(r.file, static_cast<long>(offset), SEEK_SET) != 0 || fread(bytes.data(), 1u, bytes.size(), r.file) != bytes.size()) {
+        return false;
+    }
+    r.block.resize(words);
+    for (size_t k = 0u; k < words; ++k) {
+        r.block[k] = get(bytes.data() + 4u * k);
+    }
+
+    const auto* const regs = r.block.data() + BLOCK_HEADER_WORDS;
+    r.profile = static_cast<uint8_t>(regs[16u] >> 24u);
+    if (r.profile >= PROFILE_COUNT) {
+        return false;
+    }
+    auto& m = r.m;
+    for (auto k = 0u; k < 16u; ++k) {
+        m.v[k] = static_cast<uint8_t>(regs[k / 4u] >> (8u * (k % 4u)));
+        m.stack[k] = static_cast<uint16_t>(regs[4u + k / 2u] >> (16u * (k % 2u)));
+    }
+    m.rng = {regs[12u], regs[13u], regs[14u]};
+    m.keys = static_cast<uint16_t>(regs[15u]);
+    m.i = static_cast<uint16_t>(regs[15u] >> 16u);
+    m.d_timer = static_cast<uint8_t>(regs[16u]);
+    m.s_timer = static_cast<uint8_t>(regs[16u] >> 8u);
+    m.sp = static_cast<uint8_t>(regs[16u] >> 16u);
+    m.pixels.fill(0u);
+    if (m.sp > 0x0Fu) {
+        return false;
+    }
+
+    r.pos = BLOCK_HEADER_WORDS + REGISTER_WORDS;
+    r.block_left = records;
+    r.next_block = offset + 4u * words;
+    r.cycle = r.block[2u] | (static_cast<uint64_t>(r.block[3u]) << 32u);
+    r.pc_known = false;
+    return true;
+}
+
+// Open a closed trace and read its index, the reader starts at the first
+// record. False if path is not a whole trace of this version
+inline bool open(reader& r, const char* path) {
+    if (r.file) {
+        return false;
+    }
+    r.file = fopen(path, "rb");
+    if (!r.file) {
+        return false;
+    }
+    auto get = [](const uint8_t* in, unsigned bytes) {
+        uint64_t value = 0u;
+        for (auto b = 0u; b < bytes; ++b) {
+            value |= static_cast<uint64_t>(in[b]) << (8u * b);
+        }
+        return value;
+    };
+    uint8_t header[HEADER_SIZE];
+    uint8_t footer[FOOTER_SIZE];
+    bool ok = fread(header, 1u, HEADER_SIZE, r.file) == HEADER_SIZE && get(header, 4u) == TRACE_MAGIC &&
+              header[4u] == TRACE_VERSION && fseek(r.file, -static_cast<long>(FOOTER_SIZE), SEEK_END) == 0 &&
+              fread(footer, 1u, FOOTER_SIZE, r.file) == FOOTER_SIZE && get(footer + 8u, 4u) == INDEX_MAGIC;
+    const auto file_size = ok ? static_cast<uint64_t>(ftell(r.file)) : 0u;
+    const auto count = ok ? get(footer, 8u) : 0u;
+    ok = ok && file_size >= HEADER_SIZE + FOOTER_SIZE && count <= (file_size - HEADER_SIZE - FOOTER_SIZE) / 16u;
+    if (ok) {
+        r.start_cycle = get(header + 5u, 8u);
+        r.index_interval = static_cast<uint32_t>(get(header + 13u, 4u));
+        r.records_end = file_size - FOOTER_SIZE - count * 16u;
+        std::vector<uint8_t> entries(count * 16u);
+        ok = fseek(r.file, static_cast<long>(r.records_end), SEEK_SET) == 0 &&
+             fread(entries.data(), 1u, entries.size(), r.file) == entries.size();
+        r.index.resize(count);
+        for (size_t k = 0u; ok && k < count; ++k) {
+            r.index[k] = {get(entries.data() + 16u * k, 8u), get(entries.data() + 16u * k + 8u, 8u)};
+        }
+    }
+    if (ok) {
+        r.block.clear();
+        r.block_left = 0u;
+        r.next_block = HEADER_SIZE;
+        r.cycle = r.start_cycle;
+        r.pc_known = false;
+    }
+    if (!ok) {
+        fclose(r.file);
+        r.file = nullptr;
+    }
+    return ok;
+}
+
+// Replay the next record into rec. False at the end of the trace or on a
+// malformed block
+inline bool next(reader& r, record& rec) {
+    if (r.block_left == 0u && !load_block(r, r.next_block)) {
+        return false;
+    }
+    const auto* const words = r.block.data();
+    const auto end = r.block.size();
+    if (r.pos == end) {
+        return false;
+    }
+    const auto word = words[r.pos++];
+    auto& m = r.m;
+    rec = {};
+    rec.cycle = r.cycle;
+    rec.pc = static_cast<uint16_t>(word);
+    rec.instruct = static_cast<uint16_t>(word >> 16u);
+    if (!r.pc_known || rec.pc != r.next_pc) {
+        rec.flags |= HAS_PC;
+    }
+
+    const auto& d = dispatch::DECODE_TABLE[rec.instruct];
+    const auto writes = WRITES_BY_PROFILE[r.profile][static_cast<size_t>(d.code)];
+    const auto x = d.x;
+    // sp is not masked, a trace of a run that left the stack ends there
+    if ((d.code == dispatch::op::CALL && m.sp >= 0x0Fu) || (d.code == dispatch::op::RET && m.sp > 0x0Fu)) {
+        return false;
+    }
+    rec.mem_addr = m.i;
+    m.pc = static_cast<uint16_t>(rec.pc + 2u);
+    replay_op(m, r.profile, rec.instruct);
+    // What the op read from mem or the display
+    if (d.code == dispatch::op::DRW) {
+        if (r.pos == end) {
+            return false;
+        }
+        m.v[0xFu] = static_cast<uint8_t>(words[r.pos++]);
+    } else if (d.code == dispatch::op::LD_V0X_I) {
+        if (end - r.pos < 4u) {
+            return false;
+        }
+        for (auto k = 0u; k <= x; ++k) {
+            m.v[k] = static_cast<uint8_t>(words[r.pos + k / 4u] >> (8u * (k % 4u)));
+        }
+        r.pos += 4u;
+    }
+
+    if (writes & WRITES_V0X) {
+        rec.v_mask = static_cast<uint16_t>((2u << x) - 1u);
+    } else {
+        rec.v_mask = static_cast<uint16_t>(((writes & WRITES_VX) ? 1u << x : 0u) | ((writes & WRITES_VF) ? 0x8000u : 0u));
+    }
+    if (rec.v_mask) {
+        rec.flags |= CHANGED_V;
+        for (auto k = 0u; k < 16u; ++k) {
+            rec.v[k] = (rec.v_mask & (1u << k)) ? m.v[k] : 0u;
+        }
+    }
+    if (writes & WRITES_I) {
+        rec.flags |= CHANGED_I;
+        rec.i = m.i;
+    }
+    if (writes & (WRITES_BCD | WRITES_V0X_MEM)) {
+        // Only the bytes that landed inside mem
+        const uint32_t len = (writes & WRITES_BCD) ? 3u : x + 1u;
+        rec.mem_len = static_cast<uint8_t>(std::min<uint32_t>(len, (rec.mem_addr < 4096u) ? 4096u - rec.mem_addr : 0u));
+        if (writes & WRITES_BCD) {
+            const auto val = m.v[x];
+            const uint8_t digits[3u] = {static_cast<uint8_t>(val / 100u), static_cast<uint8_t>(val / 10u % 10u),
+                                        static_cast<uint8_t>(val % 10u)};
+            memcpy(rec.mem.data(), digits, rec.mem_len);
+        } else {
+            memcpy(rec.mem.data(), m.v.data(), rec.mem_len);
+        }
+        rec.flags |= rec.mem_len ? CHANGED_MEM : 0u;
+    }
+    if (!(rec.flags & CHANGED_MEM)) {
+        rec.mem_addr = 0u;
+    }
+    if (writes & WRITES_TIMERS) {
+        rec.flags |= CHANGED_TIMERS;
+        rec.d_timer = m.d_timer;
+        rec.s_timer = m.s_timer;
+    }
+    if (writes & WRITES_SP) {
+        rec.flags |= CHANGED_SP;
+        rec.sp = m.sp;
+        rec.stack_top = m.stack[m.sp & 0x0Fu];
+    }
+
+    --r.block_left;
+    r.next_pc = static_cast<uint16_t>(rec.pc + 2u);
+    r.pc_known = true;
+    ++r.cycle;
+    return true;
+}
+
+// Position r so that next() returns the record of cycle. Replays from the
+// block of the nearest index entry, some index_interval records. False if
+// cycle is not in the trace
+inline bool seek(reader& r, uint64_t cycle) {
+    const auto after = std::upper_bound(r.index.begin(), r.index.end(), cycle, [](uint64_t c, const index_entry& e) {
+        return c < e.cycle;
+    });
+    if (after == r.index.begin()) {
+        return false;
+    }
+    const auto& entry = *(after - 1);
+    if (!load_block(r, entry.offset)) {
+        return false;
+    }
+    record skipped;
+    while (r.cycle < cycle) {
+        if (!next(r, skipped)) {
+            return false;
+        }
+    }
+    return r.block_left != 0u || load_block(r, r.next_block);
+}
+
+// One line per record from cycle on, at most count of them: cycle, pc,
+// instruction word and what changed. False if cycle is not in the trace
+inline bool dump(reader& r, FILE* out, uint64_t cycle, uint64_t count) {
+    if (!seek(r, cycle)) {
+        return false;
+    }
+    record rec;
+    for (uint64_t k = 0u; k < count && next(r, rec); ++k) {
+        fprintf(out, "%llu %03X %04X", static_cast<unsigned long long>(rec.cycle), rec.pc, rec.instruct);
+        for (auto v = 0u; v < 16u; ++v) {
+            if (rec.v_mask & (1u << v)) {
+                fprintf(out, " v%X=%02X", v, rec.v[v]);
+            }
+        }
+        if (rec.flags & CHANGED_I) {
+            fprintf(out, " I=%03X", rec.i);
+        }
+        if (rec.flags & CHANGED_MEM) {
+            fprintf(out, " [%03X]=", rec.mem_addr);
+            for (auto b = 0u; b < rec.mem_len; ++b) {
+                fprintf(out, "%02X", rec.mem[b]);
+            }
+        }
+        if (rec.flags & CHANGED_TIMERS) {
+            fprintf(out, " DT=%02X ST=%02X", rec.d_timer, rec.s_timer);
+        }
+        if (rec.flags & CHANGED_SP) {
+            fprintf(out, " SP=%X:%03X", rec.sp, rec.stack_top);
+        }
+        fputc('\n', out);
+    }
+    return true;
+}
+
+} // namespace trace
+
+} // namespace chipp8
@@ -24,6 +24,8 @@ constexpr inline void pp_array(const auto &arr) {
     std::cout << buf << std::endl;
 }
 
+// disp is one word per row with the leftmost pixel in the high bit of a
+// w bit row, as in chip8::pixels
 constexpr inline void pp_display(const auto &disp, size_t w, size_t h) {
     std::string buf;
 
@@ -36,7 +38,7 @@ constexpr inline void pp_display(const auto &disp, size_t w, size_t h) {
     for (auto y = 0u; y < h; ++y) {
         buf += std::to_string((y%10));
         for (auto x = 0u; x < w; ++x) {
-            buf += (disp[x+(y*w)] ? "#" : " ");
+            buf += (((disp[y] >> (w - 1u - x)) & 1u) ? "#" : " ");
         }
         buf += "\n";
     }
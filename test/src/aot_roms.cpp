@@ -0,0 +1,236 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/* ROMs for the ahead-of-time recompiler
+
+   Writes each program below to <dir>/<name>.ch8. The build then runs the
+   aot tool on them and compiles the output into difftest, which checks it
+   against the interpreter (see test/CMakeLists.txt).
+*/
+
+namespace {
+
+struct rom {
+    const char* name;
+    std::vector<uint16_t> words;
+};
+
+// Calls, returns, key skips, font lookups and I arithmetic
+const rom CALLS{"calls", {
+    0x6005u, // 200: LD v0, 5
+    0x2210u, // 202: CALL 210
+    0x7001u, // 204: ADD v0, 1
+    0xE09Eu, // 206: SKP v0
+    0xE0A1u, // 208: SKNP v0
+    0x400Fu, // 20A: SNE v0, 15
+    0x6000u, // 20C: LD v0, 0
+    0x1202u, // 20E: JP 202
+    0xF029u, // 210: LD F, v0
+    0xF01Eu, // 212: ADD I, v0
+    0xD015u, // 214: DRW v0, v1, 5
+    0x8F06u, // 216: SHR vF
+    0x8FFEu, // 218: SHL vF
+    0x8F05u, // 21A: SUB vF, v0
+    0x80F7u, // 21C: SUBN v0, vF
+    0x00EEu, // 21E: RET
+}};
+
+// The same loop as bench::load_alu_loop
+const rom ALU{"alu", {
+    0x6000u, // 200: LD v0, 0
+    0x6101u, // 202: LD v1, 1
+    0x7001u, // 204: ADD v0, 1
+    0x8014u, // 206: ADD v0, v1
+    0x8102u, // 208: AND v1, v0
+    0x8203u, // 20A: XOR v2, v0
+    0x8306u, // 20C: SHR v3
+    0x3000u, // 20E: SE v0, 0
+    0x1204u, // 210: JP 204
+    0xA050u, // 212: LD I, 0x50
+    0xD125u, // 214: DRW v1, v2, 5
+    0x1204u, // 216: JP 204
+}};
+
+// FX55 rewriting the block it jumps back into
+const rom PATCH{"patch", {
+    0x6073u, // 200: LD v0, 0x73
+    0x6101u, // 202: LD v1, 0x01
+    0x1208u, // 204: JP 208
+    0x0000u, // 206:
+    0x6305u, // 208: LD v3, 5      <- becomes ADD v3, 1
+    0x7201u, // 20A: ADD v2, 1
+    0xA208u, // 20C: LD I, 0x208
+    0xF155u, // 20E: LD [I], v0..v1
+    0x1208u, // 210: JP 208
+}};
+
+// FX55 storing the bytes already there over code, then FX33 rewriting a
+// jump into SYS 102, which falls into zeroed mem
+const rom BCD{"bcd", {
+    0x6072u, // 200: LD v0, 0x72
+    0x6101u, // 202: LD v1, 0x01
+    0xA20Au, // 204: LD I, 0x20A
+    0xF155u, // 206: LD [I], v0..v1  <- 72 01 over 20A
+    0x607Bu, // 208: LD v0, 123
+    0x7201u, // 20A: ADD v2, 1
+    0x3205u, // 20C: SE v2, 5
+    0x120Au, // 20E: JP 20A
+    0xA216u, // 210: LD I, 0x216
+    0xF033u, // 212: LD B, v0
+    0x1216u, // 214: JP 216
+    0x120Au, // 216: JP 20A       <- becomes SYS 102
+}};
+
+// BNNN through a table of jumps, none of which analyze() can see
+const rom TABLE{"table", {
+    0x6106u, // 200: LD v1, 6
+    0x7002u, // 202: ADD v0, 2
+    0x8012u, // 204: AND v0, v1
+    0xB20Au, // 206: JP v0 + 20A
+    0x0000u, // 208:
+    0x1212u, // 20A: JP 212
+    0x1216u, // 20C: JP 216
+    0x121Au, // 20E: JP 21A
+    0x121Eu, // 210: JP 21E
+    0x7201u, // 212: ADD v2, 1
+    0x1202u, // 214: JP 202
+    0x7301u, // 216: ADD v3, 1
+    0x1202u, // 218: JP 202
+    0x7401u, // 21A: ADD v4, 1
+    0x1202u, // 21C: JP 202
+    0x7501u, // 21E: ADD v5, 1
+    0xF50Au, // 220: LD v5, K
+    0x1202u, // 222: JP 202
+}};
+
+// The quirky ops, compiled for quirks::cosmac_vip: vY shifts, vF resets,
+// FX55/FX65 moving I and sprites clipped at the edges
+const rom VIP{"vip", {
+    0x6A3Cu, // 200: LD vA, 60
+    0x6B1Eu, // 202: LD vB, 30
+    0x7A01u, // 204: ADD vA, 1
+    0x8AB1u, // 206: OR vA, vB
+    0x8BA3u, // 208: XOR vB, vA
+    0x8C16u, // 20A: SHR vC, v1
+    0x8DAEu, // 20C: SHL vD, vA
+    0xA300u, // 20E: LD I, 0x300
+    0xF355u, // 210: LD [I], v0..v3
+    0xF265u, // 212: LD v0..v2, [I]
+    0xFA29u, // 214: LD F, vA
+    0xDAB5u, // 216: DRW vA, vB, 5
+    0x7101u, // 218: ADD v1, 1
+    0x1204u, // 21A: JP 204
+}};
+
+// BXNN jumping to XNN + vX with quirks::super_chip
+const rom SCHIP{"schip", {
+    0x6200u, // 200: LD v2, 0
+    0x7202u, // 202: ADD v2, 2
+    0x6306u, // 204: LD v3, 6
+    0x8232u, // 206: AND v2, v3
+    0xB20Cu, // 208: JP v2 + 20C
+    0x0000u, // 20A:
+    0x7401u, // 20C: ADD v4, 1
+    0x7501u, // 20E: ADD v5, 1
+    0x7601u, // 210: ADD v6, 1
+    0x7701u, // 212: ADD v7, 1
+    0x1202u, // 214: JP 202
+}};
+
+struct rng {
+    uint64_t s;
+
+    uint32_t next() {
+        s ^= s << 13u;
+        s ^= s >> 7u;
+        s ^= s << 17u;
+        return static_cast<uint32_t>(s >> 11u);
+    }
+
+    uint32_t below(uint32_t n) { return next() % n; }
+};
+
+// Long enough for every BNNN target to land in the program
+constexpr const uint16_t RANDOM_LEN = 192u;
+
+// As in difftest, minus the ops whose reference behaviour indexes out of
+// bounds. I points into the program now and then, so FX33/FX55 rewrite it
+uint16_t random_instruction(rng& r) {
+    const uint16_t x = static_cast<uint16_t>(r.below(16u) << 8u);
+    const uint16_t y = static_cast<uint16_t>(r.below(16u) << 4u);
+    const uint16_t nn = static_cast<uint16_t>(r.below(256u));
+    const uint16_t target = static_cast<uint16_t>(0x0200u + r.below(RANDOM_LEN) * 2u);
+    switch (r.below(20u)) {
+        case 0u:  return 0x00E0u;
+        case 1u:  return static_cast<uint16_t>(0x1000u | target);
+        case 2u:  return static_cast<uint16_t>(0x3000u | x | nn);
+        case 3u:  return static_cast<uint16_t>(0x4000u | x | nn);
+        case 4u:  return static_cast<uint16_t>(0x5000u | x | y);
+        case 5u:  return static_cast<uint16_t>(0x6000u | x | nn);
+        case 6u:  return static_cast<uint16_t>(0x1000u | target);
+        case 7u:
+        case 8u:
+        case 9u: {
+            constexpr uint16_t alu[] = {0x0u, 0x1u, 0x2u, 0x3u, 0x4u, 0x5u, 0x6u, 0x7u, 0xEu, 0x8u};
+            return static_cast<uint16_t>(0x8000u | x | y | alu[r.below(10u)]);
+        }
+        case 10u: return static_cast<uint16_t>(0x9000u | x | y);
+        case 11u: return static_cast<uint16_t>(0xA000u | (0x0200u + r.below(0x0B00u)));
+        case 12u: return static_cast<uint16_t>(0xC000u | x | nn);
+        case 13u: return static_cast<uint16_t>(0xD000u | x | y | r.below(16u));
+        case 14u: {
+            constexpr uint16_t fx[] = {0x07u, 0x0Au, 0x15u, 0x18u, 0x29u, 0x33u, 0x55u, 0x65u};
+            return static_cast<uint16_t>(0xF000u | x | fx[r.below(8u)]);
+        }
+        case 15u: return static_cast<uint16_t>(0xA000u | (0x0200u + r.below(RANDOM_LEN * 2u)));
+        case 16u: return static_cast<uint16_t>(0xB200u | r.below(0x80u));
+        default: {
+            return static_cast<uint16_t>(0x7000u | x | nn);
+        }
+    }
+}
+
+rom random_rom(unsigned k) {
+    rng r{0xD1B54A32D192ED03ull * (k + 1u)};
+    rom out{nullptr, {}};
+    for (auto w = 0u; w < RANDOM_LEN - 1u; ++w) {
+        out.words.push_back(random_instruction(r));
+    }
+    out.words.push_back(0x1200u);
+    return out;
+}
+
+bool write(const std::string& dir, const char* name, const std::vector<uint16_t>& words) {
+    const auto path = dir + "/" + name + ".ch8";
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "%s: could not be written\n", path.c_str());
+        return false;
+    }
+    for (const auto word: words) {
+        fputc(word >> 8u, f);
+        fputc(word & 0x00FFu, f);
+    }
+    return fclose(f) == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s dir\n", argv[0]);
+        return 2;
+    }
+    const std::string dir = argv[1];
+    bool ok = true;
+    for (const auto* program: {&CALLS, &ALU, &PATCH, &BCD, &TABLE, &VIP, &SCHIP}) {
+        ok = write(dir, program->name, program->words) && ok;
+    }
+    for (auto k = 0u; k < 4u; ++k) {
+        const auto name = "random" + std::to_string(k);
+        ok = write(dir, name.c_str(), random_rom(k).words) && ok;
+    }
+    return ok ? 0 : 1;
+}
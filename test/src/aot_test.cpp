@@ -0,0 +1,148 @@
+#include "unittest.h"
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "aot.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace test {
+
+static std::vector<uint8_t> rom_of(std::initializer_list<uint16_t> words) {
+    std::vector<uint8_t> bytes;
+    for (const auto word: words) {
+        bytes.push_back(static_cast<uint8_t>(word >> 8u));
+        bytes.push_back(static_cast<uint8_t>(word & 0x00FFu));
+    }
+    return bytes;
+}
+
+static bool has_blocks(const aot::program& p, std::initializer_list<aot::block> expected) {
+    if (p.blocks.size() != expected.size()) {
+        return false;
+    }
+    auto k = 0u;
+    for (const auto& b: expected) {
+        if (p.blocks[k].start != b.start || p.blocks[k].len != b.len) {
+            return false;
+        }
+        ++k;
+    }
+    return true;
+}
+
+void test_aot_analyze() {
+    const auto rom = rom_of({
+        0x6005u, // 200: LD v0, 5
+        0x2210u, // 202: CALL 210
+        0x7001u, // 204: ADD v0, 1
+        0x3005u, // 206: SE v0, 5
+        0x1204u, // 208: JP 204
+        0x1200u, // 20A: JP 200
+        0xFFFFu, // 20C: data
+        0xFFFFu, // 20E: data
+        0xA050u, // 210: LD I, 0x50
+        0xF033u, // 212: LD B, v0
+        0x00EEu, // 214: RET
+    });
+    const auto p = aot::analyze(rom.data(), rom.size());
+    ASSERT(has_blocks(p, {{0x200u, 2u}, {0x204u, 2u}, {0x208u, 1u}, {0x20Au, 1u}, {0x210u, 2u}, {0x214u, 1u}}),
+        "Split after calls, skips and writes, and at every target")
+    ASSERT(!p.leader[0x20Cu] && !p.leader[0x20Eu], "Data is not code")
+    ASSERT(p.indirect.empty(), "No BNNN")
+
+    const auto code = aot::code_ranges(p);
+    ASSERT(code.size() == 2u && code[0u].start == 0x200u && code[0u].len == 12u && code[1u].start == 0x210u && code[1u].len == 6u,
+        "Code bytes around the data")
+}
+
+void test_aot_analyze_edges() {
+    const auto jumps = rom_of({
+        0x3000u, // 200: SE v0, 0
+        0x1400u, // 202: JP 400
+        0xB300u, // 204: JP v0 + 300
+    });
+    auto p = aot::analyze(jumps.data(), jumps.size());
+    ASSERT(has_blocks(p, {{0x200u, 1u}, {0x202u, 1u}, {0x204u, 1u}}), "One block per branch")
+    ASSERT(!p.leader[0x400u], "Targets past the ROM are left alone")
+    ASSERT(p.indirect.size() == 1u && p.indirect[0u] == 0x204u, "BNNN is indirect")
+
+    const auto wait = rom_of({0x6001u, 0xF00Au, 0x1200u});
+    p = aot::analyze(wait.data(), wait.size());
+    ASSERT(has_blocks(p, {{0x200u, 1u}, {0x202u, 1u}, {0x204u, 1u}}), "WAIT_KP loops on itself")
+
+    // Runs off the end, the last byte is half an instruction
+    auto open = rom_of({0x6001u, 0x7001u});
+    open.push_back(0x12u);
+    p = aot::analyze(open.data(), open.size());
+    ASSERT(has_blocks(p, {{0x200u, 2u}}), "Only whole instructions")
+
+    p = aot::analyze(open.data(), 0u);
+    ASSERT(p.blocks.empty(), "Nothing to compile")
+}
+
+void test_aot_translate() {
+    const auto rom = rom_of({
+        0x6101u, // 200: LD v1, 1
+        0x7201u, // 202: ADD v2, 1
+        0xA050u, // 204: LD I, 0x50
+        0xD125u, // 206: DRW v1, v2, 5
+        0x3200u, // 208: SE v2, 0
+        0x1202u, // 20A: JP 202
+        0xF233u, // 20C: LD B, v2
+        0x1200u, // 20E: JP 200
+    });
+    const auto p = aot::analyze(rom.data(), rom.size());
+    std::string out;
+    ASSERT(aot::translate(p, "aot_test", "cosmac_vip", out), "Translated")
+    for (const auto* expected: {
+            "namespace chipp8::aot_test {",
+            "using Q = quirks::cosmac_vip;",
+            "case 0x202u: goto b_202;",
+            "DRW<Q>(cpu, 0x1u, 0x2u, 5u);",
+            "if (cpu.pc == 0x20Au) {",
+            "aot::wrote_code(cpu, written, 3u, CODE)",
+            "goto b_200;",
+            "dispatch::run<Q>(cpu, cycles);",
+        }) {
+        ASSERT(out.find(expected) != std::string::npos, "Generated code")
+    }
+    ASSERT(!aot::translate(p, "aot_test", "chip48", out), "Unknown profile")
+    ASSERT(!aot::translate(aot::analyze(rom.data(), 0u), "aot_test", "modern", out), "Empty ROM")
+}
+
+void test_aot_guards() {
+    const auto rom = rom_of({0x6001u, 0xA200u, 0xF155u, 0x1200u});
+    chip8 cpu;
+    load_program(cpu, rom.data(), rom.size());
+    const aot::range code[] = {{0x200u, 8u, rom.data()}};
+    ASSERT(aot::intact(cpu, code), "Loaded as compiled")
+    ASSERT(!aot::wrote_code(cpu, 0x200u, 2u, code), "Stored the same bytes")
+
+    // Store v0..v1 = 01 00 over LD v0, 1 and compare with dispatch::step
+    auto expected = cpu;
+    cpu.v[0u] = expected.v[0u] = 0x01u;
+    cpu.i = expected.i = 0x200u;
+    cpu.pc = expected.pc = 0x204u;
+    dispatch::step(expected);
+    ASSERT(!aot::step(cpu, code) && cpu == expected, "A write into code is reported")
+    ASSERT(!aot::intact(cpu, code), "Changed")
+
+    cpu.pc = expected.pc = 0x206u;
+    dispatch::step(expected);
+    ASSERT(aot::step(cpu, code) && cpu == expected, "Other ops step as usual")
+    ASSERT(!aot::wrote_code(cpu, 0x300u, 16u, code), "Writes elsewhere do not count")
+}
+
+void run_aot_tests() {
+    test_aot_analyze();
+    test_aot_analyze_edges();
+    test_aot_translate();
+    test_aot_guards();
+}
+
+} // namespace test
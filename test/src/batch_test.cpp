@@ -0,0 +1,94 @@
+#include "unittest.h"
+
+#include <memory>
+
+#include "batch.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Not a multiple of the vector width, so the scalar tail runs too
+constexpr const size_t LANES = 37u;
+
+// Every lane of the batch against its own machine run through dispatch, in
+// slices of 11 so runs also start out of step
+static void check_against_dispatch(const std::array<chip8, LANES>& start, unsigned slices) {
+    auto expected = std::make_unique<std::array<chip8, LANES>>(start);
+    auto b = std::make_unique<chip8_batch<LANES>>();
+    for (size_t l = 0u; l < LANES; ++l) {
+        batch::load_lane(*b, l, start[l]);
+    }
+
+    chip8 actual;
+    for (auto s = 0u; s < slices; ++s) {
+        batch::run(*b, 11u);
+        for (size_t l = 0u; l < LANES; ++l) {
+            dispatch::run((*expected)[l], 11u);
+            batch::store_lane(*b, l, actual);
+            ASSERT(actual == (*expected)[l], "Each batch lane agrees with dispatch")
+        }
+    }
+}
+
+void test_batch_diverging_lanes() {
+    auto start = std::make_unique<std::array<chip8, LANES>>();
+    for (size_t l = 0u; l < LANES; ++l) {
+        auto& cpu = (*start)[l];
+        load_program(cpu, {
+            0x7001u, // 200: ADD v0, 1
+            0x8014u, // 202: ADD v0, v1
+            0x8125u, // 204: SUB v1, v2
+            0x8236u, // 206: SHR v2
+            0x831Eu, // 208: SHL v3
+            0x8317u, // 20A: SUBN v3, v1
+            0x3000u, // 20C: SE v0, 0
+            0x1200u, // 20E: JP 200
+            0xF029u, // 210: LD F, v0
+            0xD125u, // 212: DRW v1, v2, 5
+            0xF315u, // 214: LD DT, v3
+            0xF407u, // 216: LD v4, DT
+            0x1200u, // 218: JP 200
+        });
+        // Seeded apart so the SE splits the lanes at different times
+        cpu.v[0u] = static_cast<uint8_t>(l * 7u);
+        cpu.v[1u] = static_cast<uint8_t>(l * 3u + 1u);
+        cpu.v[2u] = static_cast<uint8_t>(0xF0u - l);
+        cpu.v[3u] = static_cast<uint8_t>(l);
+    }
+    check_against_dispatch(*start, 100u);
+}
+
+void test_batch_self_modifying() {
+    auto start = std::make_unique<std::array<chip8, LANES>>();
+    for (size_t l = 0u; l < LANES; ++l) {
+        auto& cpu = (*start)[l];
+        // FX55 rewrites the low byte of the ADD at 0x206 with v0, which
+        // differs between the lanes, so lanes on the same pc split on the
+        // instruction word
+        load_program(cpu, {
+            0xA207u, // 200: LD I, 0x207
+            0x7011u, // 202: ADD v0, 0x11
+            0xF055u, // 204: LD [I], v0
+            0x7100u, // 206: ADD v1, <patched>
+            0x8F14u, // 208: ADD vF, v1
+            0x4F00u, // 20A: SNE vF, 0
+            0x00E0u, // 20C: CLS
+            0xA300u, // 20E: LD I, 0x300
+            0xF133u, // 210: LD B, v1
+            0xF265u, // 212: LD v0..v2, [I]
+            0x1200u, // 214: JP 200
+        });
+        cpu.v[0u] = static_cast<uint8_t>(l * 13u);
+    }
+    check_against_dispatch(*start, 40u);
+}
+
+void run_batch_tests() {
+    test_batch_diverging_lanes();
+    test_batch_self_modifying();
+}
+
+} // namespace test
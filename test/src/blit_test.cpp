@@ -0,0 +1,142 @@
+#include "unittest.h"
+
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include <vector>
+
+#include "blit.h"
+#include "chip8.h"
+#include "hires.h"
+
+using namespace chipp8;
+
+namespace test {
+
+constexpr const uint32_t ON = 0xFF33CC99u;
+constexpr const uint32_t OFF = 0x11000000u;
+// Never written by expand
+constexpr const uint32_t UNTOUCHED = 0xDEADBEEFu;
+
+static uint64_t next(uint64_t& state) {
+    state ^= state << 13u;
+    state ^= state >> 7u;
+    state ^= state << 17u;
+    return state;
+}
+
+void test_blit_matches_pixels() {
+    uint64_t state = 0x1234567u;
+    display pixels;
+    for (auto& row: pixels) {
+        row = next(state);
+    }
+    pixels[3u] = 0u;
+    pixels[4u] = ~0ull;
+    for (auto scale = 1u; scale <= 20u; ++scale) {
+        // A wider pitch with a margin that has to stay untouched
+        const size_t pitch = DISPLAY_WIDTH * scale + 3u;
+        std::vector<uint32_t> out(pitch * DISPLAY_HEIGHT * scale, UNTOUCHED);
+        blit::expand(pixels, ON, OFF, scale, out.data(), pitch);
+        bool same = true;
+        for (auto y = 0u; y < DISPLAY_HEIGHT * scale; ++y) {
+            for (auto x = 0u; x < pitch; ++x) {
+                const auto got = out[y * pitch + x];
+                if (x >= DISPLAY_WIDTH * scale) {
+                    same = same && got == UNTOUCHED;
+                    continue;
+                }
+                const bool on = (pixels[y / scale] >> (63u - x / scale)) & 1u;
+                same = same && got == (on ? ON : OFF);
+            }
+        }
+        ASSERT(same, "Every output pixel is its source pixel, the margin is left alone")
+
+        std::vector<uint32_t> reference(out.size(), UNTOUCHED);
+        blit::expand_scalar(pixels, ON, OFF, scale, reference.data(), pitch);
+        ASSERT(out == reference, "Same as the scalar reference")
+    }
+}
+
+void test_blit_dirty_rows() {
+    constexpr uint32_t scale = 10u;
+    constexpr size_t pitch = DISPLAY_WIDTH * scale;
+    display shown{};
+    std::vector<uint32_t> out(pitch * DISPLAY_HEIGHT * scale);
+    blit::expand(shown, ON, OFF, scale, out.data(), pitch);
+
+    display pixels = shown;
+    pixels[0u] = 0x8000000000000001ull;
+    pixels[17u] = 0xF0ull << 30u;
+    pixels[31u] = ~0ull;
+    const auto rows = blit::changed_rows(pixels, shown);
+    ASSERT(rows == ((1u << 0u) | (1u << 17u) | (1u << 31u)), "Three rows changed")
+
+    // Poison the unchanged rows, a dirty update must not rewrite them
+    std::vector<uint32_t> expected(out.size());
+    blit::expand(pixels, ON, OFF, scale, expected.data(), pitch);
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        if (!((rows >> y) & 1u)) {
+            std::fill(out.begin() + y * scale * pitch, out.begin() + (y + 1u) * scale * pitch, UNTOUCHED);
+            std::fill(expected.begin() + y * scale * pitch, expected.begin() + (y + 1u) * scale * pitch, UNTOUCHED);
+        }
+    }
+    blit::expand(pixels, ON, OFF, scale, out.data(), pitch, rows);
+    ASSERT(out == expected, "Only the changed rows are written")
+}
+
+void test_blit_planes() {
+    auto m = std::make_unique<hires::machine>();
+    hires::init(*m);
+    uint64_t state = 99u;
+    for (auto& p: m->planes) {
+        for (auto y = 0u; y < hires::HEIGHT; ++y) {
+            p.left[y] = next(state);
+            p.right[y] = next(state);
+        }
+    }
+    const blit::palette colours = {blit::rgba(0u, 0u, 0u), blit::rgba(255u, 0u, 0u), blit::rgba(0u, 255u, 0u),
+                                   blit::rgba(0u, 0u, 255u)};
+    for (const auto scale: {1u, 2u, 3u, 4u, 5u, 8u, 9u, 16u}) {
+        const size_t pitch = hires::WIDTH * scale;
+        std::vector<uint32_t> out(pitch * hires::HEIGHT * scale);
+        std::vector<uint8_t> indices(pitch * hires::HEIGHT * scale);
+        blit::expand(*m, colours, scale, out.data(), pitch);
+        blit::index(*m, scale, indices.data(), pitch);
+        bool same = true;
+        for (auto y = 0u; y < hires::HEIGHT * scale; ++y) {
+            for (auto x = 0u; x < pitch; ++x) {
+                const auto px = static_cast<uint16_t>(x / scale);
+                const auto py = static_cast<uint16_t>(y / scale);
+                const auto i = static_cast<uint32_t>(hires::get_pixel(*m, 0u, px, py)) |
+                               (static_cast<uint32_t>(hires::get_pixel(*m, 1u, px, py)) << 1u);
+                same = same && out[y * pitch + x] == colours[i] && indices[y * pitch + x] == i;
+            }
+        }
+        ASSERT(same, "Each pixel is its plane bits through the palette, and as an index")
+
+        std::vector<uint32_t> reference(out.size());
+        blit::expand_scalar(*m, colours, scale, reference.data(), pitch);
+        ASSERT(out == reference, "Same as the scalar reference")
+    }
+
+    const auto before = m->planes;
+    m->planes[1u].right[40u] ^= 1u;
+    ASSERT(blit::changed_rows(m->planes, before) == (1ull << 40u), "A change in either plane marks the row")
+}
+
+void test_blit_rgba_bytes() {
+    const auto c = blit::rgba(0x11u, 0x22u, 0x33u, 0x44u);
+    uint8_t bytes[4];
+    memcpy(bytes, &c, 4u);
+    ASSERT(bytes[0u] == 0x11u && bytes[1u] == 0x22u && bytes[2u] == 0x33u && bytes[3u] == 0x44u, "R, G, B, A in memory")
+}
+
+void run_blit_tests() {
+    test_blit_matches_pixels();
+    test_blit_dirty_rows();
+    test_blit_planes();
+    test_blit_rgba_bytes();
+}
+
+} // namespace test
@@ -0,0 +1,104 @@
+#include "unittest.h"
+
+#include "block_cache.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Run the cached interpreter in uneven slices, so blocks get cut short, and
+// check it against the plain dispatch loop after every slice
+static void check_against_dispatch(const chip8& start, unsigned slices) {
+    chip8 expected = start;
+    chip8 actual = start;
+    cache::block_cache c;
+    cache::init(c);
+
+    for (auto s = 0u; s < slices; ++s) {
+        dispatch::run(expected, 7u);
+        cache::run(c, actual, 7u);
+        ASSERT(actual == expected, "The cached interpreter agrees with dispatch")
+    }
+}
+
+void test_cache_matches_dispatch() {
+    chip8 cpu;
+    load_program(cpu, {
+        0x6000u, // 200: LD v0, 0
+        0x6101u, // 202: LD v1, 1
+        0x7001u, // 204: ADD v0, 1
+        0x8014u, // 206: ADD v0, v1
+        0x8102u, // 208: AND v1, v0
+        0x3000u, // 20A: SE v0, 0
+        0x2210u, // 20C: CALL 210
+        0x1204u, // 20E: JP 204
+        0xA050u, // 210: LD I, 0x50
+        0xD125u, // 212: DRW v1, v2, 5
+        0x00EEu, // 214: RET
+    });
+    check_against_dispatch(cpu, 200u);
+}
+
+void test_cache_self_modifying_fx55() {
+    chip8 cpu;
+    load_program(cpu, {
+        0x6073u, // 200: LD v0, 0x73
+        0x6101u, // 202: LD v1, 0x01
+        0x1208u, // 204: JP 208
+        0x0000u, // 206:
+        0x6305u, // 208: LD v3, 5      <- becomes ADD v3, 1
+        0x7201u, // 20A: ADD v2, 1
+        0xA208u, // 20C: LD I, 0x208
+        0xF155u, // 20E: LD [I], v0..v1
+        0x1208u, // 210: JP 208
+    });
+    check_against_dispatch(cpu, 20u);
+
+    chip8 actual = cpu;
+    cache::block_cache c;
+    cache::init(c);
+    cache::run(c, actual, 3u + 5u * 10u);
+    ASSERT(actual.v[3u] == 14u, "The patched instruction ran after the first pass")
+}
+
+void test_cache_self_modifying_fx33() {
+    chip8 cpu;
+    load_program(cpu, {
+        0x607Bu, // 200: LD v0, 123
+        0x7201u, // 202: ADD v2, 1
+        0xA20Au, // 204: LD I, 0x20A
+        0xF033u, // 206: LD B, v0
+        0x1202u, // 208: JP 202
+        0x1202u, // 20A: JP 202       <- becomes SYS 102
+    });
+    check_against_dispatch(cpu, 10u);
+}
+
+void test_cache_invalidate() {
+    chip8 cpu;
+    load_program(cpu, {
+        0x7101u, // 200: ADD v1, 1
+        0x1200u, // 202: JP 200
+    });
+    cache::block_cache c;
+    cache::init(c);
+    cache::run(c, cpu, 4u);
+    ASSERT(cpu.v[1u] == 2u, "The loop ran twice")
+
+    // Patch from outside the interpreter
+    cpu.mem[0x201u] = 0x02u;
+    cache::invalidate(c, 0x201u, 1u);
+    cache::run(c, cpu, 2u);
+    ASSERT(cpu.v[1u] == 4u, "The patched add is picked up")
+}
+
+void run_block_cache_tests() {
+    test_cache_matches_dispatch();
+    test_cache_self_modifying_fx55();
+    test_cache_self_modifying_fx33();
+    test_cache_invalidate();
+}
+
+} // namespace test
@@ -0,0 +1,148 @@
+#include "unittest.h"
+
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "capture.h"
+#include "chip8.h"
+
+using namespace chipp8;
+
+namespace test {
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+// A session of frames where the picture changes every `hold` frames
+static std::vector<display> session(uint32_t count, uint32_t hold) {
+    std::vector<display> frames(count);
+    display pixels{};
+    for (auto f = 0u; f < count; ++f) {
+        if (f % hold == 0u) {
+            const auto y = (f / hold * 7u) % DISPLAY_HEIGHT;
+            pixels[y] ^= std::rotr(0xF0F0ull << 48u, f / hold);
+        }
+        frames[f] = pixels;
+    }
+    return frames;
+}
+
+void test_capture_anim_round_trip() {
+    const auto path = temp_path("chipp8_capture_test.c8a");
+    const auto frames = session(1'000u, 10u);
+    capture::writer w;
+    ASSERT(capture::open(w, capture::format::anim, path.c_str(), 4u), "Opened")
+    for (const auto& pixels: frames) {
+        capture::frame(w, pixels);
+    }
+    ASSERT(capture::close(w), "Closed")
+    ASSERT(w.frames == 1'000u && w.distinct == 100u, "Repeats are not handed over")
+
+    const auto data = read_file(path);
+    std::vector<capture::entry> entries;
+    ASSERT(capture::decode_anim(data.data(), data.size(), entries), "Decodes")
+    ASSERT(entries.size() == 100u, "One entry per distinct frame")
+    size_t f = 0u;
+    for (const auto& e: entries) {
+        ASSERT(e.frames == 10u && e.pixels == frames[f], "Each picture for as long as it was shown")
+        f += e.frames;
+    }
+    ASSERT(data.size() < 100u * 16u, "A few bytes a change")
+
+    ASSERT(!capture::decode_anim(data.data(), data.size() - 1u, entries), "Cut short")
+    std::filesystem::remove(path);
+}
+
+void test_capture_anim_dense_frames() {
+    // Every byte changing, and alternating bytes, still round trip
+    std::vector<uint8_t> out = capture::anim_header();
+    display previous{};
+    display a;
+    display b;
+    a.fill(~0ull);
+    b.fill(0x00FF00FF00FF00FFull);
+    capture::encode_entry(out, previous, a, 1u);
+    capture::encode_entry(out, a, b, 2u);
+    capture::encode_entry(out, b, b, 3u);
+    std::vector<capture::entry> entries;
+    ASSERT(capture::decode_anim(out.data(), out.size(), entries) && entries.size() == 3u, "Decodes")
+    ASSERT(entries[0u].pixels == a && entries[1u].pixels == b && entries[2u].pixels == b, "Same frames")
+    ASSERT(entries[2u].frames == 3u, "Same durations")
+}
+
+void test_capture_y4m() {
+    const auto path = temp_path("chipp8_capture_test.y4m");
+    const auto frames = session(90u, 30u);
+    capture::writer w;
+    ASSERT(capture::open(w, capture::format::y4m, path.c_str()), "Opened")
+    for (const auto& pixels: frames) {
+        capture::frame(w, pixels);
+    }
+    ASSERT(capture::close(w), "Closed")
+
+    const auto data = read_file(path);
+    const std::string header = "YUV4MPEG2 W64 H32 F60:1 Ip A1:1 Cmono\n";
+    ASSERT(std::string(data.begin(), data.begin() + header.size()) == header, "Header")
+    constexpr size_t FRAME = 6u + DISPLAY_WIDTH * DISPLAY_HEIGHT;
+    ASSERT(data.size() == header.size() + 90u * FRAME, "Every frame, repeats included")
+    for (auto f = 0u; f < 90u; ++f) {
+        const auto* luma = data.data() + header.size() + f * FRAME + 6u;
+        bool same = true;
+        for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+            for (auto x = 0u; x < DISPLAY_WIDTH; ++x) {
+                const bool on = (frames[f][y] >> (63u - x)) & 1u;
+                same = same && luma[y * DISPLAY_WIDTH + x] == (on ? 255u : 0u);
+            }
+        }
+        ASSERT(same, "Frame pixels")
+    }
+    std::filesystem::remove(path);
+}
+
+void test_capture_pbm() {
+    const auto dir = temp_path("chipp8_capture_test_pbm");
+    std::filesystem::create_directories(dir);
+    const auto prefix = dir + "/frame_";
+    const auto frames = session(50u, 20u);
+    capture::writer w;
+    ASSERT(capture::open(w, capture::format::pbm, prefix.c_str()), "Opened")
+    for (const auto& pixels: frames) {
+        capture::frame(w, pixels);
+    }
+    ASSERT(capture::close(w), "Closed")
+
+    ASSERT(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) == 3, "One file per picture")
+    for (const auto f: {0u, 20u, 40u}) {
+        char name[16];
+        snprintf(name, sizeof(name), "%08u.pbm", f);
+        const auto data = read_file(prefix + name);
+        const auto bytes = capture::to_bytes(frames[f]);
+        ASSERT(data.size() == 9u + bytes.size(), "P4 header and rows")
+        ASSERT(std::equal(bytes.begin(), bytes.end(), data.begin() + 9u), "Named by the frame it appeared at")
+    }
+    std::filesystem::remove_all(dir);
+
+    ASSERT(capture::open(w, capture::format::pbm, (dir + "/missing/frame_").c_str()), "Nothing to open up front")
+    capture::frame(w, frames[0u]);
+    ASSERT(!capture::close(w), "The write fails")
+    ASSERT(!capture::open(w, capture::format::anim, (dir + "/missing.c8a").c_str()), "Unwritable")
+}
+
+void run_capture_tests() {
+    test_capture_anim_round_trip();
+    test_capture_anim_dense_frames();
+    test_capture_y4m();
+    test_capture_pbm();
+}
+
+} // namespace test
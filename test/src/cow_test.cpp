@@ -0,0 +1,166 @@
+#include "unittest.h"
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "chip8.h"
+#include "cow.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Writes v0 and its digits to 0x600 + v0, one page away from the code
+static void load_writer(chip8& cpu) {
+    load_program(cpu, {
+        0x7007u, // 200: ADD v0, 7
+        0xA600u, // 202: LD I, 0x600
+        0xF01Eu, // 204: ADD I, v0
+        0xF033u, // 206: LD B, v0
+        0xF255u, // 208: LD [I], v0..v2
+        0xF029u, // 20A: LD F, v0
+        0xD015u, // 20C: DRW v0, v1, 5
+        0x1200u, // 20E: JP 200
+    });
+}
+
+void test_cow_matches_dispatch() {
+    auto expected = std::make_unique<chip8>();
+    load_writer(*expected);
+    cow::machine m;
+    cow::load(m, *expected);
+
+    auto actual = std::make_unique<chip8>();
+    for (auto s = 0u; s < 20u; ++s) {
+        dispatch::run(*expected, 13u);
+        cow::run(m, 13u);
+        cow::store(m, *actual);
+        ASSERT(*actual == *expected, "A cow machine runs like a chip8")
+    }
+}
+
+void test_cow_fork_copies_on_write() {
+    auto cpu = std::make_unique<chip8>();
+    load_writer(*cpu);
+    cow::machine root;
+    cow::load(root, *cpu);
+
+    auto child = cow::fork(root);
+    ASSERT(cow::private_pages(child) == 0u, "A fresh fork shares every page")
+
+    cow::run(child, 4u);
+    ASSERT(cow::private_pages(child) == 1u, "FX33 copied the page it wrote")
+    ASSERT(root.mem[0x607u] == 0u, "The parent does not see the write")
+    ASSERT(child.mem[0x607u] == 0u && child.mem[0x608u] == 0u && child.mem[0x609u] == 7u, "The child does")
+
+    // Same run on a plain copy
+    dispatch::run(*cpu, 4u);
+    auto stored = std::make_unique<chip8>();
+    cow::store(child, *stored);
+    ASSERT(*stored == *cpu, "A fork runs like a copy")
+    cow::store(root, *stored);
+    load_writer(*cpu);
+    ASSERT(*stored == *cpu, "The parent is untouched")
+}
+
+// Workers fork from one shared root concurrently
+void test_cow_parallel_forks() {
+    auto start = std::make_unique<chip8>();
+    load_writer(*start);
+    cow::machine root;
+    cow::load(root, *start);
+
+    auto expected = std::make_unique<chip8>(*start);
+    dispatch::run(*expected, 40u);
+
+    constexpr auto workers = 4u;
+    std::vector<int> ok(workers, 1);
+    std::vector<std::thread> pool;
+    for (auto w = 0u; w < workers; ++w) {
+        pool.emplace_back([&, w] {
+            chip8 out;
+            for (auto k = 0u; k < 200u; ++k) {
+                auto child = cow::fork(root);
+                cow::run(child, 40u);
+                cow::store(child, out);
+                ok[w] &= (out == *expected) ? 1 : 0;
+            }
+        });
+    }
+    for (auto& t: pool) {
+        t.join();
+    }
+    for (const auto flag: ok) {
+        ASSERT(flag == 1, "Every child agrees with the reference")
+    }
+    cow::store(root, *expected);
+    ASSERT(*expected == *start, "The root is untouched")
+    ASSERT(cow::private_pages(root) == cow::PAGE_COUNT, "All the children let go of the root pages")
+}
+
+// Siblings read a page and let go of it while another one keeps writing to
+// it, in place once it is the last holder
+void test_cow_threads() {
+    auto start = std::make_unique<chip8>();
+    load_program(*start, {
+        0xA600u, // 200: LD I, 0x600
+        0x7001u, // 202: ADD v0, 1
+        0xF355u, // 204: LD [I], v0..v3
+        0x1202u, // 206: JP 202
+    });
+    uint32_t pattern = 0u;
+    for (auto addr = 0x600u; addr < 0x800u; ++addr) {
+        start->mem[addr] = static_cast<uint8_t>(addr * 37u);
+        pattern += start->mem[addr];
+    }
+    auto expected = std::make_unique<chip8>(*start);
+    dispatch::run(*expected, 1000u);
+
+    constexpr auto readers = 4u;
+    auto stored = std::make_unique<chip8>();
+    for (auto round = 0u; round < 50u; ++round) {
+        cow::machine root;
+        cow::load(root, *start);
+        std::vector<cow::machine> children(readers, cow::fork(root));
+        auto writer = cow::fork(root);
+        root = cow::machine{};
+
+        std::vector<int> ok(readers, 1);
+        std::vector<std::thread> pool;
+        for (auto w = 0u; w < readers; ++w) {
+            pool.emplace_back([&, w] {
+                for (auto pass = 0u; pass < 8u; ++pass) {
+                    uint32_t sum = 0u;
+                    for (auto addr = 0x600u; addr < 0x800u; ++addr) {
+                        sum += std::as_const(children[w].mem)[addr];
+                    }
+                    ok[w] &= (sum == pattern) ? 1 : 0;
+                }
+                children[w] = cow::machine{};
+            });
+        }
+        cow::run(writer, 1000u);
+        for (auto& t: pool) {
+            t.join();
+        }
+
+        for (const auto flag: ok) {
+            ASSERT(flag == 1, "Readers never see the writer's stores")
+        }
+        cow::store(writer, *stored);
+        ASSERT(*stored == *expected, "The writer runs like a chip8")
+        ASSERT(cow::private_pages(writer) == cow::PAGE_COUNT, "The writer is the last holder of every page")
+    }
+}
+
+void run_cow_tests() {
+    test_cow_matches_dispatch();
+    test_cow_fork_copies_on_write();
+    test_cow_parallel_forks();
+    test_cow_threads();
+}
+
+} // namespace test
@@ -0,0 +1,127 @@
+#include "unittest.h"
+
+#include "chip8.h"
+#include "debug.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Counts v0 up, storing it at 0x300 and drawing digit 0 every time round
+static void load_counter(chip8& cpu) {
+    load_program(cpu, {
+        0x7001u, // 200: ADD v0, 1
+        0xA300u, // 202: LD I, 0x300
+        0xF055u, // 204: LD [I], v0
+        0xA050u, // 206: LD I, 0x50
+        0xD115u, // 208: DRW v1, v1, 5
+        0x1200u, // 20A: JP 200
+    });
+}
+
+void test_debug_breakpoints() {
+    chip8 cpu;
+    load_counter(cpu);
+    debug::debugger dbg;
+    debug::init(dbg);
+    ASSERT(!debug::armed(dbg), "Nothing armed yet")
+
+    debug::set_breakpoint(dbg, 0x206u);
+    auto h = debug::run(dbg, cpu, 100u);
+    ASSERT(h.reason == debug::stop::breakpoint && h.pc == 0x206u && h.executed == 3u, "Stops before 206")
+    ASSERT(cpu.pc == 0x206u && cpu.v[0u] == 1u, "with 206 not run yet")
+
+    // Continuing runs the instruction it stopped on, then stops there again
+    h = debug::run(dbg, cpu, 100u);
+    ASSERT(h.reason == debug::stop::breakpoint && h.executed == 6u && cpu.v[0u] == 2u, "Once round the loop")
+
+    debug::clear_breakpoint(dbg, 0x206u);
+    ASSERT(!debug::armed(dbg), "Cleared")
+    h = debug::run(dbg, cpu, 60u);
+    ASSERT(h.reason == debug::stop::none && h.executed == 60u && cpu.v[0u] == 12u, "Runs out the cycles")
+
+    // Setting the same breakpoint twice still takes one clear
+    debug::set_breakpoint(dbg, 0x200u);
+    debug::set_breakpoint(dbg, 0x200u);
+    debug::clear_breakpoint(dbg, 0x200u);
+    ASSERT(!debug::armed(dbg) && dbg.exec_count == 0u, "Counted once")
+}
+
+void test_debug_conditions() {
+    chip8 cpu;
+    load_counter(cpu);
+    debug::debugger dbg;
+    debug::init(dbg);
+    debug::set_condition(dbg, 0x204u, 0u, debug::compare::eq, 5u);
+    auto h = debug::run(dbg, cpu, 1'000u);
+    ASSERT(h.reason == debug::stop::condition && h.pc == 0x204u && cpu.v[0u] == 5u, "Stops once v0 reaches 5")
+
+    debug::set_condition(dbg, 0x204u, 0u, debug::compare::ge, 9u);
+    h = debug::run(dbg, cpu, 1'000u);
+    ASSERT(h.reason == debug::stop::condition && cpu.v[0u] == 9u, "Either condition stops it")
+
+    // A plain breakpoint elsewhere does not make the conditional one stop
+    debug::clear_breakpoint(dbg, 0x204u);
+    debug::set_condition(dbg, 0x200u, 0u, debug::compare::lt, 3u);
+    h = debug::run(dbg, cpu, 200u);
+    ASSERT(h.reason == debug::stop::none, "v0 is never below 3 again")
+}
+
+void test_debug_watchpoints() {
+    chip8 cpu;
+    load_counter(cpu);
+    debug::debugger dbg;
+    debug::init(dbg);
+
+    debug::watch(dbg, 0x300u, 1u, false, true);
+    auto h = debug::run(dbg, cpu, 100u);
+    ASSERT(h.reason == debug::stop::write && h.pc == 0x204u && h.addr == 0x300u, "FX55 writes 0x300")
+    ASSERT(cpu.mem[0x300u] == 0u, "before it is written")
+
+    // A read watch in the middle of the font digit DRW reads
+    debug::unwatch(dbg, 0x300u, 1u);
+    debug::watch(dbg, 0x52u, 2u, true, false);
+    h = debug::run(dbg, cpu, 100u);
+    ASSERT(h.reason == debug::stop::read && h.pc == 0x208u && h.addr == 0x52u, "DRW reads 0x52")
+    ASSERT(cpu.mem[0x300u] == 1u, "The store went through")
+
+    // The write watch does not see reads
+    debug::unwatch(dbg, 0x52u, 2u);
+    debug::watch(dbg, 0x50u, 5u, false, true);
+    h = debug::run(dbg, cpu, 100u);
+    ASSERT(h.reason == debug::stop::none, "Only reads of the digit")
+
+    // A range crossing a bitmap word
+    debug::watch(dbg, 0x33Eu, 4u, true, true);
+    cpu.i = 0x33Cu;
+    ASSERT(debug::first_in(dbg.reads, cpu.i, 16u) == 2u, "First watched byte of the range")
+    ASSERT(debug::first_in(dbg.reads, 0x342u, 16u) == 16u, "None past it")
+}
+
+void test_debug_unarmed_matches_dispatch() {
+    chip8 expected;
+    load_counter(expected);
+    chip8 cpu = expected;
+    debug::debugger dbg;
+    debug::init(dbg);
+    dispatch::run(expected, 5'000u);
+    debug::run(dbg, cpu, 5'000u);
+    ASSERT(cpu == expected, "Unarmed it is dispatch::run")
+
+    // Armed with nothing ever hit it still runs the same
+    debug::set_breakpoint(dbg, 0x800u);
+    debug::watch(dbg, 0x900u, 16u, true, true);
+    dispatch::run(expected, 5'000u);
+    debug::run(dbg, cpu, 5'000u);
+    ASSERT(cpu == expected, "Armed it runs the same")
+}
+
+void run_debug_tests() {
+    test_debug_breakpoints();
+    test_debug_conditions();
+    test_debug_watchpoints();
+    test_debug_unarmed_matches_dispatch();
+}
+
+} // namespace test
@@ -0,0 +1,333 @@
+#include <initializer_list>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "block_cache.h"
+#include "chip8.h"
+#include "dispatch.h"
+#include "jit.h"
+#include "quirks.h"
+#include "rom.h"
+
+/* Differential test
+
+   Runs the same programs through dispatch::run (the reference), the cached
+   interpreter and the recompiler, in uneven slices, and fails on the first
+   slice where the chip8 states differ in any field. The ROMs translated
+   ahead of time are checked the same way against dispatch::run of their
+   quirks profile.
+*/
+
+using namespace chipp8;
+
+// Translated by the aot tool at build time, see test/CMakeLists.txt
+namespace chipp8::aot_calls { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_alu { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_patch { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_bcd { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_table { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_vip { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_schip { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_random0 { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_random1 { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_random2 { void run(chip8& cpu, uint64_t cycles); }
+namespace chipp8::aot_random3 { void run(chip8& cpu, uint64_t cycles); }
+
+namespace {
+
+struct rng {
+    uint64_t s;
+
+    uint32_t next() {
+        s ^= s << 13u;
+        s ^= s >> 7u;
+        s ^= s << 17u;
+        return static_cast<uint32_t>(s >> 11u);
+    }
+
+    uint32_t below(uint32_t n) { return next() % n; }
+};
+
+constexpr const uint16_t RANDOM_CODE_ADDR = 0x0E00u;
+constexpr const uint16_t RANDOM_CODE_LEN = 64u;
+
+// Programs are kept free of the opcodes whose reference behaviour indexes
+// out of bounds for arbitrary operands (stack over/underflow, FX1E walking
+// I off the end of mem, SKP with vX > 15, jumps out of the program)
+uint16_t random_instruction(rng& r) {
+    const uint16_t x = static_cast<uint16_t>(r.below(16u) << 8u);
+    const uint16_t y = static_cast<uint16_t>(r.below(16u) << 4u);
+    const uint16_t nn = static_cast<uint16_t>(r.below(256u));
+    const uint16_t target = static_cast<uint16_t>(RANDOM_CODE_ADDR + r.below(RANDOM_CODE_LEN) * 2u);
+    switch (r.below(20u)) {
+        case 0u:  return 0x00E0u;
+        case 1u:  return static_cast<uint16_t>(0x1000u | target);
+        case 2u:  return static_cast<uint16_t>(0x3000u | x | nn);
+        case 3u:  return static_cast<uint16_t>(0x4000u | x | nn);
+        case 4u:  return static_cast<uint16_t>(0x5000u | x | y);
+        case 5u:  return static_cast<uint16_t>(0x6000u | x | nn);
+        case 6u:  return static_cast<uint16_t>(0x7000u | x | nn);
+        case 7u:
+        case 8u:
+        case 9u: {
+            constexpr uint16_t alu[] = {0x0u, 0x1u, 0x2u, 0x3u, 0x4u, 0x5u, 0x6u, 0x7u, 0xEu, 0x8u};
+            return static_cast<uint16_t>(0x8000u | x | y | alu[r.below(10u)]);
+        }
+        case 10u: return static_cast<uint16_t>(0x9000u | x | y);
+        case 11u: return static_cast<uint16_t>(0xA000u | (0x0200u + r.below(0x0B00u)));
+        case 12u: return static_cast<uint16_t>(0xC000u | x | nn);
+        case 13u: return static_cast<uint16_t>(0xD000u | x | y | r.below(16u));
+        case 14u: {
+            constexpr uint16_t fx[] = {0x07u, 0x0Au, 0x15u, 0x18u, 0x29u, 0x33u, 0x55u, 0x65u};
+            return static_cast<uint16_t>(0xF000u | x | fx[r.below(8u)]);
+        }
+        default: {
+            // Bias towards the plain ALU ops that make up most real code
+            return static_cast<uint16_t>(0x7000u | x | nn);
+        }
+    }
+}
+
+void load(chip8& cpu, uint16_t addr, std::initializer_list<uint16_t> words) {
+    for (const auto word: words) {
+        cpu.mem[addr++] = static_cast<uint8_t>(word >> 8u);
+        cpu.mem[addr++] = static_cast<uint8_t>(word & 0x00FFu);
+    }
+}
+
+bool compare(const char* name, const chip8& start, uint64_t slices, uint64_t seed) {
+    chip8 expected = start;
+    chip8 cached = start;
+    chip8 native = start;
+
+    cache::block_cache c;
+    cache::init(c);
+    jit::code_cache j;
+    if (!jit::init(j)) {
+        printf("%s: could not map code memory\n", name);
+        return false;
+    }
+
+    rng r{seed | 1u};
+    for (uint64_t s = 0u; s < slices; ++s) {
+        const auto cycles = 1u + r.below(97u);
+        dispatch::run(expected, cycles);
+        cache::run(c, cached, cycles);
+        jit::run(j, native, cycles);
+        if (!(cached == expected) || !(native == expected)) {
+            printf("%s: diverged in slice %llu (pc %03X, cache %03X, jit %03X)\n",
+                name, static_cast<unsigned long long>(s), expected.pc, cached.pc, native.pc);
+            return false;
+        }
+        // Let WAIT_KP loops make progress now and then
+        expected.keys = cached.keys = native.keys = static_cast<uint16_t>(r.below(4u) == 0u ? r.next() : 0u);
+    }
+    return true;
+}
+
+chip8 blank() {
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+    return cpu;
+}
+
+bool run_random(unsigned programs) {
+    for (auto p = 0u; p < programs; ++p) {
+        rng r{0x9E3779B97F4A7C15ull * (p + 1u)};
+        chip8 cpu = blank();
+        for (auto k = 0u; k < RANDOM_CODE_LEN - 1u; ++k) {
+            const auto word = random_instruction(r);
+            load(cpu, static_cast<uint16_t>(RANDOM_CODE_ADDR + k * 2u), {word});
+        }
+        load(cpu, static_cast<uint16_t>(RANDOM_CODE_ADDR + (RANDOM_CODE_LEN - 1u) * 2u), {0x1E00u});
+        for (auto x = 0u; x < 16u; ++x) {
+            cpu.v[x] = static_cast<uint8_t>(r.next());
+        }
+        cpu.i = 0x0300u;
+        cpu.pc = RANDOM_CODE_ADDR;
+
+        char name[32];
+        snprintf(name, sizeof(name), "random program %u", p);
+        if (!compare(name, cpu, 200u, p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool run_crafted() {
+    bool ok = true;
+
+    // Calls, returns, key skips, font lookups and I arithmetic
+    chip8 calls = blank();
+    load(calls, PROGRAM_START_ADDR, {
+        0x6005u, // 200: LD v0, 5
+        0x2210u, // 202: CALL 210
+        0x7001u, // 204: ADD v0, 1
+        0xE09Eu, // 206: SKP v0
+        0xE0A1u, // 208: SKNP v0
+        0x400Fu, // 20A: SNE v0, 15
+        0x6000u, // 20C: LD v0, 0
+        0x1202u, // 20E: JP 202
+        0xF029u, // 210: LD F, v0
+        0xF01Eu, // 212: ADD I, v0
+        0xD015u, // 214: DRW v0, v1, 5
+        0x8F06u, // 216: SHR vF
+        0x8FFEu, // 218: SHL vF
+        0x8F05u, // 21A: SUB vF, v0
+        0x80F7u, // 21C: SUBN v0, vF
+        0x00EEu, // 21E: RET
+    });
+    calls.pc = PROGRAM_START_ADDR;
+    ok = compare("calls", calls, 500u, 1u) && ok;
+
+    // FX55 rewriting the block it jumps back into
+    chip8 patch = blank();
+    load(patch, PROGRAM_START_ADDR, {
+        0x6073u, // 200: LD v0, 0x73
+        0x6101u, // 202: LD v1, 0x01
+        0x1208u, // 204: JP 208
+        0x0000u, // 206:
+        0x6305u, // 208: LD v3, 5      <- becomes ADD v3, 1
+        0x7201u, // 20A: ADD v2, 1
+        0xA208u, // 20C: LD I, 0x208
+        0xF155u, // 20E: LD [I], v0..v1
+        0x1208u, // 210: JP 208
+    });
+    patch.pc = PROGRAM_START_ADDR;
+    ok = compare("fx55 patch", patch, 200u, 2u) && ok;
+
+    // FX33 rewriting a jump into SYS 102, which then falls into zeroed mem
+    chip8 bcd = blank();
+    load(bcd, PROGRAM_START_ADDR, {
+        0x607Bu, // 200: LD v0, 123
+        0x7201u, // 202: ADD v2, 1
+        0xA20Au, // 204: LD I, 0x20A
+        0xF033u, // 206: LD B, v0
+        0x1202u, // 208: JP 202
+        0x1202u, // 20A: JP 202       <- becomes SYS 102
+    });
+    bcd.pc = PROGRAM_START_ADDR;
+    ok = compare("fx33 patch", bcd, 50u, 3u) && ok;
+
+    // A block longer than MAX_BLOCK_LEN, then wait for a key
+    chip8 longer = blank();
+    for (auto k = 0u; k < 40u; ++k) {
+        load(longer, static_cast<uint16_t>(PROGRAM_START_ADDR + k * 2u), {static_cast<uint16_t>(0x7000u | ((k % 16u) << 8u) | k)});
+    }
+    load(longer, static_cast<uint16_t>(PROGRAM_START_ADDR + 80u), {0xF50Au, 0x1200u});
+    longer.pc = PROGRAM_START_ADDR;
+    ok = compare("long block", longer, 200u, 4u) && ok;
+
+    return ok;
+}
+
+#if CHIPP8_JIT_NATIVE
+// The largest block there is, every POOL register live and a handler call
+// for most ops, compiled in the last MAX_BLOCK_CODE bytes of the buffer
+bool run_code_buffer_end() {
+    chip8 cpu = blank();
+    for (auto k = 0u; k < 8u; ++k) {
+        // ADD vK, vK+1
+        load(cpu, static_cast<uint16_t>(PROGRAM_START_ADDR + k * 2u), {static_cast<uint16_t>(0x8004u | (k << 8u) | ((k + 1u) << 4u))});
+    }
+    for (auto k = 8u; k < cache::MAX_BLOCK_LEN; ++k) {
+        load(cpu, static_cast<uint16_t>(PROGRAM_START_ADDR + k * 2u), {0xD015u});
+    }
+    load(cpu, static_cast<uint16_t>(PROGRAM_START_ADDR + cache::MAX_BLOCK_LEN * 2u), {0x1200u});
+    cpu.pc = PROGRAM_START_ADDR;
+
+    jit::code_cache j;
+    if (!jit::init(j)) {
+        printf("code buffer end: could not map code memory\n");
+        return false;
+    }
+    const auto start = jit::CODE_BUFFER_SIZE - jit::MAX_BLOCK_CODE;
+    j.code_used = start;
+    const auto& b = jit::compile(j, cpu, PROGRAM_START_ADDR);
+    const auto size = j.code_used - start;
+    if (b.len != cache::MAX_BLOCK_LEN || size > jit::MAX_BLOCK_CODE) {
+        printf("code buffer end: %zu bytes for %u ops, the bound is %zu\n", size, b.len, jit::MAX_BLOCK_CODE);
+        return false;
+    }
+
+    chip8 expected = cpu;
+    dispatch::run(expected, 1'000u);
+    jit::run(j, cpu, 1'000u);
+    if (!(cpu == expected)) {
+        printf("code buffer end: diverged (pc %03X, jit %03X)\n", expected.pc, cpu.pc);
+        return false;
+    }
+    return true;
+}
+#else
+bool run_code_buffer_end() {
+    return true;
+}
+#endif
+
+using run_fn = void (*)(chip8&, uint64_t);
+
+struct aot_program {
+    const char* name;
+    run_fn reference;
+    run_fn compiled;
+};
+
+const aot_program AOT_PROGRAMS[] = {
+    {"calls", dispatch::run<quirks::modern>, aot_calls::run},
+    {"alu", dispatch::run<quirks::modern>, aot_alu::run},
+    {"patch", dispatch::run<quirks::modern>, aot_patch::run},
+    {"bcd", dispatch::run<quirks::modern>, aot_bcd::run},
+    {"table", dispatch::run<quirks::modern>, aot_table::run},
+    {"vip", dispatch::run<quirks::cosmac_vip>, aot_vip::run},
+    {"schip", dispatch::run<quirks::super_chip>, aot_schip::run},
+    {"random0", dispatch::run<quirks::modern>, aot_random0::run},
+    {"random1", dispatch::run<quirks::modern>, aot_random1::run},
+    {"random2", dispatch::run<quirks::modern>, aot_random2::run},
+    {"random3", dispatch::run<quirks::modern>, aot_random3::run},
+};
+
+bool compare_aot(const aot_program& p, uint64_t slices, uint64_t seed) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.ch8", AOT_DIR, p.name);
+    chip8 expected;
+    if (rom::load_file(expected, path) != rom::status::ok) {
+        printf("aot %s: could not load %s\n", p.name, path);
+        return false;
+    }
+    chip8 compiled = expected;
+
+    rng r{seed | 1u};
+    for (uint64_t s = 0u; s < slices; ++s) {
+        // Mostly frame sized slices, with a long one now and then
+        const auto cycles = r.below(16u) == 0u ? 1u + r.below(5'000u) : r.below(97u);
+        p.reference(expected, cycles);
+        p.compiled(compiled, cycles);
+        if (!(compiled == expected)) {
+            printf("aot %s: diverged in slice %llu (pc %03X, aot %03X)\n",
+                p.name, static_cast<unsigned long long>(s), expected.pc, compiled.pc);
+            return false;
+        }
+        expected.keys = compiled.keys = static_cast<uint16_t>(r.below(4u) == 0u ? r.next() : 0u);
+    }
+    return true;
+}
+
+bool run_aot() {
+    bool ok = true;
+    auto seed = 1u;
+    for (const auto& p: AOT_PROGRAMS) {
+        ok = compare_aot(p, 2'000u, seed++) && ok;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    const bool ok = run_crafted() && run_code_buffer_end() && run_random(500u) && run_aot();
+    printf("difftest: %s (native backend %s)\n", ok ? "pass" : "FAIL", CHIPP8_JIT_NATIVE ? "on" : "off");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include "unittest.h"
+
+#include "chip8.h"
+#include "dispatch.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Every instruction word must leave the cpu in the same state whether it
+// goes through parse_op or the decode table
+void test_dispatch_matches_parse_op() {
+    chip8 base;
+    init(base);
+    load_font_sprites(base);
+    for (auto r = 0u; r < 16u; ++r) {
+        base.v[r] = static_cast<uint8_t>(r * 17u + 3u);
+    }
+    base.i = 0x0300u;
+    base.pc = 0x0400u;
+    base.sp = 2u;
+    base.stack[2u] = 0x0222u;
+    base.d_timer = 7u;
+    base.keys = 0x0010u;
+
+    for (auto instruct = 0u; instruct <= 0xFFFFu; ++instruct) {
+        chip8 expected = base;
+        parse_op(expected, static_cast<uint16_t>(instruct));
+
+        chip8 actual = base;
+        dispatch::execute(actual, dispatch::DECODE_TABLE[instruct]);
+
+        ASSERT(actual == expected, "The decode table agrees with parse_op")
+    }
+}
+
+void test_dispatch_step() {
+    chip8 cpu;
+    init(cpu);
+    cpu.pc = PROGRAM_START_ADDR;
+    cpu.mem[0x200u] = 0x61u; cpu.mem[0x201u] = 0x05u; // LD v1, 5
+    cpu.mem[0x202u] = 0x71u; cpu.mem[0x203u] = 0x03u; // ADD v1, 3
+    cpu.mem[0x204u] = 0x12u; cpu.mem[0x205u] = 0x02u; // JP 202
+
+    dispatch::step(cpu);
+    ASSERT(cpu.v[1u] == 5u, "v1 is loaded")
+    ASSERT(cpu.pc == 0x202u, "The pc moved past the instruction")
+
+    dispatch::run(cpu, 5u);
+    ASSERT(cpu.v[1u] == 14u, "v1 was added to three times")
+    ASSERT(cpu.pc == 0x204u, "The pc is on the jump")
+}
+
+void run_dispatch_tests() {
+    test_dispatch_matches_parse_op();
+    test_dispatch_step();
+}
+
+} // namespace test
@@ -0,0 +1,105 @@
+#include "unittest.h"
+
+#include <initializer_list>
+#include <vector>
+
+#include "chip8.h"
+#include "fleet.h"
+
+using namespace chipp8;
+
+namespace test {
+
+static std::vector<uint8_t> rom(std::initializer_list<uint16_t> words) {
+    std::vector<uint8_t> bytes;
+    for (const auto word: words) {
+        bytes.push_back(static_cast<uint8_t>(word >> 8u));
+        bytes.push_back(static_cast<uint8_t>(word & 0x00FFu));
+    }
+    return bytes;
+}
+
+void test_tick_timers() {
+    chip8 cpu;
+    init(cpu);
+    cpu.d_timer = 2u;
+    cpu.s_timer = 1u;
+    tick_timers(cpu);
+    ASSERT(cpu.d_timer == 1u && cpu.s_timer == 0u, "Both timers count down")
+    tick_timers(cpu);
+    ASSERT(cpu.d_timer == 0u && cpu.s_timer == 0u, "Timers stop at 0")
+}
+
+// Sessions of very different lengths and inputs must come out of the pool
+// exactly as they do run one by one
+void test_fleet_matches_sequential() {
+    // Draws the font glyph of the key held down, moving one column per
+    // delay timer expiry
+    const auto keys_rom = rom({
+        0x6300u, // 200: LD v3, 0
+        0xF007u, // 202: LD v0, DT
+        0x3000u, // 204: SE v0, 0
+        0x1202u, // 206: JP 202
+        0x6405u, // 208: LD v4, 5
+        0xF415u, // 20A: LD DT, v4
+        0xE39Eu, // 20C: SKP v3
+        0x1214u, // 20E: JP 214
+        0xF329u, // 210: LD F, v3
+        0xD155u, // 212: DRW v1, v5, 5
+        0x7101u, // 214: ADD v1, 1
+        0x7301u, // 216: ADD v3, 1
+        0x430Fu, // 218: SNE v3, 15
+        0x6300u, // 21A: LD v3, 0
+        0x1202u, // 21C: JP 202
+    });
+    const auto spin_rom = rom({
+        0x7001u, // 200: ADD v0, 1
+        0xA050u, // 202: LD I, 0x50
+        0xD015u, // 204: DRW v0, v1, 5
+        0x1200u, // 206: JP 200
+    });
+
+    std::vector<fleet::session> sessions;
+    for (auto k = 0u; k < 23u; ++k) {
+        fleet::session s{(k % 3u == 0u) ? spin_rom : keys_rom, {}, 10u + 37u * k};
+        for (auto f = 0u; f < s.frames; f += 11u + k) {
+            s.input.push_back({f, static_cast<uint16_t>(1u << ((f + k) % 16u))});
+        }
+        sessions.push_back(s);
+    }
+
+    auto cfg = fleet::default_config();
+    cfg.threads = 3u;
+    cfg.slice_frames = 7u;
+    const auto results = fleet::run(sessions, cfg);
+
+    ASSERT(results.size() == sessions.size(), "One result per session")
+    for (auto k = 0u; k < sessions.size(); ++k) {
+        const auto expected = fleet::run_session(sessions[k], cfg.cycles_per_frame);
+        ASSERT(results[k].display_hash == expected.display_hash, "Same final display as a sequential run")
+        ASSERT(results[k].cycles == expected.cycles, "Same instruction count as a sequential run")
+        ASSERT(results[k].skipped == expected.skipped, "Same idle cycles as a sequential run")
+    }
+}
+
+// A worker putting a sliced session back gets to the others first
+void test_fleet_queue_rotates() {
+    fleet::task_queue q;
+    for (const uint32_t k: {0u, 1u, 2u}) {
+        fleet::push(q, k);
+    }
+    uint32_t task = 9u;
+    ASSERT(fleet::pop(q, task) && task == 0u, "The owner takes the oldest session")
+    fleet::push(q, task);
+    ASSERT(fleet::pop(q, task) && task == 1u, "and after a slice the next one")
+    ASSERT(fleet::steal(q, task) && task == 0u, "Thieves take from the other end")
+    ASSERT(fleet::pop(q, task) && task == 2u && !fleet::pop(q, task), "Nothing is lost")
+}
+
+void run_fleet_tests() {
+    test_tick_timers();
+    test_fleet_matches_sequential();
+    test_fleet_queue_rotates();
+}
+
+} // namespace test
@@ -0,0 +1,169 @@
+#include "unittest.h"
+
+#include <memory>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "hires.h"
+
+using namespace chipp8;
+
+namespace test {
+
+static bool pixel(const hires::plane& p, int x, int y) {
+    if (x < 0 || y < 0 || x >= hires::WIDTH || y >= hires::HEIGHT) {
+        return false;
+    }
+    const auto word = (x < 64) ? p.left[y] : p.right[y];
+    return (word >> (63 - x % 64)) & 1u;
+}
+
+// The scroll kernels against moving every pixel by hand
+void test_hires_scroll() {
+    hires::plane start;
+    uint64_t s = 0x9E3779B97F4A7C15ull;
+    for (auto y = 0u; y < hires::HEIGHT; ++y) {
+        s = s * 6364136223846793005ull + 1442695040888963407ull;
+        start.left[y] = s;
+        s = s * 6364136223846793005ull + 1442695040888963407ull;
+        start.right[y] = s;
+    }
+
+    struct scroll_case {
+        void (*fn)(hires::plane&, unsigned);
+        unsigned n;
+        int dx;
+        int dy;
+    };
+    const scroll_case cases[] = {
+        {hires::scroll_down, 3u, 0, 3},
+        {hires::scroll_up, 15u, 0, -15},
+        {hires::scroll_right, 4u, 4, 0},
+        {hires::scroll_left, 8u, -8, 0},
+    };
+    for (const auto& c: cases) {
+        auto p = start;
+        c.fn(p, c.n);
+        bool same = true;
+        for (int y = 0; y < hires::HEIGHT; ++y) {
+            for (int x = 0; x < hires::WIDTH; ++x) {
+                same &= (pixel(p, x, y) == pixel(start, x - c.dx, y - c.dy));
+            }
+        }
+        ASSERT(same, "Every pixel moved and the uncovered ones are clear")
+    }
+}
+
+void test_hires_big_sprite() {
+    auto m = std::make_unique<hires::machine>();
+    load_program(*m, {});
+    m->hires = true;
+    for (auto k = 0u; k < 32u; ++k) {
+        m->mem[0x300u + k] = 0xFFu;
+    }
+    m->i = 0x300u;
+    m->v[0u] = 120u;
+    m->v[1u] = 60u;
+
+    // XO-CHIP wraps the 16x16 block around both edges
+    hires::DRW<quirks::xo_chip>(*m, 0u, 1u, 0u);
+    ASSERT(m->v[0xFu] == 0u, "Nothing was erased")
+    ASSERT(m->planes[0u].right[60u] == 0xFFull && m->planes[0u].left[60u] == 0xFF00000000000000ull, "The row wraps at x 128")
+    ASSERT(m->planes[0u].right[11u] == 0xFFull && m->planes[0u].right[12u] == 0u, "The rows wrap at y 64")
+
+    // SUPER-CHIP cuts it off and still reports the overlap
+    auto clipped = std::make_unique<hires::machine>();
+    load_program(*clipped, {});
+    clipped->hires = true;
+    clipped->mem = m->mem;
+    clipped->v = m->v;
+    clipped->i = m->i;
+    hires::DRW<quirks::super_chip>(*clipped, 0u, 1u, 0u);
+    ASSERT(clipped->planes[0u].left[60u] == 0u && clipped->planes[0u].right[63u] == 0xFFull, "Clipped at the right edge")
+    ASSERT(clipped->planes[0u].right[0u] == 0u, "And at the bottom")
+    hires::DRW<quirks::super_chip>(*clipped, 0u, 1u, 0u);
+    ASSERT(clipped->v[0xFu] == 1u && clipped->planes[0u].right[63u] == 0u, "Drawing again erases it")
+}
+
+// In lo-res a font digit covers 2x2 pixels per bit, on both selected planes
+void test_hires_lores_planes() {
+    auto m = std::make_unique<hires::machine>();
+    load_program(*m, {
+        0xF301u, // 200: planes 1 and 2
+        0x6002u, // 202: LD v0, 2
+        0x6103u, // 204: LD v1, 3
+        0xA050u, // 206: LD I, 0x50 (0, then 1 for the second plane)
+        0xD015u, // 208: DRW v0, v1, 5
+    });
+    hires::run(*m, 5u);
+    ASSERT(!m->hires && m->plane_mask == 0x3u, "Lo-res with both planes selected")
+    ASSERT(m->planes[0u].left[6u] == (0xFF00ull << 44u) && m->planes[0u].left[7u] == (0xFF00ull << 44u), "The top of the 0 is doubled")
+    ASSERT(m->planes[0u].left[8u] == (0xC300ull << 44u), "Its sides too")
+    ASSERT(m->planes[1u].left[6u] == (0x0C00ull << 44u), "Plane 2 takes the next 5 bytes, the top of the 1")
+    ASSERT(hires::get_pixel(*m, 1u, 8u, 6u) && !hires::get_pixel(*m, 1u, 7u, 6u), "get_pixel reads the planes")
+}
+
+void test_hires_scroll_opcodes_and_long_i() {
+    auto m = std::make_unique<hires::machine>();
+    load_program(*m, {
+        0x00FFu, // 200: hi-res
+        0xF000u, // 202: I = 0xE000
+        0xE000u,
+        0x6080u, // 206: LD v0, 0x80
+        0xF055u, // 208: LD [I], v0
+        0x3080u, // 20A: SE v0, 0x80
+        0x1200u, // 20C: JP 200
+        0x3080u, // 20E: SE v0, 0x80, skips all of the next F000
+        0xF000u, // 210
+        0x0000u,
+        0xA400u, // 214: LD I, 0x400
+        0xD010u, // 216: DRW v0, v1, 0
+        0x00C2u, // 218: scroll down 2
+        0x00FBu, // 21A: scroll right 4
+    });
+    m->mem[0x400u] = 0x80u;
+    hires::run(*m, 10u);
+    ASSERT(m->mem[0xE000u] == 0x80u && m->i == 0x400u, "F000 NNNN reaches past 4 KB")
+    ASSERT(m->pc == 0x021Cu, "Each skip stepped over a whole instruction")
+    ASSERT(m->planes[0u].left[2u] == (1ull << 59u), "The pixel drawn at x 128 wrapped to (0, 0) and scrolled to (4, 2)")
+}
+
+// The base opcodes run exactly as on a chip8
+void test_hires_base_opcodes() {
+    constexpr uint16_t program[] = {
+        0x6A07u, // 200: LD vA, 7
+        0x7A03u, // 202: ADD vA, 3
+        0x8BA4u, // 204: ADD vB, vA
+        0x2300u, // 206: CALL 300
+        0x1204u, // 208: JP 204
+    };
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+    auto m = std::make_unique<hires::machine>();
+    hires::load_program(*m, nullptr, 0u);
+    auto addr = PROGRAM_START_ADDR;
+    for (const auto word: program) {
+        cpu.mem[addr] = m->mem[addr] = static_cast<uint8_t>(word >> 8u);
+        ++addr;
+        cpu.mem[addr] = m->mem[addr] = static_cast<uint8_t>(word & 0x00FFu);
+        ++addr;
+    }
+    cpu.mem[0x300u] = m->mem[0x300u] = 0x00u;
+    cpu.mem[0x301u] = m->mem[0x301u] = 0xEEu; // 300: RET
+    cpu.pc = PROGRAM_START_ADDR;
+
+    dispatch::run(cpu, 40u);
+    hires::run<quirks::modern>(*m, 40u);
+    ASSERT(m->v == cpu.v && m->pc == cpu.pc && m->sp == cpu.sp && m->stack == cpu.stack, "The registers match")
+}
+
+void run_hires_tests() {
+    test_hires_scroll();
+    test_hires_big_sprite();
+    test_hires_lores_planes();
+    test_hires_scroll_opcodes_and_long_i();
+    test_hires_base_opcodes();
+}
+
+} // namespace test
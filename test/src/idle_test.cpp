@@ -0,0 +1,90 @@
+#include "unittest.h"
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "idle.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Frames of `cycles` instructions with a timer tick in between, through
+// both loops. Returns the instructions skipped
+static uint64_t check_against_dispatch(const chip8& start, uint64_t cycles, unsigned frames) {
+    chip8 expected = start;
+    chip8 actual = start;
+    uint64_t skipped = 0u;
+    for (auto f = 0u; f < frames; ++f) {
+        dispatch::run(expected, cycles);
+        const auto n = idle::run(actual, cycles);
+        ASSERT(n.executed + n.skipped == cycles, "Every cycle is either executed or skipped")
+        ASSERT(actual == expected, "Fast-forward agrees with dispatch")
+        skipped += n.skipped;
+        tick_timers(expected);
+        tick_timers(actual);
+    }
+    return skipped;
+}
+
+void test_idle_wait_key() {
+    chip8 cpu;
+    load_program(cpu, {
+        0x6105u, // 200: LD v1, 5
+        0xF00Au, // 202: LD v0, K
+        0x1200u, // 204: JP 200
+    });
+    ASSERT(check_against_dispatch(cpu, 100u, 3u) == 299u, "FX0A with no keys idles out the frame")
+    cpu.keys = 0x0004u;
+    ASSERT(check_against_dispatch(cpu, 100u, 3u) == 0u, "FX0A with a key down runs")
+}
+
+void test_idle_self_jump() {
+    chip8 cpu;
+    load_program(cpu, {
+        0xA050u, // 200: LD I, 0x50
+        0xD015u, // 202: DRW v0, v1, 5
+        0x1204u, // 204: JP 204
+    });
+    ASSERT(check_against_dispatch(cpu, 50u, 2u) == 98u, "A self jump idles out the frame")
+}
+
+void test_idle_delay_poll() {
+    chip8 cpu;
+    load_program(cpu, {
+        0x6A03u, // 200: LD vA, 3
+        0xFA15u, // 202: LD DT, vA
+        0xF007u, // 204: LD v0, DT
+        0x3000u, // 206: SE v0, 0
+        0x1204u, // 208: JP 204
+        0x7101u, // 20A: ADD v1, 1
+        0x1202u, // 20C: JP 202
+    });
+    ASSERT(check_against_dispatch(cpu, 101u, 12u) > 0u, "A delay timer poll is skipped")
+}
+
+void test_idle_busy_loops_run() {
+    chip8 cpu;
+    // Counts, so no two iterations start alike
+    load_program(cpu, {
+        0x7001u, // 200: ADD v0, 1
+        0x1200u, // 202: JP 200
+    });
+    ASSERT(check_against_dispatch(cpu, 100u, 3u) == 0u, "A counting loop is executed")
+
+    // Same registers every time round, but it draws
+    load_program(cpu, {
+        0xA050u, // 200: LD I, 0x50
+        0xD015u, // 202: DRW v0, v1, 5
+        0x1200u, // 204: JP 200
+    });
+    ASSERT(check_against_dispatch(cpu, 100u, 3u) == 0u, "A drawing loop is executed")
+}
+
+void run_idle_tests() {
+    test_idle_wait_key();
+    test_idle_self_jump();
+    test_idle_delay_poll();
+    test_idle_busy_loops_run();
+}
+
+} // namespace test
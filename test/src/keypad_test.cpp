@@ -0,0 +1,175 @@
+#include "unittest.h"
+
+#include <chrono>
+#include <thread>
+
+#include "chip8.h"
+#include "keypad.h"
+#include "scheduler.h"
+
+using namespace chipp8;
+
+namespace test {
+
+void test_keypad_queue() {
+    keypad::event_queue q;
+    keypad::init(q);
+    keypad::event e;
+    ASSERT(!keypad::peek(q, e), "Empty")
+    for (auto k = 0u; k < keypad::EVENT_QUEUE_SIZE; ++k) {
+        ASSERT(keypad::push(q, static_cast<uint8_t>(k), true), "Room for a whole queue")
+    }
+    ASSERT(!keypad::push(q, 0u, false), "Then it is full")
+    for (auto k = 0u; k < keypad::EVENT_QUEUE_SIZE; ++k) {
+        ASSERT(keypad::peek(q, e) && e.key == (k & 0x0Fu) && e.pressed, "Oldest first")
+        keypad::pop(q);
+    }
+    ASSERT(!keypad::peek(q, e), "Empty again")
+
+    chip8 cpu;
+    init(cpu);
+    keypad::apply(cpu, {keypad::steady::now(), 0xAu, true});
+    keypad::apply(cpu, {keypad::steady::now(), 0x3u, true});
+    keypad::apply(cpu, {keypad::steady::now(), 0xAu, false});
+    ASSERT(cpu.keys == 0x0008u, "Presses and releases")
+}
+
+void test_keypad_threads() {
+    constexpr auto EVENTS = 100'000u;
+    keypad::event_queue q;
+    keypad::init(q);
+    std::thread frontend([&] {
+        for (auto k = 0u; k < EVENTS; ++k) {
+            while (!keypad::push(q, static_cast<uint8_t>(k), (k & 0x10u) != 0u)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    bool in_order = true;
+    keypad::event e;
+    for (auto k = 0u; k < EVENTS; ++k) {
+        while (!keypad::peek(q, e)) {
+            std::this_thread::yield();
+        }
+        in_order = in_order && e.key == (k & 0x0Fu) && e.pressed == ((k & 0x10u) != 0u);
+        keypad::pop(q);
+    }
+    frontend.join();
+    ASSERT(in_order, "Every event arrives once and in order")
+}
+
+// SKP v0 spins until key 0 is down, then v1 counts it
+static void load_wait_key_0(chip8& cpu) {
+    load_program(cpu, {
+        0x7201u, // 200: ADD v2, 1
+        0xE09Eu, // 202: SKP v0
+        0x1200u, // 204: JP 200
+        0x7101u, // 206: ADD v1, 1
+        0x1208u, // 208: JP 208
+    });
+}
+
+void test_keypad_taps_within_a_frame() {
+    chip8 cpu;
+    load_wait_key_0(cpu);
+    timing::scheduler s;
+    timing::init(s, 600u, true);
+    keypad::event_queue q;
+    keypad::init(q);
+
+    // Setting cpu.keys between frames would never show this tap to SKP
+    keypad::push(q, 0u, true);
+    keypad::push(q, 0u, false);
+    timing::run_frame(s, cpu, q);
+    ASSERT(cpu.v[1u] == 1u && cpu.keys == 0u, "The tap was seen and is over")
+    ASSERT(q.applied == 2u, "Both events count towards latency")
+
+    // More events than a frame has instructions spill into the next one
+    load_program(cpu, {
+        0xE09Eu, // 200: SKP v0
+        0x1200u, // 202: JP 200
+    });
+    keypad::event e;
+    for (auto k = 0u; k < 15u; ++k) {
+        keypad::push(q, 1u, (k & 1u) == 0u);
+    }
+    timing::run_frame(s, cpu, q);
+    ASSERT(q.applied == 12u && keypad::peek(q, e), "10 fit")
+    timing::run_frame(s, cpu, q);
+    ASSERT(q.applied == 17u && !keypad::peek(q, e), "The rest go in the next frame")
+    ASSERT(cpu.keys == 0x0002u, "The last event was a press")
+
+    // A program that never reads the keypad keeps a tap down to the end of
+    // the frame
+    load_program(cpu, {0x1200u});
+    keypad::push(q, 4u, true);
+    keypad::push(q, 4u, false);
+    timing::run_frame(s, cpu, q);
+    ASSERT(cpu.keys == 0x0010u, "Still down after the frame")
+    timing::run_frame(s, cpu, q);
+    ASSERT(cpu.keys == 0u, "Released in the next one")
+}
+
+void test_keypad_event_timing() {
+    const auto frame = timing::FRAME_DURATION;
+    ASSERT(timing::event_cycle(-frame, 10u) == 0u, "Late events go first")
+    ASSERT(timing::event_cycle(frame / 2, 10u) == 5u, "Halfway through the slot")
+    ASSERT(timing::event_cycle(frame, 10u) == 10u, "The end of the slot")
+
+    // In real time an event halfway through frame 1's slot lands before
+    // instruction 15, 5 into the frame
+    chip8 cpu;
+    load_wait_key_0(cpu);
+    timing::scheduler s;
+    timing::init(s, 600u, false);
+    keypad::event_queue q;
+    keypad::init(q);
+    keypad::push(q, {s.start + frame / 2 + std::chrono::microseconds(100), 0u, true});
+    timing::run_frame(s, cpu, q);
+    ASSERT(q.applied == 0u && cpu.v[1u] == 0u, "Not due in frame 0")
+    timing::run_frame(s, cpu, q);
+    ASSERT(q.applied == 1u && cpu.v[1u] == 1u, "Applied in frame 1")
+    ASSERT(cpu.v[2u] == 6u, "After 5 whole trips round the loop, not 3")
+    ASSERT(q.latency_max > std::chrono::steady_clock::duration::zero(), "Latency is measured")
+}
+
+// A press after the last poll of a frame is still down at the first poll
+// of the next, even though its release lands at the start of that frame
+void test_keypad_press_after_last_poll() {
+    const auto frame = timing::FRAME_DURATION;
+    chip8 cpu;
+    // Polls key 0 every 7 instructions, at 14 in frame 1 and 21 in frame 2
+    load_program(cpu, {
+        0xE09Eu, // 200: SKP v0
+        0x1206u, // 202: JP 206
+        0x7101u, // 204: ADD v1, 1
+        0x7201u, // 206: ADD v2, 1
+        0x7201u, // 208: ADD v2, 1
+        0x7201u, // 20A: ADD v2, 1
+        0x7201u, // 20C: ADD v2, 1
+        0x1200u, // 20E: JP 200
+    });
+    timing::scheduler s;
+    timing::init(s, 600u, false);
+    keypad::event_queue q;
+    keypad::init(q);
+    // Instruction 19, then 20
+    keypad::push(q, {s.start + frame * 9 / 10 + std::chrono::microseconds(100), 0u, true});
+    keypad::push(q, {s.start + frame + std::chrono::microseconds(100), 0u, false});
+    timing::run_frame(s, cpu, q);
+    timing::run_frame(s, cpu, q);
+    ASSERT(cpu.keys == 0x0001u && cpu.v[1u] == 0u, "Pressed after the last poll of frame 1")
+    timing::run_frame(s, cpu, q);
+    ASSERT(cpu.v[1u] == 1u, "The poll in frame 2 saw it")
+    ASSERT(cpu.keys == 0u && q.applied == 2u, "Released after that poll")
+}
+
+void run_keypad_tests() {
+    test_keypad_queue();
+    test_keypad_threads();
+    test_keypad_taps_within_a_frame();
+    test_keypad_event_timing();
+    test_keypad_press_after_last_poll();
+}
+
+} // namespace test
@@ -1,7 +1,7 @@
 #include "unittest.h"
 
 
-int main(int argc, char* argv[]) {
+int main() {
     test::run_tests();
     return 0;
 }
@@ -0,0 +1,129 @@
+#include "unittest.h"
+
+#include <memory>
+#include <string>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "profile.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Draws a 5 row digit, then polls the delay timer until it runs out
+static void load_poll(chip8& cpu) {
+    load_program(cpu, {
+        0xA050u, // 200: LD I, 0x50
+        0x6003u, // 202: LD v0, 3
+        0xF015u, // 204: LD DT, v0
+        0xD115u, // 206: DRW v1, v1, 5
+        0xF207u, // 208: LD v2, DT
+        0x3200u, // 20A: SE v2, 0
+        0x1208u, // 20C: JP 208
+        0x120Eu, // 20E: JP 20E
+    });
+}
+
+void test_profile_counts() {
+    chip8 cpu;
+    load_poll(cpu);
+    auto c = std::make_unique<profile::counters>();
+    profile::reset(*c);
+
+    // 4 to reach the poll, then 10 trips round it with the timer still at 3
+    profile::run<quirks::modern, true>(cpu, 4u + 30u, *c);
+    ASSERT(profile::total(*c) == 34u, "Every instruction is counted once")
+    ASSERT(c->ops[static_cast<size_t>(dispatch::op::DRW)] == 1u, "One draw")
+    ASSERT(c->draws == 1u && c->rows_drawn == 5u, "The draw put 5 rows down")
+    ASSERT(c->timer_wait == 10u, "Every FX07 read a running timer")
+    ASSERT(c->pc[0x208u] == 10u && c->pc[0x20Cu] == 10u && c->pc[0x200u] == 1u, "Per pc counts")
+    ASSERT(c->ops[static_cast<size_t>(dispatch::op::JP)] == 10u, "The loop's jumps")
+
+    // Once the timer runs out the poll falls through to the self jump
+    tick_timers(cpu);
+    tick_timers(cpu);
+    tick_timers(cpu);
+    profile::run<quirks::modern, true>(cpu, 5u, *c);
+    ASSERT(c->timer_wait == 10u, "A read of 0 is not a wait")
+    ASSERT(c->pc[0x20Eu] == 3u, "The self jump ran")
+
+    // WAIT_KP counts while no key is down
+    load_program(cpu, {0xF00Au});
+    profile::run<quirks::modern, true>(cpu, 3u, *c);
+    ASSERT(c->key_wait == 3u, "Three waits for a key")
+    cpu.keys = 0x0002u;
+    profile::run<quirks::modern, true>(cpu, 1u, *c);
+    ASSERT(c->key_wait == 3u, "A key ends the wait")
+}
+
+void test_profile_clip_rows() {
+    chip8 cpu;
+    load_program(cpu, {
+        0xA050u, // LD I, 0x50
+        0x601Eu, // LD v0, 30
+        0xD005u, // DRW v0, v0, 5
+    });
+    auto c = std::make_unique<profile::counters>();
+    profile::reset(*c);
+    profile::run<quirks::cosmac_vip, true>(cpu, 3u, *c);
+    ASSERT(c->rows_drawn == 2u, "Clipped at the bottom after 2 rows")
+}
+
+void test_profile_disabled() {
+    chip8 expected;
+    load_poll(expected);
+    chip8 cpu = expected;
+    auto c = std::make_unique<profile::counters>();
+    profile::reset(*c);
+    const auto untouched = *c;
+
+    dispatch::run(expected, 40u);
+    profile::run<quirks::modern, false>(cpu, 40u, *c);
+    ASSERT(cpu == expected, "Disabled it is dispatch::run")
+    ASSERT(*c == untouched, "and counts nothing")
+
+    // Counting does not change the run either
+    load_poll(cpu);
+    profile::run<quirks::modern, true>(cpu, 40u, *c);
+    ASSERT(cpu == expected, "Enabled it runs the same")
+}
+
+void test_profile_export() {
+    chip8 cpu;
+    load_poll(cpu);
+    auto c = std::make_unique<profile::counters>();
+    profile::reset(*c);
+    profile::run<quirks::modern, true>(cpu, 100u, *c);
+
+    const auto dump = profile::encode(*c);
+    auto back = std::make_unique<profile::counters>();
+    ASSERT(profile::decode(dump.data(), dump.size(), *back), "The dump decodes")
+    ASSERT(*back == *c, "to the same counters")
+    ASSERT(!profile::decode(dump.data(), dump.size() - 1u, *back), "A short dump is rejected")
+    auto bad = dump;
+    bad[0u] ^= 1u;
+    ASSERT(!profile::decode(bad.data(), bad.size(), *back), "So is a bad magic")
+
+    const auto csv = profile::to_csv(*c);
+    ASSERT(csv.starts_with("kind,key,count\n"), "CSV header")
+    ASSERT(csv.find("op,DRW,1\n") != std::string::npos, "Opcode line")
+    ASSERT(csv.find("pc,0x208,32\n") != std::string::npos, "Hotspot line")
+    ASSERT(csv.find("total,timer_wait,32\n") != std::string::npos, "Totals")
+    ASSERT(csv.find("pc,0x20E") == std::string::npos, "Addresses that never ran are left out")
+
+    const auto hot = profile::top(c->pc, 2u);
+    ASSERT(hot.size() == 2u && hot[0u] == 0x208u && hot[1u] == 0x20Au, "Hottest first, ties by address")
+    const auto text = profile::report(*c, 3u);
+    ASSERT(text.find("instructions 100") != std::string::npos, "Report header")
+    ASSERT(text.find("0x208") != std::string::npos && text.find("LD_REG_DT") != std::string::npos, "Report rows")
+}
+
+void run_profile_tests() {
+    test_profile_counts();
+    test_profile_clip_rows();
+    test_profile_disabled();
+    test_profile_export();
+}
+
+} // namespace test
@@ -0,0 +1,180 @@
+#include "unittest.h"
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "quirks.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Every word through the profile's decode table against parse_op<Q>
+template <typename Q>
+static void check_table_matches_parse_op() {
+    chip8 base;
+    init(base);
+    load_font_sprites(base);
+    for (auto r = 0u; r < 16u; ++r) {
+        base.v[r] = static_cast<uint8_t>(r * 17u + 3u);
+    }
+    base.i = 0x0300u;
+    base.pc = 0x0400u;
+    base.sp = 2u;
+    base.stack[2u] = 0x0222u;
+    base.keys = 0x0010u;
+
+    for (auto instruct = 0u; instruct <= 0xFFFFu; ++instruct) {
+        chip8 expected = base;
+        parse_op<Q>(expected, static_cast<uint16_t>(instruct));
+
+        chip8 actual = base;
+        dispatch::execute(actual, chip8_core<Q>::table[instruct]);
+
+        ASSERT(actual == expected, "The profile's decode table agrees with parse_op")
+    }
+}
+
+void test_quirks_tables() {
+    check_table_matches_parse_op<quirks::cosmac_vip>();
+    check_table_matches_parse_op<quirks::super_chip>();
+    check_table_matches_parse_op<quirks::xo_chip>();
+}
+
+void test_quirks_shift_and_logic() {
+    chip8 cpu;
+    init(cpu);
+    cpu.v[1u] = 0x10u;
+    cpu.v[2u] = 0x03u;
+    SHR<quirks::cosmac_vip>(cpu, 1u, 2u);
+    ASSERT(cpu.v[1u] == 0x01u && cpu.v[0xFu] == 1u, "VIP shifts vY into vX")
+    SHR<quirks::super_chip>(cpu, 2u, 1u);
+    ASSERT(cpu.v[2u] == 0x01u && cpu.v[0xFu] == 1u, "SUPER-CHIP shifts vX in place")
+
+    cpu.v[0xFu] = 9u;
+    OR_REG<quirks::cosmac_vip>(cpu, 1u, 2u);
+    ASSERT(cpu.v[0xFu] == 0u, "VIP logic ops reset vF")
+    cpu.v[0xFu] = 9u;
+    OR_REG<quirks::xo_chip>(cpu, 1u, 2u);
+    ASSERT(cpu.v[0xFu] == 9u, "XO-CHIP logic ops leave vF alone")
+}
+
+// vF holds the bit shifted out as 0 or 1, and is written after vX
+template <typename Q>
+static void check_shift_flags() {
+    chip8 cpu;
+    init(cpu);
+    cpu.v[1u] = 0x81u;
+    cpu.v[2u] = 0x81u;
+    SHL<Q>(cpu, 1u, 2u);
+    ASSERT(cpu.v[1u] == 0x02u && cpu.v[0xFu] == 1u, "8XYE sets vF to bit 7")
+    cpu.v[1u] = 0x40u;
+    cpu.v[2u] = 0x40u;
+    SHL<Q>(cpu, 1u, 2u);
+    ASSERT(cpu.v[1u] == 0x80u && cpu.v[0xFu] == 0u, "8XYE clears vF")
+
+    cpu.v[0xFu] = 0x80u;
+    cpu.v[2u] = 0x80u;
+    SHL<Q>(cpu, 0xFu, 2u);
+    ASSERT(cpu.v[0xFu] == 1u, "The flag wins over vX when X=F")
+    cpu.v[0xFu] = 0x03u;
+    cpu.v[2u] = 0x03u;
+    SHR<Q>(cpu, 0xFu, 2u);
+    ASSERT(cpu.v[0xFu] == 1u, "For 8XY6 too")
+
+    // The same through parse_op and the profile's decode table
+    cpu.v[3u] = 0xC0u;
+    cpu.v[4u] = 0xC0u;
+    chip8 table = cpu;
+    parse_op<Q>(cpu, 0x834Eu);
+    dispatch::execute(table, chip8_core<Q>::table[0x834Eu]);
+    ASSERT(cpu.v[3u] == 0x80u && cpu.v[0xFu] == 1u && table == cpu, "parse_op and the table agree")
+}
+
+void test_quirks_shift_flags() {
+    check_shift_flags<quirks::modern>();
+    check_shift_flags<quirks::cosmac_vip>();
+    check_shift_flags<quirks::super_chip>();
+    check_shift_flags<quirks::xo_chip>();
+}
+
+void test_quirks_jump_and_load_store() {
+    chip8 cpu;
+    init(cpu);
+    cpu.v[0u] = 0x01u;
+    cpu.v[3u] = 0x10u;
+    JP_V0<quirks::super_chip>(cpu, 0x0345u);
+    ASSERT(cpu.pc == 0x0355u, "SUPER-CHIP jumps to XNN + vX")
+    JP_V0<quirks::cosmac_vip>(cpu, 0x0345u);
+    ASSERT(cpu.pc == 0x0346u, "VIP jumps to NNN + v0")
+
+    cpu.i = 0x0300u;
+    LD_I_V0X<quirks::xo_chip>(cpu, 3u);
+    ASSERT(cpu.i == 0x0304u && cpu.mem[0x0303u] == 0x10u, "XO-CHIP FX55 moves I past the registers")
+    LD_V0X_I<quirks::super_chip>(cpu, 1u);
+    ASSERT(cpu.i == 0x0304u, "SUPER-CHIP FX65 leaves I alone")
+}
+
+void test_quirks_clipping() {
+    chip8 cpu;
+    init(cpu);
+    cpu.mem[0x300u] = 0xFFu;
+    cpu.mem[0x301u] = 0xFFu;
+    cpu.i = 0x300u;
+    cpu.v[0u] = 60u + 64u; // The start still wraps
+    cpu.v[1u] = 31u;
+
+    DRW<quirks::cosmac_vip>(cpu, 0u, 1u, 2u);
+    ASSERT(cpu.pixels[31u] == 0x000000000000000Full, "The right edge cuts the row off")
+    ASSERT(cpu.pixels[0u] == 0u, "The bottom edge cuts the second row off")
+
+    DRW<quirks::xo_chip>(cpu, 0u, 1u, 2u);
+    ASSERT(cpu.pixels[31u] == 0xF000000000000000ull, "XO-CHIP wraps onto the left edge")
+    ASSERT(cpu.pixels[0u] == 0xF00000000000000Full, "And onto the top")
+    ASSERT(cpu.v[0xFu] == 1u, "Wrapping over the clipped pixels collides")
+}
+
+// BXNN programs only run the same on the profile they were written for
+void test_quirks_core_run() {
+    chip8 start;
+    init(start);
+    start.pc = PROGRAM_START_ADDR;
+    constexpr uint16_t program[] = {
+        0x6302u, // 200: LD v3, 2
+        0xB300u, // 202: JP 300 + v0, or 300 + v3
+    };
+    auto addr = PROGRAM_START_ADDR;
+    for (const auto word: program) {
+        start.mem[addr++] = static_cast<uint8_t>(word >> 8u);
+        start.mem[addr++] = static_cast<uint8_t>(word & 0x00FFu);
+    }
+
+    chip8 vip = start;
+    chip8_core<quirks::cosmac_vip>::run(vip, 2u);
+    chip8 schip = start;
+    chip8_core<quirks::super_chip>::run(schip, 2u);
+    chip8 plain = start;
+    dispatch::run(plain, 2u);
+    ASSERT(vip.pc == 0x0300u && schip.pc == 0x0302u, "Each core jumps its own way")
+    ASSERT(plain == vip, "dispatch::run is the modern profile")
+}
+
+constexpr uint8_t constexpr_vip_shift() {
+    chip8 cpu;
+    init(cpu);
+    cpu.v[2u] = 0x40u;
+    parse_op<quirks::cosmac_vip>(cpu, 0x812Eu); // SHL v1, v2
+    return cpu.v[1u];
+}
+
+static_assert(constexpr_vip_shift() == 0x80u, "A profile's parse_op runs at compile time");
+
+void run_quirks_tests() {
+    test_quirks_tables();
+    test_quirks_shift_and_logic();
+    test_quirks_shift_flags();
+    test_quirks_jump_and_load_store();
+    test_quirks_clipping();
+    test_quirks_core_run();
+}
+
+} // namespace test
@@ -0,0 +1,121 @@
+#include "unittest.h"
+
+#include <stdint.h>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "replay.h"
+#include "scheduler.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Draws a random digit at a random spot, shifted right while the key of
+// that digit is down, then waits out 2 frames
+static void load_random_game(chip8& cpu) {
+    load_program(cpu, {
+        0xC03Fu, // 200: RND v0, 0x3F
+        0xC11Fu, // 202: RND v1, 0x1F
+        0xC20Fu, // 204: RND v2, 0x0F
+        0xE2A1u, // 206: SKNP v2
+        0x7004u, // 208: ADD v0, 4
+        0xF229u, // 20A: LD F, v2
+        0xD015u, // 20C: DRW v0, v1, 5
+        0x6A02u, // 20E: LD vA, 2
+        0xFA15u, // 210: LD DT, vA
+        0xFB07u, // 212: LD vB, DT
+        0x3B00u, // 214: SE vB, 0
+        0x1212u, // 216: JP 212
+        0x1200u, // 218: JP 200
+    });
+}
+
+// Record a session with the keys changing every few frames
+static replay::log record(chip8& cpu, uint32_t seed, uint32_t frames) {
+    replay::recorder r;
+    timing::scheduler s;
+    replay::start(r, s, cpu, seed, 700u, true);
+    for (auto f = 0u; f < frames; ++f) {
+        if (f % 7u == 3u) {
+            replay::set_keys(r, s, cpu, static_cast<uint16_t>(1u << (f % 16u)));
+        } else if (f % 7u == 5u) {
+            replay::set_keys(r, s, cpu, 0u);
+        }
+        timing::run_frame(s, cpu);
+    }
+    return replay::finish(r, s, cpu);
+}
+
+void test_replay_matches_recording() {
+    chip8 start;
+    load_random_game(start);
+
+    chip8 recorded = start;
+    const auto l = record(recorded, 99u, 300u);
+    ASSERT(l.event_count > 40u, "The key changes were logged")
+    ASSERT(l.events.size() <= 3u * l.event_count, "Each event packs into a few bytes")
+
+    chip8 played = start;
+    ASSERT(replay::verify(l, played), "The replay ends on the recorded display")
+    ASSERT(played == recorded, "Down to every register")
+
+    // The same log through its byte format
+    const auto bytes = replay::encode(l);
+    replay::log decoded;
+    ASSERT(replay::decode(bytes.data(), bytes.size(), decoded), "The log decodes")
+    chip8 again = start;
+    ASSERT(replay::verify(decoded, again) && again == recorded, "The decoded log replays the same")
+    ASSERT(!replay::decode(bytes.data(), bytes.size() - 1u, decoded), "A cut off log is rejected")
+
+    // A different seed is a different game
+    chip8 other = start;
+    auto reseeded = l;
+    reseeded.seed = 100u;
+    ASSERT(replay::play(reseeded, other) && !(other == recorded), "The seed is part of the session")
+}
+
+void test_replay_mid_frame_keys() {
+    chip8 start;
+    load_program(start, {
+        0xE09Eu, // 200: SKP v0
+        0x1200u, // 202: JP 200
+        0x7101u, // 204: ADD v1, 1
+        0x1200u, // 206: JP 200
+    });
+    start.keys = 0x0001u;
+
+    // Keys may change between any two instructions, not just frames
+    chip8 cpu = start;
+    replay::recorder r;
+    timing::scheduler s;
+    replay::start(r, s, cpu, 1u, 600u, true);
+    for (auto k = 0u; k < 25u; ++k) {
+        dispatch::run(cpu, 3u);
+        s.instructions += 3u;
+        replay::set_keys(r, s, cpu, (k % 2u) ? 0x0001u : 0x0000u);
+        dispatch::run(cpu, 1u);
+        s.instructions += 1u;
+    }
+    const auto& l = replay::finish(r, s, cpu);
+
+    // The timers stay at 0, so only the key timing matters
+    chip8 expected = start;
+    seed_rng(expected, 1u);
+    for (auto k = 0u; k < 25u; ++k) {
+        dispatch::run(expected, 3u);
+        expected.keys = (k % 2u) ? 0x0001u : 0x0000u;
+        dispatch::run(expected, 1u);
+    }
+    chip8 played = start;
+    ASSERT(replay::play(l, played), "The log plays")
+    ASSERT(played == expected, "Keys land on the recorded instruction")
+}
+
+void run_replay_tests() {
+    test_replay_matches_recording();
+    test_replay_mid_frame_keys();
+}
+
+} // namespace test
@@ -0,0 +1,96 @@
+#include "unittest.h"
+
+#include <memory>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "rewind.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Draws, calls, and writes mem through FX33 and FX55 at a moving I
+static void load_busy_program(chip8& cpu) {
+    load_program(cpu, {
+        0x7003u, // 200: ADD v0, 3
+        0xA300u, // 202: LD I, 0x300
+        0xF01Eu, // 204: ADD I, v0
+        0xF033u, // 206: LD B, v0
+        0xF155u, // 208: LD [I], v0..v1
+        0x2212u, // 20A: CALL 212
+        0x7101u, // 20C: ADD v1, 1
+        0x1200u, // 20E: JP 200
+        0x0000u, // 210
+        0xF029u, // 212: LD F, v0
+        0xD015u, // 214: DRW v0, v1, 5
+        0x00EEu, // 216: RET
+    });
+}
+
+// Every recorded frame, stepped back one at a time and by jumps
+void test_rewind_steps_back() {
+    auto cpu = std::make_unique<chip8>();
+    load_busy_program(*cpu);
+
+    auto h = std::make_unique<rewind::history>();
+    rewind::init(*h, *cpu, 200u, 1u << 20u, 16u);
+    std::vector<chip8> frames{*cpu};
+    for (auto f = 0u; f < 150u; ++f) {
+        dispatch::run(*cpu, 17u);
+        tick_timers(*cpu);
+        rewind::record(*h, *cpu);
+        frames.push_back(*cpu);
+    }
+    ASSERT(rewind::available(*h) == 150u, "Every frame is kept")
+
+    for (auto f = 0u; f < 40u; ++f) {
+        ASSERT(rewind::step_back(*h, *cpu), "Can step back")
+        frames.pop_back();
+        ASSERT(*cpu == frames.back(), "Stepping back restores the previous frame")
+    }
+
+    // Far enough to go through keyframes
+    ASSERT(rewind::rewind(*h, *cpu, 53u) == 53u, "Rewinds the whole distance")
+    frames.resize(frames.size() - 53u);
+    ASSERT(*cpu == frames.back(), "A long rewind lands on the right frame")
+
+    // Recording carries on from the rewound frame
+    dispatch::run(*cpu, 17u);
+    rewind::record(*h, *cpu);
+    ASSERT(rewind::step_back(*h, *cpu) && *cpu == frames.back(), "History continues after a rewind")
+
+    ASSERT(rewind::rewind(*h, *cpu, 1000u) == 57u, "Stops at the oldest frame")
+    ASSERT(*cpu == frames.front(), "Back to the start")
+    ASSERT(!rewind::step_back(*h, *cpu), "Nothing left to step back")
+}
+
+// A small ring drops the oldest frames and keeps the newest working
+void test_rewind_ring_wraps() {
+    auto cpu = std::make_unique<chip8>();
+    load_busy_program(*cpu);
+
+    auto h = std::make_unique<rewind::history>();
+    rewind::init(*h, *cpu, 30u, 0u, 8u);
+    std::vector<chip8> frames{*cpu};
+    for (auto f = 0u; f < 500u; ++f) {
+        dispatch::run(*cpu, 17u);
+        rewind::record(*h, *cpu);
+        frames.push_back(*cpu);
+    }
+    const auto kept = rewind::available(*h);
+    ASSERT(kept > 0u && kept <= 30u, "The ring holds at most max_frames")
+    for (auto f = 0u; f < kept; ++f) {
+        ASSERT(rewind::step_back(*h, *cpu), "Can step back")
+        frames.pop_back();
+        ASSERT(*cpu == frames.back(), "Every kept frame is restored exactly")
+    }
+}
+
+void run_rewind_tests() {
+    test_rewind_steps_back();
+    test_rewind_ring_wraps();
+}
+
+} // namespace test
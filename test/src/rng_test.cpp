@@ -0,0 +1,130 @@
+#include "unittest.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "chip8.h"
+#include "dispatch.h"
+#include "rng.h"
+
+using namespace chipp8;
+
+namespace test {
+
+constexpr uint8_t constexpr_draws() {
+    chip8 cpu;
+    init(cpu);
+    seed_rng(cpu, 7u, 3u);
+    RND(cpu, 0u, 0xFFu);
+    RND(cpu, 1u, 0xFFu);
+    return static_cast<uint8_t>(cpu.v[0u] ^ cpu.v[1u]);
+}
+
+static_assert(constexpr_draws() == (rng::byte_at(7u, 3u, 0u) ^ rng::byte_at(7u, 3u, 1u)), "RND can run at compile time");
+static_assert(rng::byte_at(1u, 0u, 0u) != rng::byte_at(1u, 1u, 0u) || rng::byte_at(1u, 0u, 1u) != rng::byte_at(1u, 1u, 1u),
+              "Instances draw from different streams");
+
+// Random digits at random spots, skipping the draw on odd v2
+static void load_random_draw(chip8& cpu) {
+    load_program(cpu, {
+        0xC03Fu, // 200: RND v0, 0x3F
+        0xC11Fu, // 202: RND v1, 0x1F
+        0xC20Fu, // 204: RND v2, 0x0F
+        0x6301u, // 206: LD v3, 1
+        0x8322u, // 208: AND v3, v2
+        0x3300u, // 20A: SE v3, 0
+        0x1200u, // 20C: JP 200
+        0xF229u, // 20E: LD F, v2
+        0xD015u, // 210: DRW v0, v1, 5
+        0x1200u, // 212: JP 200
+    });
+}
+
+void test_rng_streams() {
+    chip8 a;
+    init(a);
+    chip8 b;
+    init(b);
+    ASSERT(a.rng.seed == DEFAULT_RNG_SEED && a.rng.count == 0u, "init restarts the default stream")
+
+    seed_rng(a, 1234u, 5u);
+    seed_rng(b, 1234u, 5u);
+    bool same = true;
+    bool varied = false;
+    for (auto k = 0u; k < 64u; ++k) {
+        RND(a, 0u, 0xFFu);
+        RND(b, 0u, 0xFFu);
+        same &= (a.v[0u] == b.v[0u]);
+        varied |= (a.v[0u] != a.v[1u]);
+        a.v[1u] = a.v[0u];
+    }
+    ASSERT(same && varied, "One (seed, instance) gives one sequence of varied bytes")
+    ASSERT(a.rng.count == 64u, "Each RND moves the counter on by one")
+
+    // Draw 40 from the middle of the stream without drawing the first 39
+    seed_rng(b, 1234u, 5u);
+    b.rng.count = 39u;
+    RND(b, 2u, 0xFFu);
+    ASSERT(b.v[2u] == rng::byte_at(1234u, 5u, 39u), "A draw only depends on its index")
+}
+
+// Instances run on any thread in any order give the same machines
+void test_rng_scheduling_independent() {
+    constexpr auto instances = 16u;
+    auto expected = std::make_unique<std::array<chip8, instances>>();
+    for (auto k = 0u; k < instances; ++k) {
+        load_random_draw((*expected)[k]);
+        seed_rng((*expected)[k], 42u, k);
+    }
+    auto actual = std::make_unique<std::array<chip8, instances>>(*expected);
+    for (auto& cpu: *expected) {
+        dispatch::run(cpu, 500u);
+    }
+
+    // Highest instance first, spread over 4 threads
+    std::vector<std::thread> pool;
+    for (auto t = 0u; t < 4u; ++t) {
+        pool.emplace_back([&, t] {
+            for (auto k = instances; k-- > 0u;) {
+                if (k % 4u == t) {
+                    dispatch::run((*actual)[k], 500u);
+                }
+            }
+        });
+    }
+    for (auto& t: pool) {
+        t.join();
+    }
+    ASSERT(*actual == *expected, "Scheduling does not change any draw")
+    ASSERT(!((*expected)[0u].pixels == (*expected)[1u].pixels), "Instances draw different pictures")
+}
+
+// The batch engine draws every lane in bulk
+void test_rng_batch_lanes() {
+    constexpr size_t lanes = 37u;
+    auto start = std::make_unique<std::array<chip8, lanes>>();
+    auto b = std::make_unique<chip8_batch<lanes>>();
+    for (size_t l = 0u; l < lanes; ++l) {
+        load_random_draw((*start)[l]);
+        seed_rng((*start)[l], 42u, static_cast<uint32_t>(l));
+        batch::load_lane(*b, l, (*start)[l]);
+    }
+    batch::run(*b, 300u);
+
+    chip8 actual;
+    for (size_t l = 0u; l < lanes; ++l) {
+        dispatch::run((*start)[l], 300u);
+        batch::store_lane(*b, l, actual);
+        ASSERT(actual == (*start)[l], "Each lane draws its own stream, like dispatch")
+    }
+}
+
+void run_rng_tests() {
+    test_rng_streams();
+    test_rng_scheduling_independent();
+    test_rng_batch_lanes();
+}
+
+} // namespace test
@@ -0,0 +1,170 @@
+#include "unittest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "rom.h"
+
+using namespace chipp8;
+
+namespace test {
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+static std::vector<uint8_t> program_of(size_t size, uint8_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t k = 0u; k < size; ++k) {
+        bytes[k] = static_cast<uint8_t>(seed + k * 7u);
+    }
+    return bytes;
+}
+
+static void put_u32_at(std::vector<uint8_t>& data, size_t at, uint32_t value) {
+    for (auto b = 0u; b < 4u; ++b) {
+        data[at + b] = static_cast<uint8_t>(value >> (8u * b));
+    }
+}
+
+void test_rom_load_sizes() {
+    chip8 cpu;
+    init(cpu);
+    const auto full = program_of(0xE00u, 1u);
+    ASSERT(rom::load(cpu, full.data(), full.size()) == rom::status::ok, "Fills 0x200-0xFFF")
+    ASSERT(cpu.pc == PROGRAM_START_ADDR && cpu.mem[0xFFFu] == full.back() && cpu.mem[0x50u] == 0xF0u, "Loaded with the font")
+
+    const auto before = cpu;
+    const auto big = program_of(0xE01u, 2u);
+    ASSERT(rom::load(cpu, big.data(), big.size()) == rom::status::too_large, "One byte too many")
+    ASSERT(rom::load(cpu, big.data(), 0u) == rom::status::empty, "Nothing")
+    ASSERT(cpu == before, "Untouched when refused")
+
+    ASSERT(rom::load(cpu, big.data(), 0xA01u, ETI_660_PROGRAM_START_ADDR) == rom::status::too_large, "ETI 660 window")
+    ASSERT(rom::load(cpu, big.data(), 0xA00u, ETI_660_PROGRAM_START_ADDR) == rom::status::ok, "Fits the ETI 660 window")
+    ASSERT(cpu.pc == ETI_660_PROGRAM_START_ADDR && cpu.mem[0x600u] == big[0u], "Loaded at 0x600")
+}
+
+void test_rom_load_file() {
+    const auto path = temp_path("chipp8_rom_test.ch8");
+    const auto program = program_of(300u, 9u);
+    write_file(path, program);
+    chip8 cpu;
+    ASSERT(rom::load_file(cpu, path.c_str()) == rom::status::ok, "Loads")
+    ASSERT(std::equal(program.begin(), program.end(), cpu.mem.begin() + PROGRAM_START_ADDR), "Same bytes")
+
+    write_file(path, program_of(0xE01u, 3u));
+    ASSERT(rom::load_file(cpu, path.c_str()) == rom::status::too_large, "Too large")
+    write_file(path, {});
+    ASSERT(rom::load_file(cpu, path.c_str()) == rom::status::empty, "Empty")
+    std::filesystem::remove(path);
+    ASSERT(rom::load_file(cpu, path.c_str()) == rom::status::unreadable, "Missing")
+}
+
+void test_rom_pack() {
+    std::vector<rom::item> items;
+    for (auto k = 0u; k < 50u; ++k) {
+        items.push_back({"game_" + std::to_string(k), program_of(100u + k * 13u, static_cast<uint8_t>(k))});
+    }
+    // The same ROM under another name is stored once
+    items.push_back({"alias", items[7u].bytes});
+
+    std::vector<uint8_t> data;
+    ASSERT(rom::build(items, data), "Built")
+    size_t names = 0u;
+    size_t bytes = 0u;
+    for (const auto& i: items) {
+        names += i.name.size();
+        bytes += i.bytes.size();
+    }
+    ASSERT(data.size() == rom::PACK_HEADER_SIZE + rom::PACK_ENTRY_SIZE * items.size() + names + bytes - items[7u].bytes.size(),
+           "Header, index, names and each distinct ROM once")
+
+    const auto path = temp_path("chipp8_rom_test.c8p");
+    write_file(path, data);
+    rom::pack p;
+    ASSERT(rom::open(p, path.c_str()) == rom::status::ok && p.count == items.size(), "Opened")
+    for (const auto& i: items) {
+        const auto k = rom::find(p, i.name);
+        ASSERT(k < p.count, "Found by name")
+        const auto e = rom::get(p, k);
+        ASSERT(e.name == i.name && e.size == i.bytes.size() && std::equal(i.bytes.begin(), i.bytes.end(), e.bytes), "Same ROM")
+        ASSERT(rom::verify(p, k), "Hash matches")
+        chip8 cpu;
+        ASSERT(rom::load(cpu, p, i.name) == rom::status::ok, "Loads from the mapping")
+        ASSERT(std::equal(i.bytes.begin(), i.bytes.end(), cpu.mem.begin() + PROGRAM_START_ADDR), "Into mem")
+    }
+    ASSERT(rom::get(p, rom::find(p, "alias")).bytes == rom::get(p, rom::find(p, "game_7")).bytes, "Shared bytes")
+    chip8 cpu;
+    ASSERT(rom::find(p, "game_") == p.count && rom::load(cpu, p, "zzz") == rom::status::not_found, "Missing name")
+    rom::close(p);
+    std::filesystem::remove(path);
+
+    auto dup = items;
+    dup.push_back({"game_3", {1u}});
+    ASSERT(!rom::build(dup, data), "Names are unique")
+    ASSERT(!rom::build({{"empty", {}}}, data), "ROMs are not empty")
+}
+
+void test_rom_pack_rejects() {
+    std::vector<uint8_t> good;
+    ASSERT(rom::build({{"a", program_of(10u, 1u)}, {"b", program_of(20u, 2u)}}, good), "Built")
+    rom::pack p;
+    auto attach = [&](const std::vector<uint8_t>& data) { return rom::attach(p, data.data(), data.size()); };
+    ASSERT(attach(good) == rom::status::ok, "Good")
+
+    auto data = good;
+    data[0u] = 'X';
+    ASSERT(attach(data) == rom::status::not_a_pack, "Wrong magic")
+    ASSERT(attach({good.begin(), good.begin() + 8}) == rom::status::not_a_pack, "Shorter than a header")
+
+    data = good;
+    data[4u] = rom::PACK_VERSION + 1u;
+    ASSERT(attach(data) == rom::status::future_version, "Newer version")
+
+    ASSERT(attach({good.begin(), good.end() - 1}) == rom::status::corrupt, "Last ROM cut short")
+    ASSERT(attach({good.begin(), good.begin() + 40}) == rom::status::corrupt, "Index cut short")
+
+    // Second entry's offset past the end of the file
+    data = good;
+    put_u32_at(data, rom::PACK_HEADER_SIZE + rom::PACK_ENTRY_SIZE + 16u, static_cast<uint32_t>(good.size()));
+    ASSERT(attach(data) == rom::status::corrupt && !p.data, "ROM outside the file")
+
+    // A ROM pointing back into the index
+    data = good;
+    put_u32_at(data, rom::PACK_HEADER_SIZE + 16u, 0u);
+    ASSERT(attach(data) == rom::status::corrupt, "ROM over the header")
+
+    data = good;
+    put_u32_at(data, rom::PACK_HEADER_SIZE + 4u, 3u);
+    ASSERT(attach(data) == rom::status::corrupt, "Name past the names")
+
+    // Both entries named "a"
+    data = good;
+    put_u32_at(data, rom::PACK_HEADER_SIZE + rom::PACK_ENTRY_SIZE, 0u);
+    ASSERT(attach(data) == rom::status::corrupt, "Names out of order")
+
+    data = good;
+    put_u32_at(data, rom::PACK_HEADER_SIZE + rom::PACK_ENTRY_SIZE + 20u, 0xE01u);
+    ASSERT(attach(data) == rom::status::corrupt, "ROM too large to load")
+
+    rom::pack missing;
+    ASSERT(rom::open(missing, temp_path("chipp8_no_such_pack.c8p").c_str()) == rom::status::unreadable, "Missing")
+}
+
+void run_rom_tests() {
+    test_rom_load_sizes();
+    test_rom_load_file();
+    test_rom_pack();
+    test_rom_pack_rejects();
+}
+
+} // namespace test
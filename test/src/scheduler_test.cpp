@@ -0,0 +1,75 @@
+#include "unittest.h"
+
+#include <chrono>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "scheduler.h"
+
+using namespace chipp8;
+
+namespace test {
+
+void test_scheduler_frame_split() {
+    timing::scheduler s;
+    timing::init(s, 700u, true);
+    uint64_t smallest = ~0ull;
+    uint64_t largest = 0u;
+    for (auto f = 0u; f < timing::TIMER_HZ; ++f) {
+        const auto n = timing::frame_cycles(s);
+        smallest = (n < smallest) ? n : smallest;
+        largest = (n > largest) ? n : largest;
+        s.instructions += n;
+        ++s.frame;
+    }
+    ASSERT(s.instructions == 700u, "One second of frames runs exactly the instruction rate")
+    ASSERT(smallest == 11u && largest == 12u, "The remainder is spread over the frames")
+}
+
+// Turbo and real time only differ in waiting, the machine ends up the same
+void test_scheduler_turbo_matches_real_time() {
+    chip8 start;
+    load_program(start, {
+        0x6A02u, // 200: LD vA, 2
+        0xFA15u, // 202: LD DT, vA
+        0xFB07u, // 204: LD vB, DT
+        0x3B00u, // 206: SE vB, 0
+        0x1204u, // 208: JP 204
+        0x7001u, // 20A: ADD v0, 1
+        0x1202u, // 20C: JP 202
+    });
+
+    chip8 turbo = start;
+    timing::scheduler fast;
+    timing::init(fast, 1000u, true);
+    timing::run(fast, turbo, 9u);
+
+    chip8 real_time = start;
+    timing::scheduler slow;
+    timing::init(slow, 1000u, false);
+    const auto begin = std::chrono::steady_clock::now();
+    timing::run(slow, real_time, 9u);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    ASSERT(turbo == real_time, "Turbo mode gives the same machine state")
+    ASSERT(fast.instructions == 150u && slow.instructions == 150u, "9 frames at 1000 Hz")
+    ASSERT(elapsed.count() >= 0.145, "Real time mode waits for 9 / 60 s")
+
+    // The same instruction counts by hand
+    chip8 expected = start;
+    uint64_t done = 0u;
+    for (auto f = 1u; f <= 9u; ++f) {
+        const auto total = timing::instructions_by(f, 1000u);
+        dispatch::run(expected, total - done);
+        done = total;
+        tick_timers(expected);
+    }
+    ASSERT(turbo == expected, "Frames are split exactly like the plain loop")
+}
+
+void run_scheduler_tests() {
+    test_scheduler_frame_split();
+    test_scheduler_turbo_matches_real_time();
+}
+
+} // namespace test
@@ -0,0 +1,126 @@
+#include "unittest.h"
+
+#include <chrono>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "keypad.h"
+#include "shm.h"
+
+using namespace chipp8;
+
+namespace test {
+
+constexpr const uint64_t SHM_FRAMES = 20'000u;
+
+// Every row of frame f holds the same value, so a copy torn between two
+// publishes shows up as rows that differ
+static uint64_t row_of(uint64_t f) {
+    return f * 0x9E3779B97F4A7C15ull;
+}
+
+// The reader process: checks every copy it gets, presses key 5 halfway
+// through and waits to see it come back in the published keys
+static int consumer(shm::region& r) {
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    bool pressed = false;
+    uint64_t last = 0u;
+    while (std::chrono::steady_clock::now() < give_up) {
+        const auto snap = shm::read(*r.seg);
+        for (const auto row: snap.pixels) {
+            if (row != row_of(snap.frame)) {
+                return 2;
+            }
+        }
+        if (snap.frame < last || snap.d_timer != static_cast<uint8_t>(snap.frame)) {
+            return 3;
+        }
+        last = snap.frame;
+        if (!pressed && snap.frame >= SHM_FRAMES / 2u) {
+            pressed = shm::send_key(*r.seg, 5u, true);
+        }
+        if (pressed && (snap.keys & static_cast<uint16_t>(keypad::Key::Key_5))) {
+            return 0;
+        }
+    }
+    return 4;
+}
+
+// The emulator process: publishes frames and applies the keys that come
+// back until the reader is done
+static int producer(shm::region& r, pid_t child) {
+    chip8 cpu;
+    init(cpu);
+    int status = -1;
+    for (uint64_t f = 1u;; ++f) {
+        cpu.pixels.fill(row_of(f));
+        cpu.d_timer = static_cast<uint8_t>(f);
+        keypad::event e;
+        while (keypad::peek(r.seg->input, e)) {
+            keypad::apply(cpu, e);
+            keypad::pop(r.seg->input);
+        }
+        shm::publish(*r.seg, cpu);
+        if (f >= SHM_FRAMES && waitpid(child, &status, WNOHANG) == child) {
+            break;
+        }
+    }
+    return (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+}
+
+void test_shm_named_two_processes() {
+    const std::string name = "/chipp8_shm_test_" + std::to_string(getpid());
+    shm::region r;
+    ASSERT(shm::create(r, name.c_str()), "Created")
+    shm::region again;
+    ASSERT(!shm::create(again, name.c_str()) && !again.seg, "Only once")
+
+    const pid_t child = fork();
+    if (child == 0) {
+        shm::region reader;
+        _exit(shm::attach(reader, name.c_str()) ? consumer(reader) : 1);
+    }
+    ASSERT(child > 0, "Forked")
+    ASSERT(producer(r, child) == 0, "The reader saw whole frames and its key got through")
+    ASSERT(shm::frame(*r.seg) >= SHM_FRAMES && (r.seg->sequence.load() & 1u) == 0u, "Published")
+    shm::close(r);
+
+    shm::region gone;
+    ASSERT(!shm::attach(gone, name.c_str()), "Unlinked by its creator")
+}
+
+void test_shm_memfd_two_processes() {
+    shm::region r;
+    ASSERT(shm::create(r, nullptr), "Created")
+    const pid_t child = fork();
+    if (child == 0) {
+        // The descriptor came with the fork
+        shm::region reader;
+        _exit(shm::attach(reader, r.fd) ? consumer(reader) : 1);
+    }
+    ASSERT(child > 0, "Forked")
+    ASSERT(producer(r, child) == 0, "The reader saw whole frames and its key got through")
+    shm::close(r);
+}
+
+void test_shm_refuses_other_files() {
+    char path[] = "/tmp/chipp8_shm_test_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd >= 0, "Temp file")
+    unlink(path);
+    shm::region r;
+    ASSERT(!shm::attach(r, fd), "Empty")
+    ASSERT(ftruncate(fd, sizeof(shm::segment)) == 0, "Sized")
+    ASSERT(!shm::attach(r, fd) && !r.seg && r.fd == -1, "No magic")
+    close(fd);
+}
+
+void run_shm_tests() {
+    test_shm_named_two_processes();
+    test_shm_memfd_two_processes();
+    test_shm_refuses_other_files();
+}
+
+} // namespace test
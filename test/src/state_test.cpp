@@ -0,0 +1,143 @@
+#include "unittest.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "quirks.h"
+#include "state.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// A machine mid game: a program that draws, calls, counts and draws CXNN
+static chip8 busy_machine() {
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+    seed_rng(cpu, 77u, 3u);
+    const uint16_t words[] = {
+        0x2208u, // 200: CALL 208
+        0xC0FFu, // 202: RND v0, 0xFF
+        0xD015u, // 204: DRW v0, v1, 5
+        0x1200u, // 206: JP 200
+        0x7101u, // 208: ADD v1, 1
+        0xF115u, // 20A: LD DT, v1
+        0x00EEu, // 20C: RET
+    };
+    auto addr = PROGRAM_START_ADDR;
+    for (const auto word: words) {
+        cpu.mem[addr++] = static_cast<uint8_t>(word >> 8u);
+        cpu.mem[addr++] = static_cast<uint8_t>(word & 0x00FFu);
+    }
+    cpu.pc = PROGRAM_START_ADDR;
+    dispatch::run(cpu, 1'001u);
+    cpu.keys = 0x0810u;
+    return cpu;
+}
+
+// Rewrite the checksum after editing the payload of data
+static void reseal(std::vector<uint8_t>& data) {
+    state::put_u32(data.data() + 20u, state::checksum(data.data() + state::HEADER_SIZE, sizeof(chip8)));
+}
+
+void test_state_round_trip() {
+    const auto cpu = busy_machine();
+    const auto data = state::encode(cpu);
+    ASSERT(data.size() == state::FILE_SIZE, "Header and payload")
+    chip8 loaded;
+    init(loaded);
+    ASSERT(state::load(data.data(), data.size(), loaded) == state::status::ok, "Loads")
+    ASSERT(loaded == cpu, "The same machine")
+
+    // It carries on exactly where it was saved
+    auto expected = cpu;
+    dispatch::run(expected, 500u);
+    dispatch::run(loaded, 500u);
+    ASSERT(loaded == expected, "Runs on the same")
+
+    ASSERT(state::encode(cpu) == data, "Equal machines give equal files")
+    ASSERT(state::encode<quirks::cosmac_vip>(cpu)[8u] == state::quirk_bits<quirks::cosmac_vip>(), "Quirks recorded")
+}
+
+void test_state_rejects() {
+    const auto cpu = busy_machine();
+    const auto good = state::encode(cpu);
+    chip8 out;
+    auto load = [&](const std::vector<uint8_t>& data) { return state::load(data.data(), data.size(), out); };
+
+    for (const size_t size: {0ul, 3ul, 63ul, 64ul, state::FILE_SIZE - 1u}) {
+        const std::vector<uint8_t> cut(good.begin(), good.begin() + size);
+        ASSERT(load(cut) == state::status::truncated, "Cut short")
+    }
+
+    auto data = good;
+    data[1u] = 'X';
+    ASSERT(load(data) == state::status::not_a_state, "Wrong magic")
+
+    data = good;
+    data[4u] = static_cast<uint8_t>(state::VERSION + 1u);
+    ASSERT(load(data) == state::status::future_version, "Newer version")
+    data[4u] = 0u;
+    data[5u] = 1u;
+    ASSERT(load(data) == state::status::future_version, "Much newer version")
+
+    data = good;
+    state::put_u32(data.data() + 16u, state::layout_fingerprint() + 1u);
+    ASSERT(load(data) == state::status::other_layout, "Other layout")
+    data = good;
+    state::put_u32(data.data() + 12u, sizeof(chip8) + 8u);
+    ASSERT(load(data) == state::status::other_layout, "Other payload size")
+
+    ASSERT(state::load<quirks::super_chip>(good.data(), good.size(), out) == state::status::other_quirks, "Other profile")
+
+    data = good;
+    data[state::HEADER_SIZE + offsetof(chip8, mem) + 0x300u] ^= 1u;
+    ASSERT(load(data) == state::status::corrupt, "A flipped bit")
+
+    data = good;
+    data[state::HEADER_SIZE + offsetof(chip8, sp)] = 16u;
+    reseal(data);
+    ASSERT(load(data) == state::status::out_of_bounds, "sp past the stack")
+    data = good;
+    data[state::HEADER_SIZE + offsetof(chip8, pc) + 1u] = 0x10u;
+    reseal(data);
+    ASSERT(load(data) == state::status::out_of_bounds, "pc past mem")
+    data = good;
+    data[state::HEADER_SIZE + offsetof(chip8, stack) + 31u] = 0xF0u;
+    reseal(data);
+    ASSERT(load(data) == state::status::out_of_bounds, "Return address past mem")
+
+    ASSERT(load(good) == state::status::ok, "The original still loads")
+}
+
+void test_state_map_in_place() {
+    const auto path = (std::filesystem::temp_directory_path() / "chipp8_state_test.c8s").string();
+    const auto cpu = busy_machine();
+    ASSERT(state::save(cpu, path.c_str()), "Saved")
+    state::mapping m;
+    ASSERT(state::map(m, path.c_str()) == state::status::ok, "Mapped")
+    ASSERT(state::in_place(m) == cpu, "Read in place")
+    chip8 copy;
+    state::restore(m.data, copy);
+    ASSERT(copy == cpu, "Restored with one copy")
+    state::unmap(m);
+    ASSERT(!m.data, "Unmapped")
+
+    ASSERT(state::map<quirks::xo_chip>(m, path.c_str()) == state::status::other_quirks && !m.data, "Unmapped on failure")
+    std::filesystem::resize_file(path, 10u);
+    ASSERT(state::map(m, path.c_str()) == state::status::truncated, "Cut short")
+    std::filesystem::remove(path);
+    ASSERT(state::map(m, path.c_str()) == state::status::unreadable, "Missing")
+}
+
+void run_state_tests() {
+    test_state_round_trip();
+    test_state_rejects();
+    test_state_map_in_place();
+}
+
+} // namespace test
@@ -0,0 +1,189 @@
+#include "unittest.h"
+
+#include <array>
+#include <bit>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "terminal.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// The part of a terminal the renderer uses: cursor moves, clearing, and
+// ASCII or 3 byte UTF-8 characters
+struct screen {
+    std::array<std::array<uint32_t, 80u>, 40u> cells;
+    uint32_t line;
+    uint32_t column;
+};
+
+static void clear(screen& s) {
+    for (auto& row: s.cells) {
+        row.fill(' ');
+    }
+    s.line = 0u;
+    s.column = 0u;
+}
+
+static bool feed(screen& s, const char* data, size_t n) {
+    size_t k = 0u;
+    auto number = [&] {
+        uint32_t value = 0u;
+        while (k < n && data[k] >= '0' && data[k] <= '9') {
+            value = value * 10u + static_cast<uint32_t>(data[k++] - '0');
+        }
+        return value;
+    };
+    while (k < n) {
+        const auto c = static_cast<uint8_t>(data[k]);
+        if (c == 0x1Bu) {
+            if (k + 1u >= n || data[k + 1u] != '[') {
+                return false;
+            }
+            k += 2u;
+            if (data[k] == '?') {
+                ++k;
+                number();
+                ++k; // h or l
+                continue;
+            }
+            const auto a = number();
+            if (data[k] == 'J') {
+                clear(s);
+                ++k;
+                continue;
+            }
+            if (data[k] != ';') {
+                return false;
+            }
+            ++k;
+            const auto b = number();
+            if (data[k++] != 'H') {
+                return false;
+            }
+            s.line = a - 1u;
+            s.column = b - 1u;
+            continue;
+        }
+        uint32_t code = c;
+        if (c >= 0x80u) {
+            if (k + 2u >= n) {
+                return false;
+            }
+            code = ((c & 0x0Fu) << 12u) | ((static_cast<uint8_t>(data[k + 1u]) & 0x3Fu) << 6u) |
+                   (static_cast<uint8_t>(data[k + 2u]) & 0x3Fu);
+            k += 2u;
+        }
+        ++k;
+        s.cells[s.line][s.column++] = code;
+    }
+    return true;
+}
+
+// The display as the terminal should show it at (top, left)
+static bool shows(const screen& s, const display& pixels, terminal::mode style, uint32_t top, uint32_t left) {
+    for (auto y = 0u; y < DISPLAY_HEIGHT; ++y) {
+        for (auto x = 0u; x < DISPLAY_WIDTH; ++x) {
+            const bool on = (pixels[y] >> (63u - x)) & 1u;
+            if (style == terminal::mode::ascii) {
+                if (s.cells[top + y][left + x] != (on ? '#' : ' ')) {
+                    return false;
+                }
+                continue;
+            }
+            if (y & 1u) {
+                continue;
+            }
+            const bool below = (pixels[y + 1u] >> (63u - x)) & 1u;
+            const uint32_t expected = on ? (below ? 0x2588u : 0x2580u) : (below ? 0x2584u : ' ');
+            if (s.cells[top + y / 2u][left + x] != expected) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Pseudo random sprite draws, the way a game changes its display
+static void scribble(display& pixels, uint32_t& state, unsigned draws) {
+    for (auto d = 0u; d < draws; ++d) {
+        state = state * 1664525u + 1013904223u;
+        const auto x = (state >> 8u) % DISPLAY_WIDTH;
+        const auto y = (state >> 16u) % DISPLAY_HEIGHT;
+        for (auto row = 0u; row < 5u; ++row) {
+            pixels[(y + row) % DISPLAY_HEIGHT] ^= std::rotr(static_cast<uint64_t>((state >> row) & 0xFFu) << 56u, x);
+        }
+    }
+}
+
+void test_terminal_matches_frames() {
+    for (const auto style: {terminal::mode::ascii, terminal::mode::half_blocks}) {
+        terminal::renderer r;
+        terminal::init(r, style, -1, 3u, 5u);
+        screen s;
+        clear(s);
+        display pixels{};
+        uint32_t state = 7u;
+        for (auto frame = 0u; frame < 200u; ++frame) {
+            scribble(pixels, state, frame % 4u);
+            const auto n = terminal::compose(r, pixels);
+            ASSERT(n <= terminal::MAX_FRAME_BYTES, "Fits the buffer")
+            ASSERT(feed(s, r.buffer.data(), n), "Well formed escapes")
+            ASSERT(shows(s, pixels, style, 2u, 4u), "The terminal shows the frame")
+            if (frame % 4u == 0u && frame > 0u) {
+                ASSERT(n == 0u, "An unchanged frame sends nothing")
+            }
+        }
+        pixels.fill(~0ull);
+        ASSERT(feed(s, r.buffer.data(), terminal::compose(r, pixels)) && shows(s, pixels, style, 2u, 4u), "Everything on")
+        terminal::invalidate(r);
+        clear(s);
+        ASSERT(feed(s, r.buffer.data(), terminal::compose(r, pixels)) && shows(s, pixels, style, 2u, 4u), "Redrawn in full")
+    }
+}
+
+void test_terminal_small_changes() {
+    terminal::renderer r;
+    terminal::init(r, terminal::mode::half_blocks, -1);
+    display pixels{};
+    terminal::compose(r, pixels);
+
+    pixels[9u] |= 1ull << 40u;
+    const auto n = terminal::compose(r, pixels);
+    ASSERT(n == 7u + 3u, "One pixel is a cursor move and one character")
+
+    // Two pixels a few cells apart go out as one run
+    pixels[20u] |= (1ull << 60u) | (1ull << 57u);
+    const auto run = terminal::compose(r, pixels);
+    ASSERT(run == 7u + 3u + 1u + 1u + 3u, "One move, the run rewrites the cells between")
+
+    // Far apart they get a move each
+    pixels[20u] |= (1ull << 2u);
+    pixels[20u] &= ~((1ull << 60u) | (1ull << 57u));
+    const auto apart = terminal::compose(r, pixels);
+    ASSERT(apart == 7u + 4u + 8u + 3u, "Two moves")
+}
+
+void test_terminal_present() {
+    const int fd = open("/dev/null", O_WRONLY);
+    terminal::renderer r;
+    terminal::init(r, terminal::mode::ascii, fd);
+    display pixels{};
+    pixels[0u] = 0xF0ull << 56u;
+    ASSERT(terminal::present(r, pixels), "Written")
+    close(fd);
+    terminal::init(r, terminal::mode::ascii, -1);
+    ASSERT(!terminal::present(r, pixels) && !r.drawn, "A failed write draws everything next time")
+}
+
+void run_terminal_tests() {
+    test_terminal_matches_frames();
+    test_terminal_small_changes();
+    test_terminal_present();
+}
+
+} // namespace test
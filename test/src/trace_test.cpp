@@ -0,0 +1,181 @@
+#include "unittest.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "dispatch.h"
+#include "trace.h"
+
+using namespace chipp8;
+
+namespace test {
+
+// Touches every kind of change a record can carry
+static void load_busy(chip8& cpu) {
+    load_program(cpu, {
+        0xA300u, // 200: LD I, 0x300
+        0x6A7Bu, // 202: LD vA, 123
+        0xFA33u, // 204: LD B, vA
+        0x2210u, // 206: CALL 210
+        0x7001u, // 208: ADD v0, 1
+        0x7A05u, // 20A: ADD vA, 5
+        0x1204u, // 20C: JP 204
+        0x0000u, // 20E:
+        0x6105u, // 210: LD v1, 5
+        0xF115u, // 212: LD DT, v1
+        0x8121u, // 214: OR v1, v2
+        0xA300u, // 216: LD I, 0x300
+        0xF255u, // 218: LD [I], v0..v2
+        0xF165u, // 21A: LD v0..v1, [I]
+        0x00EEu, // 21C: RET
+    });
+}
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Apply rec to the registers and mem of shadow
+static void apply(chip8& shadow, const trace::record& rec) {
+    for (auto k = 0u; k < 16u; ++k) {
+        if (rec.v_mask & (1u << k)) {
+            shadow.v[k] = rec.v[k];
+        }
+    }
+    if (rec.flags & trace::CHANGED_I) {
+        shadow.i = rec.i;
+    }
+    for (auto b = 0u; b < rec.mem_len; ++b) {
+        shadow.mem[rec.mem_addr + b] = rec.mem[b];
+    }
+    if (rec.flags & trace::CHANGED_TIMERS) {
+        shadow.d_timer = rec.d_timer;
+        shadow.s_timer = rec.s_timer;
+    }
+    if (rec.flags & trace::CHANGED_SP) {
+        shadow.sp = rec.sp;
+        shadow.stack[rec.sp] = rec.stack_top;
+    }
+}
+
+// Records carry what each op of profile Q writes, vF from OR on the VIP,
+// I from FX55/FX65 on the VIP and XO-CHIP
+template <typename Q>
+static void check_round_trip(const char* name) {
+    const auto path = temp_path(name);
+    constexpr uint64_t CYCLES = 5'000u;
+
+    chip8 cpu;
+    load_busy(cpu);
+    {
+        trace::writer w;
+        ASSERT(trace::open(w, path.c_str(), 1000u, 64u, 1u), "The trace opens")
+        // The smallest ring wraps many times over the run
+        trace::run<Q>(w, cpu, CYCLES);
+        ASSERT(trace::close(w), "and closes cleanly")
+        ASSERT(w.index.size() == CYCLES / 64u + 1u, "One index entry every 64 records")
+    }
+
+    chip8 ref;
+    load_busy(ref);
+    chip8 shadow = ref;
+    trace::reader r;
+    ASSERT(trace::open(r, path.c_str()), "The trace reads back")
+    ASSERT(r.start_cycle == 1000u && r.index_interval == 64u, "Header fields")
+    trace::record rec;
+    for (uint64_t c = 0u; c < CYCLES; ++c) {
+        ASSERT(trace::next(r, rec), "A record per instruction")
+        ASSERT(rec.cycle == 1000u + c, "Cycles count from the start cycle")
+        ASSERT(rec.pc == ref.pc && rec.instruct == fetch(ref), "pc and word")
+        dispatch::step<Q>(ref);
+        apply(shadow, rec);
+        ASSERT(shadow.v == ref.v && shadow.i == ref.i && shadow.sp == ref.sp, "Register deltas")
+        ASSERT(shadow.d_timer == ref.d_timer && shadow.stack == ref.stack, "Timer and stack deltas")
+        ASSERT(shadow.mem == ref.mem, "mem deltas")
+    }
+    ASSERT(!trace::next(r, rec), "Nothing past the last instruction")
+    ASSERT(ref == cpu, "Tracing does not change the run")
+    std::filesystem::remove(path);
+}
+
+void test_trace_round_trip() {
+    check_round_trip<quirks::modern>("chipp8_trace_test.c8t");
+    check_round_trip<quirks::cosmac_vip>("chipp8_trace_vip.c8t");
+    check_round_trip<quirks::xo_chip>("chipp8_trace_xo.c8t");
+}
+
+// A field the op writes is in the record even when its value stays, and
+// the record of an op that writes nothing is the flags and the word
+void test_trace_written_fields() {
+    const auto path = temp_path("chipp8_trace_fields.c8t");
+    chip8 cpu;
+    load_program(cpu, {
+        0x6000u, // 200: LD v0, 0
+        0x3001u, // 202: SE v0, 1
+        0x8006u, // 204: SHR v0
+    });
+    {
+        trace::writer w;
+        ASSERT(trace::open(w, path.c_str()), "The trace opens")
+        trace::run(w, cpu, 3u);
+    }
+    trace::reader r;
+    ASSERT(trace::open(r, path.c_str()), "The trace reads back")
+    trace::record rec;
+    ASSERT(trace::next(r, rec) && rec.flags == (trace::HAS_PC | trace::CHANGED_V) && rec.v_mask == 0x0001u,
+        "LD v0, 0 over 0")
+    ASSERT(trace::next(r, rec) && rec.flags == 0u, "SE writes nothing")
+    ASSERT(trace::next(r, rec) && rec.v_mask == 0x8001u && rec.v[0u] == 0u && rec.v[0xFu] == 0u, "SHR writes v0 and vF")
+    std::filesystem::remove(path);
+}
+
+void test_trace_seek() {
+    const auto path = temp_path("chipp8_trace_seek.c8t");
+    chip8 cpu;
+    load_busy(cpu);
+    std::vector<uint16_t> pcs;
+    {
+        chip8 ref = cpu;
+        for (auto c = 0u; c < 3'000u; ++c) {
+            pcs.push_back(ref.pc);
+            dispatch::step(ref);
+        }
+        trace::writer w;
+        ASSERT(trace::open(w, path.c_str(), 0u, 100u), "The trace opens")
+        trace::run(w, cpu, 3'000u);
+    }
+
+    trace::reader r;
+    ASSERT(trace::open(r, path.c_str()), "Closing on destruction leaves a whole trace")
+    trace::record rec;
+    for (const uint64_t cycle: {2'999u, 0u, 1'234u, 100u, 99u}) {
+        ASSERT(trace::seek(r, cycle), "Seek into the trace")
+        ASSERT(trace::next(r, rec) && rec.cycle == cycle && rec.pc == pcs[cycle], "lands on that cycle")
+    }
+    ASSERT(!trace::seek(r, 3'000u), "Past the end")
+    std::filesystem::remove(path);
+}
+
+void test_trace_rejects() {
+    const auto path = temp_path("chipp8_trace_bad.c8t");
+    FILE* f = fopen(path.c_str(), "wb");
+    fputs("not a trace at all", f);
+    fclose(f);
+    trace::reader r;
+    ASSERT(!trace::open(r, path.c_str()), "A file that is not a trace")
+    ASSERT(!trace::open(r, "/nonexistent/dir/trace.c8t"), "A file that is not there")
+    trace::writer w;
+    ASSERT(!trace::open(w, "/nonexistent/dir/trace.c8t"), "A file that cannot be written")
+    std::filesystem::remove(path);
+}
+
+void run_trace_tests() {
+    test_trace_round_trip();
+    test_trace_written_fields();
+    test_trace_seek();
+    test_trace_rejects();
+}
+
+} // namespace test
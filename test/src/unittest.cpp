@@ -1,15 +1,7 @@
 #include "unittest.h"
 
-#include <cassert>
-
 #include "chip8.h"
 
-#define ASSERT(condition, message) \
-   do { \
-      assert(condition && #message); \
-   } while (0);
-
-
 using namespace chipp8;
 
 namespace test {
@@ -47,9 +39,96 @@ void test_push_stack() {
     ASSERT(cpu.stack[cpu.sp] == 9u, "The stack pointer now points to the value 9")
 }
 
+void test_drw() {
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+
+    cpu.v[1u] = 2u;
+    cpu.v[2u] = 3u;
+    cpu.i = FONT_START_ADDR; // 0: F0 90 90 90 F0
+    DRW(cpu, 1u, 2u, 5u);
+
+    ASSERT(cpu.v[0xFu] == 0u, "Nothing was erased")
+    ASSERT(cpu.pixels[3u] == (0xF0ull << 54u), "Top of the 0 is at x 2..5")
+    ASSERT(cpu.pixels[4u] == (0x90ull << 54u), "Sides of the 0")
+    ASSERT(cpu.pixels[7u] == (0xF0ull << 54u), "Bottom of the 0")
+    ASSERT(cpu.pixels[8u] == 0u, "Only 5 rows are drawn")
+    ASSERT(get_pixel(cpu, 2u, 3u) && !get_pixel(cpu, 3u, 4u), "get_pixel reads the rows")
+
+    // Drawing again erases it and reports the collision
+    DRW(cpu, 1u, 2u, 5u);
+    ASSERT(cpu.v[0xFu] == 1u, "Pixels were erased")
+    for (const auto row: cpu.pixels) {
+        ASSERT(row == 0u, "The display is blank again")
+    }
+}
+
+void test_drw_wraps() {
+    chip8 cpu;
+    init(cpu);
+    cpu.mem[0x300u] = 0xFFu;
+    cpu.mem[0x301u] = 0x81u;
+    cpu.i = 0x300u;
+
+    cpu.v[0u] = 60u + 64u; // Wraps x before drawing too
+    cpu.v[1u] = 31u;
+    DRW(cpu, 0u, 1u, 2u);
+
+    ASSERT(cpu.pixels[31u] == 0xF00000000000000Full, "Row 31 wraps from x 60 to 3")
+    ASSERT(cpu.pixels[0u] == 0x1000000000000008ull, "The second row wraps to the top")
+    ASSERT(cpu.v[0xFu] == 0u, "No collision")
+}
+
+void test_cls() {
+    chip8 cpu;
+    init(cpu);
+    cpu.pixels[5u] = 0xFFu;
+    CLS(cpu);
+    ASSERT(cpu.pixels[5u] == 0u, "The display is cleared")
+}
+
+constexpr uint64_t constexpr_draw() {
+    chip8 cpu;
+    init(cpu);
+    load_font_sprites(cpu);
+    cpu.i = FONT_START_ADDR + sprites::FONT_SIZE * 7u; // 7: F0 10 20 40 40
+    DRW(cpu, 0u, 0u, 5u);
+    return cpu.pixels[2u];
+}
+
+static_assert(constexpr_draw() == (0x20ull << 56u), "DRW can run at compile time");
+
 void run_tests() {
     test_pop_stack();
     test_push_stack();
+    test_drw();
+    test_drw_wraps();
+    test_cls();
+
+    run_dispatch_tests();
+    run_block_cache_tests();
+    run_batch_tests();
+    run_fleet_tests();
+    run_idle_tests();
+    run_scheduler_tests();
+    run_rewind_tests();
+    run_cow_tests();
+    run_replay_tests();
+    run_rng_tests();
+    run_quirks_tests();
+    run_hires_tests();
+    run_profile_tests();
+    run_trace_tests();
+    run_debug_tests();
+    run_keypad_tests();
+    run_terminal_tests();
+    run_capture_tests();
+    run_shm_tests();
+    run_blit_tests();
+    run_state_tests();
+    run_rom_tests();
+    run_aot_tests();
 }
 
 } // namespace test
@@ -1,7 +1,75 @@
 #pragma once
 
+#include <cassert>
+#include <initializer_list>
+#include <stdint.h>
+#include <vector>
+
+#define ASSERT(condition, message) \
+   do { \
+      assert(condition && #message); \
+   } while (0);
+
 namespace test {
 
+// Load big-endian instruction words with the load_program of the machine
+// type, chip8 or hires::machine, found through its namespace
+template <typename Machine>
+inline void load_program(Machine& m, std::initializer_list<uint16_t> words) {
+    std::vector<uint8_t> bytes;
+    for (const auto word: words) {
+        bytes.push_back(static_cast<uint8_t>(word >> 8u));
+        bytes.push_back(static_cast<uint8_t>(word & 0x00FFu));
+    }
+    load_program(m, bytes.data(), bytes.size());
+}
+
 void run_tests();
 
+void run_dispatch_tests();
+
+void run_block_cache_tests();
+
+void run_batch_tests();
+
+void run_fleet_tests();
+
+void run_idle_tests();
+
+void run_scheduler_tests();
+
+void run_rewind_tests();
+
+void run_cow_tests();
+
+void run_replay_tests();
+
+void run_rng_tests();
+
+void run_quirks_tests();
+
+void run_hires_tests();
+
+void run_profile_tests();
+
+void run_trace_tests();
+
+void run_debug_tests();
+
+void run_keypad_tests();
+
+void run_terminal_tests();
+
+void run_capture_tests();
+
+void run_shm_tests();
+
+void run_blit_tests();
+
+void run_state_tests();
+
+void run_rom_tests();
+
+void run_aot_tests();
+
 } // namespace test